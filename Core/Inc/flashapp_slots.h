@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "sha256.h"
+
+/**
+ * Chunk slots of the pipelined flashapp protocol. The host
+ * (scripts/flashapp.sh) loads chunk N in slot (N - 1) % FLASHAPP_SLOT_COUNT
+ * while the flashapp erases and programs the previous chunk from the other
+ * slot. It raises program_slot_loaded as the data arrives, fills in the
+ * descriptor and sets program_slot_ready last. The flashapp hashes the data
+ * as it arrives and releases the slot once its chunk is verified in flash.
+ *
+ * The host writes the slots over the debug port, behind the D-cache:
+ * flashapp_slots_invalidate() is called on each range before it is hashed.
+ *
+ * No dependency on the HAL so the protocol can run on the host against a
+ * stub of the debugger.
+ */
+
+#define FLASHAPP_SLOT_COUNT 2
+#define FLASHAPP_SLOT_SIZE  (416 * 1024)
+
+// Chunk descriptors, read and written by the host by name
+extern uint32_t program_slot_ready[FLASHAPP_SLOT_COUNT];
+extern uint32_t program_slot_loaded[FLASHAPP_SLOT_COUNT];
+extern uint32_t program_slot_size[FLASHAPP_SLOT_COUNT];
+extern uint32_t program_slot_address[FLASHAPP_SLOT_COUNT];
+extern uint32_t program_slot_erase[FLASHAPP_SLOT_COUNT];
+extern int32_t  program_slot_erase_bytes[FLASHAPP_SLOT_COUNT];
+extern uint8_t  program_slot_sha256[FLASHAPP_SLOT_COUNT][65];
+
+// Releases all the slots, `buffer` holds them back to back
+void flashapp_slots_init(uint8_t *buffer);
+
+uint8_t *flashapp_slot_buffer(uint32_t slot);
+uint32_t flashapp_slot_for_chunk(uint32_t chunk_idx);
+
+// Hands the slot back to the host for the chunk after the next one
+void flashapp_slot_release(uint32_t slot);
+
+// Hashes up to `max_bytes` of the data that arrived in the slot since the last call
+void flashapp_slot_hash(uint32_t slot, uint32_t max_bytes);
+
+/**
+ * Hashes what is left of the chunk in the slot. Returns its running hash,
+ * or NULL when the host flagged the slot ready before loading `size` bytes.
+ */
+SHA256_CTX *flashapp_slot_sha256(uint32_t slot, uint32_t size);
+
+// Provided by the caller: drops the cached copy of a range written by the host
+void flashapp_slots_invalidate(const void *addr, uint32_t size);
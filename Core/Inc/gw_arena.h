@@ -0,0 +1,62 @@
+#ifndef _GW_ARENA_H_
+#define _GW_ARENA_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Bump allocator over a fixed memory region, with mark/release scopes and
+ * usage accounting.
+ *
+ * Allocations are served linearly from the start of the region. A mark is
+ * the current fill level, releasing to a mark frees everything allocated
+ * after it. The region keeps its peak usage across releases, and so does
+ * every caller tag, so the headroom of a region can be read after a session.
+ *
+ * There is no dependency on the HAL so it can be built for the host with a
+ * plain buffer as region.
+ */
+
+#define GW_ARENA_ALIGN      8
+#define GW_ARENA_MAX_TAGS   16
+#define GW_ARENA_MAX_ALLOCS 64
+
+typedef struct {
+    const char *name;
+    size_t      used;
+    size_t      peak;
+} gw_arena_tag_t;
+
+typedef struct {
+    size_t  offset;
+    size_t  size;
+    uint8_t tag;
+} gw_arena_alloc_t;
+
+typedef struct {
+    const char      *name;
+    uint8_t         *base;
+    size_t           size;
+    size_t           used;
+    size_t           peak;          // Highest used since gw_arena_init()
+    size_t           session_peak;  // Highest used since the last release to 0
+    size_t           alloc_count;
+    gw_arena_alloc_t allocs[GW_ARENA_MAX_ALLOCS];
+    size_t           tag_count;
+    gw_arena_tag_t   tags[GW_ARENA_MAX_TAGS];
+} gw_arena_t;
+
+void gw_arena_init(gw_arena_t *arena, const char *name, void *base, size_t size);
+
+// Returns NULL if the region is full. tag is kept as a pointer and must be static.
+void *gw_arena_alloc(gw_arena_t *arena, size_t size, const char *tag);
+
+size_t gw_arena_mark(const gw_arena_t *arena);
+void gw_arena_release(gw_arena_t *arena, size_t mark);
+
+size_t gw_arena_free(const gw_arena_t *arena);
+
+// Prints the usage of the region and of every tag with printf
+void gw_arena_report(const gw_arena_t *arena);
+
+#endif
@@ -21,6 +21,12 @@ bool OSPI_Erase(uint32_t *address, uint32_t *size);
 void OSPI_EraseSync(uint32_t address, uint32_t size);
 
 void OSPI_PageProgram(uint32_t address, const uint8_t *buffer, size_t buffer_size);
+
+// Sends the page and returns while the flash programs it. The next OSPI_*
+// call waits for it to be done, OSPI_WaitReady() can be used to wait explicitly.
+void OSPI_PageProgramStart(uint32_t address, const uint8_t *buffer, size_t buffer_size);
+void OSPI_WaitReady(void);
+
 void OSPI_NOR_WriteEnable(void);
 void OSPI_Program(uint32_t address, const uint8_t *buffer, size_t buffer_size);
 
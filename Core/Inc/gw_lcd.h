@@ -3,24 +3,19 @@
 
 #include "stm32h7xx_hal.h"
 #include <stdint.h>
+#include "lcd_lut8.h"
 
 #define GW_LCD_WIDTH  320
 #define GW_LCD_HEIGHT 240
 
-#ifdef GW_LCD_MODE_LUT8
-extern uint8_t framebuffer1[GW_LCD_WIDTH * GW_LCD_HEIGHT]  __attribute__((section (".lcd1"))) __attribute__ ((aligned (16)));
-extern uint8_t framebuffer2[GW_LCD_WIDTH * GW_LCD_HEIGHT]  __attribute__((section (".lcd2"))) __attribute__ ((aligned (16)));
-typedef uint8_t pixel_t;
-#else
 extern uint16_t framebuffer1[GW_LCD_WIDTH * GW_LCD_HEIGHT]  __attribute__((section (".lcd1"))) __attribute__ ((aligned (16)));
 extern uint16_t framebuffer2[GW_LCD_WIDTH * GW_LCD_HEIGHT]  __attribute__((section (".lcd2"))) __attribute__ ((aligned (16)));
 typedef uint16_t pixel_t;
-#endif // GW_LCD_MODE_LUT8
 
 // 0 => framebuffer1
 // 1 => framebuffer2
 extern uint32_t active_framebuffer;
-extern uint32_t frame_counter;
+extern volatile uint32_t frame_counter;
 
 void lcd_deinit(SPI_HandleTypeDef *spi);
 void lcd_init(SPI_HandleTypeDef *spi, LTDC_HandleTypeDef *ltdc);
@@ -35,6 +30,20 @@ void lcd_set_buffers(uint16_t *buf1, uint16_t *buf2);
 void lcd_wait_for_vblank(void);
 uint32_t is_lcd_swap_pending(void);
 
+/**
+ * Pixel format of the frame drawn in the active buffer. A LUT8 frame holds
+ * GW_LCD_WIDTH * GW_LCD_HEIGHT palette indices, expanded through the palette
+ * of lcd_lut8.h. The buffer is cleared when its format changes, and the LTDC
+ * switches format and uploads the palette changes at the vertical blanking
+ * that shows the frame.
+ */
+void lcd_set_pixel_format(lcd_pixel_format_t format);
+lcd_pixel_format_t lcd_get_pixel_format(void);
+lcd_pixel_format_t lcd_get_buffer_pixel_format(const void *buffer);
+
+// Expands the LUT8 buffers to RGB565, before drawing menus or reading the framebuffer
+void lcd_restore_rgb565(void);
+
 // To be used by fault handlers
 void lcd_reset_active_buffer(void);
 
@@ -28,8 +28,11 @@ extern uint32_t __ram_exec_end__;
 extern uint32_t _sitcram_hot;
 extern uint32_t __itcram_hot_start__;
 extern uint32_t __itcram_hot_end__;
+extern uint8_t __itcram_emu_start__[];
 extern uint8_t __configflash_start__;
 extern uint8_t __configflash_end__;
+extern uint8_t __configflash2_start__;
+extern uint8_t __configflash2_end__;
 extern uint8_t __cacheflash_start__;
 extern uint8_t __cacheflash_end__;
 extern uint8_t __fbflash_start__;
@@ -79,6 +82,43 @@ extern uint8_t _OVERLAY_AMSTRAD_SIZE;
 extern void * _OVERLAY_AMSTRAD_BSS_START[];
 extern uint8_t _OVERLAY_AMSTRAD_BSS_SIZE;
 
+// Per emulator ITCM overlays, loaded at __itcram_emu_start__ by emulator_start().
+// Use these in the emulator sources (build/<emu>/*.o) for the hottest paths.
+#define ITCM_EMU_TEXT __attribute__((section(".itcram_emu_text")))
+#define ITCM_EMU_DATA __attribute__((section(".itcram_emu_data")))
+#define ITCM_EMU_BSS  __attribute__((section(".itcram_emu_bss")))
+
+extern void * _ITCRAM_NES_LOAD_START[];
+extern uint8_t _ITCRAM_NES_SIZE;
+extern uint8_t _ITCRAM_NES_BSS_SIZE;
+extern void * _ITCRAM_GB_LOAD_START[];
+extern uint8_t _ITCRAM_GB_SIZE;
+extern uint8_t _ITCRAM_GB_BSS_SIZE;
+extern void * _ITCRAM_SMS_LOAD_START[];
+extern uint8_t _ITCRAM_SMS_SIZE;
+extern uint8_t _ITCRAM_SMS_BSS_SIZE;
+extern void * _ITCRAM_PCE_LOAD_START[];
+extern uint8_t _ITCRAM_PCE_SIZE;
+extern uint8_t _ITCRAM_PCE_BSS_SIZE;
+extern void * _ITCRAM_MSX_LOAD_START[];
+extern uint8_t _ITCRAM_MSX_SIZE;
+extern uint8_t _ITCRAM_MSX_BSS_SIZE;
+extern void * _ITCRAM_WSV_LOAD_START[];
+extern uint8_t _ITCRAM_WSV_SIZE;
+extern uint8_t _ITCRAM_WSV_BSS_SIZE;
+extern void * _ITCRAM_GW_LOAD_START[];
+extern uint8_t _ITCRAM_GW_SIZE;
+extern uint8_t _ITCRAM_GW_BSS_SIZE;
+extern void * _ITCRAM_MD_LOAD_START[];
+extern uint8_t _ITCRAM_MD_SIZE;
+extern uint8_t _ITCRAM_MD_BSS_SIZE;
+extern void * _ITCRAM_A7800_LOAD_START[];
+extern uint8_t _ITCRAM_A7800_SIZE;
+extern uint8_t _ITCRAM_A7800_BSS_SIZE;
+extern void * _ITCRAM_AMSTRAD_LOAD_START[];
+extern uint8_t _ITCRAM_AMSTRAD_SIZE;
+extern uint8_t _ITCRAM_AMSTRAD_BSS_SIZE;
+
 extern uint8_t *_NES_ROM_UNPACK_BUFFER;
 extern uint8_t _NES_ROM_UNPACK_BUFFER_SIZE;
 
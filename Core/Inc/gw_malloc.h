@@ -3,12 +3,30 @@
 
 #include <stdint.h>
 #include <stddef.h>
+
+// The calling function is used as tag in the usage report
+#define ahb_malloc(size)        ahb_malloc_tag((size), __func__)
+#define ahb_calloc(count, size) ahb_calloc_tag((count), (size), __func__)
+#define itc_malloc(size)        itc_malloc_tag((size), __func__)
+#define itc_calloc(count, size) itc_calloc_tag((count), (size), __func__)
+
 void ahb_init();
-void *ahb_malloc(size_t size);
-void *ahb_calloc(size_t count,size_t size);
+void *ahb_malloc_tag(size_t size, const char *tag);
+void *ahb_calloc_tag(size_t count,size_t size, const char *tag);
+size_t ahb_mark();
+void ahb_release(size_t mark);
 
 void itc_init();
-void *itc_malloc(size_t size);
-void *itc_calloc(size_t count,size_t size);
+void *itc_malloc_tag(size_t size, const char *tag);
+void *itc_calloc_tag(size_t count,size_t size, const char *tag);
+size_t itc_mark();
+void itc_release(size_t mark);
+
+// Newlib heap (_sbrk), it never shrinks
+size_t heap_used(void);
+size_t heap_size(void);
+
+// Prints the usage and peak of every region
+void gw_malloc_report();
 
 #endif
@@ -106,10 +106,12 @@ void BSOD(BSOD_t fault, uint32_t pc, uint32_t lr) __attribute__((noreturn));
 
 void store_erase(const uint8_t *flash_ptr, uint32_t size);
 void store_save(const uint8_t *flash_ptr, const uint8_t *data, size_t size);
+void store_program(const uint8_t *flash_ptr, const uint8_t *data, size_t size);
 void boot_magic_set(uint32_t magic);
 void oc_level_set(uint32_t level);
 uint32_t oc_level_get();
 uint32_t oc_level_gets();
+void oc_level_apply(uint32_t level);
 void uptime_inc(void);
 uint32_t uptime_get(void);
 
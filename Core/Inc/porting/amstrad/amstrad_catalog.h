@@ -22,6 +22,44 @@ typedef struct {
    int track_listed_id;
 } catalogue_info_t;
 
+// Catalog computed at build time by tools/amstrad_catalog.py and appended
+// to the .cdk image, followed by its size (LE32) and the magic
+#define CAT_META_MAGIC        "CPCM"
+#define CAT_META_VERSION      1
+#define CAT_META_COMMAND_SIZE 32
+#define CAT_META_NAME_SIZE    14
+
+#define CAT_META_PROBE_CPM    0x01
+#define CAT_META_CAT_ART      0x02
+
+typedef struct {
+   unsigned char version;
+   unsigned char format_type;
+   unsigned char sectors;
+   unsigned char tracks;
+   unsigned char sides;
+   unsigned char sector_size;
+   unsigned char catalogue_sector;
+   unsigned char flags;
+   unsigned char entry_count;
+   unsigned char entries_listed_found;
+   unsigned char entries_hidden_found;
+   unsigned char first_listed_dirent;
+   unsigned char first_hidden_dirent;
+   unsigned char track_listed_id;
+   unsigned char track_hidden_id;
+   unsigned char reserved;
+   char command[CAT_META_COMMAND_SIZE];
+} catalogue_meta_t;
+
+typedef struct {
+   char filename[CAT_META_NAME_SIZE];
+   unsigned char is_hidden;
+   unsigned char reserved;
+} catalogue_meta_entry_t;
+
 extern catalogue_info_t catalogue;
 
-int catalog_probe(t_drive *drive, unsigned char user);
\ No newline at end of file
+int catalog_probe(t_drive *drive, unsigned char user);
+// Fills the catalogue from the image metadata, NULL if the image has none
+const catalogue_meta_t *catalog_load_prebuilt(const unsigned char *image, unsigned int size);
\ No newline at end of file
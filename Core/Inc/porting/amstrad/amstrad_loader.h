@@ -38,5 +38,7 @@
 #define GFX_LOADER_H__
 
 void loader_run (char * text);
+// Uses the command chosen at build time, false if the disk image has none
+bool loader_run_prebuilt (char * key_buffer, const unsigned char *image, unsigned int size);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Shared sample mixing/volume kernels used by every port to fill the
+ * audiobuffer_dma half that is being refilled.
+ *
+ * All kernels compute `dst[i] = saturate16((source * gain) >> shift)` where
+ * `source` depends on the kernel. `gain` must fit in 16 bits. A gain of 0
+ * only clears `dst`, so muting goes through the same call.
+ *
+ * The kernels have no dependency on the HAL so they can be built for the
+ * host (linux/) as well. On Cortex-M7 they use the DSP extension to process
+ * two samples per instruction when the buffers are word aligned.
+ */
+
+// Mono int16 source
+void audio_mix_s16(int16_t *dst, const int16_t *src, size_t count, int32_t gain, int shift);
+
+// Mono sum of two int16 sources (src_a[i] + src_b[i])
+void audio_mix_s16_add(int16_t *dst, const int16_t *src_a, const int16_t *src_b, size_t count, int32_t gain, int shift);
+
+// Mono sum of an interleaved L/R int16 source (src[2i] + src[2i+1])
+void audio_mix_s16_stereo(int16_t *dst, const int16_t *src, size_t count, int32_t gain, int shift);
+
+// Mono sum of an interleaved L/R int8 source
+void audio_mix_s8_stereo(int16_t *dst, const int8_t *src, size_t count, int32_t gain, int shift);
+
+// Mono unsigned 8-bit source
+void audio_mix_u8(int16_t *dst, const uint8_t *src, size_t count, int32_t gain, int shift);
+
+/**
+ * Same as audio_mix_s16_add() with a single-pole low-pass filter (6 dB/octave)
+ * applied on the sum before the gain. `coef` is the weight of the new input
+ * in 1/65536 units, `state` holds the filter output between calls.
+ */
+void audio_mix_s16_add_lowpass(int16_t *dst, const int16_t *src_a, const int16_t *src_b, size_t count,
+                               int32_t gain, int shift, uint32_t coef, int32_t *state);
+
+// Plain copy for cores that already mix and scale internally
+void audio_mix_copy(int16_t *dst, const int16_t *src, size_t count);
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Handshake between the emulators filling audiobuffer_dma and the SAI DMA
+ * playing it in a loop, one half while the other one is written.
+ *
+ * The producer brackets each block with audio_ring_write_begin() and
+ * audio_ring_write_end(); the DMA half/full transfer interrupts call
+ * audio_ring_consume() with the half that starts playing. This tells apart:
+ *
+ * - underruns: a half starts playing without a new block. The DMA plays
+ *   the block it held again, the next block fades in. The interrupt only
+ *   flags it, the fade is done by the producer.
+ * - overruns: a block is written over one that wasn't played yet, the
+ *   older block is lost (the normal case in fast forward).
+ * - late writes: the block was still being written when its half started
+ *   playing.
+ *
+ * No dependency on the HAL so it can be driven by a simulated DMA on the
+ * host.
+ */
+
+#define AUDIO_RING_FADE 64 // Samples of the fade in after a concealed block
+
+typedef struct {
+    int16_t *buffer;            // Two halves of `length` samples
+    size_t length;
+    volatile uint32_t blocks;   // Halves started by the DMA
+    volatile uint8_t playing;   // Half being played
+    volatile uint8_t filled[2]; // Written and not played yet, one byte per side to store without locking
+    volatile bool concealed;    // The DMA played a concealed block since the last write
+    bool active;                // A block was written since the last audio_ring_stop()
+    int8_t writing;             // Half being written, -1 when idle
+    uint32_t write_blocks;      // blocks at audio_ring_write_begin()
+    volatile uint32_t underruns;
+    uint32_t overruns;
+    uint32_t late_writes;
+} audio_ring_t;
+
+void audio_ring_init(audio_ring_t *ring, int16_t *buffer);
+
+/**
+ * Returns the half to fill with `length` samples, the one the DMA is not
+ * playing. Calling it again before audio_ring_write_end() returns the same
+ * half as long as the DMA didn't move on.
+ */
+int16_t *audio_ring_write_begin(audio_ring_t *ring, size_t length);
+void audio_ring_write_end(audio_ring_t *ring);
+
+// From the DMA interrupts, `half` is the half that starts playing
+void audio_ring_consume(audio_ring_t *ring, uint8_t half);
+
+// Stops the accounting until the next block, while the emulation is paused
+void audio_ring_stop(audio_ring_t *ring);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Cheat codes compiled into a patch table at build time.
+ *
+ * tools/cheat_table.py compiles the cheat file of a ROM into a table that
+ * parse_roms.py stores in the external flash with it, see
+ * retro_emulator_file_t.cheat_table. Each cheat of the table is a list of
+ * writes, either to the ROM, patched once when the game is loaded, or to
+ * the RAM, written again after every frame to hold the value. The index of
+ * a cheat is its index in retro_emulator_file_t.cheat_codes.
+ *
+ * The table is only read when the game starts or the cheats are toggled,
+ * the RAM writes of the active cheats are then resolved to pointers once,
+ * so a frame only copies their values.
+ *
+ * No dependency on the HAL, the linux/ builds measure the per-frame cost.
+ */
+
+#define CHEATS_TABLE_VERSION   1
+#define CHEATS_MAX_RAM_WRITES  64 // Of 1, 2 or 4 bytes, longer writes are split
+
+typedef enum {
+    CHEAT_ROM = 0, // Address in the ROM, without its header
+    CHEAT_RAM = 1, // Address resolved by the emulator, see cheats_ram_t
+} cheat_type_t;
+
+typedef struct {
+    uint8_t *ptr;
+    uint32_t value;
+    uint8_t size;
+} cheat_write_t;
+
+typedef struct {
+    cheat_write_t writes[CHEATS_MAX_RAM_WRITES];
+    uint16_t count;
+    uint16_t dropped; // RAM writes that didn't fit or resolve
+} cheats_t;
+
+typedef bool (*cheats_enabled_t)(int index);
+
+// Memory of `size` bytes at `address`, NULL when it isn't writable RAM
+typedef uint8_t *(*cheats_ram_t)(uint32_t address, uint32_t size);
+
+// Patches `size` bytes of the ROM at `address`
+typedef void (*cheats_rom_t)(uint32_t address, const uint8_t *data, uint32_t size);
+
+// Number of cheats, 0 for no table or a table of another version
+int cheats_count(const uint8_t *table);
+
+// Resolves the RAM writes of the enabled cheats, replacing the previous ones
+void cheats_load(cheats_t *cheats, const uint8_t *table, cheats_enabled_t enabled, cheats_ram_t ram);
+
+// Applies the ROM writes of the enabled cheats, returns how many were written
+int cheats_patch_rom(const uint8_t *table, cheats_enabled_t enabled, cheats_rom_t rom);
+
+// Once per frame, after the emulation
+void cheats_apply(const cheats_t *cheats);
@@ -3,6 +3,8 @@
 #include <odroid_system.h>
 
 #include "main.h"
+#include "audio_ring.h"
+#include "frame_sched.h"
 
 extern SAI_HandleTypeDef hsai_BlockA1;
 extern DMA_HandleTypeDef hdma_sai1_a;
@@ -21,8 +23,11 @@ typedef enum {
     DMA_TRANSFER_STATE_HF = 0x00,
     DMA_TRANSFER_STATE_TC = 0x01,
 } dma_transfer_state_t;
-extern dma_transfer_state_t dma_state;
-extern uint32_t dma_counter;
+extern volatile dma_transfer_state_t dma_state;
+extern volatile uint32_t dma_counter;
+
+// Handshake with the SAI DMA, see audio_ring.h
+extern audio_ring_t audio_ring;
 
 extern uint32_t audioBuffer[AUDIO_BUFFER_LENGTH];
 extern uint32_t audio_mute;
@@ -33,7 +38,83 @@ extern int16_t audiobuffer_dma[AUDIO_BUFFER_LENGTH * 2] __attribute__((section (
 
 extern const uint8_t volume_tbl[ODROID_AUDIO_VOLUME_MAX + 1];
 
+/**
+ * Returns the half of audiobuffer_dma that the SAI DMA is not playing, for a
+ * transfer of 2 * `length` samples. Use with the audio_mix.h kernels. The
+ * block is complete at the next common_emu_sound_end(), that
+ * common_emu_sound_sync() calls.
+ */
+int16_t *common_emu_sound_get_buffer(size_t length);
+
+// The block is written, for the loops that don't go through common_emu_sound_sync()
+void common_emu_sound_end(void);
+
+/**
+ * Returns the user volume as a gain out of 256 (volume_tbl), or 0 when the
+ * audio is muted.
+ */
+int32_t common_emu_sound_get_volume(void);
+
 bool common_emu_frame_loop(void);
+
+/**
+ * Speed achieved since the game was started or resumed from the menu, in
+ * percent of the normal speed. Fast forward may not reach the speed asked
+ * for, it is bounded by the CPU.
+ */
+uint16_t common_emu_speed_get(void);
+
+/**
+ * Starts the clock governor for the game being launched, at the tier it
+ * settled on last time or at the overclocking setting, which is also the
+ * highest tier it may use. common_emu_frame_loop() then adjusts the clock,
+ * see cpu_governor.h.
+ */
+void common_emu_clock_init(void);
+
+/**
+ * Frame pacing on the SAI DMA half/full transfer interrupts: the emu has to
+ * have filled the other half of audiobuffer_dma before each of them.
+ */
+extern frame_sched_t common_emu_sync;
+
+/**
+ * Frame pacing on the LTDC line interrupt at the end of the active area,
+ * for the loops that sync on the display instead of the audio.
+ */
+extern frame_sched_t common_emu_sync_lcd;
+
+/**
+ * Puts the core in WFI until the deadline of the frame, `deadlines` - 1
+ * more when pausing. A frame ready after its deadline doesn't wait for it,
+ * the deadlines that went by before it are counted as missed. With `sleep`
+ * false it busy-waits, for the debug overlays that measure the idle time
+ * themselves.
+ */
+void common_emu_sync_wait(uint8_t deadlines, bool sleep);
+
+/**
+ * Same on frame_counter: returns at the line interrupt that ends the frame
+ * being scanned out, a lcd_swap() right after it is shown at the next
+ * refresh. common_emu_sync_lcd.late tells whether that deadline was already
+ * gone when the frame was ready.
+ */
+void common_emu_sync_wait_lcd(bool sleep);
+
+/**
+ * Whether the last frame was synced at least `ms` before its deadline, for
+ * the ports that skip the rendering when they can't afford it.
+ */
+static inline bool common_emu_sync_has_slack(uint16_t ms)
+{
+    return frame_sched_has_slack(&common_emu_sync, ms);
+}
+
+/**
+ * End of frame sync for the emu loops. Waits for the deadlines requested by
+ * common_emu_frame_loop(): none while skipping frames, two when pausing.
+ */
+void common_emu_sound_sync(bool sleep);
 void common_emu_input_loop(odroid_gamepad_state_t *joystick, odroid_dialog_choice_t *game_options);
 
 typedef struct {
@@ -89,3 +170,11 @@ extern common_emu_state_t common_emu_state;
  * Drawable stuff over current emulation.
  */
 void common_ingame_overlay(void);
+
+/**
+ * Picks the pixel format of the frame about to be drawn in the active
+ * buffer: LUT8 unless `rgb565_only` (scaling modes that blend pixels) or
+ * something has to be drawn over the emulation. Returns true when the blit
+ * should write palette indices, see lcd_lut8.h.
+ */
+bool common_emu_lut8_frame(bool rgb565_only);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Picks the lowest CPU clock tier that keeps a game at full frame rate.
+ *
+ * The emulator loop feeds the busy time of every frame. At the end of each
+ * window the load is checked: an overloaded tier (late frames or more than
+ * CPU_GOVERNOR_HIGH_PERMILLE busy) steps up, and a tier whose load would
+ * stay under CPU_GOVERNOR_LOW_PERMILLE one tier lower steps down. A tier
+ * that has to step back up after stepping down, or that holds for
+ * CPU_GOVERNOR_SETTLE_WINDOWS windows, is locked and remembered for the
+ * game; a locked tier only goes up.
+ *
+ * No dependency on the HAL so the decisions can be replayed on the host.
+ * Retuning the clock is done by the caller, see oc_level_apply().
+ */
+
+#define CPU_GOVERNOR_LEVELS         3
+#define CPU_GOVERNOR_WINDOW         128 // Frames
+#define CPU_GOVERNOR_HIGH_PERMILLE  900
+#define CPU_GOVERNOR_LOW_PERMILLE   750
+#define CPU_GOVERNOR_SETTLE_WINDOWS 8
+
+// Core clock of each tier, same order as SystemClock_Config()
+extern const uint16_t cpu_governor_mhz[CPU_GOVERNOR_LEVELS];
+
+typedef struct {
+    uint8_t level;
+    uint8_t max_level;     // User overclocking setting
+    uint8_t settled;       // Windows without change
+    bool locked;
+    bool stepped_down;     // The current tier was reached by stepping down
+    uint16_t frames;
+    uint16_t missed;
+    uint32_t busy_10us;
+    uint32_t budget_10us;
+} cpu_governor_t;
+
+void cpu_governor_init(cpu_governor_t *gov, uint8_t level, uint8_t max_level, bool locked);
+
+/**
+ * Accounts one emulated frame. `missed` is the number of audio deadlines the
+ * frame was late for. Returns the tier to run at, which differs from
+ * gov->level when the clock has to be changed; the caller then updates it.
+ */
+uint8_t cpu_governor_frame(cpu_governor_t *gov, uint32_t busy_10us, uint32_t frame_time_10us, uint16_t missed);
+
+// Drops the partial window, after pauses, menus or fast forward
+void cpu_governor_reset_window(cpu_governor_t *gov);
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Frame deadlines of the emulator loops, on a counter of interrupts: the
+ * SAI DMA half transfers (dma_counter) or the LTDC line event at the end of
+ * the active area (frame_counter).
+ *
+ * Each interrupt is a deadline: an audio block has to be written before
+ * its half starts playing, a frame has to be swapped before the vertical
+ * blanking to be shown at the next refresh. A frame skipped to catch up
+ * still owns its deadline, only the deadlines no frame was ready for are
+ * missed. A late frame doesn't wait, the frames after it catch up.
+ *
+ * No dependency on the HAL: common.c sleeps in WFI until the counter
+ * reaches the deadline frame_sched_begin() returns, the host test drives
+ * it with simulated interrupts.
+ */
+
+typedef struct {
+    uint32_t last_counter;  // Counter at the last deadline waited for
+    uint32_t frames;        // Frames synced
+    uint32_t missed;        // Deadlines that passed before the frame was ready
+    uint16_t slack_ms;      // Time slept before the last deadline, 0 when late
+    uint8_t skipped;        // Frames skipped since the last wait that own a deadline
+    bool late;              // Last frame was ready after its deadline
+} frame_sched_t;
+
+/**
+ * Accounts the frame that is ready at `counter` and returns the counter to
+ * wait for: the deadline of the frame, `deadlines` - 1 more when pausing.
+ */
+uint32_t frame_sched_begin(frame_sched_t *sched, uint32_t counter, uint8_t deadlines);
+
+// The wait for the deadline returned by frame_sched_begin() is over
+void frame_sched_end(frame_sched_t *sched, uint32_t counter, uint32_t slept_ms);
+
+/**
+ * A frame that doesn't wait. At normal speed it still owns a deadline, in
+ * fast forward (`owns_deadline` false) the next deadline is the next one.
+ */
+void frame_sched_skip(frame_sched_t *sched, uint32_t counter, bool owns_deadline);
+
+static inline bool frame_sched_reached(uint32_t counter, uint32_t deadline)
+{
+    return (int32_t)(counter - deadline) >= 0;
+}
+
+/**
+ * Whether the last frame was done at least `ms` before its deadline. A port
+ * can skip the rendering of the next frame when that doesn't leave the
+ * time its rendering takes.
+ */
+static inline bool frame_sched_has_slack(const frame_sched_t *sched, uint16_t ms)
+{
+    return !sched->late && sched->slack_ms >= ms;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Per-frame timing histograms, to see stutters that the averages of
+ * odroid_system_get_stats() hide.
+ *
+ * odroid_system_tick() records every frame: its busy time (emulation and
+ * rendering), the time waited for the next deadline and the whole frame
+ * interval, in 1 ms bins. Late frames and audio underruns, overruns and
+ * late writes (see audio_ring.h) are counted apart. The statistics are
+ * logged and reset together with the runtime stats, when the game menu
+ * opens.
+ *
+ * No dependency on the HAL, the linux/ builds record the same statistics.
+ */
+
+#define FRAME_STATS_BINS 64 // 1 ms bins, the last one also counts longer frames
+
+typedef struct {
+    uint32_t frames;
+    uint32_t skipped;    // Emulated but not drawn
+    uint32_t late;       // Frames ready after their deadline
+    uint32_t underruns;  // Audio blocks missing when the DMA needed them
+    uint32_t overruns;   // Audio blocks overwritten before being played
+    uint32_t late_writes; // Audio blocks still being written when the DMA needed them
+    uint8_t frame_ms[3]; // p50, p95, p99
+    uint8_t busy_ms[3];
+    uint8_t wait_ms[3];
+} frame_stats_report_t;
+
+void frame_stats_reset(void);
+void frame_stats_frame(uint32_t busy_ms, uint32_t frame_ms, bool skipped);
+void frame_stats_late(void);
+void frame_stats_audio(uint32_t underruns, uint32_t overruns, uint32_t late_writes);
+
+void frame_stats_get(frame_stats_report_t *report);
+
+// One line summary, e.g. "frame 17/17/33ms busy 9/12/15ms late 2 xrun 2/0/1"
+int frame_stats_format(char *buf, size_t size, const frame_stats_report_t *report);
+
+// Prints the report to stdout (the logbuf on the device), if any frame was recorded
+void frame_stats_log(void);
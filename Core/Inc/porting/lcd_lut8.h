@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Palette of the 8-bit indexed (LUT8) display mode.
+ *
+ * Palettised cores write palette indices to the framebuffer and the LTDC
+ * expands them through its CLUT, which halves the framebuffer bandwidth and
+ * removes the palette lookup of every pixel. The ports keep their palette
+ * here in RGB565; entries changed during a frame are converted and uploaded
+ * to the CLUT at the next vertical blanking, see lcd_set_pixel_format().
+ *
+ * No dependency on the HAL, the linux/ builds expand LUT8 frames in
+ * software with lcd_lut8_expand().
+ */
+
+typedef enum {
+    LCD_PIXEL_FORMAT_RGB565 = 0,
+    LCD_PIXEL_FORMAT_LUT8,
+} lcd_pixel_format_t;
+
+#define LCD_LUT8_COLORS 256
+
+void lcd_lut8_set_color(uint8_t index, uint16_t rgb565);
+void lcd_lut8_set_palette(const uint16_t *palette, uint16_t first, uint16_t count);
+const uint16_t *lcd_lut8_palette(void);
+
+// Index used to clear the framebuffer when it switches to LUT8, should be black
+void lcd_lut8_set_background(uint8_t index);
+uint8_t lcd_lut8_background(void);
+
+// Writes the RGB888 CLUT if entries changed since the last call
+bool lcd_lut8_commit(uint32_t *clut);
+
+void lcd_lut8_expand(uint16_t *dst, const uint8_t *src, size_t count);
+// The buffer holds count indices and is turned into count RGB565 pixels
+void lcd_lut8_expand_in_place(void *buffer, size_t count);
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Every persistent setting, defined once.
+ *
+ * odroid_settings.c expands these tables into the values kept in RAM, their
+ * defaults and range checks, the odroid_settings_<name>_get/_set()
+ * accessors and the flash image. tools/settings_dump.py reads the same
+ * tables to decode a dump of the config flash on the host.
+ *
+ * The flash image is a list of (key, value) entries rather than a struct,
+ * so adding or removing a setting needs no version bump nor migration: a
+ * key missing from flash gets its default, a key the firmware doesn't know
+ * is dropped and a value out of range is clamped when loaded. A key number
+ * is never reused once released.
+ *
+ * X(key, name, type, min, max, default, accessors)
+ * - type: of the accessors, every value is stored as an int32_t;
+ * - min, max: evaluated at runtime, the width of the old struct field
+ *   when there is no count to check against;
+ * - default: the per-app defaults can use `app` (appid_t);
+ * - accessors: GENERATED, or CUSTOM when odroid_settings.c writes them.
+ *
+ * Per-ROM values are kept for the games they were last set for, see
+ * ODROID_SETTINGS_ROM_VALUES, and are addressed with odroid_settings_rom_id().
+ * The CheatCodes have their own ODROID_SETTINGS_CHEAT_ROMS entries, the
+ * other values never replace them.
+ */
+
+#define ODROID_SETTINGS_IMAGE_VERSION 7
+#define ODROID_SETTINGS_IMAGE_ENTRIES 224
+#define ODROID_SETTINGS_ROM_VALUES    64 // CpuLevel and CpuLocked of 32 games
+#define ODROID_SETTINGS_CHEAT_ROMS    64 // Games with active cheats, up to ROM_COUNT
+
+#if CODEPAGE==12521
+#define ODROID_SETTINGS_DEFAULT_LANG 1
+#elif CODEPAGE==12522
+#define ODROID_SETTINGS_DEFAULT_LANG 2
+#elif CODEPAGE==12523
+#define ODROID_SETTINGS_DEFAULT_LANG 3
+#elif CODEPAGE==12524
+#define ODROID_SETTINGS_DEFAULT_LANG 4
+#elif CODEPAGE==12525
+#define ODROID_SETTINGS_DEFAULT_LANG 5
+#elif CODEPAGE==12511
+#define ODROID_SETTINGS_DEFAULT_LANG 6
+#elif CODEPAGE==932
+#define ODROID_SETTINGS_DEFAULT_LANG 10
+#elif CODEPAGE==936
+#define ODROID_SETTINGS_DEFAULT_LANG 7
+#elif CODEPAGE==949
+#define ODROID_SETTINGS_DEFAULT_LANG 9
+#elif CODEPAGE==950
+#define ODROID_SETTINGS_DEFAULT_LANG 8
+#else
+#define ODROID_SETTINGS_DEFAULT_LANG 0
+#endif
+
+#define ODROID_SETTINGS_GLOBAL(X) \
+    X( 1, Backlight,           int32_t,             0,         ODROID_BACKLIGHT_LEVEL_COUNT - 1, ODROID_BACKLIGHT_LEVEL6,        GENERATED) \
+    X( 2, StartAction,         ODROID_START_ACTION, 0,         UINT8_MAX,                 ODROID_START_ACTION_RESUME,     GENERATED) \
+    /* Too high volume can cause brown out if the battery isn't connected */ \
+    X( 3, Volume,              int32_t,             ODROID_AUDIO_VOLUME_MIN, ODROID_AUDIO_VOLUME_MAX, ODROID_AUDIO_VOLUME_MAX / 2, GENERATED) \
+    X( 4, FontSize,            int32_t,             8,         32,                        8,                              GENERATED) \
+    X( 5, theme,               int8_t,              0,         4,                         2,                              GENERATED) \
+    X( 6, colors,              int8_t,              0,         gui_colors_count - 1,      0,                              GENERATED) \
+    X( 7, turbo_buttons,       int8_t,              0,         3,                         0,                              GENERATED) \
+    X( 8, font,                int8_t,              0,         gui_font_count - 1,        0,                              GENERATED) \
+    X( 9, lang,                int8_t,              0,         gui_lang_count - 1,        ODROID_SETTINGS_DEFAULT_LANG,   CUSTOM)    \
+    X(10, StartupApp,          int32_t,             0,         UINT8_MAX,                 0,                              GENERATED) \
+    X(11, cpu_oc_level,        uint8_t,             0,         2,                         0,                              GENERATED) \
+    X(12, StartupFile,         void *,              INT32_MIN, INT32_MAX,                 NULL,                           GENERATED) \
+    /* Turn off after 10 minutes of idle time in the main menu */ \
+    X(13, MainMenuTimeoutS,    uint16_t,            0,         UINT16_MAX,                60 * 10,                        GENERATED) \
+    X(14, MainMenuSelectedTab, uint16_t,            0,         UINT16_MAX,                0,                              GENERATED) \
+    X(15, MainMenuCursor,      uint16_t,            0,         UINT16_MAX,                0,                              GENERATED) \
+    X(16, AudioSink,           int32_t,             0,         UINT8_MAX,                 ODROID_AUDIO_SINK_SPEAKER,      GENERATED)
+
+#define ODROID_SETTINGS_APP(X) \
+    X(32, Region,              ODROID_REGION,       0,         UINT8_MAX,                 0,                              GENERATED) \
+    X(33, Palette,             int32_t,             0,         UINT8_MAX,                 app == APPID_GB ? 2 : 0,        GENERATED) \
+    X(34, DisplayScaling,      int32_t,             0,         ODROID_DISPLAY_SCALING_COUNT - 1, \
+      app == APPID_GB ? ODROID_DISPLAY_SCALING_FULL : app == APPID_NES ? ODROID_DISPLAY_SCALING_CUSTOM : 0, GENERATED) \
+    X(35, DisplayFilter,       int32_t,             0,         ODROID_DISPLAY_FILTER_COUNT - 1, \
+      app == APPID_GB || app == APPID_NES ? ODROID_DISPLAY_FILTER_SHARP : 0,                            GENERATED) \
+    X(36, DisplayOverscan,     int32_t,             0,         UINT8_MAX,                 0,                              GENERATED) \
+    X(37, SpriteLimit,         int32_t,             0,         UINT8_MAX,                 0,                              GENERATED) \
+    X(38, DisplayRotation,     int32_t,             0,         UINT8_MAX,                 ODROID_DISPLAY_ROTATION_AUTO,   GENERATED)
+
+#define ODROID_SETTINGS_ROM(X) \
+    /* Clock tier picked by the CPU governor, see cpu_governor.h */ \
+    X(64, CpuLevel,            uint8_t,             0,         2,                         0,                              GENERATED) \
+    X(65, CpuLocked,           bool,                0,         1,                         0,                              GENERATED) \
+    /* Bit array of the active retro_emulator_file_t.cheat_codes, value n (`app` in flash) holds codes 32n..32n+31 */ \
+    X(66, CheatCodes,          uint32_t,            INT32_MIN, INT32_MAX,                 0,                              GENERATED)
+
+// Identifies a game in the per-ROM settings, the same as rg_app_desc_t.gameId
+uint32_t odroid_settings_rom_id(const char *name);
+
+#define ODROID_SETTINGS_ROM_PROTOTYPES(key, name, type, min, max, def, accessors) \
+    type odroid_settings_rom_##name##_get(uint32_t rom); \
+    void odroid_settings_rom_##name##_set(uint32_t rom, type value);
+ODROID_SETTINGS_ROM(ODROID_SETTINGS_ROM_PROTOTYPES)
+
+// Forgets every per-ROM value of a game
+void odroid_settings_rom_clear(uint32_t rom);
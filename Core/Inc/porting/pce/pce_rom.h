@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * PC Engine ROM laid out in 8KB banks at build time.
+ *
+ * parse_roms.py stores the HuCards without their copier header and with
+ * the US encoding already reversed, see tools/pce_rom.py, so a ROM kept
+ * as is in the external flash is executed from there. A compressed ROM is
+ * a PCE+ image instead:
+ *
+ *     "PCE+"
+ *     uint16_t banks, uint16_t reserved
+ *     uint32_t sizes[banks]   compressed size, 0 for a bank stored as is
+ *     the banks, each padded to 4 bytes
+ *
+ * Only the banks that compress well are compressed, they are decoded once
+ * into the RAM, straight at the place they are mapped from. The other
+ * banks stay in the flash until a cheat patches them.
+ *
+ * No dependency on the HAL, the linux/ builds measure the loading time
+ * and the RAM used.
+ */
+
+#define PCE_ROM_MAGIC      "PCE+"
+#define PCE_ROM_MAGIC_SIZE 4
+#define PCE_ROM_BANK_SIZE  0x2000
+#define PCE_ROM_MAX_BANKS  0x80 // 1MB, the SF2 mapper reaches the rest from PCE.ROM_DATA
+
+typedef struct {
+    uint8_t *banks[PCE_ROM_MAX_BANKS]; // Mirrored past the end of the ROM
+    uint16_t count;                    // Banks of the ROM
+    uint8_t *ram;                      // Decoded and patched banks
+    uint32_t ram_size;
+    uint32_t ram_used;
+} pce_rom_t;
+
+// Decompresses a bank of `src_size` bytes, returns the decompressed size
+typedef size_t (*pce_rom_inflate_t)(uint8_t *dst, size_t dst_size, const uint8_t *src, size_t src_size);
+
+// Maps a PCE+ image, false when a bank doesn't decode or fit in `ram`
+bool pce_rom_unpack(pce_rom_t *rom, const uint8_t *image, pce_rom_inflate_t inflate, uint8_t *ram, uint32_t ram_size);
+
+// Maps `size` bytes of contiguous ROM, from the flash or already in `ram`
+void pce_rom_map(pce_rom_t *rom, const uint8_t *data, uint32_t size, uint8_t *ram, uint32_t ram_size);
+
+// The bank copied to the RAM on the first call, NULL when the RAM is full.
+// The caller maps the returned copy where the previous pointer was mapped.
+uint8_t *pce_rom_writable(pce_rom_t *rom, unsigned bank);
+
+// Reverses the bits of each byte of a US HuCard, false when the RAM is full.
+// Done at build time, but for the ROMs compressed without their original.
+bool pce_rom_decode_us(pce_rom_t *rom);
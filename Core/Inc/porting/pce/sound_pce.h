@@ -6,6 +6,8 @@
 
 int  pce_snd_init(void);
 void pce_snd_term(void);
-void pce_snd_update(short *buffer, unsigned length);
+// Mixes `length` mono samples into `buffer`, volume_factor is the user
+// volume (0-255 scale, see volume_tbl) applied in the same pass.
+void pce_snd_update(short *buffer, unsigned length, int volume_factor);
 
 #endif
@@ -0,0 +1,16 @@
+#pragma once
+
+/**
+ * Properties of a ROM found at build time, see retro_emulator_file_t.flags.
+ *
+ * tools/romdb.py reads them from roms/romdb.dat or detects them from the
+ * ROM data, the emulators only test the bits when a game is started.
+ *
+ * No dependency on the HAL, the linux/ builds get them from the scripts
+ * that convert their ROM.
+ */
+
+// PC Engine
+#define ROM_FLAG_PCE_US_ENCODED   (1 << 0) // Bits of each byte reversed, US HuCards, decoded by tools/pce_rom.py
+#define ROM_FLAG_PCE_TWO_PART_ROM (1 << 1) // 384KB mapped as 256KB + 128KB
+#define ROM_FLAG_PCE_ONBOARD_RAM  (1 << 2) // 32KB of RAM on the HuCard
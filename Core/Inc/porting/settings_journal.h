@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Append-only flash storage for the persistent settings image.
+ *
+ * The settings are kept in two banks. The active bank starts with a
+ * snapshot of the whole image followed by change records, each one being
+ * the byte ranges that differ from the last commit. A commit only programs
+ * its record; when the bank is full, the current image is compacted into a
+ * fresh snapshot in the other bank, which is then the only erase.
+ *
+ * Power loss safety:
+ * - the bank header is programmed after its snapshot, a bank without a
+ *   valid header is ignored and the previous one is still there;
+ * - each record is one commit with its own crc32, a torn record and
+ *   everything after it are dropped on replay, and the bank is compacted
+ *   at the next commit instead of appending after it.
+ *
+ * No dependency on the HAL, the flash is reached through the callbacks so
+ * the format is exercised on the host with simulated power loss, see
+ * linux/tests/settings_journal_test.c.
+ */
+
+#define SETTINGS_JOURNAL_BANKS       2
+#define SETTINGS_JOURNAL_BANK_SIZE   4096
+#define SETTINGS_JOURNAL_HEADER_SIZE 16
+
+// The offsets given to erase() and program() are bank * SETTINGS_JOURNAL_BANK_SIZE + offset in the bank
+typedef struct {
+    const uint8_t *banks[SETTINGS_JOURNAL_BANKS]; // Memory mapped, they don't need to be contiguous
+    void (*erase)(uint32_t offset, uint32_t size);
+    void (*program)(uint32_t offset, const void *data, uint32_t size);
+} settings_journal_flash_t;
+
+typedef struct {
+    const settings_journal_flash_t *flash;
+    uint32_t size;     // Of the settings image
+    uint8_t version;   // Of the settings image, a bank of another version is ignored
+    uint8_t bank;      // Active bank, the next compaction goes to the other one
+    bool valid;        // The active bank has a valid header
+    bool dirty;        // The active bank has garbage after the last record
+    uint32_t sequence; // Of the active bank
+    uint32_t head;     // Offset of the next record in the active bank
+} settings_journal_t;
+
+/**
+ * Finds the newest bank and replays it into `image`. Returns false when no
+ * bank holds an image of this version, `image` is then left untouched.
+ */
+bool settings_journal_load(settings_journal_t *journal, const settings_journal_flash_t *flash,
+                           void *image, uint32_t size, uint8_t version);
+
+/**
+ * Stores the changes between `committed` (the image at the last load or
+ * commit) and `image`, then updates `committed`.
+ */
+void settings_journal_commit(settings_journal_t *journal, const void *image, void *committed);
+
+// Writes `image` as the snapshot of the other bank
+void settings_journal_compact(settings_journal_t *journal, const void *image);
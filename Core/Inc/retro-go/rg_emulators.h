@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "rom_flags.h"
+
 #if !defined(COVERFLOW)
 #define COVERFLOW 0
 #endif /* COVERFLOW */
@@ -42,10 +44,15 @@ typedef struct {
     rom_region_t region;
     const rom_system_t *system;
     uint16_t game_config;
+    uint32_t crc32; // Of the ROM dump before patches, 0 when it wasn't found, see tools/romdb.py
+    uint16_t flags; // ROM_FLAG_*
+    uint32_t legacy_crc32; // PCE, key of the save states made before crc32, see tools/pce_rom.py
+    const char *patches; // Applied at build time by parse_roms.py, or NULL
 #if CHEAT_CODES == 1
-    const char** cheat_codes; // Cheat codes to choose from
-    const char** cheat_descs; // Cheat codes descriptions
+    const char* const *cheat_codes; // Cheat codes to choose from
+    const char* const *cheat_descs; // Cheat codes descriptions
     int cheat_count;
+    const uint8_t *cheat_table; // Compiled cheat_codes, see cheats.h, or NULL
 #endif
 } retro_emulator_file_t;
 
@@ -46,4 +46,7 @@ int8_t odroid_settings_get_next_lang(uint8_t cur);
 int8_t odroid_settings_get_prior_lang(uint8_t cur);
 void odroid_settings_lang_set(int8_t lang);
 uint8_t odroid_settings_cpu_oc_level_get(void);
-void odroid_settings_cpu_oc_level_set(uint8_t oc);
\ No newline at end of file
+void odroid_settings_cpu_oc_level_set(uint8_t oc);
+// Clock tier remembered by the CPU governor for a game, see cpu_governor.h
+bool odroid_settings_cpu_tier_get(uint32_t game_id, uint8_t *level, bool *locked);
+void odroid_settings_cpu_tier_set(uint32_t game_id, uint8_t level, bool locked);
\ No newline at end of file
@@ -69,6 +69,7 @@ typedef struct
     const char *s_copy_GW_time_to_RTC;
     const char *s_LCD_filter;
     const char *s_Display_RAM;
+    const char *s_Run_ahead;
     const char *s_Press_ACL;
     const char *s_Press_TIME;
     const char *s_Press_ALARM;
@@ -123,6 +124,7 @@ typedef struct
     const char *s_Type;
     const char *s_Size;
     const char *s_ImgSize;
+    const char *s_Patches;
     const char *s_Close;
     const char *s_GameProp;
     const char *s_Resume_game;
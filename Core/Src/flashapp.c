@@ -19,6 +19,7 @@
 
 #include "utils.h"
 #include "sha256.h"
+#include "flashapp_slots.h"
 
 #define DBG(...) printf(__VA_ARGS__)
 // #define DBG(...)
@@ -64,20 +65,36 @@ typedef enum {
 
     FLASHAPP_FINAL                  = 0x0D,
     FLASHAPP_ERROR                  = 0x0E,
+
+    FLASHAPP_DIFF_NEXT              = 0x0F,
+    FLASHAPP_DIFF                   = 0x10,
 } flashapp_state_t;
 
 typedef enum {
     FLASHAPP_STATUS_BAD_HASH_RAM    = 0xbad00001,
     FLASHAPP_STATUS_BAD_HAS_FLASH   = 0xbad00002,
     FLASHAPP_STATUS_NOT_ALIGNED     = 0xbad00003,
+    FLASHAPP_STATUS_TOO_LARGE       = 0xbad00004,
 
     FLASHAPP_STATUS_IDLE            = 0xcafe0000,
     FLASHAPP_STATUS_DONE            = 0xcafe0001,
     FLASHAPP_STATUS_BUSY            = 0xcafe0002,
 } flashapp_status_t;
 
+// Granularity of the differential programming. Every block of the image has
+// its sha256 in the manifest generated by tools/flash_diff.py.
+#define BLOCK_SIZE (4 * 1024)
+#define MAX_BLOCKS (4 * 1024)
+
+// Bytes hashed from the slots per flashapp_run() call
+#define SLOT_HASH_STEP (16 * 1024)
+
 typedef struct {
     tab_t    tab;
+    int32_t  slot;
+    uint32_t block_idx;
+    uint32_t block_count;
+    uint32_t block_bytes_left;
     uint32_t erase_address;
     uint32_t erase_bytes_left;
     uint32_t current_program_address;
@@ -123,6 +140,17 @@ uint32_t program_chunk_count;
 // The expected sha256 of the loaded binary
 uint8_t program_expected_sha256[65];
 
+// Set to non-zero if the loaded binary only holds the blocks that are set
+// in program_block_dirty, back to back.
+uint32_t program_sparse;
+
+// One bit per BLOCK_SIZE block from program_address, set by the block
+// compare (program_start == 3) for blocks that differ from the manifest.
+uint32_t program_block_dirty[MAX_BLOCKS / 32];
+
+// The per slot chunk descriptors of pipelined programming (program_slot_*)
+// are in flashapp_slots.c
+
 // TODO: Expose properly
 int odroid_overlay_draw_text_line(uint16_t x_pos,
                                   uint16_t y_pos,
@@ -257,6 +285,8 @@ static void test_flash(flashapp_t *flashapp)
     uint32_t size;
     uint32_t start;
     uint32_t end;
+    uint32_t t0;
+    uint32_t program_ms;
 
     const uint32_t rand_size = 512 * 1024;
 
@@ -279,9 +309,11 @@ static void test_flash(flashapp_t *flashapp)
     // Write and verify 512kB random data
     address = 0;
     size = rand_size;
+    t0 = HAL_GetTick();
     OSPI_DisableMemoryMappedMode();
     OSPI_Program(address, &flash_buffer[address], size);
     OSPI_EnableMemoryMappedMode();
+    program_ms = HAL_GetTick() - t0;
 
     // Erase parts of the flash and verify that the non erased data is still intact
     for (int i = 0; i < ARRAY_SIZE(tests); i++) {
@@ -317,12 +349,112 @@ static void test_flash(flashapp_t *flashapp)
 
     // Do a read test of the first 1MB
     uint32_t read_ms = test_read(0, 1024 * 1024);
-    sprintf(flashapp->tab.name, "All OK. Flash read: %ld.%02ld MB/s", 1024 / read_ms, (100 * 1024 / read_ms) % 100);
+    sprintf(flashapp->tab.name, "All OK. Read: %ld.%02ld MB/s Program: %ld kB/s",
+            1024 / read_ms, (100 * 1024 / read_ms) % 100, (rand_size / 1024) * 1000 / program_ms);
     lcd_swap();
     lcd_wait_for_vblank();
     redraw(flashapp);
 }
 
+static bool block_is_dirty(uint32_t idx)
+{
+    return program_block_dirty[idx / 32] & (1u << (idx % 32));
+}
+
+static void block_set_dirty(uint32_t idx)
+{
+    program_block_dirty[idx / 32] |= 1u << (idx % 32);
+}
+
+static uint32_t block_size(uint32_t idx)
+{
+    uint32_t offset = idx * BLOCK_SIZE;
+
+    return (program_size - offset) > BLOCK_SIZE ? BLOCK_SIZE : (program_size - offset);
+}
+
+// Moves flashapp->block_idx to the next dirty block, returns false when none is left.
+static bool block_next_dirty(flashapp_t *flashapp)
+{
+    while (flashapp->block_idx < flashapp->block_count) {
+        if (block_is_dirty(flashapp->block_idx)) {
+            return true;
+        }
+        flashapp->block_idx++;
+    }
+
+    return false;
+}
+
+// Number of bytes loaded by the host, only the dirty blocks in sparse mode
+static uint32_t loaded_size(void)
+{
+    uint32_t block_count = (program_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint32_t size = 0;
+
+    if (!program_sparse) {
+        return program_size;
+    }
+
+    for (uint32_t i = 0; i < block_count; i++) {
+        if (block_is_dirty(i)) {
+            size += block_size(i);
+        }
+    }
+
+    return size;
+}
+
+static void sha256_final_string(SHA256_CTX *sha256, uint8_t hash_str[65])
+{
+    uint8_t hash[32];
+
+    sha256_final(sha256, hash);
+
+    for (int i = 0; i < 32; i++) {
+        sprintf((char *) &hash_str[i * 2], "%02x", hash[i]);
+    }
+}
+
+static void sparse_flash_sha256(uint8_t hash_str[65])
+{
+    SHA256_CTX sha256;
+    uint32_t block_count = (program_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    sha256_init(&sha256);
+    for (uint32_t i = 0; i < block_count; i++) {
+        if (block_is_dirty(i)) {
+            sha256_update(&sha256, (const BYTE *) (0x90000000 + program_address + i * BLOCK_SIZE), block_size(i));
+        }
+    }
+    sha256_final_string(&sha256, hash_str);
+}
+
+// Pipelined programming: both slots follow framebuffer2 and run into the
+// emulator RAM, which is unused here. The host writes them over the debug
+// port, the D-cache must not hide the new data from the hash.
+void flashapp_slots_invalidate(const void *addr, uint32_t size)
+{
+    uint32_t start = (uint32_t) addr & ~31u;
+    uint32_t end = ((uint32_t) addr + size + 31) & ~31u;
+
+    SCB_InvalidateDCache_by_Addr((uint32_t *) start, end - start);
+}
+
+// Makes the chunk in the slot the current one
+static void slot_start(flashapp_t *flashapp, uint32_t slot)
+{
+    flashapp->slot = slot;
+    flash_buffer = flashapp_slot_buffer(slot);
+
+    program_size = program_slot_size[slot];
+    program_address = program_slot_address[slot];
+    program_erase = program_slot_erase[slot];
+    program_erase_bytes = program_slot_erase_bytes[slot];
+    program_sparse = 0;
+    memcpy(program_expected_sha256, program_slot_sha256[slot], sizeof(program_expected_sha256));
+}
+
 static void state_set(flashapp_state_t state_next)
 {
     printf("State: %ld -> %d\n", flashapp_state, state_next);
@@ -349,8 +481,11 @@ static void flashapp_run(flashapp_t *flashapp)
         program_erase_bytes = 0;
         program_chunk_idx = 1;
         program_chunk_count = 1;
+        program_sparse = 0;
+        memset(program_block_dirty, 0, sizeof(program_block_dirty));
         memset(program_expected_sha256, 0, sizeof(program_expected_sha256));
         memset(program_calculated_sha256, 0, sizeof(program_calculated_sha256));
+        flashapp_slots_init((uint8_t *) framebuffer2);
 
         flashapp->progress_value = 0;
         flashapp->progress_max = 0;
@@ -365,16 +500,29 @@ static void flashapp_run(flashapp_t *flashapp)
         flashapp->progress_value = 0;
         flashapp->progress_max = 0;
 
+        // The next chunk of a pipelined transfer is taken as soon as it is ready
+        if (program_slot_ready[flashapp_slot_for_chunk(program_chunk_idx)]) {
+            slot_start(flashapp, flashapp_slot_for_chunk(program_chunk_idx));
+            state_inc();
+            break;
+        }
+
         // program_start is set by the flash script
         switch (program_start) {
         case 1: // Normal flash operation
             program_start = 0;
+            flashapp->slot = -1;
+            flash_buffer = (uint8_t *) framebuffer2;
             state_inc();
             break;
         case 2: // Test flash
             program_start = 0;
             state_set(FLASHAPP_TEST_NEXT);
             break;
+        case 3: // Compare flash blocks against the manifest
+            program_start = 0;
+            state_set(FLASHAPP_DIFF_NEXT);
+            break;
         default:
             break;
         }
@@ -385,12 +533,29 @@ static void flashapp_run(flashapp_t *flashapp)
         state_inc();
         break;
     case FLASHAPP_CHECK_HASH_RAM_NEXT:
-        sprintf(flashapp->tab.name, "2. Checking hash in RAM (%ld bytes)", program_size);
+        sprintf(flashapp->tab.name, "2. Checking hash in RAM (%ld bytes)", loaded_size());
         state_inc();
         break;
     case FLASHAPP_CHECK_HASH_RAM:
-        // Calculate sha256 hash of the RAM first
-        sha256_to_string(program_calculated_sha256, (const BYTE*) flash_buffer, program_size);
+        if (flashapp->slot >= 0) {
+            // Most of the slot was already hashed while it was being loaded
+            if (program_size > FLASHAPP_SLOT_SIZE) {
+                sprintf(flashapp->tab.name, "** Chunk larger than the buffer! **");
+                program_status = FLASHAPP_STATUS_TOO_LARGE;
+                state_set(FLASHAPP_ERROR);
+                break;
+            }
+            SHA256_CTX *sha256 = flashapp_slot_sha256(flashapp->slot, program_size);
+            if (sha256 == NULL) {
+                // The host flagged the slot ready before loading all of it
+                memset(program_calculated_sha256, 0, sizeof(program_calculated_sha256));
+            } else {
+                sha256_final_string(sha256, program_calculated_sha256);
+            }
+        } else {
+            // Calculate sha256 hash of the RAM first
+            sha256_to_string(program_calculated_sha256, (const BYTE*) flash_buffer, loaded_size());
+        }
 
         if (strncmp((char *)program_calculated_sha256, (char *)program_expected_sha256, 64) != 0) {
             // Hashes don't match even in RAM, openocd loading failed.
@@ -406,7 +571,14 @@ static void flashapp_run(flashapp_t *flashapp)
     case FLASHAPP_ERASE_NEXT:
         OSPI_DisableMemoryMappedMode();
 
-        if (program_erase) {
+        if (program_sparse) {
+            sprintf(flashapp->tab.name, "4. Erasing changed blocks...");
+            flashapp->block_idx = 0;
+            flashapp->block_count = (program_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+            flashapp->progress_max = flashapp->block_count;
+            flashapp->progress_value = 0;
+            state_inc();
+        } else if (program_erase) {
             if (program_erase_bytes == 0) {
                 sprintf(flashapp->tab.name, "4. Performing Chip Erase (takes time)");
             } else {
@@ -438,7 +610,15 @@ static void flashapp_run(flashapp_t *flashapp)
         }
         break;
     case FLASHAPP_ERASE:
-        if (program_erase_bytes == 0) {
+        if (program_sparse) {
+            if (block_next_dirty(flashapp)) {
+                OSPI_EraseSync(program_address + flashapp->block_idx * BLOCK_SIZE, BLOCK_SIZE);
+                flashapp->block_idx++;
+            } else {
+                state_inc();
+            }
+            flashapp->progress_value = flashapp->block_idx;
+        } else if (program_erase_bytes == 0) {
             OSPI_NOR_WriteEnable();
             OSPI_ChipErase();
             state_inc();
@@ -456,15 +636,40 @@ static void flashapp_run(flashapp_t *flashapp)
         flashapp->progress_max = program_size;
         flashapp->current_program_address = program_address;
         flashapp->program_bytes_left = program_size;
+        if (program_sparse) {
+            // Only the dirty blocks were transferred
+            flashapp->progress_max = loaded_size();
+        }
         flashapp->program_buf = flash_buffer;
+        flashapp->block_idx = 0;
+        flashapp->block_bytes_left = 0;
         state_inc();
         break;
     case FLASHAPP_PROGRAM:
-        if (flashapp->program_bytes_left > 0) {
+        if (program_sparse) {
+            // program_buf is consumed linearly, the destination jumps to the next dirty block
+            if (flashapp->block_bytes_left == 0) {
+                if (!block_next_dirty(flashapp)) {
+                    state_inc();
+                    break;
+                }
+                flashapp->current_program_address = program_address + flashapp->block_idx * BLOCK_SIZE;
+                flashapp->block_bytes_left = block_size(flashapp->block_idx);
+                flashapp->block_idx++;
+            }
+
+            uint32_t bytes_to_write = flashapp->block_bytes_left > 256 ? 256 : flashapp->block_bytes_left;
+            OSPI_NOR_WriteEnable();
+            OSPI_PageProgramStart(flashapp->current_program_address, flashapp->program_buf, bytes_to_write);
+            flashapp->current_program_address += bytes_to_write;
+            flashapp->program_buf += bytes_to_write;
+            flashapp->block_bytes_left -= bytes_to_write;
+            flashapp->progress_value += bytes_to_write;
+        } else if (flashapp->program_bytes_left > 0) {
             uint32_t dest_page = flashapp->current_program_address / 256;
             uint32_t bytes_to_write = flashapp->program_bytes_left > 256 ? 256 : flashapp->program_bytes_left;
             OSPI_NOR_WriteEnable();
-            OSPI_PageProgram(dest_page * 256, flashapp->program_buf, bytes_to_write);
+            OSPI_PageProgramStart(dest_page * 256, flashapp->program_buf, bytes_to_write);
             flashapp->current_program_address += bytes_to_write;
             flashapp->program_buf += bytes_to_write;
             flashapp->program_bytes_left -= bytes_to_write;
@@ -480,9 +685,13 @@ static void flashapp_run(flashapp_t *flashapp)
         break;
     case FLASHAPP_CHECK_HASH_FLASH:
         // Calculate sha256 hash of the FLASH.
-        sha256_to_string(program_calculated_sha256,
-                         (const BYTE*) (0x90000000 + program_address),
-                         program_size);
+        if (program_sparse) {
+            sparse_flash_sha256(program_calculated_sha256);
+        } else {
+            sha256_to_string(program_calculated_sha256,
+                             (const BYTE*) (0x90000000 + program_address),
+                             program_size);
+        }
 
         if (strncmp((char *)program_calculated_sha256, (char *)program_expected_sha256, 64) != 0) {
             // Hashes don't match in FLASH, programming failed.
@@ -492,6 +701,10 @@ static void flashapp_run(flashapp_t *flashapp)
         } else {
             sprintf(flashapp->tab.name, "7. Hash OK in FLASH.");
 
+            if (flashapp->slot >= 0) {
+                flashapp_slot_release(flashapp->slot);
+            }
+
             if (program_chunk_idx != program_chunk_count) {
                 // More chunks will be programmed, skip the init state.
                 program_chunk_idx++;
@@ -507,6 +720,54 @@ static void flashapp_run(flashapp_t *flashapp)
         test_flash(flashapp);
         state_inc();
         break;
+    case FLASHAPP_DIFF_NEXT:
+        // flash_buffer holds one binary sha256 per block of the image
+        flashapp->block_idx = 0;
+        flashapp->block_count = (program_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        memset(program_block_dirty, 0, sizeof(program_block_dirty));
+
+        if (flashapp->block_count > MAX_BLOCKS) {
+            sprintf(flashapp->tab.name, "** Too many blocks to compare! **");
+            program_status = FLASHAPP_STATUS_TOO_LARGE;
+            state_set(FLASHAPP_ERROR);
+            break;
+        }
+
+        // Blocks smaller than an erase sector can't be rewritten on their own
+        if (OSPI_GetSmallestEraseSize() > BLOCK_SIZE) {
+            sprintf(flashapp->tab.name, "** Erase size too large for diff! **");
+            program_status = FLASHAPP_STATUS_NOT_ALIGNED;
+            state_set(FLASHAPP_ERROR);
+            break;
+        }
+
+        program_status = FLASHAPP_STATUS_BUSY;
+        sprintf(flashapp->tab.name, "Comparing %ld blocks...", flashapp->block_count);
+        flashapp->progress_value = 0;
+        flashapp->progress_max = flashapp->block_count;
+        state_inc();
+        break;
+    case FLASHAPP_DIFF:
+        if (flashapp->block_idx < flashapp->block_count) {
+            uint32_t idx = flashapp->block_idx;
+            uint8_t hash[32];
+            SHA256_CTX sha256;
+
+            sha256_init(&sha256);
+            sha256_update(&sha256, (const BYTE *) (0x90000000 + program_address + idx * BLOCK_SIZE), block_size(idx));
+            sha256_final(&sha256, hash);
+
+            if (memcmp(hash, &flash_buffer[idx * sizeof(hash)], sizeof(hash)) != 0) {
+                block_set_dirty(idx);
+            }
+
+            flashapp->block_idx++;
+            flashapp->progress_value = flashapp->block_idx;
+        } else {
+            // The host reads program_block_dirty once back in idle
+            state_set(FLASHAPP_IDLE);
+        }
+        break;
     case FLASHAPP_TEST:
     case FLASHAPP_FINAL:
     case FLASHAPP_ERROR:
@@ -540,7 +801,13 @@ void flashapp_main(void)
         for (int i = 0; i < 128; i++) {
             wdog_refresh();
             flashapp_run(&flashapp);
-            if (flashapp_state != FLASHAPP_PROGRAM) {
+
+            // Hash the chunks of a pipelined transfer while they arrive
+            for (uint32_t slot = 0; slot < FLASHAPP_SLOT_COUNT; slot++) {
+                flashapp_slot_hash(slot, SLOT_HASH_STEP);
+            }
+
+            if (flashapp_state != FLASHAPP_PROGRAM && flashapp_state != FLASHAPP_DIFF) {
                 break;
             }
         }
@@ -0,0 +1,76 @@
+#include "flashapp_slots.h"
+
+uint32_t program_slot_ready[FLASHAPP_SLOT_COUNT];
+uint32_t program_slot_loaded[FLASHAPP_SLOT_COUNT];
+uint32_t program_slot_size[FLASHAPP_SLOT_COUNT];
+uint32_t program_slot_address[FLASHAPP_SLOT_COUNT];
+uint32_t program_slot_erase[FLASHAPP_SLOT_COUNT];
+int32_t  program_slot_erase_bytes[FLASHAPP_SLOT_COUNT];
+uint8_t  program_slot_sha256[FLASHAPP_SLOT_COUNT][65];
+
+static uint8_t *slots;
+
+// Running hash of the bytes loaded so far in each slot
+static SHA256_CTX slot_sha256[FLASHAPP_SLOT_COUNT];
+static uint32_t slot_hashed[FLASHAPP_SLOT_COUNT];
+
+void flashapp_slots_init(uint8_t *buffer)
+{
+    slots = buffer;
+    for (uint32_t slot = 0; slot < FLASHAPP_SLOT_COUNT; slot++) {
+        flashapp_slot_release(slot);
+    }
+}
+
+uint8_t *flashapp_slot_buffer(uint32_t slot)
+{
+    return slots + slot * FLASHAPP_SLOT_SIZE;
+}
+
+uint32_t flashapp_slot_for_chunk(uint32_t chunk_idx)
+{
+    return (chunk_idx - 1) % FLASHAPP_SLOT_COUNT;
+}
+
+// The ready flag is cleared last so the host never sees a free slot with a
+// stale hash state.
+void flashapp_slot_release(uint32_t slot)
+{
+    program_slot_loaded[slot] = 0;
+    slot_hashed[slot] = 0;
+    sha256_init(&slot_sha256[slot]);
+    program_slot_ready[slot] = 0;
+}
+
+void flashapp_slot_hash(uint32_t slot, uint32_t max_bytes)
+{
+    uint32_t loaded = program_slot_loaded[slot];
+    uint8_t *data = flashapp_slot_buffer(slot) + slot_hashed[slot];
+    uint32_t len;
+
+    if (loaded > FLASHAPP_SLOT_SIZE) {
+        loaded = FLASHAPP_SLOT_SIZE;
+    }
+
+    if (loaded <= slot_hashed[slot]) {
+        return;
+    }
+
+    len = loaded - slot_hashed[slot];
+    if (len > max_bytes) {
+        len = max_bytes;
+    }
+
+    flashapp_slots_invalidate(data, len);
+    sha256_update(&slot_sha256[slot], data, len);
+    slot_hashed[slot] += len;
+}
+
+SHA256_CTX *flashapp_slot_sha256(uint32_t slot, uint32_t size)
+{
+    flashapp_slot_hash(slot, FLASHAPP_SLOT_SIZE);
+    if (slot_hashed[slot] != size) {
+        return NULL;
+    }
+    return &slot_sha256[slot];
+}
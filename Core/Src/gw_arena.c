@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "gw_arena.h"
+
+#define ALIGN_UP(x) (((x) + GW_ARENA_ALIGN - 1) & ~((size_t)GW_ARENA_ALIGN - 1))
+
+// Tags that don't fit in the table are accounted together
+static const char tag_other[] = "(other)";
+
+void gw_arena_init(gw_arena_t *arena, const char *name, void *base, size_t size)
+{
+    memset(arena, 0, sizeof(*arena));
+
+    arena->name = name;
+    arena->base = base;
+    arena->size = size;
+}
+
+static uint8_t tag_index(gw_arena_t *arena, const char *tag)
+{
+    size_t i;
+
+    if (tag == NULL) {
+        tag = tag_other;
+    }
+
+    // Tags are static strings, compare the pointers first
+    for (i = 0; i < arena->tag_count; i++) {
+        if (arena->tags[i].name == tag || strcmp(arena->tags[i].name, tag) == 0) {
+            return i;
+        }
+    }
+
+    if (arena->tag_count == GW_ARENA_MAX_TAGS) {
+        // The last slot collects everything that doesn't fit
+        arena->tags[GW_ARENA_MAX_TAGS - 1].name = tag_other;
+        return GW_ARENA_MAX_TAGS - 1;
+    }
+
+    arena->tags[i].name = tag;
+    arena->tags[i].used = 0;
+    arena->tags[i].peak = 0;
+    arena->tag_count++;
+
+    return i;
+}
+
+void *gw_arena_alloc(gw_arena_t *arena, size_t size, const char *tag)
+{
+    // The base of a region isn't necessarily aligned, the address is
+    size_t offset = arena->used + (-(uintptr_t) &arena->base[arena->used] & (GW_ARENA_ALIGN - 1));
+    size_t end;
+    gw_arena_alloc_t *last = arena->alloc_count ? &arena->allocs[arena->alloc_count - 1] : NULL;
+    uint8_t idx;
+
+    if (size > arena->size || offset + ALIGN_UP(size) > arena->size) {
+        return NULL;
+    }
+    end = offset + ALIGN_UP(size);
+
+    idx = tag_index(arena, tag);
+
+    // Consecutive allocations of a tag are kept in one record. When the
+    // records run out the last one is extended whatever its tag.
+    if (last != NULL && (last->tag == idx || arena->alloc_count == GW_ARENA_MAX_ALLOCS)) {
+        idx = last->tag;
+        last->size = end - last->offset;
+    } else {
+        arena->allocs[arena->alloc_count].offset = arena->used;
+        arena->allocs[arena->alloc_count].size = end - arena->used;
+        arena->allocs[arena->alloc_count].tag = idx;
+        arena->alloc_count++;
+    }
+
+    arena->tags[idx].used += end - arena->used;
+    if (arena->tags[idx].used > arena->tags[idx].peak) {
+        arena->tags[idx].peak = arena->tags[idx].used;
+    }
+
+    arena->used = end;
+    if (arena->used > arena->session_peak) {
+        arena->session_peak = arena->used;
+    }
+    if (arena->used > arena->peak) {
+        arena->peak = arena->used;
+    }
+
+    return &arena->base[offset];
+}
+
+size_t gw_arena_mark(const gw_arena_t *arena)
+{
+    return arena->used;
+}
+
+void gw_arena_release(gw_arena_t *arena, size_t mark)
+{
+    if (mark >= arena->used) {
+        return;
+    }
+
+    while (arena->alloc_count > 0) {
+        gw_arena_alloc_t *last = &arena->allocs[arena->alloc_count - 1];
+        size_t end = last->offset + last->size;
+
+        if (end <= mark) {
+            break;
+        }
+
+        if (last->offset < mark) {
+            // Records merge consecutive allocations, a mark can be inside one
+            arena->tags[last->tag].used -= end - mark;
+            last->size = mark - last->offset;
+            break;
+        }
+
+        arena->tags[last->tag].used -= last->size;
+        arena->alloc_count--;
+    }
+
+    arena->used = mark;
+    if (mark == 0) {
+        arena->session_peak = 0;
+    }
+}
+
+size_t gw_arena_free(const gw_arena_t *arena)
+{
+    return arena->size - arena->used;
+}
+
+void gw_arena_report(const gw_arena_t *arena)
+{
+    printf("%s: %u/%u used, session peak %u, peak %u, %u free\n",
+           arena->name,
+           (unsigned) arena->used,
+           (unsigned) arena->size,
+           (unsigned) arena->session_peak,
+           (unsigned) arena->peak,
+           (unsigned) (arena->size - arena->peak));
+
+    for (size_t i = 0; i < arena->tag_count; i++) {
+        printf("  %s: %u used, peak %u\n",
+               arena->tags[i].name,
+               (unsigned) arena->tags[i].used,
+               (unsigned) arena->tags[i].peak);
+    }
+}
@@ -17,6 +17,9 @@
 
 #define TMO_DEFAULT 1000
 
+// Flash clock cycles between two status reads by the auto-polling engine
+#define AUTOPOLL_INTERVAL 16
+
 // 3-byte JEDEC ID to uint32_t
 #define JEDEC_ID(_x0, _x1, _x2) ( (uint32_t) ( \
      ((_x0)       ) |                          \
@@ -374,6 +377,9 @@ static struct {
     const flash_config_t *config;
     const char           *name;
     bool                  mem_mapped_enabled;
+    bool                  busy;         // Auto-polling for WIP is running
+    uint32_t              busy_t0;
+    uint32_t              busy_timeout; // 0 = wait forever
 } flash = {
     .config = &config_spi_24b, // Default config to use to probe status etc.
     .name = "Unknown",
@@ -407,6 +413,8 @@ static void set_ospi_cmd(OSPI_RegularCmdTypeDef *ospi_cmd,
     ospi_cmd->DataMode = data_line_map[cmd->data_lines];
 }
 
+static void wait_for_ready(void);
+
 static void OSPI_ReadBytes(const flash_cmd_t *cmd,
                            uint32_t address,
                            uint8_t *data,
@@ -414,6 +422,8 @@ static void OSPI_ReadBytes(const flash_cmd_t *cmd,
 {
     OSPI_RegularCmdTypeDef ospi_cmd;
 
+    wait_for_ready();
+
     // DBG("RB %d 0x%08x 0x%08X %d\n", cmd->cmd, address, data, len);
 
     assert(flash.mem_mapped_enabled == false);
@@ -444,6 +454,8 @@ static void OSPI_WriteBytes(const flash_cmd_t *cmd,
 {
     OSPI_RegularCmdTypeDef ospi_cmd;
 
+    wait_for_ready();
+
     // DBG("WB %d 0x%08x 0x%08X %d\n", cmd->cmd, address, data, len);
 
     assert(flash.mem_mapped_enabled == false);
@@ -488,6 +500,57 @@ static void wait_for_status(uint8_t mask, uint8_t value, uint32_t timeout)
     } while ((status & mask) != value);
 }
 
+// Starts polling the status register in hardware until WIP is cleared. The
+// CPU is free until the next command, which waits for the flash to be ready.
+static void start_wait_for_wip(uint32_t timeout)
+{
+    OSPI_RegularCmdTypeDef ospi_cmd;
+    OSPI_AutoPollingTypeDef autopoll = {
+        .Match         = 0,
+        .Mask          = STATUS_WIP_Msk,
+        .MatchMode     = HAL_OSPI_MATCH_MODE_AND,
+        .AutomaticStop = HAL_OSPI_AUTOMATIC_STOP_ENABLE,
+        .Interval      = AUTOPOLL_INTERVAL,
+    };
+
+    assert(flash.busy == false);
+
+    set_ospi_cmd(&ospi_cmd, CMD(RDSR), 0, NULL, 1);
+
+    if (HAL_OSPI_Command(flash.hospi, &ospi_cmd, HAL_OSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (HAL_OSPI_AutoPolling_IT(flash.hospi, &autopoll) != HAL_OK) {
+        Error_Handler();
+    }
+
+    flash.busy = true;
+    flash.busy_t0 = HAL_GetTick();
+    flash.busy_timeout = timeout;
+}
+
+// Waits for the auto-polling started by start_wait_for_wip() to match
+static void wait_for_ready(void)
+{
+    if (!flash.busy) {
+        return;
+    }
+
+    // The state goes back to ready from the status match interrupt
+    while (HAL_OSPI_GetState(flash.hospi) != HAL_OSPI_STATE_READY) {
+        wdog_refresh();
+
+        if ((flash.busy_timeout > 0) && (HAL_GetTick() - flash.busy_t0 > flash.busy_timeout)) {
+            assert(!"Status poll timeout!");
+            HAL_OSPI_Abort(flash.hospi);
+            break;
+        }
+    }
+
+    flash.busy = false;
+}
+
 void OSPI_EnableMemoryMappedMode(void)
 {
     OSPI_MemoryMappedTypeDef sMemMappedCfg;
@@ -496,6 +559,9 @@ void OSPI_EnableMemoryMappedMode(void)
 
     assert(flash.mem_mapped_enabled == false);
 
+    // A program or erase may still be running
+    wait_for_ready();
+
     set_ospi_cmd(&ospi_cmd, cmd, 0, NULL, 0);
 
     // Memory-mapped mode configuration for linear burst read operations
@@ -541,14 +607,16 @@ static void _OSPI_Erase(const flash_cmd_t *cmd, uint32_t address)
 {
     OSPI_WriteBytes(cmd, address, NULL, 0);
 
-    // Wait for Write In Progress Bit to become zero
-    wait_for_status(STATUS_WIP_Msk, 0, 0);
+    // Wait for Write In Progress Bit to become zero.
+    // The next command or OSPI_WaitReady() waits for the erase to be done.
+    start_wait_for_wip(0);
 }
 
 void OSPI_ChipErase(void)
 {
     DBG("CE\n");
     _OSPI_Erase(CMD(CE), 0); // Chip Erase
+    wait_for_ready();
 }
 
 bool OSPI_Erase(uint32_t *address, uint32_t *size)
@@ -610,11 +678,13 @@ void OSPI_EraseSync(uint32_t address, uint32_t size)
     do {
         ret = OSPI_Erase(&address, &size);
     } while (ret == false);
+
+    wait_for_ready();
 }
 
-void OSPI_PageProgram(uint32_t address,
-                      const uint8_t *buffer,
-                      size_t buffer_size)
+void OSPI_PageProgramStart(uint32_t address,
+                           const uint8_t *buffer,
+                           size_t buffer_size)
 {
     assert(buffer_size <= 256);
 
@@ -622,8 +692,21 @@ void OSPI_PageProgram(uint32_t address,
 
     OSPI_WriteBytes(CMD(PP), address, buffer, buffer_size);
 
-    // Wait for Write In Progress Bit to become zero
-    wait_for_status(STATUS_WIP_Msk, 0, TMO_DEFAULT);
+    // Wait for Write In Progress Bit to become zero in the background
+    start_wait_for_wip(TMO_DEFAULT);
+}
+
+void OSPI_PageProgram(uint32_t address,
+                      const uint8_t *buffer,
+                      size_t buffer_size)
+{
+    OSPI_PageProgramStart(address, buffer, buffer_size);
+    wait_for_ready();
+}
+
+void OSPI_WaitReady(void)
+{
+    wait_for_ready();
 }
 
 void OSPI_NOR_WriteEnable(void)
@@ -643,13 +726,17 @@ void OSPI_Program(uint32_t address,
 
     assert((address & 0xff) == 0);
 
+    // WIP is polled by the OCTOSPI, the write enable of the next page goes
+    // out as soon as it clears.
     for (int i = 0; i < iterations; i++) {
         OSPI_NOR_WriteEnable();
-        OSPI_PageProgram((i + dest_page) * 256,
-                         buffer + (i * 256),
-                         buffer_size > 256 ? 256 : buffer_size);
+        OSPI_PageProgramStart((i + dest_page) * 256,
+                              buffer + (i * 256),
+                              buffer_size > 256 ? 256 : buffer_size);
         buffer_size -= 256;
     }
+
+    wait_for_ready();
 }
 
 void OSPI_ReadJedecId(uint8_t dest[3])
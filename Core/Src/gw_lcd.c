@@ -4,13 +4,8 @@
 #include "stm32h7xx_hal.h"
 #include "main.h"
 
-#if GW_LCD_MODE_LUT8
-uint8_t framebuffer1[GW_LCD_WIDTH * GW_LCD_HEIGHT];
-uint8_t framebuffer2[GW_LCD_WIDTH * GW_LCD_HEIGHT];
-#else
 uint16_t framebuffer1[GW_LCD_WIDTH * GW_LCD_HEIGHT];
 uint16_t framebuffer2[GW_LCD_WIDTH * GW_LCD_HEIGHT];
-#endif // GW_LCD_MODE_LUT8
 
 uint16_t *fb1 = framebuffer1;
 uint16_t *fb2 = framebuffer2;
@@ -21,7 +16,20 @@ extern DAC_HandleTypeDef hdac1;
 extern DAC_HandleTypeDef hdac2;
 
 uint32_t active_framebuffer;
-uint32_t frame_counter;
+volatile uint32_t frame_counter;
+
+// Format of the frame in fb1 and fb2, and the one the LTDC layer is set to
+static lcd_pixel_format_t fb_format[2];
+static lcd_pixel_format_t ltdc_format;
+
+// RGB888 CLUT, uploaded at the vertical blanking when clut_pending is set
+static uint32_t clut[LCD_LUT8_COLORS];
+static volatile uint32_t clut_pending;
+
+static const uint32_t ltdc_pixel_format[] = {
+  [LCD_PIXEL_FORMAT_RGB565] = LTDC_PIXEL_FORMAT_RGB565,
+  [LCD_PIXEL_FORMAT_LUT8]   = LTDC_PIXEL_FORMAT_L8,
+};
 
 void lcd_backlight_off()
 {
@@ -123,7 +131,28 @@ void lcd_init(SPI_HandleTypeDef *spi, LTDC_HandleTypeDef *ltdc) {
   __HAL_LTDC_ENABLE_IT(&hltdc, LTDC_IT_LI | LTDC_IT_RR);
 }
 
+static void lcd_set_ltdc_format(LTDC_HandleTypeDef *hltdc, lcd_pixel_format_t format)
+{
+  if (clut_pending) {
+    HAL_LTDC_ConfigCLUT(hltdc, clut, LCD_LUT8_COLORS, 0);
+    clut_pending = 0;
+  }
+
+  if (format != ltdc_format) {
+    // Takes effect with the reload done by HAL_LTDC_SetAddress()
+    HAL_LTDC_SetPixelFormat_NoReload(hltdc, ltdc_pixel_format[format], 0);
+    if (format == LCD_PIXEL_FORMAT_LUT8)
+      HAL_LTDC_EnableCLUT_NoReload(hltdc, 0);
+    else
+      HAL_LTDC_DisableCLUT_NoReload(hltdc, 0);
+    ltdc_format = format;
+  }
+}
+
 void HAL_LTDC_ReloadEventCallback (LTDC_HandleTypeDef *hltdc) {
+  // The buffer that was just drawn is the inactive one now
+  lcd_set_ltdc_format(hltdc, fb_format[active_framebuffer ? 0 : 1]);
+
   if (active_framebuffer == 0) {
     HAL_LTDC_SetAddress(hltdc, (uint32_t) fb2, 0);
   } else {
@@ -148,6 +177,10 @@ uint32_t lcd_get_pixel_position()
 
 void lcd_swap(void)
 {
+  if (fb_format[active_framebuffer] == LCD_PIXEL_FORMAT_LUT8 && lcd_lut8_commit(clut)) {
+    clut_pending = 1;
+  }
+
   HAL_LTDC_Reload(&hltdc, LTDC_RELOAD_VERTICAL_BLANKING);
   active_framebuffer = active_framebuffer ? 0 : 1;
 }
@@ -159,7 +192,54 @@ void lcd_sync(void)
 
   if (active != inactive) {
     memcpy(inactive, active, sizeof(framebuffer1));
+    fb_format[active_framebuffer ? 0 : 1] = fb_format[active_framebuffer];
+  }
+}
+
+void lcd_set_pixel_format(lcd_pixel_format_t format)
+{
+  if (fb_format[active_framebuffer] == format) {
+    return;
+  }
+
+  // The blits don't redraw the borders, clear what was left in the other format
+  if (format == LCD_PIXEL_FORMAT_LUT8) {
+    memset(lcd_get_active_buffer(), lcd_lut8_background(), GW_LCD_WIDTH * GW_LCD_HEIGHT);
+  } else {
+    memset(lcd_get_active_buffer(), 0, sizeof(framebuffer1));
+  }
+  fb_format[active_framebuffer] = format;
+}
+
+lcd_pixel_format_t lcd_get_pixel_format(void)
+{
+  return fb_format[active_framebuffer];
+}
+
+lcd_pixel_format_t lcd_get_buffer_pixel_format(const void *buffer)
+{
+  return fb_format[buffer == fb2 ? 1 : 0];
+}
+
+void lcd_restore_rgb565(void)
+{
+  if (fb_format[0] == LCD_PIXEL_FORMAT_RGB565 && fb_format[1] == LCD_PIXEL_FORMAT_RGB565) {
+    return;
+  }
+
+  // The displayed buffer is expanded too, switch the layer before the next frame
+  __disable_irq();
+  if (fb_format[0] == LCD_PIXEL_FORMAT_LUT8) {
+    lcd_lut8_expand_in_place(fb1, GW_LCD_WIDTH * GW_LCD_HEIGHT);
+    fb_format[0] = LCD_PIXEL_FORMAT_RGB565;
+  }
+  if (fb_format[1] == LCD_PIXEL_FORMAT_LUT8) {
+    lcd_lut8_expand_in_place(fb2, GW_LCD_WIDTH * GW_LCD_HEIGHT);
+    fb_format[1] = LCD_PIXEL_FORMAT_RGB565;
   }
+  lcd_set_ltdc_format(&hltdc, LCD_PIXEL_FORMAT_RGB565);
+  HAL_LTDC_Reload(&hltdc, LTDC_RELOAD_IMMEDIATE);
+  __enable_irq();
 }
 
 void* lcd_get_active_buffer(void)
@@ -174,6 +254,9 @@ void* lcd_get_inactive_buffer(void)
 
 void lcd_reset_active_buffer(void)
 {
+  fb_format[0] = LCD_PIXEL_FORMAT_RGB565;
+  fb_format[1] = LCD_PIXEL_FORMAT_RGB565;
+  lcd_set_ltdc_format(&hltdc, LCD_PIXEL_FORMAT_RGB565);
   HAL_LTDC_SetAddress(&hltdc, (uint32_t) fb1, 0);
   active_framebuffer = 0;
 }
@@ -187,8 +270,9 @@ void lcd_set_buffers(uint16_t *buf1, uint16_t *buf2)
 void lcd_wait_for_vblank(void)
 {
   uint32_t old_counter = frame_counter;
+  // The LTDC line event interrupt wakes the core up
   while (old_counter == frame_counter) {
-    __asm("nop");
+    __WFI();
   }
 }
 
@@ -2,60 +2,95 @@
 #include <assert.h>
 #include <stdio.h>
 #include "main.h"
+#include "gw_arena.h"
 #include "gw_malloc.h"
 
-static uint32_t current_ahb_pointer;
+static gw_arena_t ahb_arena;
 extern uint32_t __ahbram_start__;
 extern uint32_t __ahbram_end__;
 extern uint16_t __AHBRAM_LENGTH__;
 
-static uint32_t current_itc_pointer;
+static gw_arena_t itc_arena;
 extern uint32_t __itcram_start__;
 extern uint32_t __itcram_end__;
 extern uint16_t __ITCMRAM_LENGTH__;
 extern uint16_t __NULLPTR_LENGTH__;
 
 /* Ram allocation here is simple and does not support free or reallocation  */
-/* What is possible is to reinitialize all allocated buffers by calling the */
-/* AHB/ITC init function.                                                   */
+/* of single buffers. Everything allocated after a mark can be released,    */
+/* the AHB/ITC init functions release all allocated buffers.                */
+/* Peak usage is kept across releases, see gw_malloc_report().              */
 
 /* AHB RAM is 128kB, but it's not cached (as it's used for audio DMA it can't)
    so access to data in AHB RAM is slower than in other RAMs, only use this RAM
    for not time critical ressources */
 void ahb_init() {
-  current_ahb_pointer = (uint32_t)(&__ahbram_end__);
+  if (ahb_arena.base == NULL) {
+    uint32_t start = (uint32_t)(&__ahbram_end__);
+    uint32_t end = ((uint32_t)&__ahbram_start__) + ((uint32_t)(&__AHBRAM_LENGTH__));
+    gw_arena_init(&ahb_arena, "AHB", (void *)start, end - start);
+  } else {
+    gw_arena_release(&ahb_arena, 0);
+  }
 }
 
-void *ahb_malloc(size_t size) {
-  void *pointer = (void *)current_ahb_pointer;
-//  printf("hab_malloc 0x%lx size %d\n",current_ahb_pointer,size);
-  current_ahb_pointer += size;
-  assert((current_ahb_pointer) <= ((((uint32_t)&__ahbram_start__) + ((uint32_t)(&__AHBRAM_LENGTH__)))));
+void *ahb_malloc_tag(size_t size, const char *tag) {
+  void *pointer = gw_arena_alloc(&ahb_arena, size, tag);
+//  printf("ahb_malloc %p size %d\n",pointer,size);
+  assert(pointer != NULL);
   return pointer;
 }
 
-void *ahb_calloc(size_t count,size_t size) {
-  void *pointer = ahb_malloc(count*size);
+void *ahb_calloc_tag(size_t count,size_t size, const char *tag) {
+  void *pointer = ahb_malloc_tag(count*size, tag);
   memset(pointer,0,count*size);
   return pointer;
 }
 
-/* AHB RAM is 64kB, it's fast RAM and can be used for any purpose */
+size_t ahb_mark() {
+  return gw_arena_mark(&ahb_arena);
+}
+
+void ahb_release(size_t mark) {
+  gw_arena_release(&ahb_arena, mark);
+}
+
+/* ITC RAM is 64kB, it's fast RAM and can be used for any purpose */
 
 void itc_init() {
-  current_itc_pointer = (uint32_t)(&__itcram_end__);
+  if (itc_arena.base == NULL) {
+    uint32_t start = (uint32_t)(&__itcram_end__);
+    uint32_t end = ((uint32_t)&__itcram_start__) + ((uint32_t)(&__ITCMRAM_LENGTH__)) - ((uint32_t)(&__NULLPTR_LENGTH__));
+    gw_arena_init(&itc_arena, "ITC", (void *)start, end - start);
+  } else {
+    gw_arena_release(&itc_arena, 0);
+  }
 }
 
-void *itc_malloc(size_t size) {
-  void *pointer = (void *)current_itc_pointer;
-//  printf("itc_malloc 0x%lx size %d\n",current_itc_pointer,size);
-  current_itc_pointer += size;
-  assert((current_itc_pointer) <= ((((uint32_t)&__itcram_start__) + ((uint32_t)(&__ITCMRAM_LENGTH__)) - ((uint32_t)(&__NULLPTR_LENGTH__)))));
+void *itc_malloc_tag(size_t size, const char *tag) {
+  void *pointer = gw_arena_alloc(&itc_arena, size, tag);
+//  printf("itc_malloc %p size %d\n",pointer,size);
+  assert(pointer != NULL);
   return pointer;
 }
 
-void *itc_calloc(size_t count,size_t size) {
-  void *pointer = itc_malloc(count*size);
+void *itc_calloc_tag(size_t count,size_t size, const char *tag) {
+  void *pointer = itc_malloc_tag(count*size, tag);
   memset(pointer,0,count*size);
   return pointer;
 }
+
+size_t itc_mark() {
+  return gw_arena_mark(&itc_arena);
+}
+
+void itc_release(size_t mark) {
+  gw_arena_release(&itc_arena, mark);
+}
+
+/* Printed to logbuf, read it with scripts/dump_logs.sh */
+void gw_malloc_report() {
+  gw_arena_report(&ahb_arena);
+  gw_arena_report(&itc_arena);
+  printf("Heap: %u/%u used\n", (unsigned)heap_used(), (unsigned)heap_size());
+}
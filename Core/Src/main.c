@@ -233,6 +233,7 @@ void store_erase(const uint8_t *flash_ptr, uint32_t size)
     ((flash_ptr >= &__OFFSAVEFLASH_START__)   && ((flash_ptr + size) <= &__OFFSAVEFLASH_END__)) ||
     ((flash_ptr >= &__SAVEFLASH_START__)   && ((flash_ptr + size) <= &__SAVEFLASH_END__)) ||
     ((flash_ptr >= &__configflash_start__) && ((flash_ptr + size) <= &__configflash_end__)) ||
+    ((flash_ptr >= &__configflash2_start__) && ((flash_ptr + size) <= &__configflash2_end__)) ||
     ((flash_ptr >= &__fbflash_start__) && ((flash_ptr + size) <= &__fbflash_end__))
   );
 
@@ -280,6 +281,42 @@ void store_save(const uint8_t *flash_ptr, const uint8_t *data, size_t size)
   OSPI_EnableMemoryMappedMode();
 }
 
+/*
+  Programs `size` bytes at any address of an already erased area, for the
+  settings journal. Unlike store_save() nothing is erased.
+*/
+void store_program(const uint8_t *flash_ptr, const uint8_t *data, size_t size)
+{
+#ifdef DISABLE_STORE
+  return;
+#endif
+  if (flash_ptr == 0) {
+    return;
+  }
+  assert(
+    ((flash_ptr >= &__configflash_start__) && ((flash_ptr + size) <= &__configflash_end__)) ||
+    ((flash_ptr >= &__configflash2_start__) && ((flash_ptr + size) <= &__configflash2_end__))
+  );
+
+  // Convert mem mapped pointer to flash address
+  uint32_t address = flash_ptr - &__EXTFLASH_BASE__;
+
+  OSPI_DisableMemoryMappedMode();
+  while (size > 0) {
+    // A page program wraps around at the end of the 256 bytes page
+    size_t chunk = 256 - (address & 0xff);
+    if (chunk > size)
+      chunk = size;
+
+    OSPI_NOR_WriteEnable();
+    OSPI_PageProgram(address, data, chunk);
+    address += chunk;
+    data += chunk;
+    size -= chunk;
+  }
+  OSPI_EnableMemoryMappedMode();
+}
+
 void boot_magic_set(uint32_t magic)
 {
   boot_magic = magic;
@@ -302,6 +339,93 @@ uint32_t oc_level_gets()
   return ((level > 2) || (level < 0)) ? 0 : level;
 }
 
+/*
+  PLL1 settings of each level, see SystemClock_Config(). PLL2 (SAI, ADC) and
+  PLL3 (LTDC) share the HSI source and have their own dividers, so PLL1 can
+  be retuned without touching them.
+*/
+static void oc_level_pll1_config(uint32_t level, RCC_PLLInitTypeDef *pll)
+{
+  pll->PLLState = RCC_PLL_ON;
+  pll->PLLSource = RCC_PLLSOURCE_HSI;
+  switch (level) {
+    case 1: // Intermediate overclocking
+      pll->PLLM = 16;
+      pll->PLLN = 156;
+      pll->PLLP = 2;
+      pll->PLLQ = 6;
+      pll->PLLR = 2;
+      break;
+    case 2: // Maximum overclocking
+      pll->PLLM = 38;
+      pll->PLLN = 420;
+      pll->PLLP = 2;
+      pll->PLLQ = 7;
+      pll->PLLR = 2;
+      break;
+    default: // No overclocking
+      pll->PLLM = 16;
+      pll->PLLN = 140;
+      pll->PLLP = 2;
+      pll->PLLQ = 2;
+      pll->PLLR = 2;
+      break;
+  }
+  pll->PLLRGE = RCC_PLL1VCIRANGE_2;
+  pll->PLLVCOSEL = RCC_PLL1VCOWIDE;
+  pll->PLLFRACN = 0;
+}
+
+/*
+  Switches the core clock to another level without rebooting, for the clock
+  governor. The level selected in the settings (oc_level_gets()) is kept for
+  the next boot. While PLL1 is stopped the core runs from HSI and the OSPI
+  from CLKP (HSI), and nothing may run from the external flash.
+*/
+void oc_level_apply(uint32_t level)
+{
+  RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+  RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+  uint32_t flash_latency;
+
+  if ((level > 2) || (level == oc_level_get()))
+    return;
+
+  HAL_RCC_GetClockConfig(&RCC_ClkInitStruct, &flash_latency);
+  RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_SYSCLK;
+
+  __disable_irq();
+
+  __HAL_RCC_OSPI_CONFIG(RCC_OSPICLKSOURCE_CLKP);
+
+  RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_HSI;
+  if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, flash_latency) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+  oc_level_pll1_config(level, &RCC_OscInitStruct.PLL);
+  if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  // Also updates SystemCoreClock and the SysTick reload
+  RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
+  if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, flash_latency) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  if (level != 0)
+    __HAL_RCC_OSPI_CONFIG(RCC_OSPICLKSOURCE_PLL);
+
+  oc_level = (level << 16) | (oc_level & 0xFFFF);
+
+  __enable_irq();
+}
+
 void uptime_inc(void)
 {
   uptime_s++;
@@ -594,8 +718,6 @@ void SystemClock_Config(void)
   RCC_OscInitStruct.HSIState = RCC_HSI_DIV1;
   RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
   RCC_OscInitStruct.LSIState = RCC_LSI_ON;
-  RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
-  RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSI;
   /*
     NORMAL : PLLM = 16 PLLN=140 PLLP=2 PLLQ=2 PLLR=2 Clock is ClockP >> 280MHz and OSPI 64MHz
     BOOST 1: PLLM = 16 PLLN=156 PLLP=2 PLLQ=6 PLLR=2 CLOCKPLL >> 312MHz CoreClock and OSPI 104MHz
@@ -603,35 +725,8 @@ void SystemClock_Config(void)
     CoreClock= HSI/PLLM x PLLN/PLLP
     OSPIClock= HSI/PLLM x PLLN/PLLQ
   */
-  switch (oc_level & 0xF) {
-    case 1: // Intermediate overclocking
-      RCC_OscInitStruct.PLL.PLLM = 16;
-      RCC_OscInitStruct.PLL.PLLN = 156;
-      RCC_OscInitStruct.PLL.PLLP = 2;
-      RCC_OscInitStruct.PLL.PLLQ = 6;
-      RCC_OscInitStruct.PLL.PLLR = 2;
-      oc_level = 0x10001; 
-      break;
-    case 2: // Maximum overclocking
-      RCC_OscInitStruct.PLL.PLLM = 38;
-      RCC_OscInitStruct.PLL.PLLN = 420;
-      RCC_OscInitStruct.PLL.PLLP = 2;
-      RCC_OscInitStruct.PLL.PLLQ = 7;
-      RCC_OscInitStruct.PLL.PLLR = 2;
-      oc_level = 0x20002; 
-      break;
-    default: // No overclocking
-      RCC_OscInitStruct.PLL.PLLM = 16;
-      RCC_OscInitStruct.PLL.PLLN = 140;
-      RCC_OscInitStruct.PLL.PLLP = 2;
-      RCC_OscInitStruct.PLL.PLLQ = 2;
-      RCC_OscInitStruct.PLL.PLLR = 2;
-      oc_level = 0; 
-      break; 
-  }
-  RCC_OscInitStruct.PLL.PLLRGE = RCC_PLL1VCIRANGE_2;
-  RCC_OscInitStruct.PLL.PLLVCOSEL = RCC_PLL1VCOWIDE;
-  RCC_OscInitStruct.PLL.PLLFRACN = 0;
+  oc_level = oc_level_gets() * 0x10001;
+  oc_level_pll1_config(oc_level_get(), &RCC_OscInitStruct.PLL);
   if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
   {
     Error_Handler();
@@ -909,11 +1004,7 @@ static void MX_LTDC_Init(void)
   pLayerCfg.WindowX1 = 320;
   pLayerCfg.WindowY0 = 0;
   pLayerCfg.WindowY1 = 240;
-#ifdef GW_LCD_MODE_LUT8
-  pLayerCfg.PixelFormat = LTDC_PIXEL_FORMAT_L8;
-#else
   pLayerCfg.PixelFormat = LTDC_PIXEL_FORMAT_RGB565;
-#endif
   pLayerCfg.Alpha = 255;
   pLayerCfg.Alpha0 = 255;
   pLayerCfg.BlendingFactor1 = LTDC_BLENDING_FACTOR1_CA;
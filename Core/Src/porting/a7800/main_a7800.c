@@ -9,6 +9,7 @@
 #include "gw_buttons.h"
 #include "rom_manager.h"
 #include "common.h"
+#include "audio_mix.h"
 #include "lz4_depack.h"
 #include "miniz.h"
 #include "lzma.h"
@@ -171,6 +172,8 @@ static void display_ResetPalette(void)
                                  ((g & 0x00F800) >> 5) |
                                  ((b & 0x0000F8) >> 3);
    }
+   lcd_lut8_set_palette(display_palette16, 0, 256);
+   lcd_lut8_set_background(0);
 }
 
 void update_joystick(odroid_gamepad_state_t *joystick) {
@@ -237,33 +240,16 @@ static void sound_store(int16_t *audio_out_buf)
         tia_samples_buf = pokeyMixBuffer;
     }
 
-    // MUST shift with at least 1 place, or it will brownout.
-    uint8_t volume = odroid_audio_volume_get();
-    int32_t factor = volume_tbl[volume];
-
-    if (audio_mute || (volume == ODROID_AUDIO_VOLUME_MIN)) {
-        // mute
-        for (int i = 0; i < tia_size; i++) {
-            audio_out_buf[i] = 0;
-        }
-        return;
-    }
-
     // Write to DMA buffer and lower the volume accordingly
-    for (int i = 0; i < tia_size; i++) {
-        int32_t sample = *(tia_samples_buf++) << 8;
-        audio_out_buf[i] = (sample * factor) >> 8;
-    }
+    audio_mix_u8(audio_out_buf, tia_samples_buf, tia_size, common_emu_sound_get_volume(), 0);
 }
 
 int app_main_a7800(uint8_t load_state, uint8_t start_paused, uint8_t save_slot)
 {
-    size_t offset;
     const uint8_t *buffer = NULL;
     uint32_t rom_length = 0;
     uint8_t *rom_ptr = NULL;
 
-    static dma_transfer_state_t last_dma_state = DMA_TRANSFER_STATE_HF;
     odroid_gamepad_state_t joystick;
     odroid_dialog_choice_t options[] = {
         ODROID_DIALOG_CHOICE_LAST
@@ -347,22 +333,18 @@ int app_main_a7800(uint8_t load_state, uint8_t start_paused, uint8_t save_slot)
         videoHeight = Rect_GetHeight(&maria_visibleArea);
         buffer      = maria_surface + ((maria_visibleArea.top - maria_displayArea.top) * Rect_GetLength(&maria_visibleArea));
 
-        BLIT_VIDEO_BUFFER(uint16_t, buffer, display_palette16, 320, 240, 320, lcd_get_active_buffer());
-
-        offset = (dma_state == DMA_TRANSFER_STATE_HF) ? 0 : AUDIO_SAMPLE_BUFFER_SIZE;
+        if (common_emu_lut8_frame(false)) {
+            // Same layout, the LTDC does the palette lookup
+            memcpy(lcd_get_active_buffer(), buffer, 320 * 240);
+        } else {
+            BLIT_VIDEO_BUFFER(uint16_t, buffer, display_palette16, 320, 240, 320, lcd_get_active_buffer());
+        }
 
-        sound_store(&audiobuffer_dma[offset]);
+        sound_store(common_emu_sound_get_buffer(AUDIO_SAMPLE_BUFFER_SIZE));
 
         common_ingame_overlay();
         lcd_swap();
-        if(!common_emu_state.skip_frames){
-            for(uint8_t p = 0; p < common_emu_state.pause_frames + 1; p++) {
-                while (dma_state == last_dma_state) {
-                    cpumon_sleep();
-                }
-                last_dma_state = dma_state;
-            }
-        }
+        common_emu_sound_sync(true);
     }
 
     return 0;
@@ -433,4 +433,54 @@ int catalog_probe(t_drive *drive, unsigned char user)
    return catalogue.last_entry;
 }
 
+const catalogue_meta_t *catalog_load_prebuilt(const unsigned char *image, unsigned int size)
+{
+   const catalogue_meta_t *meta;
+   const catalogue_meta_entry_t *entries;
+   unsigned int meta_size;
+
+   if (image == NULL || size < sizeof(catalogue_meta_t) + 8)
+      return NULL;
+
+   if (memcmp(image + size - 4, CAT_META_MAGIC, 4) != 0)
+      return NULL;
+
+   meta_size = image[size - 8] | (image[size - 7] << 8) | (image[size - 6] << 16) | (image[size - 5] << 24);
+   if (meta_size < sizeof(catalogue_meta_t) + 8 || meta_size > size)
+      return NULL;
+
+   meta = (const catalogue_meta_t *) (image + size - meta_size);
+   entries = (const catalogue_meta_entry_t *) (meta + 1);
+
+   if (meta->version != CAT_META_VERSION || meta->entry_count > CAT_MAX_ENTRY)
+      return NULL;
+
+   if (sizeof(catalogue_meta_t) + meta->entry_count * sizeof(catalogue_meta_entry_t) + 8 != meta_size)
+      return NULL;
+
+   memset(&catalogue, 0, sizeof(catalogue_info_t));
+
+   catalogue.has_cat_art = (meta->flags & CAT_META_CAT_ART) != 0;
+   catalogue.probe_cpm = (meta->flags & CAT_META_PROBE_CPM) != 0;
+   catalogue.last_entry = meta->entry_count;
+   catalogue.entries_listed_found = meta->entries_listed_found;
+   catalogue.entries_hidden_found = meta->entries_hidden_found;
+   catalogue.first_listed_dirent = meta->first_listed_dirent;
+   catalogue.first_hidden_dirent = meta->first_hidden_dirent;
+   catalogue.track_listed_id = meta->track_listed_id;
+   catalogue.track_hidden_id = meta->track_hidden_id;
+
+   for (int idx = 0; idx < meta->entry_count; idx++)
+   {
+      strncpy(catalogue.dirent[idx].filename, entries[idx].filename, CAT_META_NAME_SIZE);
+      catalogue.dirent[idx].is_hidden = entries[idx].is_hidden;
+   }
+
+   #ifdef CATALOG_DEBUG
+   printf("[CATALOG-NEW]: prebuilt, %i entries, format %u\n", catalogue.last_entry, meta->format_type);
+   #endif
+
+   return meta;
+}
+
 #endif
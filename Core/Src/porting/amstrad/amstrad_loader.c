@@ -245,4 +245,26 @@ void loader_run (char * key_buffer)
 
    _loader_run(key_buffer, test_format, current_drive);
 }
+
+bool loader_run_prebuilt (char * key_buffer, const unsigned char *image, unsigned int size)
+{
+   const catalogue_meta_t *meta;
+
+   // The catalog is computed for AMSDOS, CPM boot lists .COM files
+   if (amstrad_is_cpm)
+      return false;
+
+   meta = catalog_load_prebuilt(image, size);
+   if (!meta)
+      return false;
+
+   memset(key_buffer, 0, LOADER_MAX_SIZE);
+   strncpy(key_buffer, meta->command, CAT_META_COMMAND_SIZE - 1);
+
+   #ifdef LOADER_DEBUG
+   printf("[  LOADER  ] >>> prebuilt [%s]\n", key_buffer);
+   #endif
+
+   return true;
+}
 #endif
@@ -9,6 +9,7 @@
 #include "gw_buttons.h"
 #include "rom_manager.h"
 #include "common.h"
+#include "audio_mix.h"
 #include "lz4_depack.h"
 #include "miniz.h"
 #include "lzma.h"
@@ -227,6 +228,9 @@ int SHIFTON = 0;
 uint8_t amstrad_framebuffer[CPC_SCREEN_WIDTH*CPC_SCREEN_HEIGHT];
 
 char loader_buffer[512];
+// Disk attached at launch, to read the auto-run command computed at build time
+static const uint8_t *autorun_disk;
+static uint32_t autorun_disk_size;
 
 static const uint8_t IMG_DISKETTE[] = {
     0x00, 0x00, 0x00, 0x3F, 0xFF, 0xE0, 0x7C, 0x00, 0x70, 0x7C, 0x03, 0x78,
@@ -280,19 +284,28 @@ void save_amstrad_data() {
     amstradSaveStateSet(state, "selected_key_index", selected_key_index);
 }
 
-static bool amstrad_system_saveState(char *pathName)
+// Index 0xFF of the RGB332 palette is white
+static void draw_disk_icon(void *buffer, uint16_t offset)
 {
-    // Show disk icon when saving state
-    uint16_t *dest = lcd_get_inactive_buffer();
+    bool lut8 = lcd_get_buffer_pixel_format(buffer) == LCD_PIXEL_FORMAT_LUT8;
     uint16_t idx = 0;
     for (uint8_t i = 0; i < 24; i++) {
         for (uint8_t j = 0; j < 24; j++) {
         if (IMG_DISKETTE[idx / 8] & (1 << (7 - idx % 8))) {
-            dest[274 + j + GW_LCD_WIDTH * (2 + i)] = 0xFFFF;
+            if (lut8)
+                ((uint8_t *)buffer)[offset + j + GW_LCD_WIDTH * (2 + i)] = 0xFF;
+            else
+                ((uint16_t *)buffer)[offset + j + GW_LCD_WIDTH * (2 + i)] = 0xFFFF;
         }
         idx++;
         }
     }
+}
+
+static bool amstrad_system_saveState(char *pathName)
+{
+    // Show disk icon when saving state
+    draw_disk_icon(lcd_get_inactive_buffer(), 274);
 #if OFF_SAVESTATE==1
     if (strcmp(pathName,"1") == 0) {
         // Save in common save slot (during a power off)
@@ -699,38 +712,63 @@ __attribute__((optimize("unroll-loops"))) static inline void screen_blit_nn(uint
     }
 }
 
+// LUT8 versions of blit_normal() and screen_blit_nn(), the LTDC does the palette lookup
+static inline void blit_normal_lut8(uint8_t *src_fb, uint8_t *framebuffer)
+{
+    const int w1 = CPC_SCREEN_WIDTH;
+    const int w2 = GW_LCD_WIDTH;
+    const int h2 = GW_LCD_HEIGHT;
+
+    for (int y = 0; y < h2; y++)
+    {
+        memcpy(&framebuffer[y * w2], &src_fb[(y + 24) * w1 + 32], w2);
+    }
+}
+
+__attribute__((optimize("unroll-loops"))) static inline void screen_blit_nn_lut8(uint8_t *src_fb, uint8_t *framebuffer)
+{
+    int x_ratio = (int)((CPC_SCREEN_WIDTH << 16) / GW_LCD_WIDTH) + 1;
+    int y_ratio = (int)((CPC_SCREEN_HEIGHT << 16) / GW_LCD_HEIGHT) + 1;
+
+    for (int i = 0; i < GW_LCD_HEIGHT; i++)
+    {
+        uint8_t *src_row = &src_fb[((i * y_ratio) >> 16) * image_buffer_current_width];
+        uint8_t *dest_row = &framebuffer[i * WIDTH];
+        for (int j = 0; j < GW_LCD_WIDTH; j++)
+        {
+            dest_row[j] = src_row[(j * x_ratio) >> 16];
+        }
+    }
+}
+
 static void blit(uint8_t *src_fb, uint16_t *framebuffer)
 {
     odroid_display_scaling_t scaling = odroid_display_get_scaling_mode();
     uint16_t offset = GW_LCD_WIDTH-26;
+    bool lut8 = common_emu_lut8_frame(false);
 
     switch (scaling)
     {
-    case ODROID_DISPLAY_SCALING_OFF:
-        blit_normal(src_fb, framebuffer);
-        break;
     // Full height, borders on the side
     case ODROID_DISPLAY_SCALING_FIT:
     case ODROID_DISPLAY_SCALING_FULL:
-        screen_blit_nn(src_fb, framebuffer);
+        if (lut8)
+            screen_blit_nn_lut8(src_fb, (uint8_t *)framebuffer);
+        else
+            screen_blit_nn(src_fb, framebuffer);
         break;
     default:
-        printf("Unsupported scaling mode %d\n", scaling);
-        blit_normal(src_fb, framebuffer);
+        if (scaling != ODROID_DISPLAY_SCALING_OFF)
+            printf("Unsupported scaling mode %d\n", scaling);
+        if (lut8)
+            blit_normal_lut8(src_fb, (uint8_t *)framebuffer);
+        else
+            blit_normal(src_fb, framebuffer);
         break;
     }
 
     if (show_disk_icon) {
-        uint16_t *dest = lcd_get_active_buffer();
-        uint16_t idx = 0;
-        for (uint8_t i = 0; i < 24; i++) {
-            for (uint8_t j = 0; j < 24; j++) {
-            if (IMG_DISKETTE[idx / 8] & (1 << (7 - idx % 8))) {
-                dest[offset + j + GW_LCD_WIDTH * (2 + i)] = 0xFFFF;
-            }
-            idx++;
-            }
-        }
+        draw_disk_icon(framebuffer, offset);
     }
     common_ingame_overlay();
     lcd_swap();
@@ -741,8 +779,8 @@ void amstrad_pcm_submit()
     // update sound volume in emulator
     amstrad_set_volume(volume_table[odroid_audio_volume_get()]);
 
-    size_t offset = (dma_state == DMA_TRANSFER_STATE_HF) ? 0 : AMSTRAD_SAMPLE_RATE / AMSTRAD_FPS;
-    memcpy(&audiobuffer_dma[offset],soundBuffer,2 * AMSTRAD_SAMPLE_RATE / AMSTRAD_FPS);
+    audio_mix_copy(common_emu_sound_get_buffer(AMSTRAD_SAMPLE_RATE / AMSTRAD_FPS), soundBuffer,
+                   AMSTRAD_SAMPLE_RATE / AMSTRAD_FPS);
 }
 
 bool amstrad_is_cpm;
@@ -797,7 +835,9 @@ static void computer_autoload()
     //   {
     //      strncpy(loader_buffer, game_configuration.loader_command, LOADER_MAX_SIZE);
     //   } else {
-    loader_run(loader_buffer);
+    if (!loader_run_prebuilt(loader_buffer, autorun_disk, autorun_disk_size)) {
+        loader_run(loader_buffer);
+    }
     //   }
 
     strcat(loader_buffer, "\n");
@@ -819,7 +859,6 @@ extern uint8_t *pbSndBuffer;
 void app_main_amstrad(uint8_t load_state, uint8_t start_paused, uint8_t save_slot)
 {
     pixel_t *fb;
-    static dma_transfer_state_t last_dma_state = DMA_TRANSFER_STATE_HF;
     odroid_gamepad_state_t joystick;
     odroid_dialog_choice_t options[10];
     int disk_load_result = 0;
@@ -835,6 +874,8 @@ void app_main_amstrad(uint8_t load_state, uint8_t start_paused, uint8_t save_slo
                         ((((i & 0x1C) >> 2) * 63 / 7) << 5) |
                         ((i & 0x3) * 31 / 3);
     }
+    lcd_lut8_set_palette(palette565, 0, 256);
+    lcd_lut8_set_background(0);
 
     if (load_state) {
 #if OFF_SAVESTATE==1
@@ -879,12 +920,16 @@ void app_main_amstrad(uint8_t load_state, uint8_t start_paused, uint8_t save_slo
             const rom_system_t *amstrad_system = rom_manager_system(&rom_mgr, "Amstrad CPC");
             selected_disk_index = rom_get_index_for_file_ext(amstrad_system, ACTIVE_FILE);
             disk_load_result = attach_disk_buffer((char *)ROM_DATA, 0);
+            autorun_disk = ROM_DATA;
+            autorun_disk_size = ROM_DATA_LENGTH;
             printf("attach_disk_buffer %d\n", disk_load_result);
         } else {
             retro_emulator_file_t *disk_file = NULL;
             const rom_system_t *amstrad_system = rom_manager_system(&rom_mgr, "Amstrad CPC");
             disk_file = (retro_emulator_file_t *)rom_get_ext_file_at_index(amstrad_system,AMSTRAD_DISK_EXTENSION,selected_disk_index);
             disk_load_result = attach_disk_buffer((char *)disk_file->address, 0);
+            autorun_disk = disk_file->address;
+            autorun_disk_size = disk_file->size;
             printf("attach_disk_buffer %d\n", disk_load_result);
         }
     }
@@ -943,17 +988,7 @@ void app_main_amstrad(uint8_t load_state, uint8_t start_paused, uint8_t save_slo
         amstrad_pcm_submit();
         amstrad_set_audio_buffer((int8_t *)soundBuffer, AMSTRAD_SAMPLE_RATE / AMSTRAD_FPS * 2);
 
-        if (!common_emu_state.skip_frames)
-        {
-            for (uint8_t p = 0; p < common_emu_state.pause_frames + 1; p++)
-            {
-                while (dma_state == last_dma_state)
-                {
-                    cpumon_sleep();
-                }
-                last_dma_state = dma_state;
-            }
-        }
+        common_emu_sound_sync(true);
     }
 }
 #endif
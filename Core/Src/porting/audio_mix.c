@@ -0,0 +1,185 @@
+#include "audio_mix.h"
+
+#include <string.h>
+
+#if defined(__ARM_FEATURE_DSP) && defined(__ARM_FEATURE_SIMD32)
+#include <arm_acle.h>
+#define AUDIO_MIX_DSP 1
+#else
+#define AUDIO_MIX_DSP 0
+#endif
+
+#define IS_WORD_ALIGNED(p) ((((uintptr_t)(p)) & 3) == 0)
+
+static inline int16_t sat16(int32_t value)
+{
+#if AUDIO_MIX_DSP
+    return __ssat(value, 16);
+#else
+    if (value > INT16_MAX)
+        return INT16_MAX;
+    if (value < INT16_MIN)
+        return INT16_MIN;
+    return value;
+#endif
+}
+
+#if AUDIO_MIX_DSP
+static inline uint32_t pack16(int32_t lo, int32_t hi)
+{
+    return ((uint32_t)lo & 0xFFFF) | ((uint32_t)hi << 16);
+}
+#endif
+
+__attribute__((optimize("unroll-loops")))
+void audio_mix_s16(int16_t *dst, const int16_t *src, size_t count, int32_t gain, int shift)
+{
+    size_t i = 0;
+
+    if (gain == 0) {
+        memset(dst, 0, count * sizeof(*dst));
+        return;
+    }
+
+#if AUDIO_MIX_DSP
+    if (IS_WORD_ALIGNED(dst) && IS_WORD_ALIGNED(src)) {
+        const uint32_t *in = (const uint32_t *)src;
+        uint32_t *out = (uint32_t *)dst;
+
+        for (; i + 1 < count; i += 2) {
+            uint32_t pair = *in++;
+            int32_t lo = __smulbb(pair, gain) >> shift;
+            int32_t hi = __smultb(pair, gain) >> shift;
+            *out++ = pack16(__ssat(lo, 16), __ssat(hi, 16));
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = sat16((src[i] * gain) >> shift);
+    }
+}
+
+__attribute__((optimize("unroll-loops")))
+void audio_mix_s16_add(int16_t *dst, const int16_t *src_a, const int16_t *src_b, size_t count, int32_t gain, int shift)
+{
+    size_t i = 0;
+
+    if (gain == 0) {
+        memset(dst, 0, count * sizeof(*dst));
+        return;
+    }
+
+#if AUDIO_MIX_DSP
+    if (IS_WORD_ALIGNED(dst) && IS_WORD_ALIGNED(src_a) && IS_WORD_ALIGNED(src_b)) {
+        const uint32_t *in_a = (const uint32_t *)src_a;
+        const uint32_t *in_b = (const uint32_t *)src_b;
+        uint32_t *out = (uint32_t *)dst;
+
+        for (; i + 1 < count; i += 2) {
+            uint32_t a = *in_a++;
+            uint32_t b = *in_b++;
+            int32_t lo = __smlabb(b, gain, __smulbb(a, gain)) >> shift;
+            int32_t hi = __smlatb(b, gain, __smultb(a, gain)) >> shift;
+            *out++ = pack16(__ssat(lo, 16), __ssat(hi, 16));
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = sat16(((src_a[i] + src_b[i]) * gain) >> shift);
+    }
+}
+
+__attribute__((optimize("unroll-loops")))
+void audio_mix_s16_stereo(int16_t *dst, const int16_t *src, size_t count, int32_t gain, int shift)
+{
+    size_t i = 0;
+
+    if (gain == 0) {
+        memset(dst, 0, count * sizeof(*dst));
+        return;
+    }
+
+#if AUDIO_MIX_DSP
+    if (IS_WORD_ALIGNED(src)) {
+        const uint32_t *in = (const uint32_t *)src;
+        uint32_t gain2 = pack16(gain, gain);
+
+        // One L/R pair per word, both multiplied and summed in one go
+        for (; i < count; i++) {
+            dst[i] = __ssat(__smuad(*in++, gain2) >> shift, 16);
+        }
+        return;
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = sat16(((src[2 * i] + src[2 * i + 1]) * gain) >> shift);
+    }
+}
+
+__attribute__((optimize("unroll-loops")))
+void audio_mix_s8_stereo(int16_t *dst, const int8_t *src, size_t count, int32_t gain, int shift)
+{
+    size_t i = 0;
+
+    if (gain == 0) {
+        memset(dst, 0, count * sizeof(*dst));
+        return;
+    }
+
+#if AUDIO_MIX_DSP
+    if (IS_WORD_ALIGNED(dst) && IS_WORD_ALIGNED(src)) {
+        const uint32_t *in = (const uint32_t *)src;
+        uint32_t *out = (uint32_t *)dst;
+
+        // A word holds L0 R0 L1 R1, unpack to [L0, L1] + [R0, R1]
+        for (; i + 1 < count; i += 2) {
+            uint32_t quad = *in++;
+            uint32_t sum = __sadd16(__sxtb16(quad), __sxtb16(__ror(quad, 8)));
+            int32_t lo = __smulbb(sum, gain) >> shift;
+            int32_t hi = __smultb(sum, gain) >> shift;
+            *out++ = pack16(__ssat(lo, 16), __ssat(hi, 16));
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = sat16(((src[2 * i] + src[2 * i + 1]) * gain) >> shift);
+    }
+}
+
+__attribute__((optimize("unroll-loops")))
+void audio_mix_u8(int16_t *dst, const uint8_t *src, size_t count, int32_t gain, int shift)
+{
+    if (gain == 0) {
+        memset(dst, 0, count * sizeof(*dst));
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = sat16((src[i] * gain) >> shift);
+    }
+}
+
+void audio_mix_s16_add_lowpass(int16_t *dst, const int16_t *src_a, const int16_t *src_b, size_t count,
+                               int32_t gain, int shift, uint32_t coef, int32_t *state)
+{
+    int32_t out = *state;
+    int64_t coef_in = coef;
+    int64_t coef_out = 0x10000 - coef;
+
+    // The filter has to keep running when muted so it does not pop on unmute
+    for (size_t i = 0; i < count; i++) {
+        out = (out * coef_out + (src_a[i] + src_b[i]) * coef_in) >> 16;
+        dst[i] = sat16((out * gain) >> shift);
+    }
+
+    *state = out;
+}
+
+void audio_mix_copy(int16_t *dst, const int16_t *src, size_t count)
+{
+    memcpy(dst, src, count * sizeof(*dst));
+}
@@ -0,0 +1,93 @@
+#include "audio_ring.h"
+
+void audio_ring_init(audio_ring_t *ring, int16_t *buffer)
+{
+    ring->buffer = buffer;
+    ring->length = 0;
+    ring->blocks = 0;
+    // The DMA starts with the first half, that the first block is written to
+    ring->playing = 1;
+    ring->filled[0] = 0;
+    ring->filled[1] = 0;
+    ring->concealed = false;
+    ring->active = false;
+    ring->writing = -1;
+    ring->write_blocks = 0;
+    ring->underruns = 0;
+    ring->overruns = 0;
+    ring->late_writes = 0;
+}
+
+int16_t *audio_ring_write_begin(audio_ring_t *ring, size_t length)
+{
+    uint8_t half = ring->playing ^ 1;
+
+    if (ring->writing == half && ring->write_blocks == ring->blocks)
+        return &ring->buffer[half * length];
+    if (ring->writing >= 0)
+        audio_ring_write_end(ring);
+
+    ring->length = length;
+    ring->write_blocks = ring->blocks;
+    ring->writing = half;
+
+    return &ring->buffer[half * length];
+}
+
+void audio_ring_write_end(audio_ring_t *ring)
+{
+    uint8_t half = ring->writing;
+
+    if (ring->writing < 0)
+        return;
+    ring->writing = -1;
+
+    if (ring->blocks != ring->write_blocks) {
+        // The half started playing while it was written
+        ring->late_writes++;
+        return;
+    }
+
+    if (ring->concealed) {
+        int16_t *dst = &ring->buffer[half * ring->length];
+        size_t fade = ring->length < AUDIO_RING_FADE ? ring->length : AUDIO_RING_FADE;
+
+        for (size_t i = 0; i < fade; i++)
+            dst[i] = dst[i] * (int32_t)i / (int32_t)fade;
+        ring->concealed = false;
+    }
+
+    // The block written before it never played
+    if (ring->filled[half])
+        ring->overruns++;
+
+    ring->filled[half] = 1;
+    ring->active = true;
+}
+
+void audio_ring_consume(audio_ring_t *ring, uint8_t half)
+{
+    ring->blocks++;
+    ring->playing = half;
+
+    if (ring->filled[half]) {
+        ring->filled[half] = 0;
+        return;
+    }
+    if (!ring->active)
+        return;
+
+    // The half plays the block it held again, audio_ring_write_end() fades
+    // the next one in
+    ring->underruns++;
+    ring->concealed = true;
+}
+
+void audio_ring_stop(audio_ring_t *ring)
+{
+    ring->active = false;
+    ring->filled[0] = 0;
+    ring->filled[1] = 0;
+    ring->concealed = false;
+    ring->writing = -1;
+}
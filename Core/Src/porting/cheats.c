@@ -0,0 +1,157 @@
+#include "cheats.h"
+
+#include <string.h>
+
+#define ALIGN4(x) (((x) + 3) & ~3)
+
+// Followed by uint32_t offsets[count], from the start of the table
+typedef struct {
+    uint16_t count;
+    uint8_t version;
+    uint8_t reserved;
+} table_header_t;
+
+// Followed by `writes` writes
+typedef struct {
+    uint16_t writes;
+    uint16_t reserved;
+} cheat_header_t;
+
+// Followed by `size` bytes, padded to 4
+typedef struct {
+    uint32_t address;
+    uint16_t size;
+    uint8_t type;     // cheat_type_t
+    uint8_t reserved;
+} write_header_t;
+
+int cheats_count(const uint8_t *table)
+{
+    table_header_t header;
+
+    if (table == NULL)
+        return 0;
+    memcpy(&header, table, sizeof(header));
+    return header.version == CHEATS_TABLE_VERSION ? header.count : 0;
+}
+
+// First write of a cheat
+static const uint8_t *cheat_writes(const uint8_t *table, int index, int *writes)
+{
+    cheat_header_t cheat;
+    uint32_t offset;
+
+    memcpy(&offset, table + sizeof(table_header_t) + index * sizeof(offset), sizeof(offset));
+    memcpy(&cheat, table + offset, sizeof(cheat));
+
+    *writes = cheat.writes;
+    return table + offset + sizeof(cheat);
+}
+
+static bool add_write(cheats_t *cheats, uint8_t *ptr, const uint8_t *data, uint8_t size)
+{
+    cheat_write_t *write;
+
+    if (cheats->count >= CHEATS_MAX_RAM_WRITES)
+        return false;
+
+    write = &cheats->writes[cheats->count++];
+    write->ptr = ptr;
+    write->value = 0;
+    write->size = size;
+    memcpy(&write->value, data, size);
+    return true;
+}
+
+void cheats_load(cheats_t *cheats, const uint8_t *table, cheats_enabled_t enabled, cheats_ram_t ram)
+{
+    int count = cheats_count(table);
+
+    cheats->count = 0;
+    cheats->dropped = 0;
+
+    for (int i = 0; i < count; i++) {
+        const uint8_t *pos;
+        int writes;
+
+        if (!enabled(i))
+            continue;
+
+        pos = cheat_writes(table, i, &writes);
+        for (int j = 0; j < writes; j++) {
+            write_header_t write;
+            const uint8_t *data = pos + sizeof(write);
+            uint8_t *ptr;
+
+            memcpy(&write, pos, sizeof(write));
+            pos = data + ALIGN4(write.size);
+            if (write.type != CHEAT_RAM)
+                continue;
+
+            ptr = ram(write.address, write.size);
+            if (ptr == NULL) {
+                cheats->dropped++;
+                continue;
+            }
+            // Split into words, then a halfword and a byte for the tail
+            for (uint32_t done = 0; done < write.size;) {
+                uint32_t left = write.size - done;
+                uint8_t size = left >= 4 ? 4 : left >= 2 ? 2 : 1;
+
+                if (!add_write(cheats, ptr + done, data + done, size)) {
+                    cheats->dropped++;
+                    break;
+                }
+                done += size;
+            }
+        }
+    }
+}
+
+int cheats_patch_rom(const uint8_t *table, cheats_enabled_t enabled, cheats_rom_t rom)
+{
+    int count = cheats_count(table);
+    int patched = 0;
+
+    for (int i = 0; i < count; i++) {
+        const uint8_t *pos;
+        int writes;
+
+        if (!enabled(i))
+            continue;
+
+        pos = cheat_writes(table, i, &writes);
+        for (int j = 0; j < writes; j++) {
+            write_header_t write;
+
+            memcpy(&write, pos, sizeof(write));
+            if (write.type == CHEAT_ROM) {
+                rom(write.address, pos + sizeof(write), write.size);
+                patched++;
+            }
+            pos += sizeof(write) + ALIGN4(write.size);
+        }
+    }
+    return patched;
+}
+
+void cheats_apply(const cheats_t *cheats)
+{
+    const cheat_write_t *write = cheats->writes;
+    const cheat_write_t *end = write + cheats->count;
+
+    // Little endian, the value is stored in the first bytes of the word
+    for (; write < end; write++) {
+        switch (write->size) {
+        case 4:
+            memcpy(write->ptr, &write->value, 4);
+            break;
+        case 2:
+            memcpy(write->ptr, &write->value, 2);
+            break;
+        default:
+            *write->ptr = write->value;
+            break;
+        }
+    }
+}
@@ -9,10 +9,15 @@
 #include <nes_input.h>
 #include <osd.h>
 #include "main.h"
+#include "audio_ring.h"
 #include "bitmaps.h"
+#include "cpu_governor.h"
+#include "frame_sched.h"
+#include "frame_stats.h"
 #include "gw_buttons.h"
 #include "gw_lcd.h"
 #include "gw_linker.h"
+#include "gw_malloc.h"
 #include "rg_i18n.h"
 
 #if ENABLE_SCREENSHOT
@@ -21,6 +26,9 @@ uint16_t framebuffer_capture[GW_LCD_WIDTH * GW_LCD_HEIGHT]  __attribute__((secti
 
 static void set_ingame_overlay(ingame_overlay_t type);
 
+// Battery level seen by the last common_ingame_overlay(), the warning needs RGB565 frames
+static bool low_battery = false;
+
 cpumon_stats_t cpumon_stats = {0};
 
 uint32_t audioBuffer[AUDIO_BUFFER_LENGTH];
@@ -30,8 +38,15 @@ uint32_t audio_mute;
 int16_t pendingSamples = 0;
 int16_t audiobuffer_dma[AUDIO_BUFFER_LENGTH * 2] __attribute__((section (".audio")));
 
-dma_transfer_state_t dma_state;
-uint32_t dma_counter;
+volatile dma_transfer_state_t dma_state;
+volatile uint32_t dma_counter;
+
+// Same state as audio_ring_init(), the DMA is started by each port
+audio_ring_t audio_ring = {
+    .buffer = audiobuffer_dma,
+    .playing = 1,
+    .writing = -1,
+};
 
 const uint8_t volume_tbl[ODROID_AUDIO_VOLUME_MAX + 1] = {
     (uint8_t)(UINT8_MAX * 0.00f),
@@ -50,14 +65,62 @@ void HAL_SAI_TxHalfCpltCallback(SAI_HandleTypeDef *hsai)
 {
     dma_counter++;
     dma_state = DMA_TRANSFER_STATE_HF;
+    audio_ring_consume(&audio_ring, 1);
 }
 
 void HAL_SAI_TxCpltCallback(SAI_HandleTypeDef *hsai)
 {
     dma_counter++;
     dma_state = DMA_TRANSFER_STATE_TC;
+    audio_ring_consume(&audio_ring, 0);
+}
+
+
+int16_t *common_emu_sound_get_buffer(size_t length)
+{
+    static int16_t dropped_block[AUDIO_BUFFER_LENGTH];
+    static uint32_t last_block;
+
+    // Fast forward makes blocks faster than the DMA plays them: the first
+    // one of each half is kept, the others go to a scratch block
+    if (odroid_system_get_app()->speedupEnabled > SPEEDUP_1x && dma_counter == last_block) {
+        return dropped_block;
+    }
+    last_block = dma_counter;
+
+    return audio_ring_write_begin(&audio_ring, length);
+}
+
+// Audio errors since the last frame, overruns are expected in fast forward
+static void common_emu_sound_stats(void)
+{
+    static uint32_t underruns;
+    static uint32_t overruns;
+    static uint32_t late_writes;
+    bool fast_forward = odroid_system_get_app()->speedupEnabled > SPEEDUP_1x;
+
+    frame_stats_audio(audio_ring.underruns - underruns, fast_forward ? 0 : audio_ring.overruns - overruns,
+                      audio_ring.late_writes - late_writes);
+    underruns = audio_ring.underruns;
+    overruns = audio_ring.overruns;
+    late_writes = audio_ring.late_writes;
+}
+
+void common_emu_sound_end(void)
+{
+    audio_ring_write_end(&audio_ring);
+    common_emu_sound_stats();
 }
 
+int32_t common_emu_sound_get_volume(void)
+{
+    uint8_t volume = odroid_audio_volume_get();
+
+    if (audio_mute || volume == ODROID_AUDIO_VOLUME_MIN) {
+        return 0;
+    }
+    return volume_tbl[volume];
+}
 
 bool odroid_netplay_quick_start(void)
 {
@@ -71,6 +134,7 @@ void odroid_audio_mute(bool mute)
         for (int i = 0; i < sizeof(audiobuffer_dma) / sizeof(audiobuffer_dma[0]); i++) {
             audiobuffer_dma[i] = 0;
         }
+        audio_ring_stop(&audio_ring);
     }
 
     audio_mute = mute;
@@ -80,6 +144,98 @@ common_emu_state_t common_emu_state = {
     .frame_time_10us = (uint16_t)(100000 / 60 + 0.5f),  // Reasonable default of 60FPS if not explicitly configured.
 };
 
+static cpu_governor_t cpu_governor;
+static uint32_t cpu_governor_missed;
+
+void common_emu_clock_init(void)
+{
+    uint32_t game_id = odroid_system_get_app()->gameId;
+    uint8_t max_level = odroid_settings_cpu_oc_level_get();
+    uint8_t level = max_level;
+    bool locked = false;
+
+    odroid_settings_cpu_tier_get(game_id, &level, &locked);
+    cpu_governor_init(&cpu_governor, level, max_level, locked);
+    oc_level_apply(cpu_governor.level);
+    cpu_governor_missed = common_emu_sync.missed;
+}
+
+/**
+ * Feeds the busy time of the last frame to the clock governor. Frames that
+ * don't run at normal speed (startup after a menu, fast forward) only drop
+ * the current window. The tier is remembered in RAM and written to flash
+ * with the other settings, not in the middle of a game.
+ */
+static void common_emu_clock_frame(uint32_t busy_ms, int16_t frame_time_10us, bool normal_speed)
+{
+    uint16_t missed = common_emu_sync.missed - cpu_governor_missed;
+    bool locked = cpu_governor.locked;
+    uint8_t level;
+
+    cpu_governor_missed = common_emu_sync.missed;
+
+    if (!normal_speed) {
+        cpu_governor_reset_window(&cpu_governor);
+        return;
+    }
+
+    level = cpu_governor_frame(&cpu_governor, 100 * busy_ms, frame_time_10us, missed);
+    if (level != cpu_governor.level) {
+        oc_level_apply(level);
+        cpu_governor.level = level;
+    } else if (locked == cpu_governor.locked) {
+        return;
+    }
+
+    odroid_settings_cpu_tier_set(odroid_system_get_app()->gameId, cpu_governor.level, cpu_governor.locked);
+}
+
+
+/**
+ * Fast-forward is paced on the clock instead of the audio DMA: frames are only
+ * slept on when ahead of the requested speed, so the speed is bounded by the
+ * CPU alone. The LCD can't show more than one frame per refresh, so all the
+ * others are skipped. Audio keeps its pitch: common_emu_sound_get_buffer()
+ * keeps the first block of each DMA half and drops the others.
+ */
+static void common_emu_fast_forward(int32_t *frame_integrator, int16_t frame_time_10us)
+{
+    static uint32_t last_drawn_frame;
+
+    // Running slower than asked for, don't try to catch up later
+    if (*frame_integrator > frame_time_10us) {
+        *frame_integrator = frame_time_10us;
+    }
+
+    if (*frame_integrator < 0) {
+        uint32_t t0 = get_elapsed_time();
+        while (*frame_integrator + 100 * (int32_t)get_elapsed_time_since(t0) < 0) {
+            cpumon_sleep();
+        }
+        *frame_integrator += 100 * get_elapsed_time_since(t0);
+        common_emu_state.last_sync_time = get_elapsed_time();
+    }
+
+    // Both values keep common_emu_sound_sync() from waiting on the DMA
+    if (frame_counter != last_drawn_frame) {
+        last_drawn_frame = frame_counter;
+        common_emu_state.skip_frames = 1;
+    } else {
+        common_emu_state.skip_frames = 2;
+    }
+    common_emu_state.skipped_frames += common_emu_state.skip_frames - 1;
+}
+
+// Normal speed time emulated since speed_start_time
+static uint32_t speed_emulated_10us;
+static uint32_t speed_start_time;
+
+uint16_t common_emu_speed_get(void)
+{
+    uint32_t elapsed_ms = get_elapsed_time_since(speed_start_time);
+
+    return elapsed_ms ? speed_emulated_10us / elapsed_ms : 0;
+}
 
 bool common_emu_frame_loop(void){
     rg_app_desc_t *app = odroid_system_get_app();
@@ -90,6 +246,8 @@ bool common_emu_frame_loop(void){
 
     if( !cpumon_stats.busy_ms ) cpumon_busy();
     odroid_system_tick(!draw_frame, 0, cpumon_stats.busy_ms);
+    common_emu_clock_frame(cpumon_stats.busy_ms, frame_time_10us,
+                           common_emu_state.startup_frames >= 3 && app->speedupEnabled == SPEEDUP_1x);
     cpumon_reset();
 
     common_emu_state.pause_frames = 0;
@@ -99,8 +257,11 @@ bool common_emu_frame_loop(void){
 
     if(common_emu_state.startup_frames < 3) {
         common_emu_state.startup_frames++;
+        speed_emulated_10us = 0;
+        speed_start_time = common_emu_state.last_sync_time;
         return true;
     }
+    speed_emulated_10us += frame_time_10us;
 
     switch(app->speedupEnabled){
         case SPEEDUP_0_5x:
@@ -126,6 +287,12 @@ bool common_emu_frame_loop(void){
             break;
     }
     frame_integrator += (elapsed_10us - frame_time_10us);
+
+    if (app->speedupEnabled > SPEEDUP_1x) {
+        common_emu_fast_forward(&frame_integrator, frame_time_10us);
+        return draw_frame;
+    }
+
     if(frame_integrator > frame_time_10us << 1) common_emu_state.skip_frames = 2;
     else if(frame_integrator > frame_time_10us) common_emu_state.skip_frames = 1;
     else if(frame_integrator < -frame_time_10us) common_emu_state.pause_frames = 1;
@@ -134,6 +301,50 @@ bool common_emu_frame_loop(void){
     return draw_frame;
 }
 
+frame_sched_t common_emu_sync;
+frame_sched_t common_emu_sync_lcd;
+
+static void common_emu_sched_wait(frame_sched_t *sched, volatile uint32_t *counter, uint8_t deadlines, bool sleep)
+{
+    uint32_t target = frame_sched_begin(sched, *counter, deadlines);
+    uint32_t t0 = get_elapsed_time();
+
+    if (sched->late) {
+        frame_stats_late();
+    }
+    while (!frame_sched_reached(*counter, target)) {
+        if (sleep)
+            cpumon_sleep();
+        else
+            __NOP();
+    }
+    frame_sched_end(sched, *counter, get_elapsed_time_since(t0));
+}
+
+void common_emu_sync_wait(uint8_t deadlines, bool sleep)
+{
+    common_emu_sched_wait(&common_emu_sync, &dma_counter, deadlines, sleep);
+}
+
+void common_emu_sync_wait_lcd(bool sleep)
+{
+    common_emu_sched_wait(&common_emu_sync_lcd, &frame_counter, 1, sleep);
+}
+
+void common_emu_sound_sync(bool sleep)
+{
+    common_emu_sound_end();
+
+    if (common_emu_state.skip_frames) {
+        // At 1x a skipped frame still owns a deadline, fast forward doesn't
+        // follow them and the next deadline is the next one
+        frame_sched_skip(&common_emu_sync, dma_counter,
+                         odroid_system_get_app()->speedupEnabled <= SPEEDUP_1x);
+        return;
+    }
+    common_emu_sync_wait(common_emu_state.pause_frames + 1, sleep);
+}
+
 
 
 /**
@@ -148,6 +359,7 @@ void common_emu_input_loop(odroid_gamepad_state_t *joystick, odroid_dialog_choic
     static int8_t last_key = -1;
     static bool pause_pressed = false;
     static bool macro_activated = false;
+    static bool mem_reported = false;
 
     if(joystick->values[ODROID_INPUT_VOLUME]){  // PAUSE/SET button
         // PAUSE/SET has been pressed, checking additional inputs for macros
@@ -163,6 +375,7 @@ void common_emu_input_loop(odroid_gamepad_state_t *joystick, odroid_dialog_choic
 #if ENABLE_SCREENSHOT
                 printf("Capturing screenshot...\n");
                 odroid_audio_mute(true);
+                lcd_restore_rgb565();
                 store_save((uint8_t *) framebuffer_capture, lcd_get_inactive_buffer(), sizeof(framebuffer_capture));
                 set_ingame_overlay(INGAME_OVERLAY_SC);
                 odroid_audio_mute(false);
@@ -219,6 +432,7 @@ void common_emu_input_loop(odroid_gamepad_state_t *joystick, odroid_dialog_choic
                 odroid_audio_mute(true);
 
                 // Call ingame overlay so that the save icon gets displayed first.
+                lcd_restore_rgb565();
                 set_ingame_overlay(INGAME_OVERLAY_SAVE);
                 common_ingame_overlay();
                 lcd_sync();
@@ -277,6 +491,13 @@ void common_emu_input_loop(odroid_gamepad_state_t *joystick, odroid_dialog_choic
         // PAUSE/SET has been released without performing any macro. Launch menu
         pause_pressed = false;
 
+        // The emulator has allocated its buffers by now
+        if (!mem_reported) {
+            gw_malloc_report();
+            mem_reported = true;
+        }
+
+        lcd_restore_rgb565();
         odroid_overlay_game_menu(game_options);
         memset(framebuffer1, 0x0, sizeof(framebuffer1));
         memset(framebuffer2, 0x0, sizeof(framebuffer2));
@@ -531,7 +752,13 @@ void common_ingame_overlay(void) {
     uint16_t by = INGAME_OVERLAY_BOX_Y;
 
     uint16_t percentage = odroid_input_read_battery().percentage;
-    if (percentage <= 15) {
+    low_battery = percentage <= 15;
+
+    // Nothing to draw, common_emu_lut8_frame() only allows LUT8 without overlay
+    if (lcd_get_pixel_format() != LCD_PIXEL_FORMAT_RGB565)
+        return;
+
+    if (low_battery) {
         if ((get_elapsed_time() % 1000) < 300)
             odroid_overlay_draw_battery(150, 90); 
     }
@@ -657,19 +884,30 @@ void common_ingame_overlay(void) {
 void common_ingame_overlay_clear(void) {
     pixel_t *fb;
     
+    // LUT8 buffers never had the overlay drawn over them
     fb = lcd_get_active_buffer();
-    draw_clear_rounded_rectangle(fb,
-                    INGAME_OVERLAY_X,
-                    INGAME_OVERLAY_Y,
-                    INGAME_OVERLAY_X + INGAME_OVERLAY_BARS_W,
-                    INGAME_OVERLAY_Y + INGAME_OVERLAY_BARS_H);
+    if (lcd_get_buffer_pixel_format(fb) == LCD_PIXEL_FORMAT_RGB565)
+        draw_clear_rounded_rectangle(fb,
+                        INGAME_OVERLAY_X,
+                        INGAME_OVERLAY_Y,
+                        INGAME_OVERLAY_X + INGAME_OVERLAY_BARS_W,
+                        INGAME_OVERLAY_Y + INGAME_OVERLAY_BARS_H);
 
     fb = lcd_get_inactive_buffer();
-    draw_clear_rounded_rectangle(fb,
-                    INGAME_OVERLAY_X,
-                    INGAME_OVERLAY_Y,
-                    INGAME_OVERLAY_X + INGAME_OVERLAY_BARS_W,
-                    INGAME_OVERLAY_Y + INGAME_OVERLAY_BARS_H);
+    if (lcd_get_buffer_pixel_format(fb) == LCD_PIXEL_FORMAT_RGB565)
+        draw_clear_rounded_rectangle(fb,
+                        INGAME_OVERLAY_X,
+                        INGAME_OVERLAY_Y,
+                        INGAME_OVERLAY_X + INGAME_OVERLAY_BARS_W,
+                        INGAME_OVERLAY_Y + INGAME_OVERLAY_BARS_H);
+}
+
+bool common_emu_lut8_frame(bool rgb565_only)
+{
+    bool lut8 = !rgb565_only && !low_battery && common_emu_state.overlay == INGAME_OVERLAY_NONE;
+
+    lcd_set_pixel_format(lut8 ? LCD_PIXEL_FORMAT_LUT8 : LCD_PIXEL_FORMAT_RGB565);
+    return lut8;
 }
 
 static void set_ingame_overlay(ingame_overlay_t type){
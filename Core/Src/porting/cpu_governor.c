@@ -0,0 +1,75 @@
+#include "cpu_governor.h"
+
+#include <stddef.h>
+
+const uint16_t cpu_governor_mhz[CPU_GOVERNOR_LEVELS] = {280, 312, 353};
+
+void cpu_governor_reset_window(cpu_governor_t *gov)
+{
+    gov->frames = 0;
+    gov->missed = 0;
+    gov->busy_10us = 0;
+    gov->budget_10us = 0;
+}
+
+void cpu_governor_init(cpu_governor_t *gov, uint8_t level, uint8_t max_level, bool locked)
+{
+    if (max_level >= CPU_GOVERNOR_LEVELS)
+        max_level = CPU_GOVERNOR_LEVELS - 1;
+    if (level > max_level)
+        level = max_level;
+
+    gov->level = level;
+    gov->max_level = max_level;
+    gov->settled = 0;
+    gov->locked = locked;
+    gov->stepped_down = false;
+    cpu_governor_reset_window(gov);
+}
+
+static uint8_t cpu_governor_decide(cpu_governor_t *gov)
+{
+    uint32_t load = gov->budget_10us ? (1000 * gov->busy_10us) / gov->budget_10us : 0;
+    bool overloaded = (load > CPU_GOVERNOR_HIGH_PERMILLE) || (gov->missed > CPU_GOVERNOR_WINDOW / 32);
+
+    if (overloaded) {
+        if (gov->level >= gov->max_level)
+            return gov->level;
+
+        // The tier above was the last one that kept up
+        if (gov->stepped_down)
+            gov->locked = true;
+        gov->stepped_down = false;
+        gov->settled = 0;
+        return gov->level + 1;
+    }
+
+    if (!gov->locked && gov->level > 0) {
+        // Same work at the lower clock
+        uint32_t lower = load * cpu_governor_mhz[gov->level] / cpu_governor_mhz[gov->level - 1];
+        if (lower < CPU_GOVERNOR_LOW_PERMILLE) {
+            gov->stepped_down = true;
+            gov->settled = 0;
+            return gov->level - 1;
+        }
+    }
+
+    if (!gov->locked && ++gov->settled >= CPU_GOVERNOR_SETTLE_WINDOWS)
+        gov->locked = true;
+
+    return gov->level;
+}
+
+uint8_t cpu_governor_frame(cpu_governor_t *gov, uint32_t busy_10us, uint32_t frame_time_10us, uint16_t missed)
+{
+    gov->busy_10us += busy_10us;
+    gov->budget_10us += frame_time_10us;
+    gov->missed += missed;
+
+    if (++gov->frames < CPU_GOVERNOR_WINDOW)
+        return gov->level;
+
+    uint8_t level = cpu_governor_decide(gov);
+    cpu_governor_reset_window(gov);
+    return level;
+}
@@ -0,0 +1,42 @@
+#include "frame_sched.h"
+
+uint32_t frame_sched_begin(frame_sched_t *sched, uint32_t counter, uint8_t deadlines)
+{
+    if (sched->frames == 0) {
+        // Nothing to be late for before the first frame
+        sched->last_counter = counter;
+    }
+
+    uint32_t passed = counter - sched->last_counter;
+    uint32_t owned = sched->skipped + 1;
+
+    // The first deadlines belong to the frames skipped since the last wait,
+    // the next one to this frame, any further one went by while a frame was
+    // still being emulated.
+    sched->skipped = 0;
+    sched->late = passed >= owned;
+    if (passed > owned) {
+        sched->missed += passed - owned;
+    }
+
+    // A late frame catches up from now on, the others wait for their own
+    // deadline and the paused ones after it.
+    return sched->late ? counter + deadlines - 1 : sched->last_counter + owned - 1 + deadlines;
+}
+
+void frame_sched_end(frame_sched_t *sched, uint32_t counter, uint32_t slept_ms)
+{
+    sched->last_counter = counter;
+    sched->slack_ms = sched->late ? 0 : (slept_ms > UINT16_MAX ? UINT16_MAX : slept_ms);
+    sched->frames++;
+}
+
+void frame_sched_skip(frame_sched_t *sched, uint32_t counter, bool owns_deadline)
+{
+    if (!owns_deadline) {
+        sched->last_counter = counter;
+        sched->skipped = 0;
+    } else if (sched->skipped < UINT8_MAX) {
+        sched->skipped++;
+    }
+}
@@ -0,0 +1,108 @@
+#include "frame_stats.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static struct {
+    uint32_t frames;
+    uint32_t skipped;
+    uint32_t late;
+    uint32_t underruns;
+    uint32_t overruns;
+    uint32_t late_writes;
+    uint32_t frame[FRAME_STATS_BINS];
+    uint32_t busy[FRAME_STATS_BINS];
+    uint32_t wait[FRAME_STATS_BINS];
+} stats;
+
+static const uint8_t percentiles[3] = {50, 95, 99};
+
+static inline void add(uint32_t *histogram, uint32_t ms)
+{
+    histogram[ms < FRAME_STATS_BINS ? ms : FRAME_STATS_BINS - 1]++;
+}
+
+// Smallest bin with at least `percent` of the frames at or below it
+static uint8_t percentile(const uint32_t *histogram, uint32_t frames, uint8_t percent)
+{
+    uint32_t target = (frames * percent + 99) / 100;
+    uint32_t count = 0;
+
+    for (int i = 0; i < FRAME_STATS_BINS; i++) {
+        count += histogram[i];
+        if (count >= target)
+            return i;
+    }
+    return FRAME_STATS_BINS - 1;
+}
+
+void frame_stats_reset(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+void frame_stats_frame(uint32_t busy_ms, uint32_t frame_ms, bool skipped)
+{
+    // Busy time is measured apart and may round above the frame interval
+    if (busy_ms > frame_ms)
+        frame_ms = busy_ms;
+
+    stats.frames++;
+    if (skipped)
+        stats.skipped++;
+    add(stats.frame, frame_ms);
+    add(stats.busy, busy_ms);
+    add(stats.wait, frame_ms - busy_ms);
+}
+
+void frame_stats_late(void)
+{
+    stats.late++;
+}
+
+void frame_stats_audio(uint32_t underruns, uint32_t overruns, uint32_t late_writes)
+{
+    stats.underruns += underruns;
+    stats.overruns += overruns;
+    stats.late_writes += late_writes;
+}
+
+void frame_stats_get(frame_stats_report_t *report)
+{
+    report->frames = stats.frames;
+    report->skipped = stats.skipped;
+    report->late = stats.late;
+    report->underruns = stats.underruns;
+    report->overruns = stats.overruns;
+    report->late_writes = stats.late_writes;
+
+    for (int i = 0; i < 3; i++) {
+        report->frame_ms[i] = percentile(stats.frame, stats.frames, percentiles[i]);
+        report->busy_ms[i] = percentile(stats.busy, stats.frames, percentiles[i]);
+        report->wait_ms[i] = percentile(stats.wait, stats.frames, percentiles[i]);
+    }
+}
+
+int frame_stats_format(char *buf, size_t size, const frame_stats_report_t *report)
+{
+    return snprintf(buf, size, "frame %d/%d/%dms busy %d/%d/%dms late %lu xrun %lu/%lu/%lu",
+                    report->frame_ms[0], report->frame_ms[1], report->frame_ms[2],
+                    report->busy_ms[0], report->busy_ms[1], report->busy_ms[2],
+                    (unsigned long)report->late, (unsigned long)report->underruns,
+                    (unsigned long)report->overruns, (unsigned long)report->late_writes);
+}
+
+void frame_stats_log(void)
+{
+    frame_stats_report_t report;
+    char line[80];
+
+    if (stats.frames == 0)
+        return;
+
+    frame_stats_get(&report);
+    frame_stats_format(line, sizeof(line), &report);
+    printf("Stats: %lu frames (%lu skipped), wait %d/%d/%dms, %s\n",
+           (unsigned long)report.frames, (unsigned long)report.skipped,
+           report.wait_ms[0], report.wait_ms[1], report.wait_ms[2], line);
+}
@@ -21,6 +21,7 @@
 #include "gnuboy/rtc.h"
 #include "gnuboy/defs.h"
 #include "common.h"
+#include "audio_mix.h"
 #include "rom_manager.h"
 #include "appid.h"
 #include "gw_malloc.h"
@@ -30,6 +31,9 @@
 // Use 60Hz for GB
 #define AUDIO_BUFFER_LENGTH_GB (AUDIO_SAMPLE_RATE / 60)
 #define AUDIO_BUFFER_LENGTH_DMA_GB ((2 * AUDIO_SAMPLE_RATE) / 60)
+
+// Time left before the deadline needed to afford rendering the next frame
+#define GB_RENDER_SLACK_MS 1
 static int16_t *audiobuffer_emulator;
 
 static odroid_video_frame_t update1 = {GB_WIDTH, GB_HEIGHT, GB_WIDTH * 2, 2, 0xFF, -1, NULL, NULL, 0, {}};
@@ -108,7 +112,7 @@ static inline void screen_blit_nn(int32_t dest_width, int32_t dest_height)
     lcd_swap();
 }
 
-static void screen_blit_bilinear(int32_t dest_width)
+ITCM_EMU_TEXT static void screen_blit_bilinear(int32_t dest_width)
 {
     static uint32_t lastFPSTime = 0;
     static uint32_t frames = 0;
@@ -312,7 +316,8 @@ static inline void screen_blit_jth(void) {
 }
 
 
-static void blit(void)
+// With the inlined scalers, run from the ITCM overlay of the emulator
+ITCM_EMU_TEXT static void blit(void)
 {
     odroid_display_scaling_t scaling = odroid_display_get_scaling_mode();
     odroid_display_filter_t filtering = odroid_display_get_filter_mode();
@@ -502,20 +507,8 @@ static bool advanced_settings_cb(odroid_dialog_choice_t *option, odroid_dialog_e
 }*/
 
 void pcm_submit() {
-    uint8_t volume = odroid_audio_volume_get();
-    int32_t factor = volume_tbl[volume];
-    size_t offset = (dma_state == DMA_TRANSFER_STATE_HF) ? 0 : AUDIO_BUFFER_LENGTH_GB;
-
-    if (audio_mute || volume == ODROID_AUDIO_VOLUME_MIN) {
-        for (int i = 0; i < AUDIO_BUFFER_LENGTH_GB; i++) {
-            audiobuffer_dma[i + offset] = 0;
-        }
-    } else {
-        for (int i = 0; i < AUDIO_BUFFER_LENGTH_GB; i++) {
-            int32_t sample = pcm.buf[i];
-            audiobuffer_dma[i + offset] = (sample * factor) >> 8;
-        }
-    }
+    audio_mix_s16(common_emu_sound_get_buffer(AUDIO_BUFFER_LENGTH_GB), pcm.buf, AUDIO_BUFFER_LENGTH_GB,
+                  common_emu_sound_get_volume(), 8);
 }
 
 rg_app_desc_t * init(uint8_t load_state, uint8_t save_slot)
@@ -604,6 +597,13 @@ void app_main_gb(uint8_t load_state, uint8_t start_paused, uint8_t save_slot)
         odroid_input_read_gamepad(&joystick);
 
         bool drawFrame = common_emu_frame_loop();
+
+        // Last frame was just in time or late, rendering this one would make
+        // it miss its deadline: emulate it without drawing
+        if (drawFrame && !common_emu_state.skip_frames && common_emu_sync.frames > 1 &&
+            !common_emu_sync_has_slack(GB_RENDER_SLACK_MS))
+            drawFrame = false;
+
         char palette_values[16];
         snprintf(palette_values, sizeof(palette_values), "%s", "7/7");
         odroid_dialog_choice_t options[] = {
@@ -648,18 +648,9 @@ void app_main_gb(uint8_t load_state, uint8_t start_paused, uint8_t save_slot)
             }
         }
 
-        if(!common_emu_state.skip_frames)
-        {
-            // odroid_audio_submit(pcm.buf, pcm.pos >> 1);
-            // handled in pcm_submit instead.
-            static dma_transfer_state_t last_dma_state = DMA_TRANSFER_STATE_HF;
-            for(uint8_t p = 0; p < common_emu_state.pause_frames + 1; p++) {
-                while (dma_state == last_dma_state) {
-                    cpumon_sleep();
-                }
-                last_dma_state = dma_state;
-            }
-        }
+        // odroid_audio_submit(pcm.buf, pcm.pos >> 1);
+        // handled in pcm_submit instead.
+        common_emu_sound_sync(true);
     }
 }
 
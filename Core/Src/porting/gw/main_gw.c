@@ -16,6 +16,7 @@
 #include "stm32h7xx_hal.h"
 
 #include "common.h"
+#include "audio_mix.h"
 #include "rom_manager.h"
 #include "rg_i18n.h"
 #include "gui.h"
@@ -182,10 +183,6 @@ static void gw_sound_init()
 
 static void gw_sound_submit()
 {
-
-    uint8_t volume = odroid_audio_volume_get();
-    int16_t factor = volume_tbl[volume];
-
     /** Enables the following code to track audio rendering issues **/
     /*
     if (gw_audio_buffer_idx < GW_AUDIO_BUFFER_LENGTH) {
@@ -199,23 +196,34 @@ static void gw_sound_submit()
     }
     */
 
-    size_t offset = (dma_state == DMA_TRANSFER_STATE_HF) ? 0 : GW_AUDIO_BUFFER_LENGTH;
+    audio_mix_u8(common_emu_sound_get_buffer(GW_AUDIO_BUFFER_LENGTH), gw_audio_buffer, GW_AUDIO_BUFFER_LENGTH,
+                 common_emu_sound_get_volume() << 4, 0);
 
-    if (audio_mute || volume == ODROID_AUDIO_VOLUME_MIN)
-    {
-        for (int i = 0; i < GW_AUDIO_BUFFER_LENGTH; i++)
-        {
-            audiobuffer_dma[i + offset] = 0;
-        }
-    }
-    else
-    {
-        for (int i = 0; i < GW_AUDIO_BUFFER_LENGTH; i++)
-        {
-            audiobuffer_dma[i + offset] = (factor) * (gw_audio_buffer[i] << 4);
-        }
-    }
+    gw_audio_buffer_copied = true;
+}
+
+/* Run-ahead: the state after the real frame is kept in RAM, runahead_frames
+ * more frames are emulated with the same input and only the last one is shown
+ * before rolling back. The game then reacts to the buttons that many frames
+ * earlier. The G&W state is small and a frame only takes a fraction of the
+ * frame time, so this costs (runahead_frames + 1) times the emulation time.
+ */
+static unsigned int runahead_frames = 0;
+static unsigned char runahead_state_buffer[sizeof(gw_state_t)];
+
+static void gw_system_run_ahead(void)
+{
+    gw_state_save(runahead_state_buffer);
 
+    for (unsigned int i = 0; i < runahead_frames; i++)
+        gw_system_run(GW_SYSTEM_CYCLES);
+}
+
+static void gw_system_run_ahead_rollback(void)
+{
+    gw_state_load(runahead_state_buffer);
+
+    /* the samples emulated ahead are dropped, the next frame restarts the buffer */
     gw_audio_buffer_copied = true;
 }
 
@@ -399,6 +407,24 @@ static bool gw_debug_submenu_display_ram(odroid_dialog_choice_t *option, odroid_
     return event == ODROID_DIALOG_ENTER;
 }
 
+// Run-ahead frames
+static char runahead_value[10];
+static bool gw_debug_submenu_run_ahead(odroid_dialog_choice_t *option, odroid_dialog_event_t event, uint32_t repeat)
+{
+    unsigned int max_runahead_frames = 2;
+
+    if (event == ODROID_DIALOG_PREV)
+        runahead_frames = runahead_frames > 0 ? runahead_frames - 1 : max_runahead_frames;
+
+    if (event == ODROID_DIALOG_NEXT)
+        runahead_frames = runahead_frames < max_runahead_frames ? runahead_frames + 1 : 0;
+
+    if (runahead_frames == 0) strcpy(option->value, curr_lang->s_No);
+    else sprintf(option->value, "%u", runahead_frames);
+
+    return event == ODROID_DIALOG_ENTER;
+}
+
 static char draw_line_content[1+2*17];
 
 static void gw_display_ram_overlay(){
@@ -430,6 +456,7 @@ int app_main_gw(uint8_t load_state, uint8_t save_slot)
         {331, curr_lang->s_copy_GW_time_to_RTC, "", 1, &gw_debug_submenu_autoget_time},
         {360, curr_lang->s_LCD_filter, LCD_deflicker_value, 1, &gw_debug_submenu_set_deflicker},
         {370, curr_lang->s_Display_RAM, display_ram_value, 1, &gw_debug_submenu_display_ram},
+        {380, curr_lang->s_Run_ahead, runahead_value, 1, &gw_debug_submenu_run_ahead},
         ODROID_DIALOG_CHOICE_LAST};
 
     odroid_system_init(ODROID_APPID_GW, GW_AUDIO_FREQ);
@@ -563,10 +590,23 @@ int app_main_gw(uint8_t load_state, uint8_t save_slot)
         /* get how many cycles have been spent in the emulator */
         proc_cycles = get_dwt_cycles();
 
+        /* copy audio samples for DMA, before any run-ahead overwrites them */
+        if (drawFrame)
+        {
+            gw_sound_submit();
+        }
+
         /* update the screen only if there is no pending frame to render */
         if (!is_lcd_swap_pending() && drawFrame)
         {
+            if (runahead_frames)
+                gw_system_run_ahead();
+
             gw_system_blit(lcd_get_active_buffer());
+
+            if (runahead_frames)
+                gw_system_run_ahead_rollback();
+
             gw_debug_bar();
             if(debug_display_ram == 1) gw_display_ram_overlay();
             common_ingame_overlay();
@@ -577,31 +617,14 @@ int app_main_gw(uint8_t load_state, uint8_t save_slot)
         }
         /****************************************************************************/
 
-        /* copy audio samples for DMA */
-        if (drawFrame)
-        {
-            gw_sound_submit();
-        }
-
         /* get how many cycles have been spent to process everything */
         end_cycles = get_dwt_cycles();
 
-        if (!common_emu_state.skip_frames)
-        {
-            for (uint8_t p = 0; p < common_emu_state.pause_frames + 1; p++)
-            {
-                static dma_transfer_state_t last_dma_state = DMA_TRANSFER_STATE_HF;
-                while (dma_state == last_dma_state)
-                {
 #ifdef GW_EMU_DEBUG_OVERLAY
-                    __NOP();
+        common_emu_sound_sync(false);
 #else
-                    cpumon_sleep();
+        common_emu_sound_sync(true);
 #endif
-                }
-                last_dma_state = dma_state;
-            }
-        }
 
         /* get how cycles have been spent inside this loop */
         loop_cycles = get_dwt_cycles();
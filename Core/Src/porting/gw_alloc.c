@@ -4,12 +4,13 @@
 #include <assert.h>
 
 #include "gw_linker.h"
+#include "gw_malloc.h"
 
+static char * heap_end;
 
 void *
 _sbrk (int incr)
 {
-    static char * heap_end;
     char *        prev_heap_end;
 
     if (heap_end == 0)
@@ -23,6 +24,16 @@ _sbrk (int incr)
     return (void *) prev_heap_end;
 }
 
+size_t heap_used(void)
+{
+    return heap_end ? heap_end - (char *) &_heap_start : 0;
+}
+
+size_t heap_size(void)
+{
+    return &_heap_end - &_heap_start;
+}
+
 #ifdef DEBUG_RG_ALLOC
 
 static struct {
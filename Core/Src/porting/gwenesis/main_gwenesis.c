@@ -35,6 +35,7 @@ __license__ = "GPLv3"
 #include "stm32h7xx_hal.h"
 
 #include "common.h"
+#include "audio_mix.h"
 #include "rom_manager.h"
 #include "appid.h"
 #include "rg_i18n.h"
@@ -321,41 +322,25 @@ static void gwenesis_audio_pll_center() {
 
 /* single-pole low-pass filter (6 dB/octave) */
 const uint32_t factora  = 0x1000; // todo as UI parameter
-const uint32_t factorb  = 0x10000 - factora;
 
 static void gwenesis_sound_submit() {
-  uint8_t volume = odroid_audio_volume_get();
-  int16_t factor = volume_tbl[volume];
+  int32_t factor = common_emu_sound_get_volume();
+  int16_t *dest = common_emu_sound_get_buffer(gwenesis_audio_buffer_lenght);
 
-  static int16_t gwenesis_audio_out = 0;
+  static int32_t gwenesis_audio_out = 0;
 
-  size_t offset;
-  offset = (dma_state == DMA_TRANSFER_STATE_HF) ? 0 : gwenesis_audio_buffer_lenght;
-
-  if (audio_mute || volume == ODROID_AUDIO_VOLUME_MIN) {
-    for (int i = 0; i < gwenesis_audio_buffer_lenght; i++) {
-      audiobuffer_dma[i + offset] = 0;
-    }
+  // filter on
+  if (gwenesis_lpfilter) {
+    audio_mix_s16_add_lowpass(dest, gwenesis_ym2612_buffer, gwenesis_sn76489_buffer, gwenesis_audio_buffer_lenght,
+                              factor, 7, factora, &gwenesis_audio_out);
+  // filter off
   } else {
-    // filter on
-    if (gwenesis_lpfilter) {
-      for (int i = 0; i < gwenesis_audio_buffer_lenght; i++) {
-
-        // low pass filter
-        int32_t gwenesis_audio_tmp = gwenesis_audio_out * factorb + (gwenesis_ym2612_buffer[i] + gwenesis_sn76489_buffer[i]) * factora;
-        gwenesis_audio_out = gwenesis_audio_tmp >> 16;
-        audiobuffer_dma[i + offset] = ((gwenesis_audio_out) * factor ) / 128;
-      }
-    // filter off
-    } else {
-      for (int i = 0; i < gwenesis_audio_buffer_lenght; i++) {
-
-        // single mone left or right
-       // audiobuffer_dma[i + offset] = ((gwenesis_ym2612_buffer[i]) * factor) / 256;
-        audiobuffer_dma[i + offset] = ((gwenesis_ym2612_buffer[i] + gwenesis_sn76489_buffer[i]) * factor) / 512;
-      }
-    }
+    audio_mix_s16_add(dest, gwenesis_ym2612_buffer, gwenesis_sn76489_buffer, gwenesis_audio_buffer_lenght,
+                      factor, 9);
   }
+
+  // Both sync modes skip common_emu_sound_sync()
+  common_emu_sound_end();
 }
 
 /************************ Debug function in overlay START *******************************/
@@ -666,7 +651,6 @@ int app_main_gwenesis(uint8_t load_state, uint8_t start_paused, uint8_t save_slo
     static int hori_screen_offset, vert_screen_offset;
     int hint_counter;
     extern int hint_pending;
-    volatile unsigned int current_frame;
     
     if (load_state) {
 #if OFF_SAVESTATE==1
@@ -690,9 +674,6 @@ int app_main_gwenesis(uint8_t load_state, uint8_t start_paused, uint8_t save_slo
     // gwenesis_init_position = 0xFFFF & lcd_get_pixel_position();
     while (true) {
 
-      /* capture the frame processed by the LCD controller */
-      current_frame = frame_counter;
-
       /* clear DWT counter used to monitor performances */
       clear_dwt_cycles();
 
@@ -844,12 +825,12 @@ int app_main_gwenesis(uint8_t load_state, uint8_t start_paused, uint8_t save_slo
 
       /* VSYNC mode */
       if (gwenesis_vsync_mode) {
-        /* Check if we are still in the same frame as at the beginning of the
-         * loop if it's different we are in overflow : skip next frame using
-         * (drawFrame = 0) otherwise we are in the same frame. wait the end of
-         * frame.
+        /* Wait for the line interrupt that ends the frame on the LCD. If it
+         * was already gone we are in overflow : skip next frame using
+         * (drawFrame = 0) otherwise swap now, shown at the next refresh.
          */
-        if (current_frame != frame_counter) {
+        common_emu_sync_wait_lcd(!gwenesis_show_debug_bar);
+        if (common_emu_sync_lcd.late) {
           overflow_count++;
           drawFrame = 0;
 
@@ -869,15 +850,8 @@ int app_main_gwenesis(uint8_t load_state, uint8_t start_paused, uint8_t save_slo
         //  if (!common_emu_state.skip_frames) {
         // odroid_audio_submit(pcm.buf, pcm.pos >> 1);
         // handled in pcm_submit instead.
-        static dma_transfer_state_t last_dma_state = DMA_TRANSFER_STATE_HF;
         //  for (uint8_t p = 0; p < common_emu_state.pause_frames + 1; p++) {
-        while (dma_state == last_dma_state) {
-          if (gwenesis_show_debug_bar)
-            __NOP();
-          else
-            cpumon_sleep();
-        }
-        last_dma_state = dma_state;
+        common_emu_sync_wait(1, !gwenesis_show_debug_bar);
       }
       // Get current line LCD position to check A/V synchronization
       gwenesis_lcd_current_line = 0xFFFF & lcd_get_pixel_position();
@@ -0,0 +1,101 @@
+#include "lcd_lut8.h"
+
+#include <string.h>
+
+static uint16_t palette[LCD_LUT8_COLORS];
+static uint8_t background;
+
+// Range of the entries changed since the last commit
+static uint16_t dirty_first = 0;
+static uint16_t dirty_end = LCD_LUT8_COLORS;
+
+static inline void mark_dirty(uint16_t first, uint16_t end)
+{
+    if (dirty_first >= dirty_end) {
+        dirty_first = first;
+        dirty_end = end;
+        return;
+    }
+    if (first < dirty_first)
+        dirty_first = first;
+    if (end > dirty_end)
+        dirty_end = end;
+}
+
+void lcd_lut8_set_color(uint8_t index, uint16_t rgb565)
+{
+    if (palette[index] != rgb565) {
+        palette[index] = rgb565;
+        mark_dirty(index, index + 1);
+    }
+}
+
+void lcd_lut8_set_palette(const uint16_t *colors, uint16_t first, uint16_t count)
+{
+    if (first >= LCD_LUT8_COLORS)
+        return;
+    if (count > LCD_LUT8_COLORS - first)
+        count = LCD_LUT8_COLORS - first;
+
+    // Most cores set their whole palette every frame, only flag real changes
+    if (memcmp(&palette[first], colors, count * sizeof(uint16_t)) != 0) {
+        memcpy(&palette[first], colors, count * sizeof(uint16_t));
+        mark_dirty(first, first + count);
+    }
+}
+
+const uint16_t *lcd_lut8_palette(void)
+{
+    return palette;
+}
+
+void lcd_lut8_set_background(uint8_t index)
+{
+    background = index;
+}
+
+uint8_t lcd_lut8_background(void)
+{
+    return background;
+}
+
+bool lcd_lut8_commit(uint32_t *clut)
+{
+    if (dirty_first >= dirty_end)
+        return false;
+
+    for (int i = dirty_first; i < dirty_end; i++) {
+        uint16_t c = palette[i];
+        uint32_t r = (c >> 11) & 0x1f;
+        uint32_t g = (c >> 5) & 0x3f;
+        uint32_t b = c & 0x1f;
+
+        // Replicate the top bits so that white stays 0xFFFFFF
+        clut[i] = (((r << 3) | (r >> 2)) << 16) |
+                  (((g << 2) | (g >> 4)) << 8) |
+                  ((b << 3) | (b >> 2));
+    }
+
+    dirty_first = LCD_LUT8_COLORS;
+    dirty_end = 0;
+    return true;
+}
+
+__attribute__((optimize("unroll-loops")))
+void lcd_lut8_expand(uint16_t *dst, const uint8_t *src, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = palette[src[i]];
+    }
+}
+
+void lcd_lut8_expand_in_place(void *buffer, size_t count)
+{
+    const uint8_t *src = buffer;
+    uint16_t *dst = buffer;
+
+    // Backwards, pixel i is written over indices 2i and 2i+1 which are already read
+    while (count-- > 0) {
+        dst[count] = palette[src[count]];
+    }
+}
@@ -16,6 +16,7 @@
 #include "stm32h7xx_hal.h"
 
 #include "common.h"
+#include "audio_mix.h"
 #include "rom_manager.h"
 #include "gw_lcd.h"
 #include "rg_i18n.h"
@@ -127,6 +128,8 @@ static uint16_t palette565[256];
 #define FPS_NTSC  60
 #define FPS_PAL   50
 static int8_t msx_fps = FPS_PAL;
+// Start of the machine ITC allocations, past the ITCM overlay emulator_start() loaded
+static size_t itc_emu_mark;
 
 #define AUDIO_MSX_SAMPLE_RATE 16000
 
@@ -155,19 +158,28 @@ static bool msx_system_LoadState(char *pathName)
     return true;
 }
 
-static bool msx_system_SaveState(char *pathName)
+// Index 0xFF of the RGB332 palette is white
+static void draw_disk_icon(void *buffer, uint16_t offset)
 {
-    // Show disk icon when saving state
-    uint16_t *dest = lcd_get_inactive_buffer();
+    bool lut8 = lcd_get_buffer_pixel_format(buffer) == LCD_PIXEL_FORMAT_LUT8;
     uint16_t idx = 0;
     for (uint8_t i = 0; i < 24; i++) {
         for (uint8_t j = 0; j < 24; j++) {
         if (IMG_DISKETTE[idx / 8] & (1 << (7 - idx % 8))) {
-            dest[274 + j + GW_LCD_WIDTH * (2 + i)] = 0xFFFF;
+            if (lut8)
+                ((uint8_t *)buffer)[offset + j + GW_LCD_WIDTH * (2 + i)] = 0xFF;
+            else
+                ((uint16_t *)buffer)[offset + j + GW_LCD_WIDTH * (2 + i)] = 0xFFFF;
         }
         idx++;
         }
     }
+}
+
+static bool msx_system_SaveState(char *pathName)
+{
+    // Show disk icon when saving state
+    draw_disk_icon(lcd_get_inactive_buffer(), 274);
 #if OFF_SAVESTATE==1
     if (strcmp(pathName,"1") == 0) {
         // Save in common save slot (during a power off)
@@ -290,106 +302,6 @@ void frameBufferSetDoubleWidth(FrameBuffer* frameBuffer, int y, int val)
     double_width = val;
 }
 
-/** GuessROM() ***********************************************/
-/** Guess MegaROM mapper of a ROM.                          **/
-/*************************************************************/
-int GuessROM(const uint8_t *buf,int size)
-{
-    int i;
-    int counters[6] = { 0, 0, 0, 0, 0, 0 };
-
-    int mapper;
-
-    /* No result yet */
-    mapper = ROM_UNKNOWN;
-
-    if (size <= 0x10000) {
-        if (size == 0x10000) {
-            if (buf[0x4000] == 'A' && buf[0x4001] == 'B') mapper = ROM_PLAIN;
-            else mapper = ROM_ASCII16;
-            return mapper;
-        } 
-        
-        if (size <= 0x4000 && buf[0] == 'A' && buf[1] == 'B') {
-            UInt16 text = buf[8] + 256 * buf[9];
-            if ((text & 0xc000) == 0x8000) {
-                return ROM_BASIC;
-            }
-        }
-        return ROM_PLAIN;
-    }
-
-    /* Count occurences of characteristic addresses */
-    for (i = 0; i < size - 3; i++) {
-        if (buf[i] == 0x32) {
-            UInt32 value = buf[i + 1] + ((UInt32)buf[i + 2] << 8);
-
-            switch(value) {
-            case 0x4000: 
-            case 0x8000: 
-            case 0xa000: 
-                counters[3]++;
-                break;
-
-            case 0x5000: 
-            case 0x9000: 
-            case 0xb000: 
-                counters[2]++;
-                break;
-
-            case 0x6000: 
-                counters[3]++;
-                counters[4]++;
-                counters[5]++;
-                break;
-
-            case 0x6800: 
-            case 0x7800: 
-                counters[4]++;
-                break;
-
-            case 0x7000: 
-                counters[2]++;
-                counters[4]++;
-                counters[5]++;
-                break;
-
-            case 0x77ff: 
-                counters[5]++;
-                break;
-            }
-        }
-    }
-
-    /* Find which mapper type got more hits */
-    mapper = 0;
-
-    counters[4] -= counters[4] ? 1 : 0;
-
-    for (i = 0; i <= 5; i++) {
-        if (counters[i] > 0 && counters[i] >= counters[mapper]) {
-            mapper = i;
-        }
-    }
-
-    if (mapper == 5 && counters[0] == counters[5]) {
-        mapper = 0;
-    }
-
-    switch (mapper) {
-        default:
-        case 0: mapper = ROM_STANDARD; break;
-        case 1: mapper = ROM_MSXDOS2; break;
-        case 2: mapper = ROM_KONAMI5; break;
-        case 3: mapper = ROM_KONAMI4; break;
-        case 4: mapper = ROM_ASCII8; break;
-        case 5: mapper = ROM_ASCII16; break;
-    }
-
-    /* Return the most likely mapper type */
-    return(mapper);
-}
-
 static bool update_disk_cb(odroid_dialog_choice_t *option, odroid_dialog_event_t event, uint32_t repeat)
 {
     char game_name[PROP_MAXPATH];
@@ -504,7 +416,7 @@ static bool update_msx_cb(odroid_dialog_choice_t *option, odroid_dialog_event_t
         boardInfo.destroy();
         boardDestroy();
         ahb_init();
-        itc_init();
+        itc_release(itc_emu_mark);
         setupEmulatorRessources(selected_msx_index);
     }
     return event == ODROID_DIALOG_ENTER;
@@ -1434,11 +1346,9 @@ static void insertGame() {
     switch (msx_game_type) {
         case MSX_GAME_ROM:
         {
-            printf("Rom Mapper %d\n",ACTIVE_FILE->mapper);
+            // Found at build time, from msxromdb.xml or guessed, see tools/romdb.py
             uint16_t mapper = ACTIVE_FILE->mapper;
-            if (mapper == ROM_UNKNOWN) {
-                mapper = GuessROM(ACTIVE_FILE->address,ACTIVE_FILE->size);
-            }
+            printf("Rom Mapper %d\n",mapper);
             if (!controls_found) {
                 // If game is using konami mapper, we setup a Konami key mapping
                 // elseway we use joystick control
@@ -1622,7 +1532,41 @@ static inline void screen_blit_nn(uint8_t *msx_fb, uint16_t *framebuffer/*int32_
     }
 }
 
-static void blit(uint8_t *msx_fb, uint16_t *framebuffer)
+// LUT8 versions of blit_normal() and screen_blit_nn(), the LTDC does the palette lookup
+static inline void blit_normal_lut8(uint8_t *msx_fb, uint8_t *framebuffer) {
+    const int w1 = image_buffer_current_width;
+    const int w2 = GW_LCD_WIDTH;
+    const int h2 = GW_LCD_HEIGHT;
+    const int hpad = 27;
+
+    for (int y = 0; y < h2; y++) {
+        memcpy(&framebuffer[y * w2 + hpad], &msx_fb[y*w1], w1);
+    }
+}
+
+__attribute__((optimize("unroll-loops")))
+static inline void screen_blit_nn_lut8(uint8_t *msx_fb, uint8_t *framebuffer)
+{
+    int w1 = width;
+    int h1 = height;
+    int w2 = GW_LCD_WIDTH;
+    int h2 = GW_LCD_HEIGHT;
+    int src_x_offset = 8;
+    int src_y_offset = 24 - (msx2_dif);
+
+    int x_ratio = (int)((w1<<16)/w2) +1;
+    int y_ratio = (int)((h1<<16)/h2) +1;
+
+    for (int i=0;i<h2;i++) {
+        uint8_t *src_row = &msx_fb[((((i*y_ratio)>>16)+src_y_offset)*image_buffer_current_width)+src_x_offset];
+        uint8_t *dest_row = &framebuffer[i*WIDTH];
+        for (int j=0;j<w2;j++) {
+            dest_row[j] = src_row[(j*x_ratio)>>16];
+        }
+    }
+}
+
+static void blit(uint8_t *msx_fb, uint16_t *framebuffer, bool lut8)
 {
     odroid_display_scaling_t scaling = odroid_display_get_scaling_mode();
     uint16_t offset = 274;
@@ -1631,7 +1575,10 @@ static void blit(uint8_t *msx_fb, uint16_t *framebuffer)
     case ODROID_DISPLAY_SCALING_OFF:
         use_overscan = true;
         update_fb_info();
-        blit_normal(msx_fb, framebuffer);
+        if (lut8)
+            blit_normal_lut8(msx_fb, (uint8_t *)framebuffer);
+        else
+            blit_normal(msx_fb, framebuffer);
         break;
     // Full height, borders on the side
     case ODROID_DISPLAY_SCALING_FIT:
@@ -1639,23 +1586,17 @@ static void blit(uint8_t *msx_fb, uint16_t *framebuffer)
         offset = GW_LCD_WIDTH-26;
         use_overscan = false;
         update_fb_info();
-        screen_blit_nn(msx_fb, framebuffer);
+        if (lut8)
+            screen_blit_nn_lut8(msx_fb, (uint8_t *)framebuffer);
+        else
+            screen_blit_nn(msx_fb, framebuffer);
         break;
     default:
         printf("Unsupported scaling mode %d\n", scaling);
         break;
     }
     if (show_disk_icon) {
-        uint16_t *dest = lcd_get_active_buffer();
-        uint16_t idx = 0;
-        for (uint8_t i = 0; i < 24; i++) {
-            for (uint8_t j = 0; j < 24; j++) {
-            if (IMG_DISKETTE[idx / 8] & (1 << (7 - idx % 8))) {
-                dest[offset + j + GW_LCD_WIDTH * (2 + i)] = 0xFFFF;
-            }
-            idx++;
-            }
-        }
+        draw_disk_icon(framebuffer, offset);
     }
 }
 
@@ -1664,8 +1605,8 @@ void app_main_msx(uint8_t load_state, uint8_t start_paused, uint8_t save_slot)
     pixel_t *fb;
     odroid_dialog_choice_t options[10];
     bool drawFrame;
-    dma_transfer_state_t last_dma_state = DMA_TRANSFER_STATE_HF;
 
+    itc_emu_mark = itc_mark();
     show_disk_icon = false;
     selected_disk_index = -1;
 
@@ -1677,6 +1618,8 @@ void app_main_msx(uint8_t load_state, uint8_t start_paused, uint8_t save_slot)
                          ((((i&0x1C)>>2)*63/7)<<5) |
                          ((i&0x3)*31/3);
     }
+    lcd_lut8_set_palette(palette565, 0, 256);
+    lcd_lut8_set_background(0);
 
     if (load_state) {
 #if OFF_SAVESTATE==1
@@ -1764,8 +1707,11 @@ void app_main_msx(uint8_t load_state, uint8_t start_paused, uint8_t save_slot)
             // If current MSX screen mode is 10 or 12, data has been directly written into
             // framebuffer (scaling is not possible for these screen modes), elseway apply
             // current scaling mode
-            if ((vdpGetScreenMode() != 10) && (vdpGetScreenMode() != 12)) {
-                blit(msx_framebuffer, fb);
+            // (the first direct frame after a LUT8 one is cleared when switching to RGB565)
+            bool direct = (vdpGetScreenMode() == 10) || (vdpGetScreenMode() == 12);
+            bool lut8 = common_emu_lut8_frame(direct);
+            if (!direct) {
+                blit(msx_framebuffer, fb, lut8);
             }
             common_ingame_overlay();
             lcd_swap();
@@ -1774,20 +1720,12 @@ void app_main_msx(uint8_t load_state, uint8_t start_paused, uint8_t save_slot)
         // Render audio
         mixerSyncGNW(mixer,(AUDIO_MSX_SAMPLE_RATE/msx_fps));
 
-        if(!common_emu_state.skip_frames) {
-            for(uint8_t p = 0; p < common_emu_state.pause_frames + 1; p++) {
-                while (dma_state == last_dma_state) {
-                    cpumon_sleep();
-                }
-                last_dma_state = dma_state;
-            }
-        }
+        common_emu_sound_sync(true);
     }
 }
 
 static Int32 soundWrite(void* dummy, Int16 *buffer, UInt32 count)
 {
-    size_t offset = (dma_state == DMA_TRANSFER_STATE_HF) ? 0 : (AUDIO_MSX_SAMPLE_RATE/msx_fps);
     uint8_t volume = odroid_audio_volume_get();
     if (volume != currentVolume) {
         if (volume == 0) {
@@ -1799,7 +1737,8 @@ static Int32 soundWrite(void* dummy, Int16 *buffer, UInt32 count)
         currentVolume = volume;
     }
 
-    memcpy(&audiobuffer_dma[offset],buffer,(AUDIO_MSX_SAMPLE_RATE/msx_fps)*sizeof(Int16));
+    // The blueMSX mixer applies the volume itself
+    audio_mix_copy(common_emu_sound_get_buffer(AUDIO_MSX_SAMPLE_RATE/msx_fps), buffer, AUDIO_MSX_SAMPLE_RATE/msx_fps);
     return 0;
 }
 
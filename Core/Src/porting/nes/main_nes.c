@@ -16,6 +16,7 @@
 #include "gw_lcd.h"
 #include "gw_linker.h"
 #include "common.h"
+#include "audio_mix.h"
 #include "rom_manager.h"
 #include "rg_i18n.h"
 #include "lz4_depack.h"
@@ -73,41 +74,15 @@ int osd_init()
    return 0;
 }
 
-// TODO: Move to lcd.c/h
-extern LTDC_HandleTypeDef hltdc;
-
 static rgb_t *palette = NULL;
 static uint16_t palette565[256];
-static uint32_t palette_spaced_565[256];
+static uint32_t palette_spaced_565[256] ITCM_EMU_BSS; // Read for each pixel by the filtering scalers
 
 
 void osd_setpalette(rgb_t *pal)
 {
     palette = pal;
-#ifdef GW_LCD_MODE_LUT8
-    uint32_t clut[256];
 
-    for (int i = 0; i < 64; i++)
-    {
-        uint16_t c = (pal[i].b>>3) | ((pal[i].g>>2)<<5) | ((pal[i].r>>3)<<11);
-
-        // The upper bits are used to indicate background and transparency.
-        // They need to be indexed as well.
-        clut[i]        = (pal[i].b) | (pal[i].g << 8) | (pal[i].r << 16);
-        clut[i | 0x40] = (pal[i].b) | (pal[i].g << 8) | (pal[i].r << 16);
-        clut[i | 0x80] = (pal[i].b) | (pal[i].g << 8) | (pal[i].r << 16);
-    }
-
-    // Update the color-LUT in the LTDC peripheral
-    HAL_LTDC_ConfigCLUT(&hltdc, clut, 256, 0);
-    HAL_LTDC_EnableCLUT(&hltdc, 0);
-
-    // color 13 is "black". Makes for a nice border.
-    memset(framebuffer1, 13, sizeof(framebuffer1));
-    memset(framebuffer2, 13, sizeof(framebuffer2));
-
-    odroid_display_force_refresh();
-#else
     for (int i = 0; i < 64; i++)
     {
         uint16_t c = (pal[i].b>>3) | ((pal[i].g>>2)<<5) | ((pal[i].r>>3)<<11);
@@ -125,7 +100,11 @@ void osd_setpalette(rgb_t *pal)
 
     }
 
-#endif
+    // Uploaded to the LTDC CLUT with the next LUT8 frame
+    lcd_lut8_set_palette(palette565, 0, 256);
+
+    // color 13 is "black". Makes for a nice border.
+    lcd_lut8_set_background(13);
 }
 
 void osd_vsync()
@@ -138,16 +117,8 @@ void osd_vsync()
     nes_getptr()->drawframe = draw_frame;
 
     // Wait until the audio buffer has been transmitted
-    static uint32_t last_dma_counter = 0;
     t0 = get_elapsed_time();
-    if(!common_emu_state.skip_frames){
-        for(uint8_t p = 0; p < common_emu_state.pause_frames + 1; p++) {
-            while (dma_counter == last_dma_counter) {
-                cpumon_sleep();
-            }
-            last_dma_counter = dma_counter;
-        }
-    }
+    common_emu_sound_sync(true);
 
     vsync_wait_ms += get_elapsed_time_since(t0);
 }
@@ -156,71 +127,12 @@ void nes_audio_submit(int16_t *buffer, int audioSamples)
 {
     // apu_process(audiobuffer_emulator, audioSamples, false); //get audio data
 
-    size_t offset = (dma_state == DMA_TRANSFER_STATE_HF) ? 0 : audioSamples;
-
     // MUST shift with at least 1 place, or it will brownout.
-    uint8_t volume = odroid_audio_volume_get();
-    int32_t factor = volume_tbl[volume];
-
-    if (audio_mute || (volume == ODROID_AUDIO_VOLUME_MIN)) {
-        // mute
-        for (int i = 0; i < audioSamples; i++) {
-            audiobuffer_dma[i + offset] = 0;
-        }
-        return;
-    }
-
-    // Write to DMA buffer and lower the volume accordingly
-    for (int i = 0; i < audioSamples; i++) {
-        int32_t sample = buffer[i];
-        audiobuffer_dma[i + offset] = (sample * factor) >> 8;
-    }
+    audio_mix_s16(common_emu_sound_get_buffer(audioSamples), buffer, audioSamples,
+                  common_emu_sound_get_volume(), 8);
 }
 
 
-#ifdef GW_LCD_MODE_LUT8
-static inline void blit_normal(bitmap_t *bmp, uint8_t *framebuffer) {
-        // LCD is 320 wide, framebuffer is only 256
-    const int hpad = (WIDTH - NES_SCREEN_WIDTH) / 2;
-
-    for (int y = 0; y < bmp->height; y++) {
-        uint8_t *row = bmp->line[y];
-        uint32 *dest = NULL;
-        if(active_framebuffer == 0) {
-            dest = &framebuffer[WIDTH * y + hpad];
-        } else {
-            dest = &framebuffer[WIDTH * y + hpad];
-        }
-        memcpy(dest, row, bmp->width);
-    }
-}
-
-static inline void blit_nearest(bitmap_t *bmp, uint8_t *framebuffer) {
-    int w1 = bmp->width;
-    int h1 = bmp->height;
-    int w2 = WIDTH;
-    int h2 = h1;
-
-    // Blit: 5581 us
-    // This can still be improved quite a bit by using aligned accesses.
-
-    int ctr = 0;
-    for (int y = 0; y < h2; y++) {
-        uint8_t  *src_row  = bmp->line[y];
-        uint8_t *dest_row = &framebuffer[y * w2];
-        int x2 = 0;
-        for (int x = 0; x < w1; x++) {
-            uint8_t b2 = src_row[x];
-            dest_row[x2++] = b2;
-            if (ctr++ == 4) {
-                ctr = 0;
-                dest_row[x2++] = b2;
-            }
-        }
-    }
-}
-#else
-
 // No scaling
 __attribute__((optimize("unroll-loops")))
 static inline void blit_normal(bitmap_t *bmp, uint16_t *framebuffer) {
@@ -285,7 +197,7 @@ static inline void blit_nearest(bitmap_t *bmp, uint16_t *framebuffer, bool full_
 
 #define CONV(_b0) ((0b11111000000000000000000000&_b0)>>10) | ((0b000001111110000000000&_b0)>>5) | ((0b0000000000011111&_b0));
 
-__attribute__((optimize("unroll-loops")))
+ITCM_EMU_TEXT __attribute__((optimize("unroll-loops")))
 static void blit_4to5(bitmap_t *bmp, uint16_t *framebuffer) {
     int w1 = bmp->width;
     int w2 = WIDTH;
@@ -312,7 +224,7 @@ static void blit_4to5(bitmap_t *bmp, uint16_t *framebuffer) {
 }
 
 
-__attribute__((optimize("unroll-loops")))
+ITCM_EMU_TEXT __attribute__((optimize("unroll-loops")))
 static void blit_5to6(bitmap_t *bmp, uint16_t *framebuffer) {
     int w1_adjusted = bmp->width - 4;
     int w2 = WIDTH;
@@ -344,13 +256,62 @@ static void blit_5to6(bitmap_t *bmp, uint16_t *framebuffer) {
         dest_row[x_dst] = palette565[src_row[x_src]];
     }
 }
-#endif
 
-static void blit(bitmap_t *bmp, uint16_t *framebuffer)
+// LUT8 versions of blit_normal() and blit_nearest(), the LTDC does the palette lookup
+static inline void blit_normal_lut8(bitmap_t *bmp, uint8_t *framebuffer) {
+    const int w2 = 320;
+    const int h2 = 240;
+    const int hpad = 27;
+
+    for (int y = 0; y < h2; y++) {
+        memcpy(&framebuffer[y * w2 + hpad], bmp->line[y], bmp->width);
+    }
+}
+
+__attribute__((optimize("unroll-loops")))
+static inline void blit_nearest_lut8(bitmap_t *bmp, uint8_t *framebuffer, bool full_width)
+{
+    int w1 = bmp->width;
+    int w2 = WIDTH;
+    int h2 = 240;
+    int hpad = full_width ? 0 : (WIDTH - 307) / 2;
+    int scale_ctr = full_width ? 3 : 4;
+
+    for (int y = 0; y < h2; y++) {
+        int ctr = 0;
+        uint8_t *src_row  = bmp->line[y];
+        uint8_t *dest_row = &framebuffer[y * w2 + hpad];
+        int x2 = 0;
+        for (int x = 0; x < w1; x++) {
+            uint8_t b2 = src_row[x];
+            dest_row[x2++] = b2;
+            if (ctr++ == scale_ctr) {
+                ctr = 0;
+                dest_row[x2++] = b2;
+            }
+        }
+    }
+}
+
+// With the inlined scalers, run from the ITCM overlay of the emulator
+ITCM_EMU_TEXT static void blit(bitmap_t *bmp, uint16_t *framebuffer)
 {
     odroid_display_scaling_t scaling = odroid_display_get_scaling_mode();
     odroid_display_filter_t filtering = odroid_display_get_filter_mode();
 
+    // The interpolating scalers blend colors, they need RGB565
+    bool nearest = (scaling == ODROID_DISPLAY_SCALING_OFF) ||
+                   (scaling == ODROID_DISPLAY_SCALING_FIT) ||
+                   (scaling == ODROID_DISPLAY_SCALING_FULL && filtering == ODROID_DISPLAY_FILTER_OFF);
+
+    if (common_emu_lut8_frame(!nearest)) {
+        if (scaling == ODROID_DISPLAY_SCALING_FULL)
+            blit_nearest_lut8(bmp, (uint8_t *) framebuffer, true);
+        else
+            blit_normal_lut8(bmp, (uint8_t *) framebuffer);
+        return;
+    }
+
     switch (scaling) {
     case ODROID_DISPLAY_SCALING_OFF:
         /* fall-through */
@@ -43,6 +43,8 @@ int odroid_overlay_game_menu()
 #include "rg_rtc.h"
 #include "rg_i18n.h"
 #include "main_msx.h"
+#include "common.h"
+#include "frame_stats.h"
 
 static retro_emulator_file_t *CHOSEN_FILE = NULL;
 // static uint16_t *overlay_buffer = NULL;
@@ -993,23 +995,29 @@ int odroid_overlay_settings_menu(odroid_dialog_choice_t *extra_options)
     return ret;
 }
 
-static void draw_game_status_bar(runtime_stats_t stats)
+static void draw_game_status_bar(runtime_stats_t stats, const frame_stats_report_t *frames)
 {
     int width = ODROID_SCREEN_WIDTH - 48, height = 16;
     int pad_text = (height - i18n_get_text_height()) / 2;
-    char bottom[80], header[60];
+    char bottom[80], header[60], timing[80];
 
-    snprintf(header, 60, "%s: %d.%d (%d.%d) / %s: %d.%d%%",
+    uint16_t speed = common_emu_speed_get();
+
+    snprintf(header, 60, "%s: %d.%d (%d.%d) / %s: %d.%d%% / x%d.%02d",
              curr_lang->s_FPS,
              (int)stats.totalFPS, (int)fmod(stats.totalFPS * 10, 10),
              (int)stats.skippedFPS, (int)fmod(stats.skippedFPS * 10, 10),
              curr_lang->s_BUSY,
-             (int)stats.busyPercent, (int)fmod(stats.busyPercent * 10, 10));
+             (int)stats.busyPercent, (int)fmod(stats.busyPercent * 10, 10),
+             speed / 100, speed % 100);
     snprintf(bottom, 80, "%s", ACTIVE_FILE ? (ACTIVE_FILE->name) : "N/A");
+    // p50/p95/p99, stutters show in the last two
+    frame_stats_format(timing, sizeof(timing), frames);
 
     odroid_overlay_draw_fill_rect(0, 0, ODROID_SCREEN_WIDTH, height, curr_colors->main_c);
-    odroid_overlay_draw_fill_rect(0, ODROID_SCREEN_HEIGHT - height, ODROID_SCREEN_WIDTH, height, curr_colors->main_c);
+    odroid_overlay_draw_fill_rect(0, ODROID_SCREEN_HEIGHT - height * 2, ODROID_SCREEN_WIDTH, height * 2, curr_colors->main_c);
     i18n_draw_text_line(48, pad_text, width, header, curr_colors->sel_c, curr_colors->main_c, 0, curr_lang);
+    i18n_draw_text_line(0, ODROID_SCREEN_HEIGHT - height * 2 + pad_text, ODROID_SCREEN_WIDTH, timing, curr_colors->sel_c, curr_colors->main_c, 0, curr_lang);
     i18n_draw_text_line(0, ODROID_SCREEN_HEIGHT - height + pad_text, ODROID_SCREEN_WIDTH, bottom, curr_colors->sel_c, curr_colors->main_c, 0, curr_lang);
     odroid_overlay_clock(2, 3);
     odroid_overlay_draw_battery(ODROID_SCREEN_WIDTH - 22, ODROID_SCREEN_HEIGHT - 13);
@@ -1073,8 +1081,9 @@ static bool cheat_update_cb(odroid_dialog_choice_t *option, odroid_dialog_event_
     bool is_on = odroid_settings_ActiveGameGenieCodes_is_enabled(CHOSEN_FILE->id, option->id);
     if (event == ODROID_DIALOG_PREV || event == ODROID_DIALOG_NEXT) 
     {
-        is_on = is_on ? false : true;
-        odroid_settings_ActiveGameGenieCodes_set(CHOSEN_FILE->id, option->id, is_on);
+        // Stays off when no more games can have cheats
+        if (odroid_settings_ActiveGameGenieCodes_set(CHOSEN_FILE->id, option->id, !is_on))
+            is_on = !is_on;
     }
     strcpy(option->value, is_on ? curr_lang->s_Cheat_Codes_ON : curr_lang->s_Cheat_Codes_OFF);
     #ifdef ENABLE_EMULATOR_MSX
@@ -1095,7 +1104,8 @@ static bool show_cheat_dialog()
     printf("count = %d\n",CHOSEN_FILE->cheat_count);
     // +1 for the terminator sentinel
     odroid_dialog_choice_t *choices = rg_alloc((CHOSEN_FILE->cheat_count + 1) * sizeof(odroid_dialog_choice_t), MEM_ANY);
-    char svalues[MAX_CHEAT_CODES][10];
+    // A ROM can have any number of cheats
+    char (*svalues)[10] = rg_alloc(CHOSEN_FILE->cheat_count * sizeof(*svalues), MEM_ANY);
 
     for(int i=0; i<CHOSEN_FILE->cheat_count; i++) 
     {
@@ -1113,6 +1123,7 @@ static bool show_cheat_dialog()
     odroid_overlay_dialog(curr_lang->s_Cheat_Codes_Title, choices, 0);
 
     rg_free(choices);
+    rg_free(svalues);
     odroid_settings_commit();
     return false;
 }
@@ -1222,12 +1233,14 @@ int odroid_overlay_game_menu(odroid_dialog_choice_t *extra_options)
     }
 
     // Collect stats before freezing emulation with wait_all_keys_released()
+    frame_stats_report_t frames;
+    frame_stats_get(&frames);
     runtime_stats_t stats = odroid_system_get_stats();
 
     odroid_audio_mute(true);
     while (odroid_input_key_is_pressed(ODROID_INPUT_ANY))
         wdog_refresh();
-    draw_game_status_bar(stats);
+    draw_game_status_bar(stats, &frames);
 
     lcd_sync();
 
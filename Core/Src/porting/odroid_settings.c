@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <stddef.h>
 #include <string.h>
 
 #include "odroid_system.h"
@@ -8,6 +9,10 @@
 #include "appid.h"
 #include "game_genie.h"
 #include "gui.h"
+#include "rom_manager.h"
+#include "crc32.h"
+#include "settings_journal.h"
+#include "odroid_settings_schema.h"
 
 #define CONFIG_MAGIC 0xcafef00d
 #define ODROID_APPID_COUNT 4
@@ -26,30 +31,76 @@
 #define UICODEPAGE 1252
 #endif
 static const char* Key_RomFilePath  = "RomFilePath";
-static const char* Key_AudioSink    = "AudioSink";
 
-// Per-app
-static const char* Key_DispRotation = "DistRotation";
-
-typedef struct app_config {
+#if CHEAT_CODES == 1
+// Each CheatCodes value of a game holds 32 codes, the value of a code is code_index / 32
+#define CHEAT_CODES_PER_VALUE 32
+#define CHEAT_CODES_MAX       (CHEAT_CODES_PER_VALUE * (UINT8_MAX + 1))
+_Static_assert(MAX_CHEAT_CODES <= CHEAT_CODES_PER_VALUE, "A game needs several CheatCodes entries");
+// Every game fits when there are few of them
+#define CHEAT_ROMS (ROM_COUNT < ODROID_SETTINGS_CHEAT_ROMS ? ROM_COUNT : ODROID_SETTINGS_CHEAT_ROMS)
+#else
+#define CHEAT_ROMS 0
+#endif
+#define ROM_VALUES (ODROID_SETTINGS_ROM_VALUES + CHEAT_ROMS)
+
+// Index of each setting in the values of its scope
+#define SETTING_INDEX(key, name, type, min, max, def, accessors) SETTING_##name,
+enum { ODROID_SETTINGS_GLOBAL(SETTING_INDEX) GLOBAL_COUNT };
+enum { ODROID_SETTINGS_APP(SETTING_INDEX) APP_COUNT };
+
+#define SETTING_KEY(key, name, type, min, max, def, accessors) KEY_##name = key,
+enum { ODROID_SETTINGS_GLOBAL(SETTING_KEY) ODROID_SETTINGS_APP(SETTING_KEY) ODROID_SETTINGS_ROM(SETTING_KEY) };
+
+typedef struct {
+    uint32_t rom;  // odroid_settings_rom_id(), 0 for an unused entry
+    uint16_t key;
+    uint8_t index; // Of a setting with several values, `app` in flash
+    int32_t value;
+} rom_value_t;
+
+static int32_t global_values[GLOBAL_COUNT];
+static int32_t app_values[APPID_COUNT][APP_COUNT];
+// ODROID_SETTINGS_ROM_VALUES entries reused in turn, then the CheatCodes
+static rom_value_t rom_values[ROM_VALUES];
+static uint8_t rom_values_next; // Entry replaced when all are in use
+
+// Stored in flash, the unused entries have key 0
+typedef struct {
+    uint16_t key;
+    uint8_t app;      // Of the per-app settings, the index of a per-ROM value
+    uint8_t reserved;
+    uint32_t rom;     // Of the per-ROM settings
+    int32_t value;
+} settings_entry_t;
+
+typedef struct {
+    settings_entry_t entries[ODROID_SETTINGS_IMAGE_ENTRIES];
+} settings_image_t;
+
+_Static_assert(GLOBAL_COUNT + APPID_COUNT * APP_COUNT + ODROID_SETTINGS_ROM_VALUES + ODROID_SETTINGS_CHEAT_ROMS <= ODROID_SETTINGS_IMAGE_ENTRIES,
+               "ODROID_SETTINGS_IMAGE_ENTRIES is too small for the schema");
+// The rest of a bank holds the change records, the bigger the image the
+// sooner a commit compacts, which is the only erase. 1K is some 40 commits
+// of a few settings. The cheats don't grow the image with ROM_COUNT, they
+// have ODROID_SETTINGS_CHEAT_ROMS entries of it.
+_Static_assert(SETTINGS_JOURNAL_HEADER_SIZE + sizeof(settings_image_t) + 1024 <= SETTINGS_JOURNAL_BANK_SIZE,
+               "settings_image_t leaves no room for the settings journal");
+
+/*
+ * Layout of the struct stored before the schema, a whole struct image
+ * written by store_save() (version 5). Only read to migrate it.
+ */
+typedef struct legacy_app_config {
     uint8_t region;
     uint8_t palette;
     uint8_t disp_scaling;
     uint8_t disp_filter;
     uint8_t disp_overscan;
     uint8_t sprite_limit;
-} app_config_t;
-
-#if CHEAT_CODES == 1
-#if (MAX_CHEAT_CODES > 32)
-#error MAX_CHEAT_CODES is assumed to be 32. Changing this value requires adjusting the type of active_cheat_codes below
-#endif
-typedef struct rom_config {
-    uint32_t active_cheat_codes; // A bit array for which cheat codes in retro_emulator_file_t.cheat_codes are active for this rom
-} rom_config_t;
-#endif
+} legacy_app_config_t;
 
-typedef struct persistent_config {
+typedef struct legacy_config {
     uint32_t magic;
     uint8_t version;
 
@@ -70,222 +121,387 @@ typedef struct persistent_config {
     uint16_t main_menu_selected_tab;
     uint16_t main_menu_cursor;
 
-    app_config_t app[APPID_COUNT];
+    legacy_app_config_t app[APPID_COUNT];
 
 #if CHEAT_CODES == 1
-    rom_config_t rom[ROM_COUNT]; // index is the same as 'id' in retro_emulator_file_t
+    uint32_t active_cheat_codes[ROM_COUNT]; // index is the same as 'id' in retro_emulator_file_t
 #endif
 
     uint32_t crc32;
-} persistent_config_t;
-
-static const persistent_config_t persistent_config_default = {
-    .magic = CONFIG_MAGIC,
-    .version = 5,
-
-    .backlight = ODROID_BACKLIGHT_LEVEL6,
-    .start_action = ODROID_START_ACTION_RESUME,
-    .volume = ODROID_AUDIO_VOLUME_MAX / 2, // Too high volume can cause brown out if the battery isn't connected.
-    .font_size = 8,
-    .theme = 2, //use as theme index
-    .colors = 0,
-    .turbo_buttons = 0,
-    .font = 0,
-#if CODEPAGE==12521
-    .lang = 1,
-#elif CODEPAGE==12522
-    .lang = 2,
-#elif CODEPAGE==12523
-    .lang = 3,
-#elif CODEPAGE==12524
-    .lang = 4,
-#elif CODEPAGE==12525
-    .lang = 5,
-#elif CODEPAGE==12511
-    .lang = 6,
-#elif CODEPAGE==932
-    .lang = 10,
-#elif CODEPAGE==936
-    .lang = 7,
-#elif CODEPAGE==949
-    .lang = 9,
-#elif CODEPAGE==950
-    .lang = 8,
-#else
-    .lang = 0,
-#endif
-    .startup_app = 0,
-    .cpu_oc_level = 0,
-    .main_menu_timeout_s = 60 * 10, // Turn off after 10 minutes of idle time in the main menu
-    .main_menu_selected_tab = 0,
-    .main_menu_cursor = 0,
-    .app = {
-        {0}, // Launcher
-        {
-            .region = 0,
-            .palette = 2,
-            .disp_scaling = ODROID_DISPLAY_SCALING_FULL,
-            .disp_filter = ODROID_DISPLAY_FILTER_SHARP,
-            .disp_overscan = 0,
-            .sprite_limit = 0,
-        }, // GB
-        {
-            .disp_scaling = ODROID_DISPLAY_SCALING_CUSTOM,
-            .disp_filter = ODROID_DISPLAY_FILTER_SHARP,
-        }, // NES
-        {0}, // SMS
-        {0}, // PCE
-        {0}, // GW
-        {0}, // MD Genesis
-    },
-#if CHEAT_CODES == 1
-    .rom = {{0}},
-#endif
+} legacy_config_t;
+
+#define LEGACY_VERSION 5
+
+// The first bank is the config sector of the older firmwares, where their
+// settings are migrated from. The second one comes out of the end of the
+// extflash so that the save regions stay where they were.
+__attribute__((section (".configflash"))) __attribute__((aligned(4096))) uint8_t persistent_config_flash[SETTINGS_JOURNAL_BANK_SIZE];
+__attribute__((section (".configflash2"))) __attribute__((aligned(4096))) uint8_t persistent_config_flash2[SETTINGS_JOURNAL_BANK_SIZE];
+_Static_assert(SETTINGS_JOURNAL_BANKS == 2, "One config flash section per bank");
+
+static settings_image_t settings_image;
+// Image stored in the journal, commits write what differs from it. Holds
+// the legacy config while it is migrated.
+static union {
+    settings_image_t image;
+    legacy_config_t legacy;
+} settings_committed;
+static settings_journal_t settings_journal;
+
+static uint8_t *const config_flash_banks[SETTINGS_JOURNAL_BANKS] = {
+    persistent_config_flash,
+    persistent_config_flash2,
 };
 
-__attribute__((section (".configflash"))) __attribute__((aligned(4096))) persistent_config_t persistent_config_flash;
-persistent_config_t persistent_config_ram;
+static void config_flash_erase(uint32_t offset, uint32_t size)
+{
+    store_erase(&config_flash_banks[offset / SETTINGS_JOURNAL_BANK_SIZE][offset % SETTINGS_JOURNAL_BANK_SIZE], size);
+}
 
-void odroid_settings_init()
+static void config_flash_program(uint32_t offset, const void *data, uint32_t size)
 {
-    memcpy(&persistent_config_ram, &persistent_config_flash, sizeof(persistent_config_t));
+    store_program(&config_flash_banks[offset / SETTINGS_JOURNAL_BANK_SIZE][offset % SETTINGS_JOURNAL_BANK_SIZE], data, size);
+}
 
-    if (persistent_config_ram.magic != CONFIG_MAGIC) {
-        printf("Config: Magic mismatch. Expected 0x%08x, got 0x%08lx\n", CONFIG_MAGIC, persistent_config_ram.magic);
-        odroid_settings_reset();
-        return;
-    }
+static const settings_journal_flash_t config_flash = {
+    .banks = {persistent_config_flash, persistent_config_flash2},
+    .erase = config_flash_erase,
+    .program = config_flash_program,
+};
 
-    if (persistent_config_ram.version != persistent_config_default.version) {
-        printf("Config: New config version, resetting settings.\n");
-        odroid_settings_reset();
-        return;
+static inline int32_t clamp(int32_t value, int32_t min, int32_t max)
+{
+    return value < min ? min : value > max ? max : value;
+}
+
+static rom_value_t *rom_value_find(uint32_t rom, uint16_t key, uint8_t index)
+{
+    for (int i = 0; rom && i < ROM_VALUES; i++) {
+        if (rom_values[i].rom == rom && rom_values[i].key == key && rom_values[i].index == index)
+            return &rom_values[i];
     }
+    return NULL;
+}
 
-    // Calculate crc32 of the whole struct with the crc32 value set to 0
-    persistent_config_ram.crc32 = 0;
-    persistent_config_ram.crc32 = crc32_le(0, (unsigned char *) &persistent_config_ram, sizeof(persistent_config_t));
+// False when the CheatCodes entries are all in use, they are never replaced
+static bool rom_value_set(uint32_t rom, uint16_t key, uint8_t index, int32_t value)
+{
+    bool cheats = key == KEY_CheatCodes;
+    int first = cheats ? ODROID_SETTINGS_ROM_VALUES : 0;
+    int end = cheats ? ROM_VALUES : ODROID_SETTINGS_ROM_VALUES;
+    rom_value_t *entry;
 
-    if (persistent_config_ram.crc32 != persistent_config_flash.crc32) {
-        printf("Config: CRC32 mismatch. Expected 0x%08lx, got 0x%08lx\n", persistent_config_ram.crc32, persistent_config_flash.crc32);
-        odroid_settings_reset();
-        return;
+    if (!rom)
+        return false;
+
+    entry = rom_value_find(rom, key, index);
+
+    for (int i = first; entry == NULL && i < end; i++) {
+        if (rom_values[i].rom == 0)
+            entry = &rom_values[i];
     }
-    //set colors;
-    curr_colors = (colors_t *)(&gui_colors[persistent_config_flash.colors]);
-    //set font
-    curr_font = odroid_settings_font_get();
-    //set lang
-    curr_lang = (lang_t *)gui_lang[odroid_settings_lang_get()];
+    if (entry == NULL && cheats)
+        return false;
+    if (entry == NULL) {
+        entry = &rom_values[rom_values_next % ODROID_SETTINGS_ROM_VALUES];
+        rom_values_next = (rom_values_next + 1) % ODROID_SETTINGS_ROM_VALUES;
+    }
+
+    entry->rom = rom;
+    entry->key = key;
+    entry->index = index;
+    entry->value = value;
+    return true;
 }
 
-void odroid_settings_commit()
+uint32_t odroid_settings_rom_id(const char *name)
 {
-    // Calculate crc32 of the whole struct with the crc32 value set to 0
-    persistent_config_ram.crc32 = 0;
-    persistent_config_ram.crc32 = crc32_le(0, (unsigned char *) &persistent_config_ram, sizeof(persistent_config_t));
+    return crc32_le(0, (const unsigned char *)name, strlen(name));
+}
 
-    store_save((const uint8_t *) &persistent_config_flash, (const uint8_t *) &persistent_config_ram, sizeof(persistent_config_t));
+void odroid_settings_rom_clear(uint32_t rom)
+{
+    for (int i = 0; rom && i < ROM_VALUES; i++) {
+        if (rom_values[i].rom == rom)
+            memset(&rom_values[i], 0, sizeof(rom_values[i]));
+    }
 }
 
-void odroid_settings_reset()
+// Validates a value read from flash, false for a key this firmware doesn't know
+static bool settings_load_value(uint16_t key, uint8_t app, uint32_t rom, int32_t value)
+{
+#define LOAD_GLOBAL(key, name, type, min, max, def, accessors) \
+    case key: \
+        global_values[SETTING_##name] = clamp(value, min, max); \
+        return true;
+#define LOAD_APP(key, name, type, min, max, def, accessors) \
+    case key: \
+        if (app < APPID_COUNT) \
+            app_values[app][SETTING_##name] = clamp(value, min, max); \
+        return true;
+#define LOAD_ROM(key, name, type, min, max, def, accessors) \
+    case key: \
+        rom_value_set(rom, key, app, clamp(value, min, max)); \
+        return true;
+
+    // A key defined twice doesn't build
+    switch (key) {
+    ODROID_SETTINGS_GLOBAL(LOAD_GLOBAL)
+    ODROID_SETTINGS_APP(LOAD_APP)
+    ODROID_SETTINGS_ROM(LOAD_ROM)
+    default:
+        return false;
+    }
+}
+
+static void settings_image_load(const settings_image_t *image)
 {
-#if CHEAT_CODES == 1 
-    for (int i = 0; i < ROM_COUNT; i++)
-    {
-        persistent_config_ram.rom[i].active_cheat_codes = 0;
-    };
-#endif
-    memcpy(&persistent_config_ram, &persistent_config_default, sizeof(persistent_config_t));
+    int dropped = 0;
 
-    // odroid_settings_commit();
+    for (int i = 0; i < ODROID_SETTINGS_IMAGE_ENTRIES; i++) {
+        const settings_entry_t *entry = &image->entries[i];
+
+        if (entry->key != 0 && !settings_load_value(entry->key, entry->app, entry->rom, entry->value))
+            dropped++;
+    }
+    if (dropped)
+        printf("Config: Dropped %d unknown settings.\n", dropped);
 }
 
-char* odroid_settings_string_get(const char *key, const char *default_value)
+static void settings_image_build(settings_image_t *image)
 {
-    return (char *) default_value;
+    settings_entry_t *entry = image->entries;
+
+#define SAVE_GLOBAL(key, name, type, min, max, def, accessors) \
+    *entry++ = (settings_entry_t){ key, 0, 0, 0, global_values[SETTING_##name] };
+#define SAVE_APP(key, name, type, min, max, def, accessors) \
+    *entry++ = (settings_entry_t){ key, app, 0, 0, app_values[app][SETTING_##name] };
+
+    memset(image, 0, sizeof(*image));
+
+    ODROID_SETTINGS_GLOBAL(SAVE_GLOBAL)
+    for (int app = 0; app < APPID_COUNT; app++) {
+        ODROID_SETTINGS_APP(SAVE_APP)
+    }
+    // Same slots as in RAM, a changed per-ROM value only rewrites its entry
+    for (int i = 0; i < ROM_VALUES; i++, entry++) {
+        if (rom_values[i].rom == 0)
+            continue;
+        entry->key = rom_values[i].key;
+        entry->app = rom_values[i].index;
+        entry->rom = rom_values[i].rom;
+        entry->value = rom_values[i].value;
+    }
 }
 
-void odroid_settings_string_set(const char *key, const char *value)
+#if CHEAT_CODES == 1
+// retro_emulator_file_t.id to odroid_settings_rom_id()
+static uint32_t cheat_rom_id(uint32_t rom_id)
 {
+    for (int s = 0; s < rom_mgr.systems_count; s++) {
+        const rom_system_t *system = rom_mgr.systems[s];
+
+        for (int i = 0; i < system->roms_count; i++) {
+            if (system->roms[i].id == rom_id)
+                return odroid_settings_rom_id(system->roms[i].name);
+        }
+    }
+    return 0;
 }
+#endif
 
-int32_t odroid_settings_int32_get(const char *key, int32_t default_value)
+// Whole struct image written by store_save() before the journal. Its crc32
+// was computed with the crc32 field set to 0.
+static bool legacy_config_read(const uint8_t *image, legacy_config_t *legacy)
 {
-    return default_value;
+    static const uint8_t zero[sizeof(uint32_t)] = {0};
+    const legacy_config_t *config = (const legacy_config_t *)image;
+    uint32_t crc = crc32_le(0, image, offsetof(legacy_config_t, crc32));
+
+    if (config->magic != CONFIG_MAGIC || config->version != LEGACY_VERSION ||
+        config->crc32 != crc32_le(crc, zero, sizeof(zero)))
+        return false;
+
+    memcpy(legacy, image, sizeof(*legacy));
+    return true;
 }
 
-void odroid_settings_int32_set(const char *key, int32_t value)
+static void legacy_config_migrate(const legacy_config_t *legacy)
+{
+    printf("Config: Migrating version %d settings.\n", legacy->version);
+
+    odroid_settings_reset();
+    settings_load_value(KEY_Backlight, 0, 0, legacy->backlight);
+    settings_load_value(KEY_StartAction, 0, 0, legacy->start_action);
+    settings_load_value(KEY_Volume, 0, 0, legacy->volume);
+    settings_load_value(KEY_FontSize, 0, 0, legacy->font_size);
+    settings_load_value(KEY_theme, 0, 0, legacy->theme);
+    settings_load_value(KEY_colors, 0, 0, legacy->colors);
+    settings_load_value(KEY_turbo_buttons, 0, 0, legacy->turbo_buttons);
+    settings_load_value(KEY_font, 0, 0, legacy->font);
+    settings_load_value(KEY_lang, 0, 0, legacy->lang);
+    settings_load_value(KEY_StartupApp, 0, 0, legacy->startup_app);
+    settings_load_value(KEY_cpu_oc_level, 0, 0, legacy->cpu_oc_level);
+    settings_load_value(KEY_StartupFile, 0, 0, (int32_t)(intptr_t)legacy->startup_file);
+    settings_load_value(KEY_MainMenuTimeoutS, 0, 0, legacy->main_menu_timeout_s);
+    settings_load_value(KEY_MainMenuSelectedTab, 0, 0, legacy->main_menu_selected_tab);
+    settings_load_value(KEY_MainMenuCursor, 0, 0, legacy->main_menu_cursor);
+
+    for (int app = 0; app < APPID_COUNT; app++) {
+        settings_load_value(KEY_Region, app, 0, legacy->app[app].region);
+        settings_load_value(KEY_Palette, app, 0, legacy->app[app].palette);
+        settings_load_value(KEY_DisplayScaling, app, 0, legacy->app[app].disp_scaling);
+        settings_load_value(KEY_DisplayFilter, app, 0, legacy->app[app].disp_filter);
+        settings_load_value(KEY_DisplayOverscan, app, 0, legacy->app[app].disp_overscan);
+        settings_load_value(KEY_SpriteLimit, app, 0, legacy->app[app].sprite_limit);
+    }
+
+#if CHEAT_CODES == 1
+    int dropped = 0;
+
+    for (int i = 0; i < ROM_COUNT; i++) {
+        if (legacy->active_cheat_codes[i] != 0 &&
+            !rom_value_set(cheat_rom_id(i), KEY_CheatCodes, 0, legacy->active_cheat_codes[i]))
+            dropped++;
+    }
+    if (dropped)
+        printf("Config: Dropped the cheats of %d games.\n", dropped);
+#endif
+}
+
+// Settings written by an older firmware, the next commit compacts them into the other bank
+static bool odroid_settings_load_legacy(void)
 {
+    legacy_config_t *legacy = &settings_committed.legacy;
+
+    // The config sector of the older firmwares is the first bank
+    if (legacy_config_read(persistent_config_flash, legacy)) {
+        legacy_config_migrate(legacy);
+        settings_journal.bank = 0;
+        return true;
+    }
+    return false;
 }
 
-void odroid_settings_cpu_oc_level_set(uint8_t oc)
+void odroid_settings_init()
 {
-    oc = (oc < 0) ? 0 : ((oc > 2) ? 2 : oc);
-    persistent_config_ram.cpu_oc_level = oc;
+    if (settings_journal_load(&settings_journal, &config_flash, &settings_committed.image,
+                              sizeof(settings_image_t), ODROID_SETTINGS_IMAGE_VERSION)) {
+        odroid_settings_reset();
+        settings_image_load(&settings_committed.image);
+    } else if (!odroid_settings_load_legacy()) {
+        printf("Config: No valid config, resetting settings.\n");
+        odroid_settings_reset();
+        return;
+    }
+
+    //set colors;
+    curr_colors = (colors_t *)(&gui_colors[odroid_settings_colors_get()]);
+    //set font
+    curr_font = odroid_settings_font_get();
+    //set lang
+    curr_lang = (lang_t *)gui_lang[odroid_settings_lang_get()];
 }
 
-uint8_t odroid_settings_cpu_oc_level_get(void)
+void odroid_settings_commit()
 {
-    return persistent_config_ram.cpu_oc_level;
+    settings_image_build(&settings_image);
+    settings_journal_commit(&settings_journal, &settings_image, &settings_committed.image);
 }
 
-int8_t odroid_settings_colors_get()
+void odroid_settings_reset()
 {
-    int colors = persistent_config_ram.colors;
-    if (colors < 0)
-        persistent_config_ram.colors = 0;
-    else if (colors >= gui_colors_count)
-        persistent_config_ram.colors = gui_colors_count - 1;
-    return persistent_config_ram.colors;
+#define RESET_GLOBAL(key, name, type, min, max, def, accessors) \
+    global_values[SETTING_##name] = (int32_t)(intptr_t)(def);
+#define RESET_APP(key, name, type, min, max, def, accessors) \
+    app_values[app][SETTING_##name] = (def);
+
+    ODROID_SETTINGS_GLOBAL(RESET_GLOBAL)
+    for (int app = 0; app < APPID_COUNT; app++) {
+        ODROID_SETTINGS_APP(RESET_APP)
+    }
+    memset(rom_values, 0, sizeof(rom_values));
+    rom_values_next = 0;
+
+    // odroid_settings_commit();
 }
 
-void odroid_settings_colors_set(int8_t colors)
+#define ACCESSORS(scope, key, name, type, min, max, def, accessors) \
+    ACCESSORS_##accessors(scope, key, name, type, min, max, def)
+#define ACCESSORS_CUSTOM(...)
+#define ACCESSORS_GENERATED(scope, ...) ACCESSORS_##scope(__VA_ARGS__)
+
+#define ACCESSORS_GLOBAL(key, name, type, min, max, def) \
+    type odroid_settings_##name##_get(void) \
+    { \
+        return (type)(intptr_t)global_values[SETTING_##name]; \
+    } \
+    void odroid_settings_##name##_set(type value) \
+    { \
+        global_values[SETTING_##name] = clamp((int32_t)(intptr_t)value, min, max); \
+    }
+
+#define ACCESSORS_APP(key, name, type, min, max, def) \
+    type odroid_settings_##name##_get(void) \
+    { \
+        return (type)app_values[odroid_system_get_app()->id][SETTING_##name]; \
+    } \
+    void odroid_settings_##name##_set(type value) \
+    { \
+        app_values[odroid_system_get_app()->id][SETTING_##name] = clamp((int32_t)value, min, max); \
+    }
+
+#define ACCESSORS_ROM(key, name, type, min, max, def) \
+    type odroid_settings_rom_##name##_get(uint32_t rom) \
+    { \
+        rom_value_t *entry = rom_value_find(rom, key, 0); \
+        return (type)(entry ? entry->value : (def)); \
+    } \
+    void odroid_settings_rom_##name##_set(uint32_t rom, type value) \
+    { \
+        rom_value_set(rom, key, 0, clamp((int32_t)value, min, max)); \
+    }
+
+#define GLOBAL_ACCESSORS(...) ACCESSORS(GLOBAL, __VA_ARGS__)
+#define APP_ACCESSORS(...)    ACCESSORS(APP, __VA_ARGS__)
+#define ROM_ACCESSORS(...)    ACCESSORS(ROM, __VA_ARGS__)
+
+ODROID_SETTINGS_GLOBAL(GLOBAL_ACCESSORS)
+ODROID_SETTINGS_APP(APP_ACCESSORS)
+ODROID_SETTINGS_ROM(ROM_ACCESSORS)
+
+char* odroid_settings_string_get(const char *key, const char *default_value)
 {
-    if (colors < 0)
-        colors = 0;
-    else if (colors >= gui_colors_count)
-        colors = gui_colors_count - 1;
-    persistent_config_ram.colors = colors;
+    return (char *) default_value;
 }
 
+void odroid_settings_string_set(const char *key, const char *value)
+{
+}
 
-int8_t odroid_settings_font_get()
+int32_t odroid_settings_int32_get(const char *key, int32_t default_value)
 {
-    int font = persistent_config_ram.font;
-    if (font < 0)
-        persistent_config_ram.font = 0;
-    else if (font >= gui_font_count)
-        persistent_config_ram.font = gui_font_count - 1;
-    return persistent_config_ram.font;
+    return default_value;
 }
 
-void odroid_settings_font_set(int8_t font)
+void odroid_settings_int32_set(const char *key, int32_t value)
 {
-    if (font < 0)
-        font = 0;
-    else if (font >= gui_font_count)
-        font = gui_font_count - 1;
-    persistent_config_ram.font = font;
 }
 
-int8_t odroid_settings_turbo_buttons_get()
+bool odroid_settings_cpu_tier_get(uint32_t game_id, uint8_t *level, bool *locked)
 {
-    int turbo_buttons = persistent_config_ram.turbo_buttons;
-    if (turbo_buttons < 0)
-        persistent_config_ram.turbo_buttons = 0;
-    else if (turbo_buttons >= 3)
-        persistent_config_ram.turbo_buttons = 3;
-    return persistent_config_ram.turbo_buttons;
+    if (rom_value_find(game_id, KEY_CpuLevel, 0) == NULL)
+        return false;
+
+    *level = odroid_settings_rom_CpuLevel_get(game_id);
+    *locked = odroid_settings_rom_CpuLocked_get(game_id);
+    return true;
 }
 
-void odroid_settings_turbo_buttons_set(int8_t turbo_buttons)
+void odroid_settings_cpu_tier_set(uint32_t game_id, uint8_t level, bool locked)
 {
-    if (turbo_buttons < 0)
-        turbo_buttons = 0;
-    else if (turbo_buttons >= 3)
-        turbo_buttons = 3;
-    persistent_config_ram.turbo_buttons = turbo_buttons;
+    odroid_settings_rom_CpuLevel_set(game_id, level);
+    odroid_settings_rom_CpuLocked_set(game_id, locked);
 }
 
 
@@ -319,40 +535,16 @@ int8_t odroid_settings_get_prior_lang(uint8_t cur)
 
 int8_t odroid_settings_lang_get()
 {
-    int lang = persistent_config_ram.lang;
+    int lang = global_values[SETTING_lang];
     return odroid_settings_get_prior_lang(lang + 1);
 }
 
 
 void odroid_settings_lang_set(int8_t lang)
 {
-    if (lang < 0)
-        lang = 0;
-    else if (lang >= gui_lang_count)
-        lang = gui_lang_count - 1;
-    persistent_config_ram.lang = lang;
+    global_values[SETTING_lang] = clamp(lang, 0, gui_lang_count - 1);
 }
 
-#if COVERFLOW != 0
-int8_t odroid_settings_theme_get()
-{
-    int theme = persistent_config_ram.theme;
-    if (theme < 0)
-        persistent_config_ram.theme = 0;
-    else if (theme > 4)
-        persistent_config_ram.theme = 4;
-    return persistent_config_ram.theme;
-}
-void odroid_settings_theme_set(int8_t theme)
-{
-    if (theme < 0)
-        theme = 0;
-    else if (theme > 4)
-        theme = 4;
-    persistent_config_ram.theme = theme;
-}
-#endif
-
 int32_t odroid_settings_app_int32_get(const char *key, int32_t default_value)
 {
     return default_value;
@@ -366,16 +558,6 @@ void odroid_settings_app_int32_set(const char *key, int32_t value)
 }
 
 
-int32_t odroid_settings_FontSize_get()
-{
-    return persistent_config_ram.font_size;
-}
-void odroid_settings_FontSize_set(int32_t value)
-{
-    persistent_config_ram.font_size = value;
-}
-
-
 char* odroid_settings_RomFilePath_get()
 {
   return odroid_settings_string_get(Key_RomFilePath, NULL);
@@ -386,188 +568,41 @@ void odroid_settings_RomFilePath_set(const char* value)
 }
 
 
-int32_t odroid_settings_Volume_get()
-{
-    return persistent_config_ram.volume;
-}
-void odroid_settings_Volume_set(int32_t value)
-{
-    persistent_config_ram.volume = value;
-}
-
-
-int32_t odroid_settings_AudioSink_get()
-{
-  return odroid_settings_int32_get(Key_AudioSink, ODROID_AUDIO_SINK_SPEAKER);
-}
-void odroid_settings_AudioSink_set(int32_t value)
-{
-  odroid_settings_int32_set(Key_AudioSink, value);
-}
-
-
-
-int32_t odroid_settings_Backlight_get()
-{
-    return persistent_config_ram.backlight;
-}
-void odroid_settings_Backlight_set(int32_t value)
-{
-    persistent_config_ram.backlight = value;
-}
-
-
-ODROID_START_ACTION odroid_settings_StartAction_get()
-{
-    return persistent_config_ram.start_action;
-}
-void odroid_settings_StartAction_set(ODROID_START_ACTION value)
-{
-    persistent_config_ram.start_action = value;
-}
-
-
-int32_t odroid_settings_StartupApp_get()
-{
-    return persistent_config_ram.startup_app;
-}
-void odroid_settings_StartupApp_set(int32_t value)
-{
-    persistent_config_ram.startup_app = value;
-}
-
-
-void* odroid_settings_StartupFile_get()
-{
-    return persistent_config_ram.startup_file;
-}
-void odroid_settings_StartupFile_set(void *value)
-{
-    persistent_config_ram.startup_file = value;
-}
-
-
-uint16_t odroid_settings_MainMenuTimeoutS_get()
-{
-    return persistent_config_ram.main_menu_timeout_s;
-}
-void odroid_settings_MainMenuTimeoutS_set(uint16_t value)
-{
-    persistent_config_ram.main_menu_timeout_s = value;
-}
-
-uint16_t odroid_settings_MainMenuSelectedTab_get()
-{
-    return persistent_config_ram.main_menu_selected_tab;
-}
-void odroid_settings_MainMenuSelectedTab_set(uint16_t value)
-{
-    persistent_config_ram.main_menu_selected_tab = value;
-}
-
-uint16_t odroid_settings_MainMenuCursor_get()
-{
-    return persistent_config_ram.main_menu_cursor;
-}
-void odroid_settings_MainMenuCursor_set(uint16_t value)
-{
-    persistent_config_ram.main_menu_cursor = value;
-}
-
-
-int32_t odroid_settings_Palette_get()
-{
-    return persistent_config_ram.app[odroid_system_get_app()->id].palette;
-}
-void odroid_settings_Palette_set(int32_t value)
-{
-    persistent_config_ram.app[odroid_system_get_app()->id].palette = value;
-}
-
-
-int32_t odroid_settings_SpriteLimit_get()
-{
-    return persistent_config_ram.app[odroid_system_get_app()->id].sprite_limit;
-}
-void odroid_settings_SpriteLimit_set(int32_t value)
-{
-    persistent_config_ram.app[odroid_system_get_app()->id].sprite_limit = value;
-}
-
-
-ODROID_REGION odroid_settings_Region_get()
-{
-    return persistent_config_ram.app[odroid_system_get_app()->id].region;
-}
-void odroid_settings_Region_set(ODROID_REGION value)
-{
-    persistent_config_ram.app[odroid_system_get_app()->id].region = value;
-}
-
-
-int32_t odroid_settings_DisplayScaling_get()
-{
-    return persistent_config_ram.app[odroid_system_get_app()->id].disp_scaling;
-}
-void odroid_settings_DisplayScaling_set(int32_t value)
-{
-    persistent_config_ram.app[odroid_system_get_app()->id].disp_scaling = value;
-}
-
-
-int32_t odroid_settings_DisplayFilter_get()
-{
-    return persistent_config_ram.app[odroid_system_get_app()->id].disp_filter;
-}
-void odroid_settings_DisplayFilter_set(int32_t value)
-{
-    persistent_config_ram.app[odroid_system_get_app()->id].disp_filter = value;
-}
-
-
-int32_t odroid_settings_DisplayRotation_get()
-{
-  return odroid_settings_app_int32_get(Key_DispRotation, ODROID_DISPLAY_ROTATION_AUTO);
-}
-void odroid_settings_DisplayRotation_set(int32_t value)
-{
-  odroid_settings_app_int32_set(Key_DispRotation, value);
-}
-
-
-int32_t odroid_settings_DisplayOverscan_get()
-{
-    return persistent_config_ram.app[odroid_system_get_app()->id].disp_overscan;
-}
-void odroid_settings_DisplayOverscan_set(int32_t value)
-{
-    persistent_config_ram.app[odroid_system_get_app()->id].disp_overscan = value;
-}
-
-
-#if CHEAT_CODES == 1 
+#if CHEAT_CODES == 1
 bool odroid_settings_ActiveGameGenieCodes_is_enabled(uint32_t rom_id, int code_index)
 {
-    if (rom_id < 0 || rom_id >= ROM_COUNT || code_index < 0 || code_index > MAX_CHEAT_CODES) {
+    if (rom_id < 0 || rom_id >= ROM_COUNT || code_index < 0 || code_index >= CHEAT_CODES_MAX) {
         return false;
     }
 
-    uint32_t active_cheat_codes = persistent_config_ram.rom[rom_id].active_cheat_codes;
-    return ((active_cheat_codes >> code_index) & 0x1) == 1;
+    rom_value_t *entry = rom_value_find(cheat_rom_id(rom_id), KEY_CheatCodes, code_index / CHEAT_CODES_PER_VALUE);
+    uint32_t active_cheat_codes = entry ? entry->value : 0;
+    return ((active_cheat_codes >> (code_index % CHEAT_CODES_PER_VALUE)) & 0x1) == 1;
 }
 
 bool odroid_settings_ActiveGameGenieCodes_set(uint32_t rom_id, int code_index, bool enable)
 {
-    if (rom_id < 0 || rom_id >= ROM_COUNT || code_index < 0 || code_index > MAX_CHEAT_CODES) {
+    if (rom_id < 0 || rom_id >= ROM_COUNT || code_index < 0 || code_index >= CHEAT_CODES_MAX) {
         return false;
     }
 
+    uint32_t rom = cheat_rom_id(rom_id);
+    uint8_t index = code_index / CHEAT_CODES_PER_VALUE;
+    rom_value_t *entry = rom_value_find(rom, KEY_CheatCodes, index);
+    uint32_t active_cheat_codes = entry ? entry->value : 0;
+
     if (enable) {
-        persistent_config_ram.rom[rom_id].active_cheat_codes |= (1<<code_index);
+        active_cheat_codes |= (1u << (code_index % CHEAT_CODES_PER_VALUE));
     } else  {
-        persistent_config_ram.rom[rom_id].active_cheat_codes &= ~(1<<code_index);
+        active_cheat_codes &= ~(1u << (code_index % CHEAT_CODES_PER_VALUE));
     }
 
+    // A value without active codes frees its entry
+    if (active_cheat_codes != 0)
+        return rom_value_set(rom, KEY_CheatCodes, index, active_cheat_codes);
+    if (entry)
+        memset(entry, 0, sizeof(*entry));
+
     return true;
 }
 #endif
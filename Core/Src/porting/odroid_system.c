@@ -4,7 +4,11 @@
 #include "rom_manager.h"
 #include "gw_linker.h"
 #include "gui.h"
+#include "gw_lcd.h"
 #include "main.h"
+#include "common.h"
+#include "frame_stats.h"
+#include "odroid_settings_schema.h"
 
 static rg_app_desc_t currentApp;
 static runtime_stats_t statistics;
@@ -41,11 +45,14 @@ void odroid_system_init(int appId, int sampleRate)
 
 void odroid_system_emu_init(state_handler_t load, state_handler_t save, netplay_callback_t netplay_cb)
 {
-    // currentApp.gameId = crc32_le(0, buffer, sizeof(buffer));
     currentApp.gameId = 0;
+    if (ACTIVE_FILE != NULL)
+        currentApp.gameId = odroid_settings_rom_id(ACTIVE_FILE->name);
     currentApp.loadState = load;
     currentApp.saveState = save;
 
+    common_emu_clock_init();
+
     printf("%s: Init done. GameId=%08lX\n", __func__, currentApp.gameId);
 }
 
@@ -84,6 +91,8 @@ bool odroid_system_emu_save_state(int slot)
 
 IRAM_ATTR void odroid_system_tick(uint skippedFrame, uint fullFrame, uint busyTime)
 {
+    uint32_t now = get_elapsed_time();
+
     if (skippedFrame) counters.skippedFrames++;
     else if (fullFrame) counters.fullFrames++;
     counters.totalFrames++;
@@ -93,9 +102,10 @@ IRAM_ATTR void odroid_system_tick(uint skippedFrame, uint fullFrame, uint busyTi
         skip = 0;
     } else {
         counters.busyTime += busyTime;
+        frame_stats_frame(busyTime, now - statistics.lastTickTime, skippedFrame);
     }
 
-    statistics.lastTickTime = get_elapsed_time();
+    statistics.lastTickTime = now;
 }
 
 void odroid_system_switch_app(int app)
@@ -146,6 +156,9 @@ runtime_stats_t odroid_system_get_stats()
     statistics.skippedFPS = counters.skippedFrames / (tickTime / 1000.f);
     statistics.totalFPS = counters.totalFrames / (tickTime / 1000.f);
 
+    frame_stats_log();
+    frame_stats_reset();
+
     skip = 1;
     counters.busyTime = 0;
     counters.totalFrames = 0;
@@ -158,6 +171,7 @@ runtime_stats_t odroid_system_get_stats()
 void odroid_system_sleep(void)
 {
     odroid_settings_StartupFile_set(ACTIVE_FILE);
+    lcd_restore_rgb565();
 
     // odroid_settings_commit();
     gui_save_current_tab();
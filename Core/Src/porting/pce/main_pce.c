@@ -11,7 +11,6 @@
 #undef CYCLES_PER_LINE
 
 #include <pce.h>
-#include <romdb_pce.h>
 #include "lz4_depack.h"
 #include <assert.h>
 #include "miniz.h"
@@ -27,6 +26,8 @@
 #include "appid.h"
 #include "lzma.h"
 #include "rg_i18n.h"
+#include "cheats.h"
+#include "pce_rom.h"
 
 //#define PCE_SHOW_DEBUG
 //#define XBUF_WIDTH 	(480 + 32)
@@ -48,13 +49,16 @@
 
 static uint16_t mypalette[256];
 static int current_height, current_width;
-static short audioBuffer_pce[ AUDIO_BUFFER_LENGTH_PCE * 2];
 static uint8_t pce_framebuffer[XBUF_WIDTH * XBUF_HEIGHT * 2];
 static uint8_t PCE_EXRAM_BUF[0x8000];
+static pce_rom_t pce_rom;
 
 // TODO: Move to lcd.c/h
 extern LTDC_HandleTypeDef hltdc;
 static char pce_log[100];
+#if CHEAT_CODES == 1
+static cheats_t pce_cheats;
+#endif
 
 /**
  * Describes what is saved in a save state. Changing the order will break
@@ -126,6 +130,7 @@ void set_color(int index, uint8_t r, uint8_t g, uint8_t b) {
         col = COLOR_RGB(r,g,b);
     }
     mypalette[index] = col;
+    lcd_lut8_set_color(index, col);
 }
 
 void init_color_pals() {
@@ -134,6 +139,9 @@ void init_color_pals() {
           set_color(i, (i & 0x1C)>>2, (i & 0xE0) >> 5, (i & 0x03) );
     }
     set_color(255, 0x3f, 0x3f, 0x3f);
+
+    // Index 0 is black
+    lcd_lut8_set_background(0);
 }
 
 void osd_gfx_set_mode(int width, int height) {
@@ -209,7 +217,8 @@ static bool LoadStateAddr(char *pathName, uint8_t *saveAddr) {
     uint32_t *crc_ptr = (uint32_t *)pce_save_buf;
 #pragma GCC diagnostic ignored "-Warray-bounds"
     sprintf(pce_log,"%08lX",crc_ptr[0]);
-    if (crc_ptr[0]!=PCE.ROM_CRC) {
+    // Or the key of the save states made before the ROM was identified at build time
+    if (crc_ptr[0]!=PCE.ROM_CRC && (ACTIVE_FILE->legacy_crc32 == 0 || crc_ptr[0]!=ACTIVE_FILE->legacy_crc32)) {
         return true;
     }
 #pragma GCC diagnostic pop
@@ -238,101 +247,55 @@ static bool LoadStateStm(char *pathName) {
     return LoadStateAddr(pathName, (uint8_t *)ACTIVE_FILE->save_address);
 }
 
-static void
-pce_rom_full_patch()
+#if CHEAT_CODES == 1
+static bool
+pce_cheat_enabled(int index)
 {
-    for (int i = 0; i < PCE.rp_count; i++)
-    {
-        uint8_t p_count = PCE.patchs[i][0];
-        uint8_t p_start = 1;
-        for (int j = 0; j < p_count; j++)
-        {
-            uint32_t addr = (PCE.patchs[i][p_start] & 0xf) * 0x10000 + PCE.patchs[i][p_start + 1] * 0x100 + PCE.patchs[i][p_start + 2];
-            uint8_t count = (PCE.patchs[i][p_start] >> 4) + 1;
-            for (int x = 0; x < count; x++)
-            {
-                // all address are seek from rom_data
-                //uint8_t val = PCE.ROM_DATA[addr + x];
-                PCE.ROM_DATA[addr + x] = PCE.patchs[i][p_start + 3 + x];
-                //printf("Patched at RAM: %p from val: %2x To: %2x \n", (unsigned char *)(addr + x), val, PCE.patchs[i][p_start + 3 + x]);
-            }
-            p_start = p_start + count + 3; 
-        }
-    }
+    return odroid_settings_ActiveGameGenieCodes_is_enabled(ACTIVE_FILE->id, index);
 }
 
+// RAM writes address the 8KB work RAM
+static uint8_t *
+pce_cheat_ram(uint32_t addr, uint32_t size)
+{
+    return addr + size <= sizeof(PCE.RAM) ? PCE.RAM + addr : NULL;
+}
 
+// The banks executed from the flash are copied to the RAM first and
+// mapped instead, the decoded ones are patched in place
 static void
-pce_rom_patch()
+pce_rom_patch(uint32_t addr, const uint8_t *data, uint32_t size)
 {
-    unsigned char *dest = (unsigned char *)&_PCE_ROM_UNPACK_BUFFER;
-    uint32_t available_size = (uint32_t)&_PCE_ROM_UNPACK_BUFFER_SIZE;
-
-    uint8_t *DynMEM[16]; //max 16*16=256k;  single bank is 8k but here must two bank batch move
-    uint8_t DynCount = 0;
-    uint8_t CurIdx = 0;
-    uint16_t MaxCount =  available_size / 0x4000;
-    MaxCount = (MaxCount > 16) ? 16 : MaxCount;
-
-    for (int i = 0; i < PCE.rp_count; i++)
+    for (uint32_t x = 0; x < size && addr + x < pce_rom.count * PCE_ROM_BANK_SIZE; x++)
     {
-        uint8_t p_count = PCE.patchs[i][0];
-        uint8_t p_start = 1;
-        for (int j = 0; j < p_count; j++)
-        {
-            uint32_t addr = (PCE.patchs[i][p_start] & 0xf) * 0x10000 + PCE.patchs[i][p_start + 1] * 0x100 + PCE.patchs[i][p_start + 2];
-            uint32_t s_addr = addr / 0x4000 * 0x4000;
-            uint32_t x_addr = addr & 0x3fff;
-            //found here moved?
-            CurIdx = 0xFF;
-            for (int k=0; k<DynCount && k<MaxCount; k++)
-            {
-                if (DynMEM[k] == (unsigned char *)s_addr) 
-                {
-                    CurIdx = k;
-                    break;
-                } 
+        uint32_t bank = (addr + x) / PCE_ROM_BANK_SIZE;
+        uint8_t *mapped = pce_rom.banks[bank];
+        uint8_t *block = pce_rom_writable(&pce_rom, bank);
+        if (block == NULL)
+            return;
+        if (block != mapped) {
+            for (int k = 0; k < 0x80; k++) {
+                if (PCE.MemoryMapR[k] == mapped)
+                    PCE.MemoryMapR[k] = block;
             }
-
-            if (CurIdx == 0xFF) 
-            {
-                //New Item;
-                DynCount += 1;
-                if (DynCount > MaxCount)
-                    return;
-                DynMEM[DynCount - 1] = (unsigned char *)s_addr;
-                //Set Index and copy data;
-                CurIdx = DynCount - 1;
-                uint8_t *d_addr = dest + CurIdx * 0x4000;
-
-                for (int k=0; k<0x4000; k++)
-                    dest[CurIdx * 0x4000 + k] = PCE.ROM_DATA[s_addr + k];
-
-                for (int k = 0; k < 0x80; k++) 
-                {
-                    if (PCE.MemoryMapR[k] == (PCE.ROM_DATA + s_addr))
-                    {
-                        PCE.MemoryMapR[k] = d_addr;
-                    }
-                    else if (PCE.MemoryMapR[k] == (PCE.ROM_DATA + s_addr + 0x2000))
-                    {
-                        PCE.MemoryMapR[k] = d_addr + 0x2000;
-                    }
-                }
-            }
-
-            uint8_t count = (PCE.patchs[i][p_start] >> 4) + 1;
-            for (int x = 0; x < count; x++)
-            {
-                // all address are seek from rom_data
-                //uint8_t val = dest[CurIdx * 0x4000 + x_addr + x];
-                dest[CurIdx * 0x4000 + x_addr + x] = PCE.patchs[i][p_start + 3 + x];
-                //printf("Patched %p at RAM: %p from val: %2x To: %2x \n", (unsigned char *)(addr + x), &(dest[CurIdx * 0x4000 + x_addr + x]), val, PCE.patchs[i][p_start + 3 + x]);
-            }
-            p_start = p_start + count + 3; 
         }
+        block[(addr + x) % PCE_ROM_BANK_SIZE] = data[x];
     }
 }
+#endif
+
+// Decompresses a bank of a PCE+ image, see pce_rom.h
+static size_t
+pce_rom_inflate(uint8_t *dst, size_t dst_size, const uint8_t *src, size_t src_size)
+{
+    if (strcmp(ROM_EXT, "lzma") == 0)
+        return lzma_inflate(dst, dst_size, src, src_size);
+    if (strcmp(ROM_EXT, "zopfli") == 0)
+        return tinfl_decompress_mem_to_mem(dst, dst_size, src, src_size, TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+    if (memcmp(src, LZ4_MAGIC, LZ4_MAGIC_SIZE) == 0 && lz4_get_original_size(src) == dst_size)
+        return lz4_uncompress(src, dst);
+    return 0;
+}
 
 size_t
 pce_osd_getromdata(unsigned char **data)
@@ -390,59 +353,50 @@ pce_osd_getromdata(unsigned char **data)
 }
 
 void LoadCartPCE() {
-    int offset;
-    size_t rom_length = pce_osd_getromdata(&PCE.ROM);
-    offset = rom_length & 0x1fff;
-    PCE.ROM_SIZE = (rom_length - offset) / 0x2000;
-    PCE.ROM_DATA = PCE.ROM + offset;
-    if (PCE.ROM_SIZE < 192) {
-        PCE.ROM_CRC = crc32_le(0, PCE.ROM, ROM_DATA_LENGTH);
+    uint8_t *ram = (uint8_t *)&_PCE_ROM_UNPACK_BUFFER;
+    uint32_t ram_size = (uint32_t)&_PCE_ROM_UNPACK_BUFFER_SIZE;
+    uint32_t start = HAL_GetTick();
+
+    if (memcmp(ROM_DATA, PCE_ROM_MAGIC, PCE_ROM_MAGIC_SIZE) == 0) {
+        // Laid out in banks by parse_roms.py, see tools/pce_rom.py
+        bool unpacked = pce_rom_unpack(&pce_rom, ROM_DATA, pce_rom_inflate, ram, ram_size);
+        assert(unpacked);
+        PCE.ROM = PCE.ROM_DATA = pce_rom.banks[0];
+        PCE.ROM_SIZE = pce_rom.count;
     } else {
-        PCE.ROM_CRC = crc32_le(0, PCE.ROM, 4096);
+        // Stored as is, or compressed as a whole without its original
+        size_t rom_length = pce_osd_getromdata(&PCE.ROM);
+        int offset = rom_length & 0x1fff;
+        PCE.ROM_SIZE = (rom_length - offset) / 0x2000;
+        PCE.ROM_DATA = PCE.ROM + offset;
+        pce_rom_map(&pce_rom, PCE.ROM_DATA, PCE.ROM_SIZE * 0x2000, ram, ram_size);
+
+        // Decoded at build time, but when compressed without its original.
+        // The reset vector of a US HuCard reads backwards.
+        if ((ACTIVE_FILE->flags & ROM_FLAG_PCE_US_ENCODED) || (ACTIVE_FILE->crc32 == 0 && PCE.ROM_SIZE > 0 && PCE.ROM_DATA[0x1FFF] < 0xE0)) {
+            printf("US Encrypted rom code\n");
+            bool decoded = pce_rom_decode_us(&pce_rom);
+            assert(decoded);
+        }
     }
-    //   PCE.ROM_CRC = crc32_le(0, PCE.ROM, rom_length);
+    // Identified at build time, see tools/romdb.py
+    PCE.ROM_CRC = ACTIVE_FILE->crc32;
 
-       uint IDX = 0;
+       uint16_t flags = ACTIVE_FILE->flags;
        uint ROM_MASK = 1;
 
        while (ROM_MASK < PCE.ROM_SIZE) ROM_MASK <<= 1;
        ROM_MASK--;
 
 #ifdef PCE_SHOW_DEBUG
-       printf("Rom Size: %d, B1:%X, B2:%X, B3:%X, B4:%X" , rom_length, PCE.ROM[0], PCE.ROM[1],PCE.ROM[2],PCE.ROM[3]);
+       printf("Rom Size: %d, B1:%X, B2:%X, B3:%X, B4:%X" , PCE.ROM_SIZE, PCE.ROM_DATA[0], PCE.ROM_DATA[1], PCE.ROM_DATA[2], PCE.ROM_DATA[3]);
 #endif
 
-       for (int index = 0; index < KNOWN_ROM_COUNT; index++) {
-           if (PCE.ROM_CRC == pceRomFlags[index].crc) {
-               IDX = index;
-               break;
-           }
-       }
-
-       printf("Game Name: %s\n", pceRomFlags[IDX].Name);
-       printf("Game Region: %s\n", (pceRomFlags[IDX].Flags & JAP) ? "Japan" : "USA");
-
-       // US Encrypted
-    if ((pceRomFlags[IDX].Flags & US_ENCODED) || PCE.ROM_DATA[0x1FFF] < 0xE0) {
-		printf("US Encrypted rom code");
-		unsigned char inverted_nibble[16] = {
-			0, 8, 4, 12, 2, 10, 6, 14,
-			1, 9, 5, 13, 3, 11, 7, 15
-		};
-
-		for (int x = 0; x < PCE.ROM_SIZE * 0x2000; x++) {
-			unsigned char temp = PCE.ROM_DATA[x] & 15;
-
-			PCE.ROM_DATA[x] &= ~0x0F;
-			PCE.ROM_DATA[x] |= inverted_nibble[PCE.ROM_DATA[x] >> 4];
-
-			PCE.ROM_DATA[x] &= ~0xF0;
-			PCE.ROM_DATA[x] |= inverted_nibble[temp] << 4;
-		}
-    }
+       printf("Game CRC: %08lX, flags: %X\n", PCE.ROM_CRC, flags);
+       printf("ROM: %d banks, %ld bytes of RAM, loaded in %ld ms\n", PCE.ROM_SIZE, pce_rom.ram_used, HAL_GetTick() - start);
 
 	// For example with Devil Crush 512Ko
-    if (pceRomFlags[IDX].Flags & TWO_PART_ROM) 
+    if (flags & ROM_FLAG_PCE_TWO_PART_ROM) 
         PCE.ROM_SIZE = 0x30;
 
     // Game ROM
@@ -452,28 +406,28 @@ void LoadCartPCE() {
             case 0x00:
             case 0x10:
             case 0x50:
-                PCE.MemoryMapR[i] = PCE.ROM_DATA + (i & ROM_MASK) * 0x2000;
+                PCE.MemoryMapR[i] = pce_rom.banks[i & ROM_MASK];
                 break;
             case 0x20:
             case 0x60:
-                PCE.MemoryMapR[i] = PCE.ROM_DATA + ((i - 0x20) & ROM_MASK) * 0x2000;
+                PCE.MemoryMapR[i] = pce_rom.banks[(i - 0x20) & ROM_MASK];
                 break;
             case 0x30:
             case 0x70:
-                PCE.MemoryMapR[i] = PCE.ROM_DATA + ((i - 0x10) & ROM_MASK) * 0x2000;
+                PCE.MemoryMapR[i] = pce_rom.banks[(i - 0x10) & ROM_MASK];
                 break;
             case 0x40:
-                PCE.MemoryMapR[i] = PCE.ROM_DATA + ((i - 0x20) & ROM_MASK) * 0x2000;
+                PCE.MemoryMapR[i] = pce_rom.banks[(i - 0x20) & ROM_MASK];
                 break;
             }
         } else {
-            PCE.MemoryMapR[i] = PCE.ROM_DATA + (i & ROM_MASK) * 0x2000;
+            PCE.MemoryMapR[i] = pce_rom.banks[i & ROM_MASK];
         }
         PCE.MemoryMapW[i] = PCE.NULLRAM;
     }
 
     // Allocate the card's onboard ram
-    if (pceRomFlags[IDX].Flags & ONBOARD_RAM) {
+    if (flags & ROM_FLAG_PCE_ONBOARD_RAM) {
         PCE.ExRAM = PCE.ExRAM ?: PCE_EXRAM_BUF;
         PCE.MemoryMapR[0x40] = PCE.MemoryMapW[0x40] = PCE.ExRAM;
         PCE.MemoryMapR[0x41] = PCE.MemoryMapW[0x41] = PCE.ExRAM + 0x2000;
@@ -485,15 +439,10 @@ void LoadCartPCE() {
     if (PCE.ROM_SIZE >= 192)
         PCE.MemoryMapW[0x00] = PCE.IOAREA;
 
-    //pce_rom_patch
-    unsigned char *dest = (unsigned char *)&_PCE_ROM_UNPACK_BUFFER;
-    printf("Rom: %p %p \n", PCE.ROM, dest);
-
-    if (PCE.ROM != dest)
-        pce_rom_patch();
-    else
-        pce_rom_full_patch();
-        
+#if CHEAT_CODES == 1
+    int patched = cheats_patch_rom(ACTIVE_FILE->cheat_table, pce_cheat_enabled, pce_rom_patch);
+    printf("Cheats: %d ROM patches, %ld bytes of RAM used\n", patched, pce_rom.ram_used);
+#endif
 }
 
 void ResetPCE(bool hard) {
@@ -516,7 +465,7 @@ void pce_input_read(odroid_gamepad_state_t* out_state) {
     PCE.Joypad.regs[0] = rc;
 }
 
-void pce_osd_gfx_blit(bool drawFrame) {
+ITCM_EMU_TEXT void pce_osd_gfx_blit(bool drawFrame) {
     if (!drawFrame) {
         memset(pce_framebuffer,0,sizeof(pce_framebuffer));
         return;
@@ -556,27 +505,53 @@ void pce_osd_gfx_blit(bool drawFrame) {
     int renderHeight = (current_height<=GW_LCD_HEIGHT)?current_height:GW_LCD_HEIGHT;
     int renderWidth = (current_width<=GW_LCD_WIDTH)?current_width:GW_LCD_WIDTH;
 
-    for(y=0;y<renderHeight;y++) {
-        fbTmp = emuFrameBuffer+(y*XBUF_WIDTH);
-        offsetY = y*GW_LCD_WIDTH;
-        if (xScale) {
-            // Horizontal - Scale 
-            for(int x=0;x<GW_LCD_WIDTH;x++) {
-                framebuffer_active[offsetY+x]= mypalette[fbTmp[ (x * xScale) >> 8 ]];
+#ifdef PCE_SHOW_DEBUG
+    // The debug text is drawn in RGB565
+    bool lut8 = common_emu_lut8_frame(true);
+#else
+    bool lut8 = common_emu_lut8_frame(false);
+#endif
+
+    if (lut8) {
+        // The LTDC expands mypalette, copy the indices
+        uint8_t *framebuffer_lut8 = (uint8_t *) framebuffer_active;
+        for(y=0;y<renderHeight;y++) {
+            fbTmp = emuFrameBuffer+(y*XBUF_WIDTH);
+            offsetY = y*GW_LCD_WIDTH;
+            if (xScale) {
+                for(int x=0;x<GW_LCD_WIDTH;x++) {
+                    framebuffer_lut8[offsetY+x]= fbTmp[ (x * xScale) >> 8 ];
+                }
+            } else {
+                memcpy(&framebuffer_lut8[offsetY+offsetX], &fbTmp[cropX], renderWidth);
             }
-        } else {
-            // No scaling, 1:1
-            for(int x=0;x<renderWidth;x++) {
-                   framebuffer_active[offsetY+x+offsetX]=mypalette[fbTmp[x+cropX]];
+        }
+        for(;y<GW_LCD_HEIGHT;y++) {
+            memset(&framebuffer_lut8[y*GW_LCD_WIDTH+offsetX], 0, renderWidth);
+        }
+    } else {
+        for(y=0;y<renderHeight;y++) {
+            fbTmp = emuFrameBuffer+(y*XBUF_WIDTH);
+            offsetY = y*GW_LCD_WIDTH;
+            if (xScale) {
+                // Horizontal - Scale 
+                for(int x=0;x<GW_LCD_WIDTH;x++) {
+                    framebuffer_active[offsetY+x]= mypalette[fbTmp[ (x * xScale) >> 8 ]];
+                }
+            } else {
+                // No scaling, 1:1
+                for(int x=0;x<renderWidth;x++) {
+                       framebuffer_active[offsetY+x+offsetX]=mypalette[fbTmp[x+cropX]];
+                }
             }
         }
-    }
-    // Temporary, Y scaling is not yet implemented
-    for(;y<GW_LCD_HEIGHT;y++) {
-        fbTmp = emuFrameBuffer+(y*XBUF_WIDTH);
-        offsetY = y*GW_LCD_WIDTH;
-        for(int x=0;x<renderWidth;x++) {
-            framebuffer_active[offsetY+x+offsetX]=0;
+        // Temporary, Y scaling is not yet implemented
+        for(;y<GW_LCD_HEIGHT;y++) {
+            fbTmp = emuFrameBuffer+(y*XBUF_WIDTH);
+            offsetY = y*GW_LCD_WIDTH;
+            for(int x=0;x<renderWidth;x++) {
+                framebuffer_active[offsetY+x+offsetX]=0;
+            }
         }
     }
 
@@ -595,19 +570,12 @@ void pce_osd_gfx_blit(bool drawFrame) {
 void pce_pcm_submit() {
     uint8_t volume = odroid_audio_volume_get();
     int32_t factor = volume_tbl[volume] / 2; // Divide by 2 to prevent overflow in stereo mixing
-    pce_snd_update(audioBuffer_pce, AUDIO_BUFFER_LENGTH_PCE );
-    size_t offset = (dma_state == DMA_TRANSFER_STATE_HF) ? 0 : AUDIO_BUFFER_LENGTH_PCE;
+
+    // The PSG still has to run when muted to consume DDA samples
     if (audio_mute || volume == ODROID_AUDIO_VOLUME_MIN) {
-        for (int i = 0; i < AUDIO_BUFFER_LENGTH_PCE; i++) {
-            audiobuffer_dma[offset + i] = 0;
-        }
-    } else {
-        for (int i = 0; i < AUDIO_BUFFER_LENGTH_PCE; i++) {
-            /* mix left & right */
-            int32_t sample = (audioBuffer_pce[i*2] + audioBuffer_pce[i*2+1]);
-            audiobuffer_dma[offset + i] = (sample * factor) >> 8;
-        }
+        factor = 0;
     }
+    pce_snd_update(common_emu_sound_get_buffer(AUDIO_BUFFER_LENGTH_PCE), AUDIO_BUFFER_LENGTH_PCE, factor);
 }
 
 int app_main_pce(uint8_t load_state, uint8_t start_paused, uint8_t save_slot) {
@@ -642,30 +610,15 @@ int app_main_pce(uint8_t load_state, uint8_t start_paused, uint8_t save_slot) {
     // Init PCE Core
     pce_init();
 
-#if CHEAT_CODES == 1
-    int cheat_count = 0;
-    const char **active_cheat_codes = NULL;
-    for(int i=0; i<MAX_CHEAT_CODES && i<ACTIVE_FILE->cheat_count; i++) {
-        if (odroid_settings_ActiveGameGenieCodes_is_enabled(ACTIVE_FILE->id, i)) {
-            cheat_count++;
-        }
-    }
-
-    active_cheat_codes = rg_alloc(cheat_count * sizeof(char**), MEM_ANY);
-    for(int i=0, j=0; i<MAX_CHEAT_CODES && i<ACTIVE_FILE->cheat_count; i++) {
-        if (odroid_settings_ActiveGameGenieCodes_is_enabled(ACTIVE_FILE->id, i)) {
-            active_cheat_codes[j] = ACTIVE_FILE->cheat_codes[i];
-            j++;
-        }
-    }
-    PCE.patchs = (char **)active_cheat_codes;
-    PCE.rp_count = cheat_count;
-#endif
-
     LoadCartPCE();
     ResetPCE(false);
     printf("PCE Core initialized\n");
 
+#if CHEAT_CODES == 1
+    cheats_load(&pce_cheats, ACTIVE_FILE->cheat_table, pce_cheat_enabled, pce_cheat_ram);
+    printf("Cheats: %d RAM writes, %d dropped\n", pce_cheats.count, pce_cheats.dropped);
+#endif
+
     // If user select "RESUME" in main menu
     if (load_state) {
 #if OFF_SAVESTATE==1
@@ -706,28 +659,20 @@ int app_main_pce(uint8_t load_state, uint8_t start_paused, uint8_t save_slot) {
         for (PCE.Scanline = 0; PCE.Scanline < 263; ++PCE.Scanline) {
             gfx_run();
         }
+#if CHEAT_CODES == 1
+        cheats_apply(&pce_cheats);
+#endif
 
         pce_osd_gfx_blit(drawFrame);
         if(drawFrame) pce_pcm_submit();
 
-        if(!common_emu_state.skip_frames){
-            dma_transfer_state_t last_dma_state = DMA_TRANSFER_STATE_HF;
-            for(uint8_t p = 0; p < common_emu_state.pause_frames + 1; p++) {
-                while (dma_state == last_dma_state) {
-                    cpumon_sleep();
-                }
-                last_dma_state = dma_state;
-            }
-        }
+        common_emu_sound_sync(true);
 
         // Prevent overflow
         PCE.Timer.cycles_counter -= Cycles;
         PCE.MaxCycles -= Cycles;
         Cycles = 0;
     }
-#if CHEAT_CODES == 1
-    rg_free(active_cheat_codes); // No need to clean up the objects in the array as they're allocated in read only space
-#endif
 }
 
 #endif
\ No newline at end of file
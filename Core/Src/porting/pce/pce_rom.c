@@ -0,0 +1,118 @@
+#include "pce_rom.h"
+
+#include <string.h>
+
+#define ALIGN4(x) (((x) + 3) & ~3)
+
+// Followed by uint32_t sizes[banks]
+typedef struct {
+    char magic[PCE_ROM_MAGIC_SIZE];
+    uint16_t banks;
+    uint16_t reserved;
+} image_header_t;
+
+static void mirror_banks(pce_rom_t *rom)
+{
+    if (rom->count == 0)
+        return;
+    for (int i = rom->count; i < PCE_ROM_MAX_BANKS; i++)
+        rom->banks[i] = rom->banks[i % rom->count];
+}
+
+static bool in_ram(const pce_rom_t *rom, const uint8_t *ptr)
+{
+    return ptr >= rom->ram && ptr < rom->ram + rom->ram_size;
+}
+
+bool pce_rom_unpack(pce_rom_t *rom, const uint8_t *image, pce_rom_inflate_t inflate, uint8_t *ram, uint32_t ram_size)
+{
+    image_header_t header;
+    const uint8_t *sizes = image + sizeof(header);
+    const uint8_t *pos;
+
+    memcpy(&header, image, sizeof(header));
+    if (header.banks == 0 || header.banks > PCE_ROM_MAX_BANKS)
+        return false;
+
+    rom->count = header.banks;
+    rom->ram = ram;
+    rom->ram_size = ram_size;
+    rom->ram_used = 0;
+
+    pos = sizes + header.banks * sizeof(uint32_t);
+    for (int i = 0; i < header.banks; i++) {
+        uint32_t size;
+
+        memcpy(&size, sizes + i * sizeof(size), sizeof(size));
+        if (size == 0) {
+            rom->banks[i] = (uint8_t *)pos;
+            pos += PCE_ROM_BANK_SIZE;
+            continue;
+        }
+
+        if (rom->ram_used + PCE_ROM_BANK_SIZE > ram_size)
+            return false;
+        rom->banks[i] = ram + rom->ram_used;
+        if (inflate(rom->banks[i], PCE_ROM_BANK_SIZE, pos, size) != PCE_ROM_BANK_SIZE)
+            return false;
+        rom->ram_used += PCE_ROM_BANK_SIZE;
+        pos += ALIGN4(size);
+    }
+
+    mirror_banks(rom);
+    return true;
+}
+
+void pce_rom_map(pce_rom_t *rom, const uint8_t *data, uint32_t size, uint8_t *ram, uint32_t ram_size)
+{
+    uint32_t count = size / PCE_ROM_BANK_SIZE;
+
+    rom->count = count > PCE_ROM_MAX_BANKS ? PCE_ROM_MAX_BANKS : count;
+    rom->ram = ram;
+    rom->ram_size = ram_size;
+    rom->ram_used = in_ram(rom, data) ? ALIGN4(data - ram + size) : 0;
+
+    for (int i = 0; i < rom->count; i++)
+        rom->banks[i] = (uint8_t *)data + i * PCE_ROM_BANK_SIZE;
+    mirror_banks(rom);
+}
+
+uint8_t *pce_rom_writable(pce_rom_t *rom, unsigned bank)
+{
+    uint8_t *bank_ptr = rom->banks[bank % PCE_ROM_MAX_BANKS];
+    uint8_t *copy;
+
+    if (in_ram(rom, bank_ptr))
+        return bank_ptr;
+    if (rom->ram_used + PCE_ROM_BANK_SIZE > rom->ram_size)
+        return NULL;
+
+    copy = rom->ram + rom->ram_used;
+    rom->ram_used += PCE_ROM_BANK_SIZE;
+    memcpy(copy, bank_ptr, PCE_ROM_BANK_SIZE);
+
+    // The mirrors of the bank too
+    for (int i = 0; i < PCE_ROM_MAX_BANKS; i++) {
+        if (rom->banks[i] == bank_ptr)
+            rom->banks[i] = copy;
+    }
+    return copy;
+}
+
+bool pce_rom_decode_us(pce_rom_t *rom)
+{
+    static const uint8_t inverted_nibble[16] = {
+        0, 8, 4, 12, 2, 10, 6, 14,
+        1, 9, 5, 13, 3, 11, 7, 15
+    };
+
+    for (int i = 0; i < rom->count; i++) {
+        uint8_t *bank = pce_rom_writable(rom, i);
+
+        if (bank == NULL)
+            return false;
+        for (int j = 0; j < PCE_ROM_BANK_SIZE; j++)
+            bank[j] = (inverted_nibble[bank[j] & 0x0F] << 4) | inverted_nibble[bank[j] >> 4];
+    }
+    return true;
+}
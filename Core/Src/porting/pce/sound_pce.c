@@ -3,8 +3,10 @@
 #ifdef ENABLE_EMULATOR_PCE
 // sound.c - Sound emulation
 //
+#include <assert.h>
 #include "sound_pce.h"
 #include "pce.h"
+#include "gw_linker.h"
 
 static const uint32_t vol_tbl[32] = {
     100  , 451  , 508  , 573   , 646   , 728   , 821   , 925   ,
@@ -13,13 +15,25 @@ static const uint32_t vol_tbl[32] = {
     7085 , 7986 , 9002 , 10148 , 11439 , 12894 , 14535 , 16384 
 };
 
-typedef int16_t sample_t;
 static uint32_t noise_rand[PSG_CHANNELS];
 static int32_t noise_level[PSG_CHANNELS];
-// The buffer should be signed but it seems to sound better
-// unsigned. I am still reviewing the implementation bellow.
-// static uint8_t mix_buffer[44100 / 60 * 2];
-static sample_t mix_buffer[PCE_SAMPLE_RATE / 60 * 2];
+
+/*
+ * Channels are mixed into a 32-bit accumulator, one slot per output sample.
+ * Output is mono (the SAI runs a single slot), so each channel gets one gain
+ * that folds together its balance/volume registers, the PSG master balance
+ * and the user volume. The accumulator is scaled back by PSG_MIX_SHIFT and
+ * saturated when it is written out.
+ *
+ * Compared with the previous float path (per-channel ">> 8" on each side,
+ * master volume applied on top, then L+R mixed and scaled by volume_tbl), the
+ * result differs only by the per-channel truncations the old path did, i.e.
+ * at most PSG_CHANNELS * 2 * 15 * (volume_tbl[v] / 2) / 256 + 1 LSB (<= 91
+ * LSB at full volume), except where the old path wrapped around int16.
+ */
+#define PSG_MIX_SHIFT 8
+static int32_t mix_buffer[PCE_SAMPLE_RATE / 60] ITCM_EMU_BSS;
+static int32_t chan_gain[PSG_CHANNELS] ITCM_EMU_BSS;
 
 struct host_machine {
 	bool paused;
@@ -44,63 +58,107 @@ struct host_machine {
 
 struct host_machine host;
 
-static inline void
-psg_update_chan(sample_t *buf, int ch, size_t dwSize)
+static inline int
+psg_wave_sample(uint8_t value)
 {
-    psg_chan_t *chan = &PCE.PSG.chan[ch];
-    int sample = 0;
-    uint32_t Tp;
-    sample_t *buf_end = buf + dwSize;
+    int sample = value - 16;
+    return (sample >= 0) ? sample + 1 : sample;
+}
 
-    /*
-    * This gives us a volume level of (0...15).
-    */
-    int lvol = (((chan->balance >>  4) * 1.1) * (chan->control & 0x1E)) / 32;
-    int rvol = (((chan->balance & 0xF) * 1.1) * (chan->control & 0x1E)) / 32;
+/*
+ * Compute the mono gain of every channel. This replaces the float
+ * (balance * 1.1 * volume) / 32 lookup done for every channel at every
+ * update: (b * 1.1 * v) / 32 == (b * v * 11) / 320 for all register values.
+ */
+static void
+psg_update_gains(int32_t volume_factor)
+{
+    int master_l = PCE.PSG.volume >> 4;
+    int master_r = PCE.PSG.volume & 0x0F;
 
-    lvol = vol_tbl[lvol & 0x1F];
-    rvol = vol_tbl[rvol & 0x1F];
+    for (int ch = 0; ch < PSG_CHANNELS; ch++) {
+        psg_chan_t *chan = &PCE.PSG.chan[ch];
+        int level = chan->control & 0x1E;
+        int lvol = vol_tbl[(((chan->balance >>  4) * level * 11) / 320) & 0x1F];
+        int rvol = vol_tbl[(((chan->balance & 0xF) * level * 11) / 320) & 0x1F];
 
-    if (!host.sound.stereo) {
-        lvol = (lvol + rvol) / 2;
+        chan_gain[ch] = ((lvol * master_l + rvol * master_r) * volume_factor) >> 8;
     }
+}
+
+/*
+ * Fixed-point increment of the wave pointer for a given 12-bit period.
+ *
+ * The original line of code read:
+ * fixed_inc = ((uint32_t) (3.2 * 1118608 / host.sound.freq) << 16) / Tp;
+ * The 3.2 * 1118608 comes out to 3574595.6 which is meant to represent the
+ * 3.58mhz clock used in the pc engine to decrement the sound 'frequency'.
+ *
+ * Taken from the PSG doc written by Paul Clifford (paul@plasma.demon.co.uk)
+ * <in reference to the 12 bit frequency value in PSG registers 2 and 3>
+ * "For waveform output, a copy of this value is, in effect, decremented 3,580,000
+ *  times a second until zero is reached.  When this happens the PSG advances an
+ *  internal pointer into the channel's waveform buffer by one."
+ *
+ * So we take the sampling rate into consideration with regard to the 3580000
+ * effective pc engine samplerate, in 16.16 fixed point.
+ */
+static inline uint32_t
+psg_wave_inc(uint32_t Tp)
+{
+    return ((CLOCK_PSG / host.sound.freq) << 16) / Tp;
+}
+
+static inline bool
+psg_lfo_enabled(void)
+{
+    return (PCE.PSG.lfo_ctrl & 0x03) != 0;
+}
+
+/*
+ * Channel 0 period when the LFO is on: channel 1's current wave sample,
+ * shifted by the LFO control depth, is added to the programmed period.
+ */
+static inline uint32_t
+psg_lfo_period(uint32_t Tp)
+{
+    psg_chan_t *lfo = &PCE.PSG.chan[1];
+    int shift = ((PCE.PSG.lfo_ctrl & 0x03) - 1) << 1;
+    int32_t offset = (lfo->wave_data[lfo->wave_index] - 16) * (1 << shift);
+    uint32_t period = (Tp + offset) & 0xFFF;
+
+    return period ? period : 0x1000;
+}
+
+static inline void
+psg_update_chan(int32_t *buf, int ch, size_t count, int32_t gain)
+{
+    psg_chan_t *chan = &PCE.PSG.chan[ch];
+    int32_t *buf_end = buf + count;
+    int sample = 0;
+    uint32_t Tp;
 
     // This isn't very accurate, we don't track how long each DA sample should play
     // but we call psg_update() often enough (10x per frame) that guessing should be good enough...
     if (chan->dda_count) {
         // Cycles per frame: 119318
         // Samples per frame: 368
-
-        // Cycles per scanline: 454
-        // Samples per scanline: ~1.4
-
         // One sample = 324 cycles
-
-        // const int cycles_per_sample = CYCLES_PER_FRAME / (host.sound.sample_freq / 60);
-
-        // float repeat = (float)elapsed / cycles_per_sample / chan->dda_count;
-        // printf("%.2f\n", repeat);
-
         int start = (int)chan->dda_index - chan->dda_count;
         if (start < 0)
             start += 0x100;
 
-        int repeat = 3; // MIN(2, (dwSize / 2) / chan->dda_count) + 1;
+        const int repeat = 3;
 
         while (buf < buf_end && (chan->dda_count || chan->control & PSG_DDA_ENABLE)) {
             if (chan->dda_count) {
-                // sample = chan->dda_data[(start++) & 0x7F];
-                if ((sample = (chan->dda_data[(start++) & 0xFF] - 16)) >= 0)
-                    sample++;
+                sample = psg_wave_sample(chan->dda_data[(start++) & 0xFF]);
                 chan->dda_count--;
             }
 
-            for (int i = 0; i < repeat; i++) {
-                *buf++ = (sample * lvol) >> 8;
-
-                if (host.sound.stereo) {
-                    *buf++ = (sample * rvol) >> 8;
-                }
+            int32_t value = sample * gain;
+            for (int i = 0; i < repeat && buf < buf_end; i++) {
+                *buf++ += value;
             }
         }
     }
@@ -115,12 +173,16 @@ psg_update_chan(sample_t *buf, int ch, size_t dwSize)
     * PSG Noise generation (it has priority over DDA and WAVE)
     */
     else if ((ch == 4 || ch == 5) && (chan->noise_ctrl & PSG_NOISE_ENABLE)) {
-        int Np = (chan->noise_ctrl & 0x1F);
+        uint32_t step = 3000 + (chan->noise_ctrl & 0x1F) * 512;
+        uint32_t freq = host.sound.freq;
+        int32_t value = noise_level[ch] * gain;
 
         while (buf < buf_end) {
-            chan->noise_accum += 3000 + Np * 512;
+            chan->noise_accum += step;
 
-            if ((Tp = (chan->noise_accum / host.sound.freq)) >= 1) {
+            // step < freq, so this fires at most once per sample and the
+            // division only happens on the rare tick after a state load.
+            if (chan->noise_accum >= freq) {
                 if (noise_rand[ch] & 0x00080000) {
                     noise_rand[ch] = ((noise_rand[ch] ^ 0x0004) << 1) + 1;
                     noise_level[ch] = -15;
@@ -128,14 +190,12 @@ psg_update_chan(sample_t *buf, int ch, size_t dwSize)
                     noise_rand[ch] <<= 1;
                     noise_level[ch] = 15;
                 }
-                chan->noise_accum -= host.sound.freq * Tp;
+                value = noise_level[ch] * gain;
+                Tp = chan->noise_accum / freq;
+                chan->noise_accum -= freq * Tp;
             }
 
-            *buf++ = (noise_level[ch] * lvol) >> 8;
-
-            if (host.sound.stereo) {
-                *buf++ = (noise_level[ch] * rvol) >> 8;
-            }
+            *buf++ += value;
         }
     }
     /*
@@ -145,54 +205,58 @@ psg_update_chan(sample_t *buf, int ch, size_t dwSize)
 
     }
     /*
-    * PSG Wave generation.
+    * Channel 1 is the LFO modulator when the LFO is on, it is not heard and
+    * its wave pointer is advanced by channel 0 below.
     */
-    else if ((Tp = chan->freq_lsb + (chan->freq_msb << 8)) > 0) {
-        /*
-         * Thank god for well commented code!  The original line of code read:
-         * fixed_inc = ((uint32_t) (3.2 * 1118608 / host.sound.freq) << 16) / Tp;
-         * and had nary a comment to be found.  It took a little head scratching to get
-         * it figured out.  The 3.2 * 1118608 comes out to 3574595.6 which is obviously
-         * meant to represent the 3.58mhz cpu clock speed used in the pc engine to
-         * decrement the sound 'frequency'.  I haven't figured out why the original
-         * author had the two numbers multiplied together to get the odd value instead of
-         * just using 3580000.  I did some checking and the value will compute the same
-         * using either value divided by any standard soundcard samplerate.  The
-         * host.sound.freq is our soundcard's samplerate which is quite a bit slower than
-         * the pce's cpu (3580000 vs. 22050/44100 typically).
-         *
-         * Taken from the PSG doc written by Paul Clifford (paul@plasma.demon.co.uk)
-         * <in reference to the 12 bit frequency value in PSG registers 2 and 3>
-         * "For waveform output, a copy of this value is, in effect, decremented 3,580,000
-         *  times a second until zero is reached.  When this happens the PSG advances an
-         *  internal pointer into the channel's waveform buffer by one."
-         *
-         * So all we need to do to emulate original pc engine behaviour is take our soundcard's
-         * sampling rate into consideration with regard to the 3580000 effective pc engine
-         * samplerate.  We use 16.16 fixed arithmetic for speed.
-         */
-        uint32_t fixed_inc = ((CLOCK_PSG / host.sound.freq) << 16) / Tp;
+    else if (ch == 1 && psg_lfo_enabled()) {
+
+    }
+    /*
+    * PSG Wave generation, channel 0 with frequency modulation. Like the
+    * other channels it stays silent with a period of 0.
+    */
+    else if (ch == 0 && psg_lfo_enabled() && (Tp = chan->freq_lsb + (chan->freq_msb << 8)) > 0) {
+        psg_chan_t *lfo = &PCE.PSG.chan[1];
+        uint32_t lfo_freq = PCE.PSG.lfo_freq ? PCE.PSG.lfo_freq : 0x100;
+        uint32_t lfo_period = (lfo->freq_lsb + (lfo->freq_msb << 8)) ?: 0x1000;
+        uint32_t lfo_inc = (PCE.PSG.lfo_ctrl & 0x80) ? 0 : psg_wave_inc(lfo_period * lfo_freq);
+        uint32_t fixed_inc = psg_wave_inc(psg_lfo_period(Tp));
+
+        if (lfo_inc == 0) {
+            lfo->wave_accum = 0;
+            lfo->wave_index = 0;
+        }
 
         while (buf < buf_end) {
-            if ((sample = (chan->wave_data[chan->wave_index] - 16)) >= 0)
-                sample++;
+            *buf++ += psg_wave_sample(chan->wave_data[chan->wave_index]) * gain;
 
-            *buf++ = (sample * lvol) >> 8;
+            chan->wave_accum += fixed_inc;
+            chan->wave_accum &= 0x1FFFFF;    /* (31 << 16) + 0xFFFF */
+            chan->wave_index = chan->wave_accum >> 16;
 
-            if (host.sound.stereo) {
-                *buf++ = (sample * rvol) >> 8;
+            lfo->wave_accum += lfo_inc;
+            lfo->wave_accum &= 0x1FFFFF;
+            if ((lfo->wave_accum >> 16) != lfo->wave_index) {
+                // The period only changes when the LFO steps, divide there
+                lfo->wave_index = lfo->wave_accum >> 16;
+                fixed_inc = psg_wave_inc(psg_lfo_period(Tp));
             }
+        }
+    }
+    /*
+    * PSG Wave generation.
+    */
+    else if ((Tp = chan->freq_lsb + (chan->freq_msb << 8)) > 0) {
+        uint32_t fixed_inc = psg_wave_inc(Tp);
+
+        while (buf < buf_end) {
+            *buf++ += psg_wave_sample(chan->wave_data[chan->wave_index]) * gain;
 
             chan->wave_accum += fixed_inc;
             chan->wave_accum &= 0x1FFFFF;    /* (31 << 16) + 0xFFFF */
             chan->wave_index = chan->wave_accum >> 16;
         }
     }
-
-//pad_and_return:
-    if (buf < buf_end) {
-        memset(buf, 0, (void*)buf_end - (void*)buf);
-    }
 }
 
 void osd_snd_init(void) {
@@ -216,22 +280,24 @@ void pce_snd_term(void) {
 }
 
 
-void pce_snd_update(int16_t *output, unsigned length) {
-    int lvol = (PCE.PSG.volume >> 4);
-    int rvol = (PCE.PSG.volume & 0x0F);
-
-    if (host.sound.stereo) {
-        length *= 2;
-    }
+// With the inlined channel loops, run from the ITCM overlay of the emulator
+ITCM_EMU_TEXT void pce_snd_update(int16_t *output, unsigned length, int volume_factor) {
+    assert(length <= sizeof(mix_buffer) / sizeof(mix_buffer[0]));
 
-    memset(output, 0, length * 2);
+    psg_update_gains(volume_factor);
+    memset(mix_buffer, 0, length * sizeof(mix_buffer[0]));
 
     for (int i = 0; i < PSG_CHANNELS; i++) {
-        psg_update_chan((void*)mix_buffer, i, length);
-        for (int j = 0; j < length; j += 2) {
-            output[j] += mix_buffer[j] * lvol;
-            output[j + 1] += mix_buffer[j + 1] * rvol;
-        }
+        psg_update_chan(mix_buffer, i, length, chan_gain[i]);
+    }
+
+    for (int i = 0; i < length; i++) {
+        int32_t sample = mix_buffer[i] >> PSG_MIX_SHIFT;
+        if (sample > INT16_MAX)
+            sample = INT16_MAX;
+        else if (sample < INT16_MIN)
+            sample = INT16_MIN;
+        output[i] = sample;
     }
 }
 
@@ -0,0 +1,230 @@
+#include "settings_journal.h"
+
+#include <string.h>
+
+#include "crc32.h"
+
+#define JOURNAL_MAGIC 0x4C4E4A53 // "SJNL"
+#define RECORD_END    0xFFFFFFFF
+#define MERGE_GAP     8          // Ranges closer than this share a range header
+
+#define ALIGN4(x) (((x) + 3) & ~3)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;
+    uint16_t size;
+    uint8_t version;
+    uint8_t reserved;
+    uint32_t crc;     // Of the snapshot
+} bank_header_t;
+
+// Followed by `length` bytes of ranges
+typedef struct {
+    uint32_t length;
+    uint32_t crc;
+} record_header_t;
+
+// Followed by `length` bytes, padded to 4 with 0xFF
+typedef struct {
+    uint16_t offset;
+    uint16_t length;
+} range_header_t;
+
+static const uint8_t padding[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+
+static inline const uint8_t *bank_ptr(const settings_journal_t *journal, uint8_t bank)
+{
+    return journal->flash->banks[bank];
+}
+
+static inline uint32_t records_start(const settings_journal_t *journal)
+{
+    return SETTINGS_JOURNAL_HEADER_SIZE + ALIGN4(journal->size);
+}
+
+static bool bank_valid(const settings_journal_t *journal, uint8_t bank, bank_header_t *header)
+{
+    const uint8_t *ptr = bank_ptr(journal, bank);
+
+    memcpy(header, ptr, sizeof(*header));
+    return header->magic == JOURNAL_MAGIC &&
+           header->version == journal->version &&
+           header->size == journal->size &&
+           header->crc == crc32_le(0, ptr + SETTINGS_JOURNAL_HEADER_SIZE, journal->size);
+}
+
+// Applies the ranges of a record, false if one doesn't fit in the image
+static bool apply_record(const settings_journal_t *journal, uint8_t *image, const uint8_t *ranges, uint32_t length)
+{
+    uint32_t pos = 0;
+
+    while (pos + sizeof(range_header_t) <= length) {
+        range_header_t range;
+
+        memcpy(&range, ranges + pos, sizeof(range));
+        pos += sizeof(range);
+        if (range.offset + range.length > journal->size || pos + range.length > length)
+            return false;
+        memcpy(image + range.offset, ranges + pos, range.length);
+        pos += ALIGN4(range.length);
+    }
+    return pos == length;
+}
+
+bool settings_journal_load(settings_journal_t *journal, const settings_journal_flash_t *flash,
+                           void *image, uint32_t size, uint8_t version)
+{
+    bank_header_t header;
+    int best = -1;
+    uint32_t best_sequence = 0;
+
+    journal->flash = flash;
+    journal->size = size;
+    journal->version = version;
+    journal->valid = false;
+    journal->dirty = false;
+    journal->sequence = 0;
+    journal->bank = SETTINGS_JOURNAL_BANKS - 1;
+
+    if (records_start(journal) + sizeof(record_header_t) > SETTINGS_JOURNAL_BANK_SIZE)
+        return false;
+
+    for (int bank = 0; bank < SETTINGS_JOURNAL_BANKS; bank++) {
+        if (!bank_valid(journal, bank, &header))
+            continue;
+        if (best < 0 || (int32_t)(header.sequence - best_sequence) > 0) {
+            best = bank;
+            best_sequence = header.sequence;
+        }
+    }
+    if (best < 0)
+        return false;
+
+    const uint8_t *ptr = bank_ptr(journal, best);
+    uint32_t pos = records_start(journal);
+
+    memcpy(image, ptr + SETTINGS_JOURNAL_HEADER_SIZE, size);
+
+    while (pos + sizeof(record_header_t) <= SETTINGS_JOURNAL_BANK_SIZE) {
+        record_header_t record;
+
+        memcpy(&record, ptr + pos, sizeof(record));
+        if (record.length == RECORD_END)
+            break;
+
+        // Torn or corrupted, drop it and whatever follows
+        if (record.length > SETTINGS_JOURNAL_BANK_SIZE - pos - sizeof(record) ||
+            record.crc != crc32_le(0, ptr + pos + sizeof(record), record.length) ||
+            !apply_record(journal, image, ptr + pos + sizeof(record), record.length)) {
+            journal->dirty = true;
+            break;
+        }
+        pos += sizeof(record) + record.length;
+    }
+
+    // A record torn before its header was programmed leaves bytes behind
+    for (uint32_t i = pos; !journal->dirty && i < SETTINGS_JOURNAL_BANK_SIZE; i++) {
+        if (ptr[i] != 0xFF)
+            journal->dirty = true;
+    }
+
+    journal->bank = best;
+    journal->valid = true;
+    journal->sequence = best_sequence;
+    journal->head = pos;
+    return true;
+}
+
+void settings_journal_compact(settings_journal_t *journal, const void *image)
+{
+    uint8_t bank = (journal->bank + 1) % SETTINGS_JOURNAL_BANKS;
+    uint32_t offset = bank * SETTINGS_JOURNAL_BANK_SIZE;
+    bank_header_t header = {
+        .magic = JOURNAL_MAGIC,
+        .sequence = journal->sequence + 1,
+        .size = journal->size,
+        .version = journal->version,
+        .reserved = 0xFF,
+        .crc = crc32_le(0, image, journal->size),
+    };
+
+    journal->flash->erase(offset, SETTINGS_JOURNAL_BANK_SIZE);
+    journal->flash->program(offset + SETTINGS_JOURNAL_HEADER_SIZE, image, journal->size);
+    // Last, the bank is only valid once the snapshot is complete
+    journal->flash->program(offset, &header, sizeof(header));
+
+    journal->bank = bank;
+    journal->valid = true;
+    journal->dirty = false;
+    journal->sequence = header.sequence;
+    journal->head = records_start(journal);
+}
+
+// Next range of bytes that differ from `pos`, false when there are none left
+static bool next_range(const uint8_t *a, const uint8_t *b, uint32_t size, uint32_t *pos, range_header_t *range)
+{
+    uint32_t start = *pos;
+    uint32_t end;
+
+    while (start < size && a[start] == b[start])
+        start++;
+    if (start >= size)
+        return false;
+
+    end = start + 1;
+    for (uint32_t i = end; i < size && i - end < MERGE_GAP; i++) {
+        if (a[i] != b[i])
+            end = i + 1;
+    }
+
+    range->offset = start;
+    range->length = end - start;
+    *pos = end;
+    return true;
+}
+
+void settings_journal_commit(settings_journal_t *journal, const void *image, void *committed)
+{
+    const uint8_t *new = image;
+    const uint8_t *old = committed;
+    record_header_t record = {0, 0};
+    range_header_t range;
+    uint32_t pos = 0;
+
+    // Size and crc first, the header is programmed before the ranges
+    while (next_range(new, old, journal->size, &pos, &range)) {
+        uint32_t pad = ALIGN4(range.length) - range.length;
+
+        record.crc = crc32_le(record.crc, (const uint8_t *)&range, sizeof(range));
+        record.crc = crc32_le(record.crc, new + range.offset, range.length);
+        record.crc = crc32_le(record.crc, padding, pad);
+        record.length += sizeof(range) + range.length + pad;
+    }
+    if (record.length == 0 && journal->valid)
+        return;
+
+    if (!journal->valid || journal->dirty ||
+        journal->head + sizeof(record) + record.length > SETTINGS_JOURNAL_BANK_SIZE) {
+        settings_journal_compact(journal, image);
+    } else {
+        uint32_t offset = journal->bank * SETTINGS_JOURNAL_BANK_SIZE + journal->head;
+
+        journal->flash->program(offset, &record, sizeof(record));
+        offset += sizeof(record);
+
+        pos = 0;
+        while (next_range(new, old, journal->size, &pos, &range)) {
+            uint32_t pad = ALIGN4(range.length) - range.length;
+
+            journal->flash->program(offset, &range, sizeof(range));
+            journal->flash->program(offset + sizeof(range), new + range.offset, range.length);
+            if (pad)
+                journal->flash->program(offset + sizeof(range) + range.length, padding, pad);
+            offset += sizeof(range) + range.length + pad;
+        }
+        journal->head += sizeof(record) + record.length;
+    }
+
+    memcpy(committed, image, journal->size);
+}
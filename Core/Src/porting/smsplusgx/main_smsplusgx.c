@@ -13,6 +13,7 @@
 #include "shared.h"
 #include "rom_manager.h"
 #include "common.h"
+#include "audio_mix.h"
 #include "main_smsplusgx.h"
 #include "appid.h"
 #include "rg_i18n.h"
@@ -47,7 +48,6 @@ static bool consoleIsSG  = false;
 extern LTDC_HandleTypeDef hltdc;
 
 void set_config();
-unsigned int crc32_le(unsigned int crc, unsigned char const * buf,unsigned int len);
 
 // --- MAIN
 #define SMSROM_RAM_BUFFER_LENGTH (60*1024)
@@ -170,7 +170,8 @@ load_rom_from_flash(uint8_t emu_engine)
 
     cart.sram = sram;
     cart.pages = cart.size / 0x4000;
-    cart.crc = crc32_le(0, cart.rom, cart.size);
+    // Of the dump, computed at build time, see tools/romdb.py
+    cart.crc = ACTIVE_FILE->crc32;
     cart.loaded = 1;
 
     if (emu_engine == SMSPLUSGX_ENGINE_COLECO)
@@ -344,23 +345,32 @@ blit_sms(bitmap_t *bmp, uint16_t *framebuffer) {	/* 256 x 192 -> 320 x 230 */
     }
 }
 
-void sms_pcm_submit() {
-    uint8_t volume = odroid_audio_volume_get();
-    int32_t factor = volume_tbl[volume] / 2; // Divide by 2 to prevent overflow in stereo mixing
-    size_t offset = (dma_state == DMA_TRANSFER_STATE_HF) ? 0 : AUDIO_BUFFER_LENGTH_SMS;
-    if (audio_mute || volume == ODROID_AUDIO_VOLUME_MIN) {
-        for (int i = 0; i < AUDIO_BUFFER_LENGTH_SMS; i++) {
-            audiobuffer_dma[i + offset] = 0;
-        }
-    } else {
-        for (int i = 0; i < AUDIO_BUFFER_LENGTH_SMS; i++) {
-            /* mix left & right */
-            int32_t sample = (sms_snd.output[0][i] + sms_snd.output[1][i]);
-            audiobuffer_dma[i + offset] = (sample * factor) >> 8;
+/* Unfiltered version of blit_gg() and blit_sms(), the LTDC does the palette lookup */
+static void
+blit_nearest_lut8(bitmap_t *bmp, uint8_t *framebuffer, int w, int h) {
+    const int hpad = (WIDTH - w) / 2;
+    const int vpad = (HEIGHT - h) / 2;
+    const uint32_t x_step = (bmp->viewport.w << 16) / w;
+    const uint32_t y_step = (bmp->viewport.h << 16) / h;
+
+    for (int y = 0; y < h; y++) {
+        uint8_t *src_row = &bmp->data[(((y * y_step) >> 16) + bmp->viewport.y) * bmp->pitch + bmp->viewport.x];
+        uint8_t *dest_row = &framebuffer[(y + vpad) * WIDTH + hpad];
+        uint32_t x_src = 0;
+        for (int x = 0; x < w; x++, x_src += x_step) {
+            dest_row[x] = src_row[x_src >> 16] & 0x1f;
         }
     }
 }
 
+void sms_pcm_submit() {
+    int32_t factor = common_emu_sound_get_volume() / 2; // Divide by 2 to prevent overflow in stereo mixing
+
+    /* mix left & right */
+    audio_mix_s16_add(common_emu_sound_get_buffer(AUDIO_BUFFER_LENGTH_SMS),
+                      sms_snd.output[0], sms_snd.output[1], AUDIO_BUFFER_LENGTH_SMS, factor, 8);
+}
+
 static void sms_draw_frame()
 {
   static uint32_t lastFPSTime = 0;
@@ -385,11 +395,17 @@ static void sms_draw_frame()
       palette_spaced[i] = ((0b1111100000000000 & p) << 10) |
                           ((0b0000011111100000 & p) << 5) |
                           ((0b0000000000011111 & p));
+      /* Games change the palette between frames, only changes are uploaded */
+      lcd_lut8_set_color(i, p);
   }
 
   curr_framebuffer = lcd_get_active_buffer();
-  if (sms.console == CONSOLE_GG)     blit_gg(&bitmap, curr_framebuffer);
-  else                               blit_sms(&bitmap, curr_framebuffer);
+  if (common_emu_lut8_frame(odroid_display_get_filter_mode() != ODROID_DISPLAY_FILTER_OFF)) {
+      if (sms.console == CONSOLE_GG) blit_nearest_lut8(&bitmap, (uint8_t *)curr_framebuffer, 320, 240);
+      else                           blit_nearest_lut8(&bitmap, (uint8_t *)curr_framebuffer, 320, 230);
+  }
+  else if (sms.console == CONSOLE_GG) blit_gg(&bitmap, curr_framebuffer);
+  else                                blit_sms(&bitmap, curr_framebuffer);
   common_ingame_overlay();
   lcd_swap();
 }
@@ -502,6 +518,10 @@ app_main_smsplusgx(uint8_t load_state, uint8_t start_paused, uint8_t save_slot,
     memset(framebuffer1, 0, sizeof(framebuffer1));
     memset(framebuffer2, 0, sizeof(framebuffer2));
 
+    // The game palette only uses 32 entries, keep a black one for the borders
+    lcd_lut8_set_color(32, 0x0000);
+    lcd_lut8_set_background(32);
+
     if (load_state) {
 #if OFF_SAVESTATE==1
         if (save_slot == 1) {
@@ -545,16 +565,7 @@ app_main_smsplusgx(uint8_t load_state, uint8_t start_paused, uint8_t save_slot,
             sms_pcm_submit();
         }
 
-        if(!common_emu_state.skip_frames)
-        {
-            for(uint8_t p = 0; p < common_emu_state.pause_frames + 1; p++) {
-                static dma_transfer_state_t last_dma_state = DMA_TRANSFER_STATE_HF;
-                while (dma_state == last_dma_state) {
-                    cpumon_sleep();
-                }
-                last_dma_state = dma_state;
-            }
-        }
+        common_emu_sound_sync(true);
     }
 }
 
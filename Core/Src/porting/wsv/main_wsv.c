@@ -9,6 +9,7 @@
 #include "gw_buttons.h"
 #include "rom_manager.h"
 #include "common.h"
+#include "audio_mix.h"
 #include "lz4_depack.h"
 #include "miniz.h"
 #include "lzma.h"
@@ -52,22 +53,13 @@ static bool SaveState(char *pathName) {
 }
 
 void wsv_pcm_submit() {
-    uint8_t volume = odroid_audio_volume_get();
-    int32_t factor = volume_tbl[volume]/2; // Divide by 2 to prevent overflow in stereo mixing
+    int32_t factor = common_emu_sound_get_volume() / 2; // Divide by 2 to prevent overflow in stereo mixing
 
     supervision_update_sound((uint8 *)audioBuffer_wsv,WSV_AUDIO_BUFFER_LENGTH*2);
-    size_t offset = (dma_state == DMA_TRANSFER_STATE_HF) ? 0 : WSV_AUDIO_BUFFER_LENGTH;
-    if (audio_mute || volume == ODROID_AUDIO_VOLUME_MIN) {
-        for (int i = 0; i < WSV_AUDIO_BUFFER_LENGTH; i++) {
-            audiobuffer_dma[offset + i] = 0;
-        }
-    } else {
-        for (int i = 0; i < WSV_AUDIO_BUFFER_LENGTH; i++) {
-            /* mix left & right */
-            int32_t sample = audioBuffer_wsv[2*i] + audioBuffer_wsv[2*i+1];
-            audiobuffer_dma[offset + i] = (sample * factor);
-        }
-    }
+
+    /* mix left & right */
+    audio_mix_s8_stereo(common_emu_sound_get_buffer(WSV_AUDIO_BUFFER_LENGTH),
+                        audioBuffer_wsv, WSV_AUDIO_BUFFER_LENGTH, factor, 0);
 }
 
 __attribute__((optimize("unroll-loops")))
@@ -559,15 +551,7 @@ int app_main_wsv(uint8_t load_state, uint8_t start_paused, uint8_t save_slot)
             blit();
         }
         wsv_pcm_submit();
-        if(!common_emu_state.skip_frames){
-            static dma_transfer_state_t last_dma_state = DMA_TRANSFER_STATE_HF;
-            for(uint8_t p = 0; p < common_emu_state.pause_frames + 1; p++) {
-                while (dma_state == last_dma_state) {
-                    cpumon_sleep();
-                }
-                last_dma_state = dma_state;
-            }
-        }
+        common_emu_sound_sync(true);
     }
 
     return 0;
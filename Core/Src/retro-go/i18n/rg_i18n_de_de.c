@@ -98,6 +98,7 @@ const lang_t lang_de_de LANG_DATA = {
     .s_copy_GW_time_to_RTC = "G&W Zeit -> RTC",
     .s_LCD_filter = "LCD filter",
     .s_Display_RAM = "Anzeigespeicher",
+    .s_Run_ahead = "Vorausberechnung",
     .s_Press_ACL = "Drcke ACL oder Reset",
     .s_Press_TIME = "Drcke TIME [B+TIME]",
     .s_Press_ALARM = "Drcke ALARM [B+GAME]",
@@ -157,6 +158,7 @@ const lang_t lang_de_de LANG_DATA = {
     .s_Type = "Typ",
     .s_Size = "Gre",
     .s_ImgSize = "Bildgre",
+    .s_Patches = "Patches",
     .s_Close = "Schlieen",
     .s_GameProp = "Eigenschaften",
     .s_Resume_game = "Spiel fortsetzen",
@@ -85,6 +85,7 @@ const lang_t lang_en_us LANG_DATA = {
     .s_copy_GW_time_to_RTC = "copy G&W time to RTC",
     .s_LCD_filter = "LCD filter",
     .s_Display_RAM = "Display RAM",
+    .s_Run_ahead = "Run-ahead",
     .s_Press_ACL = "Press ACL or reset",
     .s_Press_TIME = "Press TIME [B+TIME]",
     .s_Press_ALARM = "Press ALARM [B+GAME]",
@@ -145,6 +146,7 @@ const lang_t lang_en_us LANG_DATA = {
     .s_Type = "Type",
     .s_Size = "Size",
     .s_ImgSize = "ImgSize",
+    .s_Patches = "Patches",
     .s_Close = "Close",
     .s_GameProp = "Properties",
     .s_Resume_game = "Resume game",
@@ -93,6 +93,7 @@ const lang_t lang_es_es LANG_DATA = {
     .s_copy_GW_time_to_RTC = "Copiar hora G&W a RTC",
     .s_LCD_filter = "Filtro LCD",
     .s_Display_RAM = "Mostrar RAM",
+    .s_Run_ahead = "Run-ahead",
     .s_Press_ACL = "Pulsar ACL o reset",
     .s_Press_TIME = "Pulsar TIME [B+TIME]",
     .s_Press_ALARM = "Pulsar ALARM [B+GAME]",
@@ -153,6 +154,7 @@ const lang_t lang_es_es LANG_DATA = {
     .s_Type = "Tipo",
     .s_Size = "Tamao",
     .s_ImgSize = "Tamao Imagen",
+    .s_Patches = "Parches",
     .s_Close = "Cerrar",
     .s_GameProp = "Propiedades",
     .s_Resume_game = "Continuar",
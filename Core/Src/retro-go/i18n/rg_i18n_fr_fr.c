@@ -94,6 +94,7 @@ const lang_t lang_fr_fr LANG_DATA = {
     .s_copy_GW_time_to_RTC = "Copie temps G&W vers horloge RTC",
     .s_LCD_filter = "Filtre LCD",
     .s_Display_RAM = "Montrer la RAM",
+    .s_Run_ahead = "Anticipation",
     .s_Press_ACL = "Presser ACL ou Reset",
     .s_Press_TIME = "Presser TIME [B+TIME]",
     .s_Press_ALARM = "Presser ALARM [B+GAME]",
@@ -154,6 +155,7 @@ const lang_t lang_fr_fr LANG_DATA = {
     .s_Type = "Type",
     .s_Size = "Taille",
     .s_ImgSize = "Taille image",
+    .s_Patches = "Patchs",
     .s_Close = "Fermer",
     .s_GameProp = "Proprits",
     .s_Resume_game = "Reprendre le jeu",
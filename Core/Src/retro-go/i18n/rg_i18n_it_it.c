@@ -95,6 +95,7 @@ const lang_t lang_it_it LANG_DATA = {
     .s_copy_GW_time_to_RTC = "Copia orario G&W sull'RTC",
     .s_LCD_filter = "Filtro LCD",
     .s_Display_RAM = "Mostra la RAM",
+    .s_Run_ahead = "Anticipo",
     .s_Press_ACL = "Premi ACL o Reset",
     .s_Press_TIME = "Premi TIME [B+TIME]",
     .s_Press_ALARM = "Premi ALARM [B+GAME]",
@@ -155,6 +156,7 @@ const lang_t lang_it_it LANG_DATA = {
     .s_Type = "Tipo",
     .s_Size = "Dimensione",
     .s_ImgSize = "Dimensione immagine",
+    .s_Patches = "Patch",
     .s_Close = "Chiudi",
     .s_GameProp = "Propriet",
     .s_Resume_game = "Riprendi gioco",
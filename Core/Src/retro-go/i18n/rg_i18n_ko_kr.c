@@ -95,6 +95,7 @@ const lang_t lang_ko_kr LANG_DATA = {
     .s_copy_GW_time_to_RTC = "copy G&W time to RTC",
     .s_LCD_filter = "LCD filter",
     .s_Display_RAM = "Display RAM",
+    .s_Run_ahead = "Run-ahead",
     .s_Press_ACL = "Press ACL or reset",
     .s_Press_TIME = "Press TIME [B+TIME]",
     .s_Press_ALARM = "Press ALARM [B+GAME]",
@@ -155,6 +156,7 @@ const lang_t lang_ko_kr LANG_DATA = {
     .s_Type = "",
     .s_Size = "ũ",
     .s_ImgSize = "̹ ũ",
+    .s_Patches = "ġ",
     .s_Close = "ݱ",
     .s_GameProp = "Ӽ",
     .s_Resume_game = "  ϱ",
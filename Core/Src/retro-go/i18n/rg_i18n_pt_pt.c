@@ -94,6 +94,7 @@ const lang_t lang_pt_pt LANG_DATA = {
     .s_copy_GW_time_to_RTC = "copiar hora G&W para RTC",
     .s_LCD_filter = "Filtro LCD",
     .s_Display_RAM = "Mostrar RAM",
+    .s_Run_ahead = "Run-ahead",
     .s_Press_ACL = "Pressione ACL ou reset",
     .s_Press_TIME = "Pressione TIME [B+TIME]",
     .s_Press_ALARM = "Pressione ALARM [B+GAME]",
@@ -147,6 +148,7 @@ const lang_t lang_pt_pt LANG_DATA = {
     .s_Type = "Tipo",
     .s_Size = "Tamanho",
     .s_ImgSize = "Tamanho da Imagem",
+    .s_Patches = "Patches",
     .s_Close = "Fechar",
     .s_GameProp = "Propriedades",
     .s_Resume_game = "Resumir jogo",
@@ -93,6 +93,7 @@ const lang_t lang_ru_ru LANG_DATA = {
     .s_copy_GW_time_to_RTC = "  G&W  RTC",
     .s_LCD_filter = " LCD",
     .s_Display_RAM = " RAM",
+    .s_Run_ahead = "Run-ahead",
     .s_Press_ACL = " ACL  ",
     .s_Press_TIME = " TIME [B+TIME]",
     .s_Press_ALARM = " ALARM [B+GAME]",
@@ -153,6 +154,7 @@ const lang_t lang_ru_ru LANG_DATA = {
     .s_Type = "",
     .s_Size = "",
     .s_ImgSize = " ",
+    .s_Patches = "",
     .s_Close = "",
     .s_GameProp = "",
     .s_Resume_game = " ",
@@ -97,6 +97,7 @@ const lang_t lang_zh_cn LANG_DATA = {
     .s_copy_GW_time_to_RTC = "ͬʱ䵽ϵͳ",
     .s_LCD_filter = "Ļ",
     .s_Display_RAM = "ʾڴϢ",
+    .s_Run_ahead = "Run-ahead",
     .s_Press_ACL = "Ϸ",
     .s_Press_TIME = "ģ TIME   [B+TIME]",
     .s_Press_ALARM = "ģ ALARM  [B+GAME]",
@@ -157,6 +158,7 @@ const lang_t lang_zh_cn LANG_DATA = {
     .s_Type = "ͣ",
     .s_Size = "С",
     .s_ImgSize = "ͼ",
+    .s_Patches = "",
     .s_Close = " ر",
     .s_GameProp = "Ϸļ",
     .s_Resume_game = " Ϸ",
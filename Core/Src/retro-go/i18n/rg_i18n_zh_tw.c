@@ -94,6 +94,7 @@ const lang_t lang_zh_tw LANG_DATA = {
     .s_copy_GW_time_to_RTC = "PBɶt",
     .s_LCD_filter = "ùo",
     .s_Display_RAM = "ܰOT",
+    .s_Run_ahead = "Run-ahead",
     .s_Press_ACL = "mC",
     .s_Press_TIME = " TIME   [B+TIME]",
     .s_Press_ALARM = " ALARM  [B+GAME]",
@@ -151,6 +152,7 @@ const lang_t lang_zh_tw LANG_DATA = {
     .s_Type = "G",
     .s_Size = "jpG",
     .s_ImgSize = "ϹG",
+    .s_Patches = "ɤB",
     .s_Close = " ",
     .s_GameProp = "Cݩ",
     .s_Resume_game = " Js",
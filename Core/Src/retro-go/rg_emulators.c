@@ -312,6 +312,7 @@ void emulator_show_file_info(retro_emulator_file_t *file)
     char type_value[32];
     char size_value[32];
     char img_size[32];
+    char patches_value[128];
     //char crc_value[32];
     //crc_value[0] = '\x00';
 
@@ -322,10 +323,13 @@ void emulator_show_file_info(retro_emulator_file_t *file)
 		#if COVERFLOW != 0
         {0, curr_lang->s_ImgSize, img_size, 1, NULL},
 		#endif
+        {0, curr_lang->s_Patches, patches_value, 1, NULL},
         ODROID_DIALOG_CHOICE_SEPARATOR,
         {1, curr_lang->s_Close, "", 1, NULL},
         ODROID_DIALOG_CHOICE_LAST
     };
+    // Before the separator, the close button and the terminator
+    int patches_index = sizeof(choices) / sizeof(choices[0]) - 4;
 
     sprintf(choices[0].value, "%.127s", file->name);
     sprintf(choices[1].value, "%s", file->ext);
@@ -333,6 +337,10 @@ void emulator_show_file_info(retro_emulator_file_t *file)
     #if COVERFLOW != 0
     sprintf(choices[3].value, "%d KB", file->img_size / 1024);
 	#endif
+    if (file->patches)
+        sprintf(choices[patches_index].value, "%.127s", file->patches);
+    else
+        memmove(&choices[patches_index], &choices[patches_index + 1], 3 * sizeof(choices[0]));
 
     odroid_overlay_dialog(curr_lang->s_GameProp, choices, -1);
 }
@@ -343,8 +351,9 @@ static bool cheat_update_cb(odroid_dialog_choice_t *option, odroid_dialog_event_
     bool is_on = odroid_settings_ActiveGameGenieCodes_is_enabled(CHOSEN_FILE->id, option->id);
     if (event == ODROID_DIALOG_PREV || event == ODROID_DIALOG_NEXT) 
     {
-        is_on = is_on ? false : true;
-        odroid_settings_ActiveGameGenieCodes_set(CHOSEN_FILE->id, option->id, is_on);
+        // Stays off when no more games can have cheats
+        if (odroid_settings_ActiveGameGenieCodes_set(CHOSEN_FILE->id, option->id, !is_on))
+            is_on = !is_on;
     }
     strcpy(option->value, is_on ? curr_lang->s_Cheat_Codes_ON : curr_lang->s_Cheat_Codes_OFF);
     return event == ODROID_DIALOG_ENTER;
@@ -356,7 +365,8 @@ static bool show_cheat_dialog()
 
     // +1 for the terminator sentinel
     odroid_dialog_choice_t *choices = rg_alloc((CHOSEN_FILE->cheat_count + 1) * sizeof(odroid_dialog_choice_t), MEM_ANY);
-    char svalues[MAX_CHEAT_CODES][10];
+    // A ROM can have any number of cheats
+    char (*svalues)[10] = rg_alloc(CHOSEN_FILE->cheat_count * sizeof(*svalues), MEM_ANY);
     for(int i=0; i<CHOSEN_FILE->cheat_count; i++) 
     {
         const char *label = CHOSEN_FILE->cheat_descs[i];
@@ -373,6 +383,7 @@ static bool show_cheat_dialog()
     odroid_overlay_dialog(curr_lang->s_Cheat_Codes_Title, choices, 0);
 
     rg_free(choices);
+    rg_free(svalues);
     odroid_settings_commit();
     return false;
 }
@@ -465,6 +476,27 @@ bool emulator_show_file_menu(retro_emulator_file_t *file)
     return force_redraw;
 }
 
+// Copies the ITCM overlay of an emulator and clears its bss. It is the first
+// ITC allocation after itc_init(), the emulator allocations come after it.
+static void load_itcram_overlay(void *load_start, size_t size, size_t bss_size)
+{
+    uint8_t *dst;
+
+    if (size + bss_size == 0) {
+        return;
+    }
+
+    dst = itc_malloc_tag(size + bss_size, "itcram overlay");
+    assert(dst == __itcram_emu_start__);
+
+    memcpy(dst, load_start, size);
+    memset(dst + size, 0, bss_size);
+
+    // The copied code is executed right after
+    __DSB();
+    __ISB();
+}
+
 void emulator_start(retro_emulator_file_t *file, bool load_state, bool start_paused, uint8_t save_slot)
 {
     printf("Retro-Go: Starting game: %s\n", file->name);
@@ -486,6 +518,7 @@ void emulator_start(retro_emulator_file_t *file, bool load_state, bool start_pau
         memcpy(&__RAM_EMU_START__, &_OVERLAY_GB_LOAD_START, (size_t)&_OVERLAY_GB_SIZE);
         memset(&_OVERLAY_GB_BSS_START, 0x0, (size_t)&_OVERLAY_GB_BSS_SIZE);
         SCB_CleanDCache_by_Addr((uint32_t *)&__RAM_EMU_START__, (size_t)&_OVERLAY_GB_SIZE);
+        load_itcram_overlay(&_ITCRAM_GB_LOAD_START, (size_t)&_ITCRAM_GB_SIZE, (size_t)&_ITCRAM_GB_BSS_SIZE);
         app_main_gb(load_state, start_paused, save_slot);
 #endif
     } else if(strcmp(emu->system_name, "Nintendo Entertainment System") == 0) {
@@ -493,6 +526,7 @@ void emulator_start(retro_emulator_file_t *file, bool load_state, bool start_pau
         memcpy(&__RAM_EMU_START__, &_OVERLAY_NES_LOAD_START, (size_t)&_OVERLAY_NES_SIZE);
         memset(&_OVERLAY_NES_BSS_START, 0x0, (size_t)&_OVERLAY_NES_BSS_SIZE);
         SCB_CleanDCache_by_Addr((uint32_t *)&__RAM_EMU_START__, (size_t)&_OVERLAY_NES_SIZE);
+        load_itcram_overlay(&_ITCRAM_NES_LOAD_START, (size_t)&_ITCRAM_NES_SIZE, (size_t)&_ITCRAM_NES_BSS_SIZE);
         app_main_nes(load_state, start_paused, save_slot);
 #endif
     } else if(strcmp(emu->system_name, "Sega Master System") == 0 ||
@@ -503,6 +537,7 @@ void emulator_start(retro_emulator_file_t *file, bool load_state, bool start_pau
         memcpy(&__RAM_EMU_START__, &_OVERLAY_SMS_LOAD_START, (size_t)&_OVERLAY_SMS_SIZE);
         memset(&_OVERLAY_SMS_BSS_START, 0x0, (size_t)&_OVERLAY_SMS_BSS_SIZE);
         SCB_CleanDCache_by_Addr((uint32_t *)&__RAM_EMU_START__, (size_t)&_OVERLAY_SMS_SIZE);
+        load_itcram_overlay(&_ITCRAM_SMS_LOAD_START, (size_t)&_ITCRAM_SMS_SIZE, (size_t)&_ITCRAM_SMS_BSS_SIZE);
         if (! strcmp(emu->system_name, "Colecovision")) app_main_smsplusgx(load_state, start_paused, save_slot, SMSPLUSGX_ENGINE_COLECO);
         else
         if (! strcmp(emu->system_name, "Sega SG-1000")) app_main_smsplusgx(load_state, start_paused, save_slot, SMSPLUSGX_ENGINE_SG1000);
@@ -513,6 +548,7 @@ void emulator_start(retro_emulator_file_t *file, bool load_state, bool start_pau
         memcpy(&__RAM_EMU_START__, &_OVERLAY_GW_LOAD_START, (size_t)&_OVERLAY_GW_SIZE);
         memset(&_OVERLAY_GW_BSS_START, 0x0, (size_t)&_OVERLAY_GW_BSS_SIZE);
         SCB_CleanDCache_by_Addr((uint32_t *)&__RAM_EMU_START__, (size_t)&_OVERLAY_GW_SIZE);
+        load_itcram_overlay(&_ITCRAM_GW_LOAD_START, (size_t)&_ITCRAM_GW_SIZE, (size_t)&_ITCRAM_GW_BSS_SIZE);
         app_main_gw(load_state, save_slot);
 #endif
     } else if(strcmp(emu->system_name, "PC Engine") == 0) {
@@ -520,6 +556,7 @@ void emulator_start(retro_emulator_file_t *file, bool load_state, bool start_pau
       memcpy(&__RAM_EMU_START__, &_OVERLAY_PCE_LOAD_START, (size_t)&_OVERLAY_PCE_SIZE);
       memset(&_OVERLAY_PCE_BSS_START, 0x0, (size_t)&_OVERLAY_PCE_BSS_SIZE);
       SCB_CleanDCache_by_Addr((uint32_t *)&__RAM_EMU_START__, (size_t)&_OVERLAY_PCE_SIZE);
+      load_itcram_overlay(&_ITCRAM_PCE_LOAD_START, (size_t)&_ITCRAM_PCE_SIZE, (size_t)&_ITCRAM_PCE_BSS_SIZE);
       app_main_pce(load_state, start_paused, save_slot);
 #endif
     } else if(strcmp(emu->system_name, "MSX") == 0) {
@@ -527,6 +564,7 @@ void emulator_start(retro_emulator_file_t *file, bool load_state, bool start_pau
       memcpy(&__RAM_EMU_START__, &_OVERLAY_MSX_LOAD_START, (size_t)&_OVERLAY_MSX_SIZE);
       memset(&_OVERLAY_MSX_BSS_START, 0x0, (size_t)&_OVERLAY_MSX_BSS_SIZE);
       SCB_CleanDCache_by_Addr((uint32_t *)&__RAM_EMU_START__, (size_t)&_OVERLAY_MSX_SIZE);
+      load_itcram_overlay(&_ITCRAM_MSX_LOAD_START, (size_t)&_ITCRAM_MSX_SIZE, (size_t)&_ITCRAM_MSX_BSS_SIZE);
       app_main_msx(load_state, start_paused, save_slot);
 #endif
     } else if(strcmp(emu->system_name, "Watara Supervision") == 0) {
@@ -534,6 +572,7 @@ void emulator_start(retro_emulator_file_t *file, bool load_state, bool start_pau
       memcpy(&__RAM_EMU_START__, &_OVERLAY_WSV_LOAD_START, (size_t)&_OVERLAY_WSV_SIZE);
       memset(&_OVERLAY_WSV_BSS_START, 0x0, (size_t)&_OVERLAY_WSV_BSS_SIZE);
       SCB_CleanDCache_by_Addr((uint32_t *)&__RAM_EMU_START__, (size_t)&_OVERLAY_WSV_SIZE);
+      load_itcram_overlay(&_ITCRAM_WSV_LOAD_START, (size_t)&_ITCRAM_WSV_SIZE, (size_t)&_ITCRAM_WSV_BSS_SIZE);
       app_main_wsv(load_state, start_paused, save_slot);
 #endif
     } else if(strcmp(emu->system_name, "Sega Genesis") == 0)  {
@@ -541,6 +580,7 @@ void emulator_start(retro_emulator_file_t *file, bool load_state, bool start_pau
       memcpy(&__RAM_EMU_START__, &_OVERLAY_MD_LOAD_START, (size_t)&_OVERLAY_MD_SIZE);
       memset(&_OVERLAY_MD_BSS_START, 0x0, (size_t)&_OVERLAY_MD_BSS_SIZE);
       SCB_CleanDCache_by_Addr((uint32_t *)&__RAM_EMU_START__, (size_t)&_OVERLAY_MD_SIZE);
+      load_itcram_overlay(&_ITCRAM_MD_LOAD_START, (size_t)&_ITCRAM_MD_SIZE, (size_t)&_ITCRAM_MD_BSS_SIZE);
       app_main_gwenesis(load_state, start_paused, save_slot);
  #endif
     } else if(strcmp(emu->system_name, "Atari 7800") == 0)  {
@@ -548,6 +588,7 @@ void emulator_start(retro_emulator_file_t *file, bool load_state, bool start_pau
       memcpy(&__RAM_EMU_START__, &_OVERLAY_A7800_LOAD_START, (size_t)&_OVERLAY_A7800_SIZE);
       memset(&_OVERLAY_A7800_BSS_START, 0x0, (size_t)&_OVERLAY_A7800_BSS_SIZE);
       SCB_CleanDCache_by_Addr((uint32_t *)&__RAM_EMU_START__, (size_t)&_OVERLAY_A7800_SIZE);
+      load_itcram_overlay(&_ITCRAM_A7800_LOAD_START, (size_t)&_ITCRAM_A7800_SIZE, (size_t)&_ITCRAM_A7800_BSS_SIZE);
       app_main_a7800(load_state, start_paused, save_slot);
  #endif
     } else if(strcmp(emu->system_name, "Amstrad CPC") == 0)  {
@@ -555,6 +596,7 @@ void emulator_start(retro_emulator_file_t *file, bool load_state, bool start_pau
       memcpy(&__RAM_EMU_START__, &_OVERLAY_AMSTRAD_LOAD_START, (size_t)&_OVERLAY_AMSTRAD_SIZE);
       memset(&_OVERLAY_AMSTRAD_BSS_START, 0x0, (size_t)&_OVERLAY_AMSTRAD_BSS_SIZE);
       SCB_CleanDCache_by_Addr((uint32_t *)&__RAM_EMU_START__, (size_t)&_OVERLAY_AMSTRAD_SIZE);
+      load_itcram_overlay(&_ITCRAM_AMSTRAD_LOAD_START, (size_t)&_ITCRAM_AMSTRAD_SIZE, (size_t)&_ITCRAM_AMSTRAD_BSS_SIZE);
       app_main_amstrad(load_state, start_paused, save_slot);
   #endif
     }
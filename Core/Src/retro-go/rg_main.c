@@ -106,7 +106,7 @@ static bool color_shift_cb(odroid_dialog_choice_t *option, odroid_dialog_event_t
 
 static bool main_menu_cpu_oc_cb(odroid_dialog_choice_t *option, odroid_dialog_event_t event, uint32_t repeat)
 {
-    int cpu_oc = oc_level_gets();
+    int cpu_oc = odroid_settings_cpu_oc_level_get();
     if (event == ODROID_DIALOG_PREV) {
         cpu_oc--;
         if (cpu_oc < 0)
@@ -117,9 +117,9 @@ static bool main_menu_cpu_oc_cb(odroid_dialog_choice_t *option, odroid_dialog_ev
         if (cpu_oc > 2)
             cpu_oc = 0;
     }
-    oc_level_set(cpu_oc);
+    // Applied on the next boot, the clock governor moves oc_level_get() in games
     odroid_settings_cpu_oc_level_set(cpu_oc);
-    int cpu_oc1 = cpu_oc - oc_level_get();
+    int cpu_oc1 = cpu_oc - oc_level_gets();
     char *s = (char *)(curr_lang->s_CPU_OC_Stay_at);
     if (cpu_oc1 > 0)
         s = (char *)(curr_lang->s_CPU_OC_Upgrade_to);
@@ -539,10 +539,12 @@ void retro_loop()
                 if (r == 9)
                     soft_reset_do();
 #endif
-                if (oc_level_gets() != oc_level_get())
+                if (odroid_settings_cpu_oc_level_get() != oc_level_gets())
                     //reboot;
-                    if (odroid_overlay_confirm(curr_lang->s_Confirm_OC_Reboot, false) == 1)
+                    if (odroid_overlay_confirm(curr_lang->s_Confirm_OC_Reboot, false) == 1) {
+                        oc_level_set(odroid_settings_cpu_oc_level_get());
                         odroid_system_switch_app(0);
+                    }
                 gui_redraw();
             }
             // TIME menu
@@ -809,7 +811,7 @@ void app_main(uint8_t boot_mode)
     lcd_set_buffers(framebuffer1, framebuffer2);
     odroid_system_init(ODROID_APPID_LAUNCHER, 32000);
     uint8_t oc = odroid_settings_cpu_oc_level_get();
-    if (oc != oc_level_get())
+    if (oc != oc_level_gets())
     {
         //reboot to oc level;
         oc_level_set(oc);
@@ -19,6 +19,8 @@
 #include <nes_input.h>
 #include <osd.h>
 
+#include "lcd_lut8.h"
+
 
 #define WIDTH  320
 #define HEIGHT 240
@@ -43,8 +45,6 @@ extern unsigned char cart_rom[];
 extern unsigned int cart_rom_len;
 static uint romCRC32;
 
-static uint16_t myPalette[64];
-
 static int16_t audioBufferA[AUDIO_BUFFER_LENGTH * 2];
 static int16_t audioBufferB[AUDIO_BUFFER_LENGTH * 2];
 static int16_t pendingSamples = 0;
@@ -112,8 +112,12 @@ void osd_setpalette(rgb_t *pal)
    for (int i = 0; i < 64; i++)
    {
       uint16_t c = (pal[i].b>>3) | ((pal[i].g>>2)<<5) | ((pal[i].r>>3)<<11);
-    //   myPalette[i] = (c>>8) | ((c&0xff)<<8);
-      myPalette[i] = c;
+
+      // The upper bits are used to indicate background and transparency
+      lcd_lut8_set_color(i, c);
+      lcd_lut8_set_color(i | 0x40, c);
+      lcd_lut8_set_color(i | 0x80, c);
+      lcd_lut8_set_color(i | 0xC0, c);
    }
    odroid_display_force_refresh();
 }
@@ -150,23 +154,11 @@ void osd_blitscreen(bitmap_t *bmp)
     const int hpad = (WIDTH - NES_SCREEN_WIDTH) / 2;
 
     // printf("%d x %d\n", bmp->width, bmp->height);
+    // Same LUT8 expansion as the LTDC does on the device
     for (int line = 0; line < bmp->height; line++) {
         uint8_t *row = bmp->line[line];
-        for (int x = 0; x < bmp->width; x++) {
-
-            // This doesn't look good, but why? There is a palette and the
-            // data seems to be stored with LUT indexes
-            
-            // this will read oob
-            // fb_data[(2*line    ) * WIDTH + x + hpad] = myPalette[row[x]];
-            // fb_data[(2*line + 1) * WIDTH + x + hpad] = myPalette[row[x]];
-
-            fb_data[(2*line    ) * WIDTH + x + hpad] = myPalette[row[x] & 0b111111];
-            fb_data[(2*line + 1) * WIDTH + x + hpad] = myPalette[row[x] & 0b111111];
-
-            // fb_data[(2*line) * WIDTH + x] = row[x];
-            // fb_data[(2*line + 1) * WIDTH + x] = row[x];
-        }
+        lcd_lut8_expand(&fb_data[(2*line    ) * WIDTH + hpad], row, bmp->width);
+        lcd_lut8_expand(&fb_data[(2*line + 1) * WIDTH + hpad], row, bmp->width);
     }
 
     SDL_UpdateTexture(fb_texture, NULL, fb_data, WIDTH * BPP);
@@ -1,4 +1,8 @@
 #include "odroid_system.h"
+#include "frame_stats.h"
+
+// No game menu to collect the frame statistics, log them every 10s at 60Hz
+#define FRAME_STATS_LOG_FRAMES 600
 
 static panic_trace_t *panicTrace = (void *)0x0;
 
@@ -54,5 +58,12 @@ IRAM_ATTR void odroid_system_tick(uint skippedFrame, uint fullFrame, uint busyTi
     counters.totalFrames++;
     counters.busyTime += busyTime;
 
+    if (statistics.lastTickTime)
+        frame_stats_frame(busyTime, get_elapsed_time() - statistics.lastTickTime, skippedFrame);
+    if (counters.totalFrames % FRAME_STATS_LOG_FRAMES == 0) {
+        frame_stats_log();
+        frame_stats_reset();
+    }
+
     statistics.lastTickTime = get_elapsed_time();
 }
@@ -5,16 +5,23 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 
 #include <SDL2/SDL.h>
 
 #include "porting.h"
 #include "crc32.h"
+#include "cheats.h"
 
 #include <gfx.h>
 #include "gw_lcd.h"
 #include <pce.h>
-#include <romdb.h>
+#include "rom_flags.h"
+#include "pce_rom.h"
+#include "sound_pce.h"
+#include "lz4_depack.h"
+#include "lzma.h"
+#include "miniz.h"
 
 #undef printf
 #define APP_ID 20
@@ -52,6 +59,20 @@ static uint8_t emulator_framebuffer_pce[XBUF_WIDTH * XBUF_HEIGHT * 2];
 
 extern unsigned char ROM_DATA[];
 extern unsigned int cart_rom_len;
+extern const uint8_t CHEAT_TABLE[]; // From the .pceplus file given to update_pce_rom.sh
+extern const uint32_t ROM_CRC32;    // From tools/romdb.py, like the ROM entries
+extern const uint16_t ROM_FLAGS;
+extern const char *ROM_EXT;
+
+// Log the cost of the RAM cheats every 10s at 60Hz
+#define CHEATS_LOG_FRAMES 600
+
+static cheats_t cheats;
+static struct {
+    uint32_t frames;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} cheats_cost;
 
 
 static odroid_video_frame_t update1 = {WIDTH, HEIGHT, WIDTH * 2, 2, 0xFF, -1, NULL, NULL, 0, {}};
@@ -74,10 +95,11 @@ extern unsigned char cart_rom[];
 extern unsigned int cart_rom_len;
 
 static uint8_t PCE_EXRAM_BUF[0x8000];
+static uint8_t PCE_ROM_RAM[0x49000]; // MAX_COMPRESSED_PCE_SIZE of parse_roms.py
+static pce_rom_t pce_rom;
 static int framePerSecond=0;
 
 static int current_height, current_width;
-#define PCE_SAMPLE_RATE   (22050)
 #define AUDIO_BUFFER_LENGTH_PCE  (PCE_SAMPLE_RATE / 60)
 //static short audioBuffer_pce[ AUDIO_BUFFER_LENGTH_PCE * 2];
 
@@ -301,9 +323,20 @@ static bool SaveStateStm(char *name)
 	return 0;  
 }
 
+static int16_t audio_buffer[AUDIO_BUFFER_LENGTH_PCE];
+
 void pcm_submit(void)
 {
+    // Nothing plays it, the mixer still runs like on the device
+    pce_snd_update(audio_buffer, AUDIO_BUFFER_LENGTH_PCE, UINT8_MAX / 2);
+}
+
+static uint64_t time_ns(void)
+{
+    struct timespec ts;
 
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
 }
 
 size_t
@@ -314,68 +347,59 @@ pce_osd_getromdata(unsigned char **data)
     return cart_rom_len;
 }
 
-const struct {
-	const uint32_t crc;
-	const char *Name;
-	const uint32_t Flags;
-} pceRomFlags[] = {
-	{0x00000000, "Unknown", JAP},
-	{0xF0ED3094, "Blazing Lazers", USA | TWO_PART_ROM},
-	{0xB4A1B0F6, "Blazing Lazers", USA | TWO_PART_ROM},
-	{0x55E9630D, "Legend of Hero Tonma", USA | US_ENCODED},
-	{0x083C956A, "Populous", JAP | ONBOARD_RAM},
-	{0x0A9ADE99, "Populous", JAP | ONBOARD_RAM},
-};
+// Decompresses a bank of a PCE+ image, see pce_rom.h
+static size_t
+pce_rom_inflate(uint8_t *dst, size_t dst_size, const uint8_t *src, size_t src_size)
+{
+    if (strcmp(ROM_EXT, "lzma") == 0)
+        return lzma_inflate(dst, dst_size, src, src_size);
+    if (strcmp(ROM_EXT, "zopfli") == 0)
+        return tinfl_decompress_mem_to_mem(dst, dst_size, src, src_size, TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+    if (memcmp(src, LZ4_MAGIC, LZ4_MAGIC_SIZE) == 0 && lz4_get_original_size(src) == dst_size)
+        return lz4_uncompress(src, dst);
+    return 0;
+}
 
 int LoadCard(const char *name) {
-    int offset;
-    size_t rom_length = pce_osd_getromdata(&PCE.ROM);
-    offset = rom_length & 0x1fff;
-       
-       
-       PCE.ROM_SIZE = (rom_length - offset) / 0x2000;
-       PCE.ROM_DATA = PCE.ROM + offset;
-       PCE.ROM_CRC = crc32_le(0, PCE.ROM, rom_length);
+    uint64_t start = time_ns();
+
+    if (memcmp(ROM_DATA, PCE_ROM_MAGIC, PCE_ROM_MAGIC_SIZE) == 0) {
+        // Laid out in banks by update_pce_rom.sh, see tools/pce_rom.py
+        if (!pce_rom_unpack(&pce_rom, ROM_DATA, pce_rom_inflate, PCE_ROM_RAM, sizeof(PCE_ROM_RAM)))
+            return 1;
+        PCE.ROM = PCE.ROM_DATA = pce_rom.banks[0];
+        PCE.ROM_SIZE = pce_rom.count;
+    } else {
+        size_t rom_length = pce_osd_getromdata(&PCE.ROM);
+        int offset = rom_length & 0x1fff;
+        PCE.ROM_SIZE = (rom_length - offset) / 0x2000;
+        PCE.ROM_DATA = PCE.ROM + offset;
+        pce_rom_map(&pce_rom, PCE.ROM_DATA, PCE.ROM_SIZE * 0x2000, PCE_ROM_RAM, sizeof(PCE_ROM_RAM));
+
+        // Decoded at build time, but when compressed without its original.
+        // The reset vector of a US HuCard reads backwards.
+        if ((ROM_FLAGS & ROM_FLAG_PCE_US_ENCODED) || (ROM_CRC32 == 0 && PCE.ROM_SIZE > 0 && PCE.ROM_DATA[0x1FFF] < 0xE0)) {
+            printf("US Encrypted rom code\n");
+            if (!pce_rom_decode_us(&pce_rom))
+                return 1;
+        }
+    }
+       PCE.ROM_CRC = ROM_CRC32;
        
-       uint8_t IDX = 0;
+       uint16_t flags = ROM_FLAGS;
        uint8_t ROM_MASK = 1;
 
        while (ROM_MASK < PCE.ROM_SIZE) ROM_MASK <<= 1;
        ROM_MASK--;
 
-       printf("Rom Size: %d, B1:%X, B2:%X, B3:%X, B4:%X\n" , rom_length, PCE.ROM[0], PCE.ROM[1],PCE.ROM[2],PCE.ROM[3]);
-
-       for (int index = 0; index < KNOWN_ROM_COUNT; index++) {
-           if (PCE.ROM_CRC == pceRomFlags[index].crc) {
-               IDX = index;
-               break;
-           }
-       }
-
-       printf("Game Name: %s\n", pceRomFlags[IDX].Name);
-       printf("Game Region: %s\n", (pceRomFlags[IDX].Flags & JAP) ? "Japan" : "USA");
-
-       // US Encrypted
-    if ((pceRomFlags[IDX].Flags & US_ENCODED) || PCE.ROM_DATA[0x1FFF] < 0xE0) {
-
-		unsigned char inverted_nibble[16] = {
-			0, 8, 4, 12, 2, 10, 6, 14,
-			1, 9, 5, 13, 3, 11, 7, 15
-		};
-
-		for (int x = 0; x < PCE.ROM_SIZE * 0x2000; x++) {
-			unsigned char temp = PCE.ROM_DATA[x] & 15;
+       printf("Rom Size: %d, B1:%X, B2:%X, B3:%X, B4:%X\n" , PCE.ROM_SIZE, PCE.ROM_DATA[0], PCE.ROM_DATA[1], PCE.ROM_DATA[2], PCE.ROM_DATA[3]);
 
-			PCE.ROM_DATA[x] &= ~0x0F;
-			PCE.ROM_DATA[x] |= inverted_nibble[PCE.ROM_DATA[x] >> 4];
-
-			PCE.ROM_DATA[x] &= ~0xF0;
-			PCE.ROM_DATA[x] |= inverted_nibble[temp] << 4;
-		}
-    }
+       printf("Game CRC: %08X, flags: %X\n", PCE.ROM_CRC, flags);
+       printf("ROM: %d banks, %u bytes of RAM, loaded in %llu us\n", PCE.ROM_SIZE, pce_rom.ram_used,
+              (unsigned long long)(time_ns() - start) / 1000);
 
 	// For example with Devil Crush 512Ko
-    if (pceRomFlags[IDX].Flags & TWO_PART_ROM) 
+    if (flags & ROM_FLAG_PCE_TWO_PART_ROM) 
         PCE.ROM_SIZE = 0x30;
 
     // Game ROM
@@ -385,28 +409,28 @@ int LoadCard(const char *name) {
             case 0x00:
             case 0x10:
             case 0x50:
-                PCE.MemoryMapR[i] = PCE.ROM_DATA + (i & ROM_MASK) * 0x2000;
+                PCE.MemoryMapR[i] = pce_rom.banks[i & ROM_MASK];
                 break;
             case 0x20:
             case 0x60:
-                PCE.MemoryMapR[i] = PCE.ROM_DATA + ((i - 0x20) & ROM_MASK) * 0x2000;
+                PCE.MemoryMapR[i] = pce_rom.banks[(i - 0x20) & ROM_MASK];
                 break;
             case 0x30:
             case 0x70:
-                PCE.MemoryMapR[i] = PCE.ROM_DATA + ((i - 0x10) & ROM_MASK) * 0x2000;
+                PCE.MemoryMapR[i] = pce_rom.banks[(i - 0x10) & ROM_MASK];
                 break;
             case 0x40:
-                PCE.MemoryMapR[i] = PCE.ROM_DATA + ((i - 0x20) & ROM_MASK) * 0x2000;
+                PCE.MemoryMapR[i] = pce_rom.banks[(i - 0x20) & ROM_MASK];
                 break;
             }
         } else {
-            PCE.MemoryMapR[i] = PCE.ROM_DATA + (i & ROM_MASK) * 0x2000;
+            PCE.MemoryMapR[i] = pce_rom.banks[i & ROM_MASK];
         }
         PCE.MemoryMapW[i] = PCE.NULLRAM;
     }
 
     // Allocate the card's onboard ram
-    if (pceRomFlags[IDX].Flags & ONBOARD_RAM) {
+    if (flags & ROM_FLAG_PCE_ONBOARD_RAM) {
         PCE.ExRAM = PCE.ExRAM ?: PCE_EXRAM_BUF;
         PCE.MemoryMapR[0x40] = PCE.MemoryMapW[0x40] = PCE.ExRAM;
         PCE.MemoryMapR[0x41] = PCE.MemoryMapW[0x41] = PCE.ExRAM + 0x2000;
@@ -442,6 +466,58 @@ InitPCE(int samplerate, bool stereo, const char *huecard)
 	return 0;
 }
 
+// All the cheats are enabled on the host
+static bool cheat_enabled(int index)
+{
+    return true;
+}
+
+static uint8_t *cheat_ram(uint32_t addr, uint32_t size)
+{
+    return addr + size <= sizeof(PCE.RAM) ? PCE.RAM + addr : NULL;
+}
+
+// Like main_pce.c, the banks in the flash are copied to the RAM first
+static void cheat_rom(uint32_t addr, const uint8_t *data, uint32_t size)
+{
+    for (uint32_t x = 0; x < size && addr + x < pce_rom.count * PCE_ROM_BANK_SIZE; x++) {
+        uint32_t bank = (addr + x) / PCE_ROM_BANK_SIZE;
+        uint8_t *mapped = pce_rom.banks[bank];
+        uint8_t *block = pce_rom_writable(&pce_rom, bank);
+
+        if (block == NULL)
+            return;
+        if (block != mapped) {
+            for (int k = 0; k < 0x80; k++) {
+                if (PCE.MemoryMapR[k] == mapped)
+                    PCE.MemoryMapR[k] = block;
+            }
+        }
+        block[(addr + x) % PCE_ROM_BANK_SIZE] = data[x];
+    }
+}
+
+static void cheats_frame(void)
+{
+    uint64_t start = time_ns();
+    uint64_t ns;
+
+    cheats_apply(&cheats);
+    ns = time_ns() - start;
+
+    cheats_cost.frames++;
+    cheats_cost.total_ns += ns;
+    if (ns > cheats_cost.max_ns)
+        cheats_cost.max_ns = ns;
+
+    if (cheats_cost.frames == CHEATS_LOG_FRAMES) {
+        printf("cheats: %d RAM writes, %llu ns avg, %llu ns max per frame\n", cheats.count,
+               (unsigned long long)(cheats_cost.total_ns / cheats_cost.frames),
+               (unsigned long long)cheats_cost.max_ns);
+        memset(&cheats_cost, 0, sizeof(cheats_cost));
+    }
+}
+
 void init(void)
 {
     printf("init()\n");
@@ -457,6 +533,13 @@ void init(void)
 
     // Load ROM
     InitPCE(0,0,"game.pce");
+    pce_snd_init();
+
+    printf("cheats: %d cheats, %d ROM patches\n", cheats_count(CHEAT_TABLE),
+           cheats_patch_rom(CHEAT_TABLE, cheat_enabled, cheat_rom));
+    cheats_load(&cheats, CHEAT_TABLE, cheat_enabled, cheat_ram);
+    printf("cheats: %d RAM writes, %d dropped\n", cheats.count, cheats.dropped);
+    printf("ROM: %u bytes of RAM with the patched banks\n", pce_rom.ram_used);
 
     // Video
     memset(fb_data, 0, sizeof(fb_data));
@@ -649,8 +732,9 @@ int main(int argc, char *argv[])
         for (PCE.Scanline = 0; PCE.Scanline < 263; ++PCE.Scanline) {
             gfx_run();
         }
+        cheats_frame();
         pce_osd_gfx_blit(drawFrame);
-        //if(drawFrame) pce_pcm_submit();
+        if(drawFrame) pcm_submit();
 
         // Prevent overflow
         PCE.Timer.cycles_counter -= Cycles;
@@ -0,0 +1,273 @@
+/*
+ * Compares the fixed-point PSG mixer of Core/Src/porting/pce/sound_pce.c
+ * with the float stereo path it replaced, kept below as the reference.
+ *
+ * Random PSG states (wave, noise and DDA channels, the LFO off since the
+ * old path had none) are mixed by both paths for a few frames. The mono
+ * samples must stay within the bound documented in sound_pce.c, except
+ * where the old path wrapped around int16, and both paths must leave the
+ * channels in the same state.
+ *
+ *     make -f Makefile.pce sound_test
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <pce.h>
+#include "sound_pce.h"
+
+#define LENGTH  (PCE_SAMPLE_RATE / 60)
+#define TRIALS  2000
+#define FRAMES  4
+
+// Defined by pce.c in the emulator
+__typeof__(PCE) PCE;
+
+static const uint32_t ref_vol_tbl[32] = {
+    100  , 451  , 508  , 573   , 646   , 728   , 821   , 925   ,
+    1043 , 1175 , 1325 , 1493  , 1683  , 1898  , 2139  , 2411  ,
+    2718 , 3064 , 3454 , 3893  , 4388  , 4947  , 5576  , 6285  ,
+    7085 , 7986 , 9002 , 10148 , 11439 , 12894 , 14535 , 16384
+};
+
+static uint32_t ref_noise_rand[PSG_CHANNELS];
+static int32_t ref_noise_level[PSG_CHANNELS];
+// The DDA loop of the old path wrote up to 2 repeats past the end
+static int16_t ref_mix_buffer[LENGTH * 2 + 4];
+
+/*
+ * The old psg_update_chan(), stereo output at PCE_SAMPLE_RATE.
+ */
+static void
+ref_psg_update_chan(int16_t *buf, int ch, size_t dwSize)
+{
+    psg_chan_t *chan = &PCE.PSG.chan[ch];
+    int sample = 0;
+    uint32_t Tp;
+    int16_t *buf_end = buf + dwSize;
+
+    int lvol = (((chan->balance >>  4) * 1.1) * (chan->control & 0x1E)) / 32;
+    int rvol = (((chan->balance & 0xF) * 1.1) * (chan->control & 0x1E)) / 32;
+
+    lvol = ref_vol_tbl[lvol & 0x1F];
+    rvol = ref_vol_tbl[rvol & 0x1F];
+
+    if (chan->dda_count) {
+        int start = (int)chan->dda_index - chan->dda_count;
+        if (start < 0)
+            start += 0x100;
+
+        int repeat = 3;
+
+        while (buf < buf_end && (chan->dda_count || chan->control & PSG_DDA_ENABLE)) {
+            if (chan->dda_count) {
+                if ((sample = (chan->dda_data[(start++) & 0xFF] - 16)) >= 0)
+                    sample++;
+                chan->dda_count--;
+            }
+
+            for (int i = 0; i < repeat; i++) {
+                *buf++ = (sample * lvol) >> 8;
+                *buf++ = (sample * rvol) >> 8;
+            }
+        }
+    }
+
+    if (!(chan->control & PSG_CHAN_ENABLE)) {
+        chan->wave_accum = 0;
+    }
+    else if ((ch == 4 || ch == 5) && (chan->noise_ctrl & PSG_NOISE_ENABLE)) {
+        int Np = (chan->noise_ctrl & 0x1F);
+
+        while (buf < buf_end) {
+            chan->noise_accum += 3000 + Np * 512;
+
+            if ((Tp = (chan->noise_accum / PCE_SAMPLE_RATE)) >= 1) {
+                if (ref_noise_rand[ch] & 0x00080000) {
+                    ref_noise_rand[ch] = ((ref_noise_rand[ch] ^ 0x0004) << 1) + 1;
+                    ref_noise_level[ch] = -15;
+                } else {
+                    ref_noise_rand[ch] <<= 1;
+                    ref_noise_level[ch] = 15;
+                }
+                chan->noise_accum -= PCE_SAMPLE_RATE * Tp;
+            }
+
+            *buf++ = (ref_noise_level[ch] * lvol) >> 8;
+            *buf++ = (ref_noise_level[ch] * rvol) >> 8;
+        }
+    }
+    else if (chan->control & PSG_DDA_ENABLE) {
+
+    }
+    else if ((Tp = chan->freq_lsb + (chan->freq_msb << 8)) > 0) {
+        uint32_t fixed_inc = ((CLOCK_PSG / PCE_SAMPLE_RATE) << 16) / Tp;
+
+        while (buf < buf_end) {
+            if ((sample = (chan->wave_data[chan->wave_index] - 16)) >= 0)
+                sample++;
+
+            *buf++ = (sample * lvol) >> 8;
+            *buf++ = (sample * rvol) >> 8;
+
+            chan->wave_accum += fixed_inc;
+            chan->wave_accum &= 0x1FFFFF;
+            chan->wave_index = chan->wave_accum >> 16;
+        }
+    }
+
+    if (buf < buf_end) {
+        memset(buf, 0, (void*)buf_end - (void*)buf);
+    }
+}
+
+/*
+ * The old pce_snd_update() and the L+R mix of pce_pcm_submit(). `wrapped`
+ * is set for the samples where an int16 of the old path wrapped around.
+ */
+static void
+ref_snd_update(int16_t *output, unsigned length, int factor, bool *wrapped)
+{
+    int lvol = (PCE.PSG.volume >> 4);
+    int rvol = (PCE.PSG.volume & 0x0F);
+    int16_t stereo[LENGTH * 2];
+    int32_t wide[LENGTH * 2];
+
+    memset(stereo, 0, sizeof(stereo));
+    memset(wide, 0, sizeof(wide));
+
+    for (int i = 0; i < PSG_CHANNELS; i++) {
+        ref_psg_update_chan(ref_mix_buffer, i, length * 2);
+        for (int j = 0; j < length * 2; j += 2) {
+            stereo[j] += ref_mix_buffer[j] * lvol;
+            stereo[j + 1] += ref_mix_buffer[j + 1] * rvol;
+            wide[j] += ref_mix_buffer[j] * lvol;
+            wide[j + 1] += ref_mix_buffer[j + 1] * rvol;
+        }
+    }
+
+    for (int i = 0; i < length; i++) {
+        int32_t sample = ((stereo[i * 2] + stereo[i * 2 + 1]) * factor) >> 8;
+
+        wrapped[i] = stereo[i * 2] != wide[i * 2] || stereo[i * 2 + 1] != wide[i * 2 + 1] ||
+                     sample > INT16_MAX || sample < INT16_MIN;
+        output[i] = sample;
+    }
+}
+
+static void
+random_psg(void)
+{
+    memset(&PCE.PSG, 0, sizeof(PCE.PSG));
+    PCE.PSG.volume = rand() & 0xFF;
+
+    for (int ch = 0; ch < PSG_CHANNELS; ch++) {
+        psg_chan_t *chan = &PCE.PSG.chan[ch];
+
+        chan->control = rand() & 0xFF;
+        chan->balance = rand() & 0xFF;
+        chan->freq_lsb = rand() & 0xFF;
+        chan->freq_msb = rand() & 0x0F;
+        chan->noise_ctrl = rand() & 0x9F;
+        chan->wave_index = rand() & 0x1F;
+        chan->wave_accum = chan->wave_index << 16;
+        chan->dda_index = rand() & 0xFF;
+        chan->dda_count = (rand() & 3) == 0 ? rand() % 100 : 0;
+        for (int i = 0; i < 32; i++)
+            chan->wave_data[i] = rand() & 0x1F;
+        for (int i = 0; i < 256; i++)
+            chan->dda_data[i] = rand() & 0x1F;
+    }
+}
+
+static bool
+lfo_mute_test(void)
+{
+    int16_t output[LENGTH];
+
+    random_psg();
+    for (int ch = 0; ch < PSG_CHANNELS; ch++) {
+        PCE.PSG.chan[ch].control = 0;
+        PCE.PSG.chan[ch].dda_count = 0;
+    }
+    PCE.PSG.chan[0].control = PSG_CHAN_ENABLE | 0x1F;
+    PCE.PSG.chan[0].balance = 0xFF;
+    PCE.PSG.chan[0].freq_lsb = 0;
+    PCE.PSG.chan[0].freq_msb = 0;
+    PCE.PSG.volume = 0xFF;
+    PCE.PSG.lfo_ctrl = 1;
+
+    pce_snd_update(output, LENGTH, 127);
+    for (int i = 0; i < LENGTH; i++) {
+        if (output[i] != 0) {
+            printf("LFO: channel 0 heard with a period of 0\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    __typeof__(PCE.PSG) start, after;
+    int16_t output[LENGTH], expected[LENGTH];
+    bool wrapped[LENGTH];
+    int max_diff = 0, compared = 0, skipped = 0, failures = 0;
+
+    srand(argc > 1 ? atoi(argv[1]) : 1);
+
+    pce_snd_init();
+    ref_noise_rand[4] = 0x51F63101;
+    ref_noise_rand[5] = 0x1F631042;
+
+    for (int trial = 0; trial < TRIALS; trial++) {
+        // volume_tbl[] / 2, as pce_pcm_submit() passes it
+        int factor = (rand() % 256) / 2;
+        int bound = PSG_CHANNELS * 2 * 15 * factor / 256 + 1;
+
+        random_psg();
+
+        for (int frame = 0; frame < FRAMES; frame++) {
+            memcpy(&start, &PCE.PSG, sizeof(start));
+            pce_snd_update(output, LENGTH, factor);
+            memcpy(&after, &PCE.PSG, sizeof(after));
+
+            memcpy(&PCE.PSG, &start, sizeof(start));
+            ref_snd_update(expected, LENGTH, factor, wrapped);
+
+            if (memcmp(&after, &PCE.PSG, sizeof(after)) != 0) {
+                printf("trial %d frame %d: the channels diverged\n", trial, frame);
+                failures++;
+                break;
+            }
+
+            for (int i = 0; i < LENGTH; i++) {
+                int diff = abs(output[i] - expected[i]);
+
+                if (wrapped[i]) {
+                    skipped++;
+                    continue;
+                }
+                compared++;
+                if (diff > max_diff)
+                    max_diff = diff;
+                if (diff > bound) {
+                    printf("trial %d frame %d sample %d: %d instead of %d (factor %d)\n",
+                           trial, frame, i, output[i], expected[i], factor);
+                    failures++;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (!lfo_mute_test())
+        failures++;
+
+    printf("sound: %d samples compared, %d wrapped in the old path, max difference %d LSB, %d failures\n",
+           compared, skipped, max_diff, failures);
+    return failures ? 1 : 0;
+}
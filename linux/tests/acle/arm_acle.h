@@ -0,0 +1,43 @@
+/*
+ * Host versions of the ACLE intrinsics audio_mix.c uses, so its Cortex-M7
+ * DSP paths can be checked on the host as well.
+ */
+#pragma once
+
+#include <stdint.h>
+
+static inline int32_t __ssat(int32_t value, unsigned bits)
+{
+    int32_t max = (1 << (bits - 1)) - 1;
+
+    if (value > max)
+        return max;
+    if (value < -max - 1)
+        return -max - 1;
+    return value;
+}
+
+static inline int32_t bottom(uint32_t x) { return (int16_t)(x & 0xFFFF); }
+static inline int32_t top(uint32_t x)    { return (int16_t)(x >> 16); }
+
+static inline int32_t __smulbb(uint32_t a, uint32_t b) { return bottom(a) * bottom(b); }
+static inline int32_t __smultb(uint32_t a, uint32_t b) { return top(a) * bottom(b); }
+static inline int32_t __smlabb(uint32_t a, uint32_t b, int32_t acc) { return acc + bottom(a) * bottom(b); }
+static inline int32_t __smlatb(uint32_t a, uint32_t b, int32_t acc) { return acc + top(a) * bottom(b); }
+static inline int32_t __smuad(uint32_t a, uint32_t b) { return bottom(a) * bottom(b) + top(a) * top(b); }
+
+static inline uint32_t __ror(uint32_t x, uint32_t n)
+{
+    return n % 32 ? (x >> (n % 32)) | (x << (32 - n % 32)) : x;
+}
+
+// Bytes 0 and 2, sign extended to halfwords
+static inline uint32_t __sxtb16(uint32_t x)
+{
+    return ((uint32_t)(int16_t)(int8_t)(x & 0xFF) & 0xFFFF) | ((uint32_t)(int16_t)(int8_t)(x >> 16) << 16);
+}
+
+static inline uint32_t __sadd16(uint32_t a, uint32_t b)
+{
+    return ((bottom(a) + bottom(b)) & 0xFFFF) | ((uint32_t)(top(a) + top(b)) << 16);
+}
@@ -0,0 +1,230 @@
+/*
+ * Golden test of Core/Src/porting/audio_mix.c against the pcm_submit loops
+ * of the ports it replaced, kept below as the references.
+ *
+ * Random sources are mixed at random volumes, from misaligned buffers too.
+ * A kernel must give the sample of the old loop, or the saturated one
+ * where the old loop wrapped around int16. The Genesis loops divided where
+ * the kernels shift, they may differ by 1 LSB on negative samples.
+ *
+ * Built twice, with the plain C kernels and with the Cortex-M7 DSP ones
+ * (on the intrinsics of tests/acle/arm_acle.h):
+ *
+ *     make -f Makefile.tests
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_mix.h"
+
+#define LENGTH 800 // Longest half of audiobuffer_dma, PAL Genesis
+#define TRIALS 2000
+
+static int failures;
+static int compared;
+static int wrapped;
+
+static int16_t sat16(int64_t value)
+{
+    return value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : value;
+}
+
+// `expected` is what the old loop computed without the int16 store
+static bool check(const char *name, int trial, int i, int16_t output, int64_t expected, int tolerance)
+{
+    int64_t diff;
+
+    if (expected != (int16_t)expected) {
+        wrapped++;
+        diff = output - sat16(expected);
+        tolerance = 0;
+    } else {
+        compared++;
+        diff = output - expected;
+    }
+    if (diff > tolerance || diff < -tolerance) {
+        printf("%s trial %d sample %d: %d instead of %lld\n", name, trial, i, output, (long long)expected);
+        failures++;
+        return false;
+    }
+    return true;
+}
+
+static int16_t random_s16(void)
+{
+    // Loud sources now and then, to reach the saturation
+    return (rand() & 3) ? (rand() % 8192) - 4096 : (rand() & 0xFFFF) - 0x8000;
+}
+
+static int32_t random_volume(void)
+{
+    return (rand() & 7) ? rand() % 256 : 0;
+}
+
+// NES and GB: (sample * factor) >> 8
+static void test_s16(int trial)
+{
+    int16_t src[LENGTH + 1], out[LENGTH + 1];
+    int offset = rand() & 1, src_offset = rand() & 1, count = rand() % LENGTH;
+    int32_t factor = random_volume();
+
+    for (int i = 0; i < LENGTH + 1; i++)
+        src[i] = random_s16();
+    audio_mix_s16(out + offset, src + src_offset, count, factor, 8);
+    for (int i = 0; i < count; i++) {
+        int32_t sample = src[i + src_offset];
+        if (!check("s16", trial, i, out[i + offset], (sample * factor) >> 8, 0))
+            return;
+    }
+}
+
+// SMS: ((output[0][i] + output[1][i]) * factor) >> 8, factor = volume / 2
+static void test_s16_add(int trial)
+{
+    int16_t a[LENGTH + 1], b[LENGTH + 1], out[LENGTH + 1];
+    int offset = rand() & 1, a_offset = rand() & 1, b_offset = rand() & 1, count = rand() % LENGTH;
+    int32_t factor = random_volume() / 2;
+
+    for (int i = 0; i < LENGTH + 1; i++) {
+        a[i] = random_s16();
+        b[i] = random_s16();
+    }
+    audio_mix_s16_add(out + offset, a + a_offset, b + b_offset, count, factor, 8);
+    for (int i = 0; i < count; i++) {
+        int32_t sample = a[i + a_offset] + b[i + b_offset];
+        if (!check("s16_add", trial, i, out[i + offset], (sample * factor) >> 8, 0))
+            return;
+    }
+}
+
+// Genesis, filter off: ((ym[i] + sn[i]) * factor) / 512
+static void test_s16_add_div(int trial)
+{
+    int16_t ym[LENGTH], sn[LENGTH], out[LENGTH];
+    int count = rand() % LENGTH;
+    int32_t factor = random_volume();
+
+    for (int i = 0; i < LENGTH; i++) {
+        ym[i] = random_s16();
+        sn[i] = random_s16() / 4;
+    }
+    audio_mix_s16_add(out, ym, sn, count, factor, 9);
+    for (int i = 0; i < count; i++) {
+        if (!check("s16_add genesis", trial, i, out[i], ((ym[i] + sn[i]) * factor) / 512, 1))
+            return;
+    }
+}
+
+// WSV: (L + R) * factor on int8, factor = volume / 2
+static void test_s8_stereo(int trial)
+{
+    int8_t src[LENGTH * 2 + 4];
+    int16_t out[LENGTH + 1];
+    int offset = rand() & 1, src_offset = rand() & 3, count = rand() % LENGTH;
+    int32_t factor = random_volume() / 2;
+
+    for (int i = 0; i < LENGTH * 2 + 4; i++)
+        src[i] = rand();
+    audio_mix_s8_stereo(out + offset, src + src_offset, count, factor, 0);
+    for (int i = 0; i < count; i++) {
+        int32_t sample = src[src_offset + 2 * i] + src[src_offset + 2 * i + 1];
+        if (!check("s8_stereo", trial, i, out[i + offset], sample * factor, 0))
+            return;
+    }
+}
+
+// SMS/PCE style interleaved int16 stereo
+static void test_s16_stereo(int trial)
+{
+    int16_t src[LENGTH * 2 + 1], out[LENGTH];
+    int src_offset = rand() & 1, count = rand() % LENGTH;
+    int32_t factor = random_volume() / 2;
+
+    for (int i = 0; i < LENGTH * 2 + 1; i++)
+        src[i] = random_s16();
+    audio_mix_s16_stereo(out, src + src_offset, count, factor, 8);
+    for (int i = 0; i < count; i++) {
+        int32_t sample = src[src_offset + 2 * i] + src[src_offset + 2 * i + 1];
+        if (!check("s16_stereo", trial, i, out[i], (sample * factor) >> 8, 0))
+            return;
+    }
+}
+
+// A7800: ((sample << 8) * factor) >> 8, G&W: factor * (sample << 4)
+static void test_u8(int trial)
+{
+    uint8_t src[LENGTH];
+    int16_t out[LENGTH];
+    int count = rand() % LENGTH;
+    int32_t factor = random_volume();
+    bool gw = rand() & 1;
+
+    for (int i = 0; i < LENGTH; i++)
+        src[i] = gw ? rand() & 0x0F : rand();
+    audio_mix_u8(out, src, count, gw ? factor << 4 : factor, 0);
+    for (int i = 0; i < count; i++) {
+        int64_t expected = gw ? factor * (src[i] << 4) : ((int64_t)(src[i] << 8) * factor) >> 8;
+        if (!check(gw ? "u8 gw" : "u8 a7800", trial, i, out[i], expected, 0))
+            return;
+    }
+}
+
+// Genesis, filter on. The old filter kept its output in an int16 and its
+// sum in an int32, the comparison stops at the first one that wrapped.
+static void test_s16_add_lowpass(int trial)
+{
+    static const uint32_t factora = 0x1000;
+    static const uint32_t factorb = 0x10000 - factora;
+    int16_t ym[LENGTH], sn[LENGTH], out[LENGTH];
+    int32_t state = 0;
+    int64_t ref_out = 0;
+    int32_t factor = random_volume();
+
+    for (int frame = 0; frame < 4; frame++) {
+        int count = rand() % LENGTH;
+
+        for (int i = 0; i < count; i++) {
+            ym[i] = random_s16() / 2;
+            sn[i] = random_s16() / 8;
+        }
+        audio_mix_s16_add_lowpass(out, ym, sn, count, factor, 7, factora, &state);
+        for (int i = 0; i < count; i++) {
+            int64_t tmp = ref_out * factorb + (int64_t)(ym[i] + sn[i]) * factora;
+
+            if (tmp != (int32_t)tmp || (tmp >> 16) != (int16_t)(tmp >> 16)) {
+                wrapped += count - i;
+                return;
+            }
+            ref_out = tmp >> 16;
+            if (!check("s16_add_lowpass", trial, i, out[i], (ref_out * factor) / 128, 1))
+                return;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    srand(argc > 1 ? atoi(argv[1]) : 1);
+
+    for (int trial = 0; trial < TRIALS; trial++) {
+        test_s16(trial);
+        test_s16_add(trial);
+        test_s16_add_div(trial);
+        test_s8_stereo(trial);
+        test_s16_stereo(trial);
+        test_u8(trial);
+        test_s16_add_lowpass(trial);
+    }
+
+    printf("audio_mix%s: %d samples compared, %d saturated where the old loops wrapped, %d failures\n",
+#ifdef __ARM_FEATURE_DSP
+           " (DSP)",
+#else
+           "",
+#endif
+           compared, wrapped, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,258 @@
+/*
+ * Test of Core/Src/porting/audio_ring.c against a simulated SAI DMA.
+ *
+ * The DMA plays the two halves of the buffer in turn and calls
+ * audio_ring_consume() when it moves to the other one. A few scenarios
+ * check each case of audio_ring.h: blocks played in order, underrun with
+ * the next block faded in, overrun, late write and stop. A random run
+ * then interleaves the producer and the DMA and checks that every half
+ * started is a block played, an underrun or silence before the first
+ * block, and that every block written is played, overwritten, late or
+ * still pending. The interrupt must never touch the buffer.
+ *
+ *     make -f Makefile.tests
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_ring.h"
+
+#define LENGTH 800 // Longest half of audiobuffer_dma, PAL Genesis
+#define STEPS  200000
+
+static int failures;
+static int16_t buffer[LENGTH * 2];
+static audio_ring_t ring;
+static uint8_t dma_half; // Half being played
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("%s:%d: ", __func__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        failures++; \
+        return; \
+    } \
+} while (0)
+
+static void setup(void)
+{
+    memset(buffer, 0, sizeof(buffer));
+    audio_ring_init(&ring, buffer);
+    dma_half = ring.playing;
+}
+
+// The DMA reached the end of a half and starts the other one
+static void dma_next(void)
+{
+    static int16_t before[LENGTH * 2];
+
+    memcpy(before, buffer, sizeof(buffer));
+    dma_half ^= 1;
+    audio_ring_consume(&ring, dma_half);
+    if (memcmp(before, buffer, sizeof(buffer)) != 0) {
+        printf("audio_ring_consume() wrote to the buffer\n");
+        failures++;
+    }
+}
+
+static void fill(int16_t *dst, int16_t value)
+{
+    for (int i = 0; i < LENGTH; i++)
+        dst[i] = value;
+}
+
+static void write_block(int16_t value)
+{
+    fill(audio_ring_write_begin(&ring, LENGTH), value);
+    audio_ring_write_end(&ring);
+}
+
+static bool half_is(uint8_t half, int16_t value)
+{
+    for (int i = 0; i < LENGTH; i++) {
+        if (buffer[half * LENGTH + i] != value)
+            return false;
+    }
+    return true;
+}
+
+static void test_in_order(void)
+{
+    setup();
+    for (int16_t block = 1; block <= 100; block++) {
+        write_block(block);
+        dma_next();
+        CHECK(half_is(dma_half, block), "block %d not playing", block);
+    }
+    CHECK(ring.underruns == 0 && ring.overruns == 0 && ring.late_writes == 0,
+          "%u underruns %u overruns %u late writes", ring.underruns, ring.overruns, ring.late_writes);
+}
+
+static void test_underrun(void)
+{
+    setup();
+    write_block(1000);
+    dma_next();
+    write_block(2000);
+    dma_next();
+
+    // No block for the next half, it plays again what it held
+    dma_next();
+    CHECK(ring.underruns == 1, "%u underruns", ring.underruns);
+    CHECK(half_is(dma_half, 1000), "concealed half changed");
+    CHECK(ring.concealed, "not concealed");
+
+    write_block(3000);
+    uint8_t half = dma_half ^ 1;
+    CHECK(!ring.concealed, "still concealed after the next block");
+    CHECK(buffer[half * LENGTH] == 0, "first sample not faded in: %d", buffer[half * LENGTH]);
+    for (int i = 1; i < AUDIO_RING_FADE; i++)
+        CHECK(buffer[half * LENGTH + i] >= buffer[half * LENGTH + i - 1], "fade in not rising at %d", i);
+    CHECK(buffer[half * LENGTH + AUDIO_RING_FADE] == 3000, "fade in too long");
+
+    dma_next();
+    CHECK(ring.underruns == 1, "%u underruns after the next block", ring.underruns);
+}
+
+static void test_overrun(void)
+{
+    setup();
+    write_block(1);
+    write_block(2);
+    CHECK(ring.overruns == 1, "%u overruns", ring.overruns);
+    dma_next();
+    CHECK(half_is(dma_half, 2), "the newest block is not playing");
+    CHECK(ring.underruns == 0, "%u underruns", ring.underruns);
+}
+
+static void test_late_write(void)
+{
+    setup();
+    write_block(1);
+    dma_next();
+
+    int16_t *dst = audio_ring_write_begin(&ring, LENGTH);
+    // Same half while the DMA doesn't move
+    CHECK(audio_ring_write_begin(&ring, LENGTH) == dst, "write_begin moved to the other half");
+    fill(dst, 2);
+    dma_next();
+    audio_ring_write_end(&ring);
+    CHECK(ring.late_writes == 1, "%u late writes", ring.late_writes);
+    CHECK(ring.underruns == 1, "%u underruns", ring.underruns);
+    CHECK(!ring.filled[0] && !ring.filled[1], "late block counted as written");
+}
+
+static void test_stop(void)
+{
+    setup();
+    // Silence before the first block isn't an underrun
+    dma_next();
+    dma_next();
+    CHECK(ring.underruns == 0, "%u underruns before the first block", ring.underruns);
+
+    write_block(1);
+    dma_next();
+    audio_ring_stop(&ring);
+    for (int i = 0; i < 10; i++)
+        dma_next();
+    CHECK(ring.underruns == 0, "%u underruns while stopped", ring.underruns);
+
+    write_block(2);
+    dma_next();
+    CHECK(half_is(dma_half, 2), "block after stop not playing");
+}
+
+static uint32_t played, silent;
+static int16_t latest[2]; // Last block written to each half
+
+// dma_next() with the accounting of the random run
+static bool dma_step(int step)
+{
+    bool filled = ring.filled[dma_half ^ 1];
+    bool active = ring.active;
+    uint32_t underruns = ring.underruns;
+
+    dma_next();
+    if (filled) {
+        played++;
+        // Past the fade in, the block playing is the last one written to the half
+        if (buffer[dma_half * LENGTH + LENGTH - 1] != latest[dma_half]) {
+            printf("test_random step %d: half %d plays %d instead of %d\n", step, dma_half,
+                   buffer[dma_half * LENGTH + LENGTH - 1], latest[dma_half]);
+            failures++;
+            return false;
+        }
+    } else if (!active) {
+        silent++;
+    } else if (ring.underruns != underruns + 1) {
+        printf("test_random step %d: underrun not counted\n", step);
+        failures++;
+        return false;
+    }
+    return true;
+}
+
+static void test_random(void)
+{
+    uint32_t written = 0;
+    int16_t value = 0;
+
+    setup();
+    for (int step = 0; step < STEPS; step++) {
+        int action = rand() % 8;
+
+        if (action < 3) {
+            // A whole block
+            value = value == INT16_MAX ? 1 : value + 1;
+            latest[dma_half ^ 1] = value;
+            write_block(value);
+            written++;
+        } else if (action == 3) {
+            // A block the DMA may catch up with
+            int16_t *dst = audio_ring_write_begin(&ring, LENGTH);
+
+            value = value == INT16_MAX ? 1 : value + 1;
+            latest[dma_half ^ 1] = value;
+            fill(dst, value);
+            if ((rand() & 1) && !dma_step(step))
+                return;
+            audio_ring_write_end(&ring);
+            written++;
+        } else if (!dma_step(step)) {
+            return;
+        }
+    }
+
+    uint32_t pending = ring.filled[0] + ring.filled[1];
+    if (ring.blocks != played + ring.underruns + silent) {
+        printf("test_random: %u halves started, %u played, %u underruns, %u silent\n",
+               ring.blocks, played, ring.underruns, silent);
+        failures++;
+    }
+    if (written != played + ring.overruns + ring.late_writes + pending) {
+        printf("test_random: %u blocks written, %u played, %u overruns, %u late, %u pending\n",
+               written, played, ring.overruns, ring.late_writes, pending);
+        failures++;
+    }
+    printf("audio_ring: %u blocks written, %u played, %u underruns, %u overruns, %u late writes\n",
+           written, played, ring.underruns, ring.overruns, ring.late_writes);
+}
+
+int main(int argc, char *argv[])
+{
+    srand(argc > 1 ? atoi(argv[1]) : 1);
+
+    test_in_order();
+    test_underrun();
+    test_overrun();
+    test_late_write();
+    test_stop();
+    test_random();
+
+    printf("audio_ring: %d failures\n", failures);
+    return failures ? 1 : 0;
+}
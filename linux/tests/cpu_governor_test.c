@@ -0,0 +1,194 @@
+/*
+ * Test of Core/Src/porting/cpu_governor.c on simulated games.
+ *
+ * A game needs a fixed amount of work per frame, its busy time scales with
+ * the clock of the tier it runs at and a frame over its budget misses a
+ * deadline. For every amount of work and starting tier the governor must
+ * end locked on the lowest tier that keeps up, or stay on the highest
+ * allowed one when none does, without going over the overclocking
+ * setting. A few
+ * scenarios then check the cases of cpu_governor.h: a locked tier only
+ * goes up, stepping back up locks, late frames alone step up and a window
+ * dropped by cpu_governor_reset_window() decides nothing.
+ *
+ *     make -f Makefile.tests
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cpu_governor.h"
+
+#define FRAME_TIME_10US 1667 // 60Hz
+#define FRAMES          (64 * CPU_GOVERNOR_WINDOW)
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("%s:%d: ", __func__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        failures++; \
+        return; \
+    } \
+} while (0)
+
+// Busy time of `work` (in 10us at the lowest tier) at the given tier, with some noise
+static uint32_t busy_at(uint32_t work, uint8_t level)
+{
+    uint32_t busy = work * cpu_governor_mhz[0] / cpu_governor_mhz[level];
+
+    return busy + rand() % 20;
+}
+
+// Runs a game until it has run FRAMES frames, returns the number of tier changes
+static int run_game(cpu_governor_t *gov, uint32_t work)
+{
+    int changes = 0;
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+        uint32_t busy = busy_at(work, gov->level);
+        uint16_t missed = busy > FRAME_TIME_10US ? 1 : 0;
+        uint8_t level = cpu_governor_frame(gov, busy, FRAME_TIME_10US, missed);
+
+        if (level != gov->level) {
+            if (level > gov->max_level) {
+                printf("work %u: tier %d over the setting %d\n", work, level, gov->max_level);
+                failures++;
+            }
+            gov->level = level;
+            changes++;
+        }
+    }
+    return changes;
+}
+
+static void test_games(void)
+{
+    for (uint32_t work = 100; work <= 2200; work += 50) {
+        for (uint8_t max_level = 0; max_level < CPU_GOVERNOR_LEVELS; max_level++) {
+            for (uint8_t start = 0; start <= max_level; start++) {
+                cpu_governor_t gov;
+                uint8_t lowest = max_level;
+
+                // Lowest tier with the load under the thresholds, with the noise
+                for (int level = max_level; level >= 0; level--) {
+                    uint32_t busy = work * cpu_governor_mhz[0] / cpu_governor_mhz[level] + 20;
+
+                    if (1000 * busy > CPU_GOVERNOR_HIGH_PERMILLE * FRAME_TIME_10US)
+                        break;
+                    lowest = level;
+                }
+
+                cpu_governor_init(&gov, start, max_level, false);
+                int changes = run_game(&gov, work);
+
+                // Only an overloaded top tier keeps looking
+                CHECK(gov.locked || gov.level == max_level, "work %u tiers %d..%d: not locked",
+                      work, start, max_level);
+                CHECK(changes <= 2 * CPU_GOVERNOR_LEVELS, "work %u tiers %d..%d: %d changes",
+                      work, start, max_level, changes);
+                CHECK(gov.level >= lowest, "work %u tiers %d..%d: tier %d overloaded, %d keeps up",
+                      work, start, max_level, gov.level, lowest);
+                // Between the thresholds the governor may stay a tier higher
+                uint32_t busy = work * cpu_governor_mhz[0] / cpu_governor_mhz[lowest] + 20;
+                if (1000 * busy < CPU_GOVERNOR_LOW_PERMILLE * FRAME_TIME_10US)
+                    CHECK(gov.level == lowest, "work %u tiers %d..%d: tier %d instead of %d",
+                          work, start, max_level, gov.level, lowest);
+            }
+        }
+    }
+}
+
+static void window(cpu_governor_t *gov, uint32_t busy, uint16_t missed_per_window)
+{
+    for (int frame = 0; frame < CPU_GOVERNOR_WINDOW; frame++) {
+        uint8_t level = cpu_governor_frame(gov, busy, FRAME_TIME_10US, frame < missed_per_window);
+
+        if (level != gov->level)
+            gov->level = level;
+    }
+}
+
+static void test_init(void)
+{
+    cpu_governor_t gov;
+
+    cpu_governor_init(&gov, 2, 1, false);
+    CHECK(gov.level == 1, "tier %d over the setting", gov.level);
+    cpu_governor_init(&gov, 5, 7, true);
+    CHECK(gov.max_level == CPU_GOVERNOR_LEVELS - 1 && gov.level == CPU_GOVERNOR_LEVELS - 1,
+          "tier %d setting %d", gov.level, gov.max_level);
+    CHECK(gov.locked, "locked state lost");
+}
+
+static void test_locked(void)
+{
+    cpu_governor_t gov;
+
+    // Idle, but the tier was found for this game before
+    cpu_governor_init(&gov, 1, 2, true);
+    window(&gov, 100, 0);
+    CHECK(gov.level == 1, "locked tier stepped down to %d", gov.level);
+
+    window(&gov, FRAME_TIME_10US, 0);
+    CHECK(gov.level == 2, "locked tier overloaded, still at %d", gov.level);
+}
+
+static void test_step_back_up(void)
+{
+    cpu_governor_t gov;
+
+    cpu_governor_init(&gov, 1, 2, false);
+    window(&gov, FRAME_TIME_10US * 600 / 1000, 0);
+    CHECK(gov.level == 0 && !gov.locked, "tier %d locked %d after a light window", gov.level, gov.locked);
+
+    // The load didn't scale with the clock, or the game got heavier
+    window(&gov, FRAME_TIME_10US * 950 / 1000, 0);
+    CHECK(gov.level == 1 && gov.locked, "tier %d locked %d after stepping back up", gov.level, gov.locked);
+
+    window(&gov, FRAME_TIME_10US * 600 / 1000, 0);
+    CHECK(gov.level == 1, "locked tier stepped down to %d", gov.level);
+}
+
+static void test_missed(void)
+{
+    cpu_governor_t gov;
+
+    cpu_governor_init(&gov, 0, 2, true);
+    window(&gov, FRAME_TIME_10US / 2, CPU_GOVERNOR_WINDOW / 32);
+    CHECK(gov.level == 0, "stepped up on %d late frames", CPU_GOVERNOR_WINDOW / 32);
+    window(&gov, FRAME_TIME_10US / 2, CPU_GOVERNOR_WINDOW / 32 + 1);
+    CHECK(gov.level == 1, "tier %d with late frames", gov.level);
+}
+
+static void test_reset_window(void)
+{
+    cpu_governor_t gov;
+
+    cpu_governor_init(&gov, 0, 2, false);
+    // Fast forward, overloaded but never a whole window
+    for (int i = 0; i < 10; i++) {
+        for (int frame = 0; frame < CPU_GOVERNOR_WINDOW - 1; frame++)
+            CHECK(cpu_governor_frame(&gov, 2 * FRAME_TIME_10US, FRAME_TIME_10US, 1) == 0, "decided in a partial window");
+        cpu_governor_reset_window(&gov);
+    }
+    CHECK(gov.level == 0 && gov.settled == 0, "tier %d settled %d", gov.level, gov.settled);
+}
+
+int main(int argc, char *argv[])
+{
+    srand(argc > 1 ? atoi(argv[1]) : 1);
+
+    test_games();
+    test_init();
+    test_locked();
+    test_step_back_up();
+    test_missed();
+    test_reset_window();
+
+    printf("cpu_governor: %d failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,261 @@
+/*
+ * Simulation of the pipelined flashapp protocol of Core/Src/flashapp_slots.c.
+ *
+ * A stub of the debugger plays scripts/flashapp.sh: it waits for the slot
+ * of each chunk to be free, loads the chunk in LOAD_STEP steps raising
+ * program_slot_loaded, then fills in the descriptor and sets
+ * program_slot_ready. A model of flashapp_run() takes the chunks in order,
+ * checks their hash, programs them in pages into a fake flash and
+ * releases the slot. Both sides take turns at random.
+ *
+ * The debugger writes to memory, the flashapp only sees a range once
+ * flashapp_slots_invalidate() was called on it, as behind the D-cache. A
+ * range hashed without it hashes stale data and the chunk fails.
+ *
+ * The image must end up in flash. The flashapp must reject a chunk flagged
+ * ready before it was loaded. A chunk changed after it was loaded must be
+ * rejected, unless the flashapp hashed and programmed the data from before
+ * the change.
+ *
+ *     make -f Makefile.tests
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flashapp_slots.h"
+
+#define LOAD_STEP      (32 * 1024) // As in flashapp.sh
+#define SLOT_HASH_STEP (16 * 1024) // As in flashapp.c
+#define PAGE_SIZE      256
+#define IMAGE_SIZE     (3 * FLASHAPP_SLOT_SIZE + 12345)
+#define CHUNKS         ((IMAGE_SIZE + FLASHAPP_SLOT_SIZE - 1) / FLASHAPP_SLOT_SIZE)
+
+static int failures;
+
+static uint8_t image[IMAGE_SIZE];
+static uint8_t flash[IMAGE_SIZE];
+static uint8_t memory[FLASHAPP_SLOT_COUNT * FLASHAPP_SLOT_SIZE]; // Written by the debugger
+static uint8_t cached[FLASHAPP_SLOT_COUNT * FLASHAPP_SLOT_SIZE]; // Seen by the flashapp
+
+void flashapp_slots_invalidate(const void *addr, uint32_t size)
+{
+    size_t offset = (const uint8_t *)addr - cached;
+
+    if (offset + size > sizeof(cached)) {
+        printf("invalidate out of the slots: offset %zu size %u\n", offset, size);
+        failures++;
+        return;
+    }
+    memcpy(&cached[offset], &memory[offset], size);
+}
+
+typedef enum {
+    FAULT_NONE,
+    FAULT_READY_EARLY,   // Ready before the last step is loaded
+    FAULT_REWRITE,       // A byte changed after it was loaded
+} fault_t;
+
+static void hash_string(const uint8_t *data, size_t len, uint8_t hash_str[65])
+{
+    sha256_to_string(hash_str, data, len);
+}
+
+static void final_string(SHA256_CTX *sha256, uint8_t hash_str[65])
+{
+    uint8_t hash[32];
+
+    sha256_final(sha256, hash);
+    for (int i = 0; i < 32; i++)
+        sprintf((char *)&hash_str[i * 2], "%02x", hash[i]);
+}
+
+// The debugger side, one openocd command per step
+typedef struct {
+    uint32_t chunk;   // From 1
+    uint32_t offset;  // Loaded so far
+    fault_t fault;
+    uint32_t fault_chunk;
+} host_t;
+
+static uint32_t chunk_size(uint32_t chunk)
+{
+    uint32_t start = (chunk - 1) * FLASHAPP_SLOT_SIZE;
+
+    return IMAGE_SIZE - start < FLASHAPP_SLOT_SIZE ? IMAGE_SIZE - start : FLASHAPP_SLOT_SIZE;
+}
+
+static void host_step(host_t *host)
+{
+    if (host->chunk > CHUNKS)
+        return;
+
+    uint32_t slot = flashapp_slot_for_chunk(host->chunk);
+    uint32_t size = chunk_size(host->chunk);
+    uint8_t *dst = &memory[slot * FLASHAPP_SLOT_SIZE];
+    const uint8_t *src = &image[(host->chunk - 1) * FLASHAPP_SLOT_SIZE];
+    bool faulty = host->fault != FAULT_NONE && host->chunk == host->fault_chunk;
+
+    // wait_for_slot
+    if (host->offset == 0 && program_slot_ready[slot])
+        return;
+
+    if (host->offset < size && !(faulty && host->fault == FAULT_READY_EARLY && host->offset + LOAD_STEP >= size)) {
+        uint32_t len = size - host->offset < LOAD_STEP ? size - host->offset : LOAD_STEP;
+
+        memcpy(dst + host->offset, src + host->offset, len);
+        host->offset += len;
+        program_slot_loaded[slot] = host->offset;
+        return;
+    }
+
+    if (faulty && host->fault == FAULT_REWRITE)
+        dst[size / 3] ^= 0x55;
+
+    program_slot_size[slot] = size;
+    program_slot_address[slot] = (host->chunk - 1) * FLASHAPP_SLOT_SIZE;
+    program_slot_erase[slot] = 1;
+    program_slot_erase_bytes[slot] = size;
+    hash_string(src, size, program_slot_sha256[slot]);
+    program_slot_ready[slot] = 1;
+
+    host->chunk++;
+    host->offset = 0;
+}
+
+// The flashapp side, the states of flashapp_run() that matter here
+typedef enum {
+    DEVICE_IDLE,
+    DEVICE_PROGRAM,
+    DEVICE_DONE,
+    DEVICE_ERROR,
+} device_state_t;
+
+typedef struct {
+    device_state_t state;
+    uint32_t chunk;
+    int32_t slot;
+    uint32_t programmed;
+    uint8_t expected[65];
+} device_t;
+
+static void device_step(device_t *device)
+{
+    uint8_t calculated[65] = {0};
+
+    switch (device->state) {
+    case DEVICE_IDLE:
+        if (device->chunk > CHUNKS) {
+            device->state = DEVICE_DONE;
+            break;
+        }
+        if (!program_slot_ready[flashapp_slot_for_chunk(device->chunk)])
+            break;
+        device->slot = flashapp_slot_for_chunk(device->chunk);
+        memcpy(device->expected, program_slot_sha256[device->slot], sizeof(device->expected));
+
+        // FLASHAPP_CHECK_HASH_RAM
+        SHA256_CTX *sha256 = flashapp_slot_sha256(device->slot, program_slot_size[device->slot]);
+        if (sha256 != NULL)
+            final_string(sha256, calculated);
+        if (strncmp((char *)calculated, (char *)device->expected, 64) != 0) {
+            device->state = DEVICE_ERROR;
+            break;
+        }
+        device->programmed = 0;
+        device->state = DEVICE_PROGRAM;
+        break;
+    case DEVICE_PROGRAM: {
+        uint32_t size = program_slot_size[device->slot];
+        uint32_t len = size - device->programmed < PAGE_SIZE ? size - device->programmed : PAGE_SIZE;
+
+        memcpy(&flash[program_slot_address[device->slot] + device->programmed],
+               flashapp_slot_buffer(device->slot) + device->programmed, len);
+        device->programmed += len;
+        if (device->programmed < size)
+            break;
+
+        // FLASHAPP_CHECK_HASH_FLASH
+        hash_string(&flash[program_slot_address[device->slot]], size, calculated);
+        if (strncmp((char *)calculated, (char *)device->expected, 64) != 0) {
+            device->state = DEVICE_ERROR;
+            break;
+        }
+        flashapp_slot_release(device->slot);
+        device->chunk++;
+        device->state = DEVICE_IDLE;
+        break;
+    }
+    case DEVICE_DONE:
+    case DEVICE_ERROR:
+        break;
+    }
+
+    // flashapp_main() hashes the slots between the runs
+    if (device->state != DEVICE_ERROR) {
+        for (uint32_t slot = 0; slot < FLASHAPP_SLOT_COUNT; slot++)
+            flashapp_slot_hash(slot, SLOT_HASH_STEP);
+    }
+}
+
+static device_state_t run(fault_t fault, uint32_t fault_chunk, int host_weight)
+{
+    host_t host = {.chunk = 1, .fault = fault, .fault_chunk = fault_chunk};
+    device_t device = {.chunk = 1, .slot = -1};
+
+    memset(flash, 0xFF, sizeof(flash));
+    memset(memory, 0, sizeof(memory));
+    memset(cached, 0xAA, sizeof(cached));
+    flashapp_slots_init(cached);
+
+    for (int step = 0; step < 10000000; step++) {
+        if (rand() % 100 < host_weight)
+            host_step(&host);
+        else
+            device_step(&device);
+
+        if (device.state == DEVICE_DONE || device.state == DEVICE_ERROR)
+            return device.state;
+    }
+    return DEVICE_IDLE;
+}
+
+int main(int argc, char *argv[])
+{
+    static const int host_weights[] = {5, 30, 50, 90};
+
+    srand(argc > 1 ? atoi(argv[1]) : 1);
+    for (int i = 0; i < IMAGE_SIZE; i++)
+        image[i] = rand();
+
+    for (int w = 0; w < sizeof(host_weights) / sizeof(host_weights[0]); w++) {
+        device_state_t state = run(FAULT_NONE, 0, host_weights[w]);
+
+        if (state != DEVICE_DONE) {
+            printf("host weight %d: flashapp stopped in state %d\n", host_weights[w], state);
+            failures++;
+        } else if (memcmp(flash, image, sizeof(image)) != 0) {
+            printf("host weight %d: flash differs from the image\n", host_weights[w]);
+            failures++;
+        }
+
+        for (uint32_t chunk = 1; chunk <= CHUNKS; chunk++) {
+            if (run(FAULT_READY_EARLY, chunk, host_weights[w]) != DEVICE_ERROR) {
+                printf("host weight %d: chunk %u ready before it was loaded, not rejected\n", host_weights[w], chunk);
+                failures++;
+            }
+            // Rejected, or already hashed and programmed from the copy that was hashed
+            state = run(FAULT_REWRITE, chunk, host_weights[w]);
+            if (state != DEVICE_ERROR && (state != DEVICE_DONE || memcmp(flash, image, sizeof(image)) != 0)) {
+                printf("host weight %d: chunk %u changed after it was loaded, wrong data programmed\n",
+                       host_weights[w], chunk);
+                failures++;
+            }
+        }
+    }
+
+    printf("flashapp_slots: %d chunks of %d bytes, %d failures\n", CHUNKS, FLASHAPP_SLOT_SIZE, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * Simulation of Core/Src/porting/frame_sched.c against a clock.
+ *
+ * The interrupts of the SAI DMA and of the LTDC line event come at a fixed
+ * period, frames take a random time to emulate, some of them longer than
+ * the period. A loop like common_emu_sync_wait() wakes up at the first
+ * interrupt at or after its deadline. After every frame:
+ *  - each interrupt since the start is owned by a frame (skipped frames
+ *    and paused ones included) or counted as missed,
+ *  - a frame ready before its deadline is late for nothing, wakes up at
+ *    its deadline and its slack is the time it slept,
+ *  - a late frame doesn't wait and has no slack.
+ * The counter starts right before it wraps around.
+ *
+ * A last run checks the skip decision of the GB port: not rendering after
+ * a frame with no slack must not make more frames late.
+ *
+ *     make -f Makefile.tests
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "frame_sched.h"
+
+#define FRAMES 20000
+#define COUNTER_START 0xFFFFFF00u
+
+static int failures;
+
+typedef struct {
+    const char *name;
+    uint32_t period_us;  // Time between two interrupts
+    uint64_t now_us;
+    uint32_t counter;
+} sim_clock_t;
+
+static uint32_t sim_advance(sim_clock_t *clock, uint64_t us)
+{
+    uint64_t before = clock->now_us / clock->period_us;
+
+    clock->now_us += us;
+    clock->counter += clock->now_us / clock->period_us - before;
+    return clock->counter;
+}
+
+static bool fail(const sim_clock_t *clock, int frame, const char *what)
+{
+    printf("%s frame %d: %s\n", clock->name, frame, what);
+    failures++;
+    return false;
+}
+
+// Random emulation time, `load` percent of the period on average
+static uint32_t random_work(const sim_clock_t *clock, int load)
+{
+    uint32_t average = clock->period_us * load / 100;
+
+    // Now and then a frame much longer than the others
+    if ((rand() % 50) == 0)
+        return average * 3;
+    return average / 2 + rand() % average;
+}
+
+static bool run(sim_clock_t *clock, int load, bool fast_forward, uint32_t *late_frames)
+{
+    frame_sched_t sched = {0};
+    uint32_t owned = 0;     // Interrupts owned by the frames so far
+    uint32_t start = COUNTER_START;
+
+    clock->now_us = 0;
+    clock->counter = COUNTER_START;
+    *late_frames = 0;
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+        sim_advance(clock, random_work(clock, load));
+
+        int action = rand() % 16;
+        if (sched.frames > 0 && action == 0) {
+            frame_sched_skip(&sched, clock->counter, !fast_forward);
+            if (fast_forward) {
+                // The interrupts so far are nobody's, start over from here
+                owned = clock->counter - start - sched.missed;
+            } else {
+                owned++;
+            }
+            continue;
+        }
+
+        uint8_t deadlines = action == 1 ? 2 : 1;  // Pausing
+        if (sched.frames == 0) {
+            // The interrupts before the first frame are nobody's
+            start = clock->counter;
+        }
+        uint32_t ready = clock->counter;
+        uint32_t target = frame_sched_begin(&sched, ready, deadlines);
+        uint64_t ready_us = clock->now_us;
+
+        if (!frame_sched_reached(clock->counter, target)) {
+            // Wakes up at the interrupt that reaches the deadline
+            uint64_t wake_us = (clock->now_us / clock->period_us + (target - clock->counter)) * clock->period_us;
+            sim_advance(clock, wake_us - clock->now_us);
+        }
+        frame_sched_end(&sched, clock->counter, (clock->now_us - ready_us) / 1000);
+        owned += deadlines;
+
+        if (sched.late) {
+            (*late_frames)++;
+            if (clock->counter - ready != deadlines - 1)
+                return fail(clock, frame, "late frame waited");
+            if (sched.slack_ms != 0)
+                return fail(clock, frame, "late frame has slack");
+        } else {
+            if (clock->counter != target)
+                return fail(clock, frame, "woke up past the deadline");
+            if (sched.slack_ms != (clock->now_us - ready_us) / 1000)
+                return fail(clock, frame, "slack is not the time slept");
+        }
+        if (frame_sched_has_slack(&sched, 1) != (!sched.late && clock->now_us - ready_us >= 1000))
+            return fail(clock, frame, "has_slack disagrees with the slack");
+        if (clock->counter - start != owned + sched.missed)
+            return fail(clock, frame, "interrupt neither owned nor missed");
+        if (sched.last_counter != clock->counter)
+            return fail(clock, frame, "last counter is not the counter");
+    }
+
+    if (sched.frames == 0 || clock->counter >= COUNTER_START)
+        return fail(clock, FRAMES, "counter didn't wrap around");
+    return true;
+}
+
+// GB loop: 2ms of rendering, not done after a frame with less than 1ms slack
+static uint32_t run_gb(sim_clock_t *clock, bool skip_on_slack)
+{
+    frame_sched_t sched = {0};
+    uint32_t late_frames = 0;
+
+    clock->now_us = 0;
+    clock->counter = COUNTER_START;
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+        bool draw = !skip_on_slack || sched.frames < 2 || frame_sched_has_slack(&sched, 1);
+        uint64_t ready_us;
+
+        sim_advance(clock, random_work(clock, 80) + (draw ? 2000 : 0));
+        ready_us = clock->now_us;
+
+        uint32_t target = frame_sched_begin(&sched, clock->counter, 1);
+        if (!frame_sched_reached(clock->counter, target)) {
+            uint64_t wake_us = (clock->now_us / clock->period_us + (target - clock->counter)) * clock->period_us;
+            sim_advance(clock, wake_us - clock->now_us);
+        }
+        frame_sched_end(&sched, clock->counter, (clock->now_us - ready_us) / 1000);
+        late_frames += sched.late;
+    }
+    return late_frames;
+}
+
+int main(int argc, char *argv[])
+{
+    sim_clock_t clocks[] = {
+        {"SAI 60Hz", 16667},
+        {"SAI 50Hz", 20000},
+        {"LTDC", 16949},
+    };
+    static const int loads[] = {50, 90, 110, 150};
+
+    srand(argc > 1 ? atoi(argv[1]) : 1);
+
+    for (int c = 0; c < sizeof(clocks) / sizeof(clocks[0]); c++) {
+        for (int l = 0; l < sizeof(loads) / sizeof(loads[0]); l++) {
+            for (int ff = 0; ff < 2; ff++) {
+                uint32_t late_frames;
+
+                if (run(&clocks[c], loads[l], ff, &late_frames))
+                    printf("%s load %d%%%s: %u late frames\n", clocks[c].name, loads[l],
+                           ff ? " fast forward" : "", late_frames);
+            }
+        }
+    }
+
+    sim_clock_t gb_clock = {"GB", 16667};
+    uint32_t late_always = run_gb(&gb_clock, false);
+    uint32_t late_slack = run_gb(&gb_clock, true);
+    printf("GB: %u late frames always rendering, %u skipping on slack\n", late_always, late_slack);
+    if (late_slack > late_always) {
+        printf("GB: skipping on slack makes more frames late\n");
+        failures++;
+    }
+
+    printf("frame_sched: %d failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * Test of Core/Src/gw_arena.c on regions at every misalignment.
+ *
+ * Random allocations, marks and releases run against a model of the
+ * region: every pointer must be aligned to GW_ARENA_ALIGN, inside the
+ * region and clear of the live allocations, an allocation may only fail
+ * when it wouldn't fit, and releasing to a mark must give the same
+ * pointers again. The usage of the tags must add up to the usage of the
+ * region, also once the tag and record tables are full.
+ *
+ *     make -f Makefile.tests
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gw_arena.h"
+
+#define REGION_SIZE 4096
+#define STEPS       20000
+#define MAX_LIVE    256
+
+static int failures;
+static uint8_t memory[REGION_SIZE + GW_ARENA_ALIGN] __attribute__((aligned(GW_ARENA_ALIGN)));
+
+static const char *const tag_names[] = {
+    "cpu", "ppu", "apu", "rom", "ram", "vram", "sram", "state", "lut", "fb",
+    "audio", "mapper", "cheats", "netplay", "overlay", "rewind", "misc", "save", "tmp", "z80",
+};
+
+typedef struct {
+    uint8_t *ptr;
+    size_t size;
+    uint8_t fill;
+} live_t;
+
+static live_t live[MAX_LIVE];
+static size_t live_count;
+
+#define FAIL(...) do { \
+    printf("misalignment %d step %d: ", misalignment, step); \
+    printf(__VA_ARGS__); \
+    printf("\n"); \
+    failures++; \
+    return; \
+} while (0)
+
+static void run(int misalignment)
+{
+    uint8_t *base = memory + misalignment;
+    size_t size = REGION_SIZE - (rand() % 64);
+    gw_arena_t arena;
+    size_t marks[8];
+    size_t mark_live[8];
+    size_t mark_count = 0;
+    int step = 0;
+
+    gw_arena_init(&arena, "test", base, size);
+    live_count = 0;
+
+    for (step = 0; step < STEPS; step++) {
+        int action = rand() % 10;
+
+        if (action < 6 && live_count < MAX_LIVE) {
+            size_t length = (rand() & 3) ? rand() % 64 : rand() % 1024;
+            const char *tag = tag_names[rand() % (sizeof(tag_names) / sizeof(tag_names[0]))];
+            uintptr_t next = ((uintptr_t)&base[arena.used] + GW_ARENA_ALIGN - 1) & ~(uintptr_t)(GW_ARENA_ALIGN - 1);
+            size_t rounded = (length + GW_ARENA_ALIGN - 1) & ~(size_t)(GW_ARENA_ALIGN - 1);
+            uint8_t *ptr = gw_arena_alloc(&arena, length, tag);
+
+            if (ptr == NULL) {
+                // Sizes are rounded up to the alignment too
+                if (next + rounded <= (uintptr_t)&base[size])
+                    FAIL("%zu bytes with %zu free not allocated", length, gw_arena_free(&arena));
+                continue;
+            }
+            if ((uintptr_t)ptr & (GW_ARENA_ALIGN - 1))
+                FAIL("%p not aligned", (void *)ptr);
+            if (ptr < base || ptr + length > base + size)
+                FAIL("%zu bytes at %p out of the region", length, (void *)ptr);
+            for (size_t i = 0; i < live_count; i++) {
+                if (ptr < live[i].ptr + live[i].size && live[i].ptr < ptr + length)
+                    FAIL("%p overlaps a live allocation", (void *)ptr);
+            }
+            for (size_t i = 0; i < live_count; i++) {
+                for (size_t j = 0; j < live[i].size; j++) {
+                    if (live[i].ptr[j] != live[i].fill)
+                        FAIL("live allocation overwritten");
+                }
+            }
+            live[live_count].ptr = ptr;
+            live[live_count].size = length;
+            live[live_count].fill = rand();
+            memset(ptr, live[live_count].fill, length);
+            live_count++;
+        } else if (action < 8 && mark_count < 8) {
+            marks[mark_count] = gw_arena_mark(&arena);
+            mark_live[mark_count] = live_count;
+            mark_count++;
+        } else if (mark_count > 0) {
+            // Release to a random mark, the next allocation gets the same pointer again
+            size_t m = rand() % mark_count;
+            uint8_t *again;
+
+            gw_arena_release(&arena, marks[m]);
+            live_count = mark_live[m];
+            mark_count = m;
+            if (gw_arena_mark(&arena) != marks[m])
+                FAIL("released to %zu instead of %zu", gw_arena_mark(&arena), marks[m]);
+
+            again = gw_arena_alloc(&arena, 1, "again");
+            if (again != NULL) {
+                gw_arena_release(&arena, marks[m]);
+                if (gw_arena_alloc(&arena, 1, "again") != again)
+                    FAIL("released memory not served again");
+                gw_arena_release(&arena, marks[m]);
+            }
+        } else {
+            gw_arena_release(&arena, 0);
+            live_count = 0;
+            if (arena.used != 0 || arena.session_peak != 0)
+                FAIL("release to 0 left %zu used", arena.used);
+        }
+
+        size_t tags_used = 0;
+        for (size_t i = 0; i < arena.tag_count; i++) {
+            tags_used += arena.tags[i].used;
+            if (arena.tags[i].used > arena.tags[i].peak)
+                FAIL("tag %s above its peak", arena.tags[i].name);
+        }
+        if (tags_used != arena.used)
+            FAIL("tags use %zu, region %zu", tags_used, arena.used);
+        if (arena.tag_count > GW_ARENA_MAX_TAGS || arena.alloc_count > GW_ARENA_MAX_ALLOCS)
+            FAIL("%zu tags %zu records", arena.tag_count, arena.alloc_count);
+        if (arena.used > size || arena.peak < arena.used || arena.session_peak < arena.used)
+            FAIL("used %zu peak %zu session peak %zu of %zu", arena.used, arena.peak, arena.session_peak, size);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    srand(argc > 1 ? atoi(argv[1]) : 1);
+
+    for (int misalignment = 0; misalignment < GW_ARENA_ALIGN; misalignment++)
+        run(misalignment);
+
+    printf("gw_arena: %d failures\n", failures);
+    return failures ? 1 : 0;
+}
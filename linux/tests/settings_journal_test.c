@@ -0,0 +1,236 @@
+/*
+ * Power loss test of Core/Src/porting/settings_journal.c.
+ *
+ * The journal runs on a fake 2x4K NOR flash: an erase sets the bytes to
+ * 0xFF, a program can only clear bits. A reference run counts the flash
+ * operations of a sequence of commits, going through several compactions.
+ * The sequence is then replayed with the power cut at each operation,
+ * before it, halfway through it and right after it. After every cut, the
+ * image loaded must be the last one committed or the one being committed,
+ * and the journal must go on committing from there.
+ *
+ *     make -f Makefile.tests
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "settings_journal.h"
+
+#define IMAGE_SIZE 2688 // The settings image, 224 entries of 12 bytes
+#define COMMITS    64
+#define RECOVERY   24 // Commits after the power is back
+#define VERSION    7
+
+typedef enum {
+    CUT_BEFORE,
+    CUT_HALFWAY,
+    CUT_AFTER,
+    CUT_MODES,
+} cut_mode_t;
+
+static uint8_t flash[SETTINGS_JOURNAL_BANKS * SETTINGS_JOURNAL_BANK_SIZE];
+static uint32_t flash_ops;   // Operations since the flash was powered
+static int32_t cut_at = -1;  // Operation the power is cut at, -1 for never
+static cut_mode_t cut_mode;
+static bool powered;
+
+static uint8_t images[COMMITS][IMAGE_SIZE];
+
+// True when the operation is carried out, `*size` is what is done of it
+static bool flash_op(uint32_t *size)
+{
+    uint32_t op = flash_ops++;
+
+    if (!powered)
+        return false;
+    if (op != cut_at)
+        return true;
+
+    powered = false;
+    if (cut_mode == CUT_BEFORE)
+        return false;
+    if (cut_mode == CUT_HALFWAY)
+        *size /= 2;
+    return true;
+}
+
+static void fake_erase(uint32_t offset, uint32_t size)
+{
+    if (offset % SETTINGS_JOURNAL_BANK_SIZE || size != SETTINGS_JOURNAL_BANK_SIZE) {
+        printf("erase of %u bytes at %u isn't a bank\n", size, offset);
+        exit(1);
+    }
+    if (flash_op(&size))
+        memset(&flash[offset], 0xFF, size);
+}
+
+static void fake_program(uint32_t offset, const void *data, uint32_t size)
+{
+    const uint8_t *bytes = data;
+
+    if (offset + size > sizeof(flash)) {
+        printf("program of %u bytes at %u is out of the flash\n", size, offset);
+        exit(1);
+    }
+    if (!flash_op(&size))
+        return;
+    for (uint32_t i = 0; i < size; i++)
+        flash[offset + i] &= bytes[i];
+}
+
+static const settings_journal_flash_t fake_flash = {
+    .banks = {flash, flash + SETTINGS_JOURNAL_BANK_SIZE},
+    .erase = fake_erase,
+    .program = fake_program,
+};
+
+// A few settings change at each commit, now and then a lot of them
+static void make_images(void)
+{
+    srand(1);
+    memset(images[0], 0, IMAGE_SIZE);
+    for (int i = 1; i < COMMITS; i++) {
+        int changes = (i % 16 == 0) ? 400 : 1 + rand() % 6;
+
+        memcpy(images[i], images[i - 1], IMAGE_SIZE);
+        for (int j = 0; j < changes; j++)
+            images[i][rand() % IMAGE_SIZE] = rand();
+    }
+}
+
+// Commits images[from..to) one after the other
+static void run(settings_journal_t *journal, uint8_t *committed, int from, int to)
+{
+    for (int i = from; i < to; i++) {
+        uint8_t image[IMAGE_SIZE];
+
+        memcpy(image, images[i], IMAGE_SIZE);
+        settings_journal_commit(journal, image, committed);
+    }
+}
+
+static bool boot(settings_journal_t *journal, uint8_t *committed)
+{
+    memset(committed, 0xAA, IMAGE_SIZE);
+    return settings_journal_load(journal, &fake_flash, committed, IMAGE_SIZE, VERSION);
+}
+
+// Index of the image `data` is, the newest one first, -1 for none
+static int find_image(const uint8_t *data, int newest)
+{
+    for (int i = newest; i >= 0; i--) {
+        if (memcmp(data, images[i], IMAGE_SIZE) == 0)
+            return i;
+    }
+    return -1;
+}
+
+// Commit in progress at each flash operation of the reference run
+static int op_commit[COMMITS * 64];
+
+static uint32_t reference_run(void)
+{
+    settings_journal_t journal;
+    uint8_t committed[IMAGE_SIZE];
+
+    memset(flash, 0xFF, sizeof(flash));
+    flash_ops = 0;
+    cut_at = -1;
+    powered = true;
+
+    boot(&journal, committed);
+    for (int i = 0; i < COMMITS; i++) {
+        uint32_t start = flash_ops;
+
+        run(&journal, committed, i, i + 1);
+        for (uint32_t op = start; op < flash_ops; op++) {
+            if (op >= sizeof(op_commit) / sizeof(op_commit[0])) {
+                printf("more flash operations than expected\n");
+                exit(1);
+            }
+            op_commit[op] = i;
+        }
+    }
+    return flash_ops;
+}
+
+static bool cut_test(uint32_t op, cut_mode_t mode)
+{
+    static const char *modes[] = {"before", "halfway", "after"};
+    settings_journal_t journal;
+    uint8_t committed[IMAGE_SIZE];
+    int commit = op_commit[op];
+    int loaded;
+
+    memset(flash, 0xFF, sizeof(flash));
+    flash_ops = 0;
+    cut_at = op;
+    cut_mode = mode;
+    powered = true;
+
+    boot(&journal, committed);
+    run(&journal, committed, 0, COMMITS);
+
+    // Power back
+    powered = true;
+    cut_at = -1;
+    if (!boot(&journal, committed)) {
+        // Only the first snapshot can be missing
+        if (commit != 0) {
+            printf("op %u %s, commit %d: nothing loaded\n", op, modes[mode], commit);
+            return false;
+        }
+        loaded = -1;
+    } else {
+        loaded = find_image(committed, commit);
+        if (loaded < 0 || loaded < commit - 1) {
+            printf("op %u %s, commit %d: loaded image %d\n", op, modes[mode], commit, loaded);
+            return false;
+        }
+    }
+
+    // The journal goes on from what it loaded, with other changes than the
+    // ones cut. Each commit is there at the next boot.
+    uint8_t image[IMAGE_SIZE];
+    uint32_t seed = op * CUT_MODES + mode;
+
+    memcpy(image, loaded >= 0 ? images[loaded] : images[0], IMAGE_SIZE);
+    for (int i = 0; i < RECOVERY; i++) {
+        settings_journal_t check;
+        uint8_t loaded_image[IMAGE_SIZE];
+
+        for (int j = 0; j < 4; j++) {
+            seed = seed * 1103515245 + 12345;
+            image[(seed >> 8) % IMAGE_SIZE] ^= 1 + (seed >> 24) % 255;
+        }
+        settings_journal_commit(&journal, image, committed);
+        if (!boot(&check, loaded_image) || memcmp(loaded_image, image, IMAGE_SIZE) != 0) {
+            printf("op %u %s, commit %d: lost commit %d after the power loss\n", op, modes[mode], commit, i);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t ops;
+    int failures = 0;
+
+    make_images();
+    ops = reference_run();
+
+    for (uint32_t op = 0; op < ops; op++) {
+        for (cut_mode_t mode = 0; mode < CUT_MODES; mode++) {
+            if (!cut_test(op, mode))
+                failures++;
+        }
+    }
+
+    printf("settings_journal: %d commits, %u flash operations, %u power cuts, %d failures\n",
+           COMMITS, ops, ops * CUT_MODES, failures);
+    return failures ? 1 : 0;
+}
@@ -1,8 +1,9 @@
 #!/bin/bash
 
 if [[ $# -lt 1 ]]; then
-    echo "Usage: $0 <pce_rom.pce> [pce_rom.c]"
+    echo "Usage: $0 <pce_rom.pce> [pce_rom.c] [lz4|zopfli|lzma]"
     echo "This will convert the pc engine rom into a .c file and update all the references"
+    echo "The rom is laid out like parse_roms.py does, compressed bank by bank if asked"
     exit 1
 fi
 
@@ -17,15 +18,36 @@ if [[ $# -gt 1 ]]; then
     OUTFILE=$2
 fi
 
-SIZE=$(wc -c "$INFILE" | awk '{print $1}')
+COMPRESS=""
+extension="${INFILE##*.}"
+if [[ $# -gt 2 ]]; then
+    COMPRESS="--compress $3"
+    extension=$3
+fi
+
+# Without its header and decoded, see tools/pce_rom.py
+ROMFILE=$(mktemp)
+DEFINES=$(python3 "$(dirname "$0")/../tools/pce_rom.py" "$INFILE" -o "$ROMFILE" $COMPRESS --c-defines) || exit 1
+
+SIZE=$(wc -c "$ROMFILE" | awk '{print $1}')
 
 echo "const unsigned char ROM_DATA[] __attribute__((section (\".extflash_game_rom\"))) = {" > $OUTFILE
-xxd -i < "$INFILE" >> $OUTFILE
+xxd -i < "$ROMFILE" >> $OUTFILE
+rm "$ROMFILE"
 echo "};" >> $OUTFILE
 echo "unsigned int ROM_DATA_LENGTH = $SIZE;" >> $OUTFILE
 echo "unsigned int cart_rom_len = $SIZE;" >> $OUTFILE
 
-extension="${INFILE##*.}"
 echo "const char *ROM_EXT = \"$extension\";" >> $OUTFILE
 
+# Cheats of the .pceplus file next to the rom, if any
+CHEATS="${INFILE%.*}.pceplus"
+if [[ ! -e "$CHEATS" ]]; then
+    CHEATS=/dev/null
+fi
+python3 "$(dirname "$0")/../tools/cheat_table.py" "$CHEATS" --c-array CHEAT_TABLE >> $OUTFILE
+
+# CRC and flags of the rom, found at build time like in parse_roms.py
+echo "$DEFINES" >> $OUTFILE
+
 echo "Done!"
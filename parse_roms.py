@@ -1,6 +1,7 @@
 #!/usr/bin/env python3
 import argparse
 import hashlib
+import json
 import os
 import shutil
 import struct
@@ -10,6 +11,8 @@ from pathlib import Path
 from tempfile import TemporaryDirectory
 from typing import List
 
+from tools import cheat_table, pce_rom, rom_patch, romdb
+
 try:
     from tqdm import tqdm
 except ImportError:
@@ -22,9 +25,17 @@ const retro_emulator_file_t {name}[] EMU_DATA = {{
 const uint32_t {name}_count = {rom_count};
 """
 
-# Note: this value is not easily changed as it's assumed in some memory optimizations
+# Of the .ggcodes and .mcf files, applied by the emulator cores. The .pceplus
+# cheats are compiled into a cheat table (tools/cheat_table.py), unlimited.
 MAX_CHEAT_CODES = 16
 
+# Patched and compressed ROMs by the hash of their inputs, see
+# ROMParser._build_rom(). outputs.json holds the key of each compressed ROM
+# written next to its original, an output with another key is stale.
+ROM_CACHE_DIR = Path("build/rom_cache")
+ROM_CACHE_MANIFEST = ROM_CACHE_DIR / "outputs.json"
+ROM_CACHE_VERSION = 2
+
 ROM_ENTRY_TEMPLATE = """\t{{
 #if CHEAT_CODES == 1
 \t\t.id = {rom_id},
@@ -43,10 +54,15 @@ ROM_ENTRY_TEMPLATE = """\t{{
 \t\t.region = {region},
 \t\t.mapper = {mapper},
 \t\t.game_config = {game_config},
+\t\t.crc32 = {crc32},
+\t\t.flags = {flags},
+\t\t.legacy_crc32 = {legacy_crc32},
+\t\t.patches = {patches},
 #if CHEAT_CODES == 1
 \t\t.cheat_codes = {cheat_codes},
 \t\t.cheat_descs = {cheat_descs},
 \t\t.cheat_count = {cheat_count},
+\t\t.cheat_table = {cheat_table},
 #endif
 \t}},"""
 
@@ -97,6 +113,7 @@ SAVE_SIZES = {
 # TODO: Find a better way to find this before building
 MAX_COMPRESSED_NES_SIZE = 0x00081000
 MAX_COMPRESSED_PCE_SIZE = 0x00049000
+PCE_CHEAT_BANKS = 4  # Of the PCE RAM, left for the banks patched by cheats
 MAX_COMPRESSED_WSV_SIZE = 0x00080000
 MAX_COMPRESSED_SG_COL_SIZE = 60 * 1024
 MAX_COMPRESSED_A7800_SIZE = 131200
@@ -278,6 +295,44 @@ def compress_lzma(data, level=None):
 
     return compressed_data
 
+def decompress(data, compression):
+    """`data` as it was before ``compress_<compression>``, None when it can't be decoded."""
+    compression = compression.lstrip(".")
+    try:
+        if compression == "lzma":
+            import lzma
+
+            # The header compress_lzma() strips, the LZMA1 defaults of preset 6
+            decompressor = lzma.LZMADecompressor(
+                format=lzma.FORMAT_RAW,
+                filters=[{"id": lzma.FILTER_LZMA1, "preset": 6, "dict_size": 16 * 1024}],
+            )
+            return decompressor.decompress(data)
+        if compression == "zopfli":
+            import zlib
+
+            return zlib.decompress(data, wbits=-15)
+        if compression == "lz4":
+            try:
+                import lz4.frame as lz4
+
+                return lz4.decompress(data)
+            except ImportError:
+                pass
+            lz4_path = os.environ["LZ4_PATH"] if "LZ4_PATH" in os.environ else "lz4"
+            if not shutil.which(lz4_path):
+                return None
+            return subprocess.check_output([lz4_path, "-d", "-c"], input=data, stderr=subprocess.DEVNULL)
+    except Exception:
+        pass
+    return None
+
+
+def binary_symbol(path):
+    # Prefix of the symbols objcopy -I binary derives from the input path
+    return "_binary_" + "".join([i if i.isalnum() else "_" for i in str(path)])
+
+
 def sha1_for_file(filename):
     sha1 = hashlib.sha1()
     if os.path.exists(filename):
@@ -396,7 +451,12 @@ class ROM:
         filepath = Path(filepath)
 
         self.rom_id = 0 
+        self.cheat_table = None
         self.path = filepath
+        self.data_path = filepath  # Patched copy in the ROM cache, if any
+        self.source_path = filepath  # The dump, identified by identify()
+        self.info = None
+        self.patches = []          # Applied to data_path or the compressed ROM
         self.filename = filepath
         # Remove compression extension from the name in case it ends with that
         if filepath.suffix in COMPRESSIONS or filepath.suffix == '.cdk':
@@ -444,52 +504,20 @@ class ROM:
         return self.path.read_bytes()
 
     def get_rom_patchs(self):
-        #get pce rompatchs files
+        # PCE ROM patches and RAM writes, compiled into the cheat table
         pceplus = Path(self.path.parent, self.filename + ".pceplus")
 
         if not os.path.exists(pceplus):
             return []
 
-        codes_and_descs = []
-        for line in pceplus.read_text().splitlines():
-            line = line.strip()
-            if not line:
-                continue
-            if line.startswith("#"):
-                continue
-            parts = line.split(',')
-            cmd_count = 0
-            cmd_str = ""
-            for i in range(len(parts) - 1):
-                part = parts[i].strip()
-                #get cmd byte count
-                x_str = part[0:2]
-                x = (int(x_str, 16) >> 4) + 1
-                one_cmd = ""
-                for y in range(3):
-                    one_cmd = one_cmd + "\\x" + part[y * 2: y * 2 + 2] 
-                for y in range(x):
-                    one_cmd = one_cmd + "\\x" + part[y * 2 + 6: y * 2 + 8]
-                #got one cmd
-                cmd_count += 1
-                cmd_str = cmd_str + one_cmd
-            cmd_str = "\\x%x" % (cmd_count) + cmd_str
-            desc = parts[len(parts) - 1]
-            if desc is not None:
-                desc = desc[:40]
-                desc = desc.replace('\\', r'\\\\')
-                desc = desc.replace('"', r'\"')
-                desc = desc.strip()
-
-            codes_and_descs.append((cmd_str, desc))
-
-        if len(codes_and_descs) > MAX_CHEAT_CODES:
-            print(
-                f"INFO: {self.name} has more than {MAX_CHEAT_CODES} cheat codes. Truncating..."
-            )
-            codes_and_descs = codes_and_descs[:MAX_CHEAT_CODES]
+        return cheat_table.parse_pceplus(pceplus.read_text())
 
-        return codes_and_descs
+    def get_cheat_table(self):
+        # Indexed like get_cheat_codes(), where the .ggcodes file comes first
+        if os.path.exists(Path(self.path.parent, self.filename + ".ggcodes")):
+            return None
+        cheats = self.get_rom_patchs()
+        return cheat_table.compile_table(cheats) if cheats else None
 
     def get_cheat_codes(self):
         # Get game genie code file path
@@ -537,7 +565,19 @@ class ROM:
 
         pceplus = Path(self.path.parent, self.filename + ".pceplus")
         if os.path.exists(pceplus):
-            return self.get_rom_patchs()
+            codes_and_descs = []
+            for cheat in self.get_rom_patchs():
+                desc = cheat.desc
+                # Shorten description
+                if desc is not None:
+                    desc = desc[:40]
+                    desc = desc.replace('\\', r'\\\\')
+                    desc = desc.replace('"', r'\"')
+                    desc = desc.strip()
+
+                codes_and_descs.append((cheat.code, desc))
+
+            return codes_and_descs
 
         mfc_path = Path(self.path.parent, self.filename + ".mcf")
         if os.path.exists(mfc_path):
@@ -626,28 +666,35 @@ class ROM:
 
     @property
     def size(self):
-        return self.path.stat().st_size
-
-    @property
-    def mapper(self):
-        mapper = 0
-        if self.system_name == "MSX":
-            mapper = int(subprocess.check_output([sys.executable, "./tools/findblueMsxMapper.py", "roms/msx_bios/msxromdb.xml", str(self.path)]))
-        return mapper
+        return self.data_path.stat().st_size
+
+    def identify(self, db: romdb.RomDb, folder: str):
+        if self.info is not None:
+            return self.info  # With the flags of the built rom, see _build_rom()
+        # Hash the dump once and look it up, see tools/romdb.py
+        source = self.source_path
+        if source.suffix == ".cdk" and source.with_suffix("").exists():
+            source = source.with_suffix("")  # The controls are listed for the .dsk
+        data = None
+        if source.suffix[1:] in COMPRESSIONS.keys():
+            # Without its original, the dump is decompressed here
+            data = decompress(source.read_bytes(), source.suffix)
+        elif source.suffix != ".cdk":
+            data = source.read_bytes()
+        if data is None:
+            # Only the file name tells something about it
+            print(f"Warning : {self.name} can't be identified without its original file")
+            self.info = romdb.RomInfo()
+        else:
+            self.info = db.identify(folder, data, disk=source.suffix.lower() == ".dsk")
+            if folder == "pce":
+                # Stored as the file is, see _build_rom() for the others
+                self.info.legacy_crc32 = pce_rom.legacy_crc32(data, source.stat().st_size)
+        if folder == "msx" and self.info.controls == romdb.DEFAULT_CONTROLS:
+            print(f"Warning : {self.name} has no controls configuration in roms/msx_bios/msxromdb.xml, default controls will be used")
+        return self.info
 
     @property
-    def game_config(self):
-        value = 0xff
-        if self.system_name == "MSX":
-            # MSX game_config structure :
-            # b7-b0 : Controls profile
-            # b8 : Does the game require to press ctrl at boot ?
-            sp_output = subprocess.check_output([sys.executable, "./tools/findblueMsxControls.py", "roms/msx_bios/msxromdb.xml", str(self.path).replace('.dsk.cdk','.dsk')]).splitlines()
-            value = int(sp_output[0]) + (int(sp_output[1]) << 8)
-            if int(sp_output[0]) == 0xff :
-                print(f"Warning : {self.name} has no controls configuration in roms/msx_bios/msxromdb.xml, default controls will be used")
-        return value
-    @property
     def img_size(self):
         try:
             return self.img_path.stat().st_size
@@ -701,10 +748,15 @@ class ROMParser:
                     "(Australia)",
                 ]
             )
+            if rom.info.region:
+                is_pal = rom.info.region == "pal"
             region = "REGION_PAL" if is_pal else "REGION_NTSC"
             gg_count_name = "%s%s_COUNT" % (cheat_codes_prefix, i)
             gg_code_array_name = "%sCODE_%s" % (cheat_codes_prefix, i)
             gg_desc_array_name = "%sDESC_%s" % (cheat_codes_prefix, i)
+            gg_table_name = "%sTABLE_%s" % (cheat_codes_prefix, i)
+            patches = ", ".join(p.name for p in rom.patches)
+            patches = '"%s"' % patches.replace("\\", "\\\\").replace('"', '\\"') if patches else "NULL"
             body += ROM_ENTRY_TEMPLATE.format(
                 rom_id=rom.rom_id,
                 name=str(rom.name),
@@ -720,8 +772,13 @@ class ROMParser:
                 cheat_codes=gg_code_array_name if cheat_codes_prefix else "NULL",
                 cheat_descs=gg_desc_array_name if cheat_codes_prefix else 0,
                 cheat_count=gg_count_name if cheat_codes_prefix else 0,
-                mapper=rom.mapper,
-                game_config=rom.game_config,
+                cheat_table=gg_table_name if rom.cheat_table else "NULL",
+                patches=patches,
+                mapper=rom.info.mapper,
+                game_config=rom.info.game_config,
+                crc32="0x%08x" % rom.info.crc32,
+                flags=rom.info.c_flags,
+                legacy_crc32="0x%08x" % rom.info.legacy_crc32,
             )
             body += "\n"
             pubcount += 1
@@ -734,6 +791,14 @@ class ROMParser:
         if "GCC_PATH" in os.environ:
             prefix = os.environ["GCC_PATH"]
         prefix = Path(prefix)
+        redefine = []
+        if rom.data_path != rom.path:
+            # The patched copy keeps the symbols of the ROM
+            for suffix in ("_start", "_end", "_size"):
+                redefine += [
+                    "--redefine-sym",
+                    binary_symbol(rom.data_path) + suffix + "=" + rom.symbol[: -len("_start")] + suffix,
+                ]
         if system_name == "Sega Genesis":
             subprocess.check_output(
                 [
@@ -747,7 +812,8 @@ class ROMParser:
                     "-B",
                     "armv7e-m",
                     "--reverse-bytes=2",
-                    rom.path,
+                    *redefine,
+                    rom.data_path,
                     rom.obj_path,
                 ]
             )
@@ -763,7 +829,8 @@ class ROMParser:
                     "elf32-littlearm",
                     "-B",
                     "armv7e-m",
-                    rom.path,
+                    *redefine,
+                    rom.data_path,
                     rom.obj_path,
                 ]
             )
@@ -838,20 +905,28 @@ class ROMParser:
     def generate_save_entry(self, name: str, save_size: int) -> str:
         return f'uint8_t {name}[{save_size}]  __attribute__((section (".saveflash"))) __attribute__((aligned(4096)));\n'
 
-    def generate_cheat_entry(self, name: str, num: int, cheat_codes_and_descs: []) -> str:
+    def generate_cheat_entry(self, name: str, num: int, cheat_codes_and_descs: [], table: bytes) -> str:
         str = ""
 
-        codes = "{%s}" % ",".join(f'"{c}"' for (c,d) in cheat_codes_and_descs)
-        descs = "{%s}" % ",".join(f'NULL' if d is None else f'"{d}"' for (c,d) in cheat_codes_and_descs)
         number_of_codes = len(cheat_codes_and_descs)
 
         count_name = "%s%s_COUNT" % (name, num)
         code_array_name = "%sCODE_%s" % (name, num)
         desc_array_name = "%sDESC_%s" % (name, num)
+        table_name = "%sTABLE_%s" % (name, num)
         str += f'#if CHEAT_CODES == 1\n'
-        str += f'const char* {code_array_name}[{number_of_codes}] = {codes};\n'
-        str += f'const char* {desc_array_name}[{number_of_codes}] = {descs};\n'
+        # The strings too go to the external flash, there is no limit on the cheats of a ROM
+        for j, (c, d) in enumerate(cheat_codes_and_descs):
+            str += f'static const char {code_array_name}_{j}[] EMU_DATA = "{c}";\n'
+            if d is not None:
+                str += f'static const char {desc_array_name}_{j}[] EMU_DATA = "{d}";\n'
+        codes = "{%s}" % ",".join(f'{code_array_name}_{j}' for j in range(number_of_codes))
+        descs = "{%s}" % ",".join('NULL' if d is None else f'{desc_array_name}_{j}' for j, (c, d) in enumerate(cheat_codes_and_descs))
+        str += f'const char* const {code_array_name}[{number_of_codes}] EMU_DATA = {codes};\n'
+        str += f'const char* const {desc_array_name}[{number_of_codes}] EMU_DATA = {descs};\n'
         str += f'const int {count_name} = {number_of_codes};\n'
+        if table is not None:
+            str += cheat_table.c_array(table_name, table, " EMU_DATA")
         str += f'#endif\n'
 
         return str
@@ -890,11 +965,9 @@ class ROMParser:
 
         return 0
 
-    def _compress_rom(self, variable_name, rom, compress_gb_speed=False, compress=None):
-        """This will create a compressed rom file next to the original rom."""
+    def _compress_rom(self, variable_name, rom, data, compress_gb_speed=False, compress=None):
+        """Compressed `data` of the rom, None when it is stored uncompressed."""
         global sms_reserved_flash_size
-        if not (rom.publish):
-            return
         if compress is None:
             compress = "lz4"
 
@@ -903,50 +976,48 @@ class ROMParser:
 
         if compress[0] != ".":
             compress = "." + compress
-        output_file = Path(str(rom.path) + compress)
         compress = COMPRESSIONS[compress]
-        data = rom.read()
 
         if "nes_system" in variable_name:  # NES
-            if rom.path.stat().st_size > MAX_COMPRESSED_NES_SIZE:
+            if len(data) > MAX_COMPRESSED_NES_SIZE:
                 print(
                     f"INFO: {rom.name} is too large to compress, skipping compression!"
                 )
-                return
-            compressed_data = compress(data)
-            output_file.write_bytes(compressed_data)
+                return None
+            return compress(data)
         elif "pce_system" in variable_name:  # PCE
-            if rom.path.stat().st_size > MAX_COMPRESSED_PCE_SIZE:
+            # Bank by bank, the emulator decodes them to its RAM
+            if len(data) > pce_rom.MAX_BANKS * pce_rom.BANK_SIZE:
                 print(
                     f"INFO: {rom.name} is too large to compress, skipping compression!"
                 )
-                return
-            compressed_data = compress(data)
-            output_file.write_bytes(compressed_data)
+                return None
+            ram_size = MAX_COMPRESSED_PCE_SIZE - PCE_CHEAT_BANKS * pce_rom.BANK_SIZE
+            data = pce_rom.pack(data, compress, ram_size)
+            if data is None:
+                print(f"INFO: {rom.name} doesn't compress, skipping compression!")
+            return data
         elif "wsv_system" in variable_name:  # WSV
-            if rom.path.stat().st_size > MAX_COMPRESSED_WSV_SIZE:
+            if len(data) > MAX_COMPRESSED_WSV_SIZE:
                 print(
                     f"INFO: {rom.name} is too large to compress, skipping compression!"
                 )
-                return
-            compressed_data = compress(data)
-            output_file.write_bytes(compressed_data)
+                return None
+            return compress(data)
         elif "a7800_system" in variable_name:  # Atari 7800
-            if rom.path.stat().st_size > MAX_COMPRESSED_A7800_SIZE:
+            if len(data) > MAX_COMPRESSED_A7800_SIZE:
                 print(
                     f"INFO: {rom.name} is too large to compress, skipping compression!"
                 )
-                return
-            compressed_data = compress(data)
-            output_file.write_bytes(compressed_data)
+                return None
+            return compress(data)
         elif variable_name in ["col_system","sg1000_system"] :  # COL or SG
-            if rom.path.stat().st_size > MAX_COMPRESSED_SG_COL_SIZE:
+            if len(data) > MAX_COMPRESSED_SG_COL_SIZE:
                 print(
                     f"INFO: {rom.name} is too large to compress, skipping compression!"
                 )
-                return
-            compressed_data = compress(data)
-            output_file.write_bytes(compressed_data)
+                return None
+            return compress(data)
 
         elif variable_name in ["sms_system","gg_system","md_system"]:  # GG or SMS or MD
 
@@ -966,9 +1037,7 @@ class ROMParser:
             for compressed_bank in compressed_banks:
                 output_data.append(compressed_bank)
 
-            output_data = b"".join(output_data)
-
-            output_file.write_bytes(output_data)
+            return b"".join(output_data)
         elif "gb_system" in variable_name:  # GB/GBC
             BANK_SIZE = 16384
             banks = [data[i : i + BANK_SIZE] for i in range(0, len(data), BANK_SIZE)]
@@ -1016,9 +1085,105 @@ class ROMParser:
                     output_banks.append(compressed_bank)
                 else:
                     output_banks.append(compress(bank, level=DONT_COMPRESS))
-            output_data = b"".join(output_banks)
+            return b"".join(output_banks)
+
+        return None
 
-            output_file.write_bytes(output_data)
+    def _legacy_pce_crc32(self, rom, compress):
+        """pce_rom.legacy_crc32() of a PCE rom the former builds compressed as a whole.
+
+        Only the size of the compressed rom is needed, it is kept in
+        ROM_CACHE_DIR under the hash of the rom.
+        """
+        data = rom.read()
+        if len(data) > MAX_COMPRESSED_PCE_SIZE:
+            return rom.info.legacy_crc32  # They stored it as is
+        size_file = ROM_CACHE_DIR / (sha1_for_file(rom.path) + ".legacy_size." + compress)
+        if size_file.exists():
+            size = int(size_file.read_text())
+        else:
+            size = len(COMPRESSIONS[compress](data))
+            ROM_CACHE_DIR.mkdir(parents=True, exist_ok=True)
+            size_file.write_text(str(size))
+        return pce_rom.legacy_crc32(data, size)
+
+    def _build_rom(self, variable_name, rom, manifest, compress_gb_speed=False, compress=None):
+        """Applies the patches of the rom and compresses it next to the original.
+
+        PCE roms are also laid out the way the emulator maps them, see
+        tools/pce_rom.py, and their flags updated.
+
+        The result is kept in ROM_CACHE_DIR under the hash of the rom, of its
+        patches and of the compression, it is only rebuilt when one of them
+        changes. Returns True when the compressed rom is up to date, False when
+        the rom is stored uncompressed, from rom.data_path.
+        """
+        if not (rom.publish) or rom.ext == "cdk":
+            return False
+        rom.patches = rom_patch.find_patches(rom.path.parent, rom.filename)
+        layout_flags = None
+        normalize = False
+        if "pce_system" in variable_name:
+            layout_flags = rom.identify(self.romdb, "pce").flags
+            normalize = pce_rom.needs_normalize(rom.path.stat().st_size, layout_flags)
+            rom.info.flags = layout_flags - {"PCE_US_ENCODED"}
+            if compress is not None:
+                rom.info.legacy_crc32 = self._legacy_pce_crc32(rom, compress)
+        if compress is None and not rom.patches and not normalize:
+            return False
+
+        key = hashlib.sha1()
+        for part in [ROM_CACHE_VERSION, variable_name, compress, compress_gb_speed, sha1_for_file(rom.path), sorted(layout_flags or ())]:
+            key.update(str(part).encode())
+        for patch in rom.patches:
+            key.update(patch.name.encode())
+            key.update(sha1_for_file(patch).encode())
+        key = key.hexdigest()
+
+        output_file = Path(str(rom.path) + "." + compress) if compress else None
+        compressed_file = ROM_CACHE_DIR / (key + "." + compress) if compress else None
+        patched_file = ROM_CACHE_DIR / (key + "." + rom.ext)
+
+        if compressed_file is None or not compressed_file.exists():
+            if patched_file.exists():
+                rom.data_path = patched_file
+                data = None
+            else:
+                data = rom.read()
+                for patch in rom.patches:
+                    try:
+                        data = rom_patch.apply(data, patch)
+                    except rom_patch.PatchError as e:
+                        print(f"Error: {rom.name}: {e}")
+                        exit(-1)
+                    print(f"Applied {patch.name} to {rom.name}")
+                if layout_flags is not None:
+                    data, _ = pce_rom.normalize(data, layout_flags)
+
+            compressed_data = None
+            if data is not None and compress is not None:
+                compressed_data = self._compress_rom(
+                    variable_name, rom, data, compress_gb_speed=compress_gb_speed, compress=compress
+                )
+            ROM_CACHE_DIR.mkdir(parents=True, exist_ok=True)
+            if compressed_data is None:
+                if data is not None and (rom.patches or normalize):
+                    patched_file.write_bytes(data)
+                    rom.data_path = patched_file
+                # Don't leave a compressed rom of other inputs behind
+                if output_file and manifest.pop(str(output_file), None):
+                    output_file.unlink(missing_ok=True)
+                return False
+            compressed_file.write_bytes(compressed_data)
+
+        if (
+            manifest.get(str(output_file)) != key
+            or not output_file.exists()
+            or output_file.stat().st_size != compressed_file.stat().st_size
+        ):
+            shutil.copyfile(compressed_file, output_file)
+            manifest[str(output_file)] = key
+        return True
 
     def _convert_dsk(self, variable_name, dsk, compress):
         """This will convert dsk image to cdk."""
@@ -1123,28 +1288,41 @@ class ROMParser:
         #add .cdk disks to list
         roms_raw.extend(cdk_disks)
 
-        roms_compressed = find_compressed_roms()
+        manifest = {}
+        if ROM_CACHE_MANIFEST.exists():
+            manifest = json.loads(ROM_CACHE_MANIFEST.read_text())
 
-        roms_raw = [r for r in roms_raw if not contains_rom_by_name(r, roms_compressed)]
-        if roms_raw and compress is not None:
+        roms_built = []
+        if roms_raw:
             pbar = tqdm(roms_raw) if tqdm else roms_raw
             for r in pbar:
                 if tqdm:
-                    pbar.set_description(f"Compressing: {system_name} / {r.name}")
-                self._compress_rom(
+                    pbar.set_description(f"Building: {system_name} / {r.name}")
+                if self._build_rom(
                     variable_name,
                     r,
+                    manifest,
                     compress_gb_speed=compress_gb_speed,
                     compress=compress,
-                )
-            # Re-generate the compressed rom list
-            roms_compressed = find_compressed_roms()
-
-        # Create a list with all compressed roms and roms that
-        # don't have a compressed counterpart.
-        roms = roms_compressed[:]
+                ):
+                    roms_built.append(r)
+            if ROM_CACHE_DIR.exists():
+                ROM_CACHE_MANIFEST.write_text(json.dumps(manifest, indent=1, sort_keys=True))
+
+        # Create a list with the compressed roms built from their original and
+        # the ones without original, then the roms stored uncompressed.
+        roms = []
+        for c in find_compressed_roms():
+            built = [r for r in roms_built if r.name == c.name]
+            if built:
+                c.patches = built[0].patches
+                c.info = built[0].info
+                c.source_path = built[0].path
+                roms.append(c)
+            elif not contains_rom_by_name(c, roms_raw):
+                roms.append(c)
         for r in roms_raw:
-            if not contains_rom_by_name(r, roms_compressed):
+            if not contains_rom_by_name(r, roms_built):
                 roms.append(r)
 
         for rom in roms:
@@ -1182,16 +1360,22 @@ class ROMParser:
             for i, rom in enumerate(roms):
                 if not (rom.publish):
                     continue
+                rom.identify(self.romdb, folder)
+                rom_save_size = save_size
                 if folder == "gb":
-                    save_size = self.get_gameboy_save_size(rom.path)
+                    rom_save_size = self.get_gameboy_save_size(rom.path)
+                if rom.info.save_size is not None:
+                    rom_save_size = rom.info.save_size
 
                 # Aligned
                 aligned_size = 4 * 1024
                 if rom.enable_save:
-                    system_save_size = (
-                        (save_size + aligned_size - 1) // (aligned_size)
+                    aligned_save_size = (
+                        (rom_save_size + aligned_size - 1) // (aligned_size)
                     ) * aligned_size
-                    total_save_size += system_save_size
+                    # The largest one, romdb.dat can change the size of a rom
+                    system_save_size = max(system_save_size, aligned_save_size)
+                    total_save_size += aligned_save_size
                 total_rom_size += rom.size
                 if (args.coverflow != 0) :
                     total_img_size += rom.img_size
@@ -1203,11 +1387,12 @@ class ROMParser:
                     except NoArtworkError:
                         pass
                 if rom.enable_save:
-                    f.write(self.generate_save_entry(save_prefix + str(i), save_size))
+                    f.write(self.generate_save_entry(save_prefix + str(i), rom_save_size))
 
                 cheat_codes_and_descs = rom.get_cheat_codes();
+                rom.cheat_table = rom.get_cheat_table() if cheat_codes_prefix else None
                 if cheat_codes_prefix:
-                    f.write(self.generate_cheat_entry(cheat_codes_prefix, i, cheat_codes_and_descs))
+                    f.write(self.generate_cheat_entry(cheat_codes_prefix, i, cheat_codes_and_descs, rom.cheat_table))
 
             rom_entries = self.generate_rom_entries(
                 folder + "_roms", roms, save_prefix, variable_name, cheat_codes_prefix
@@ -1241,6 +1426,7 @@ class ROMParser:
             path.write_text(data)
 
     def parse(self, args):
+        self.romdb = romdb.RomDb()
         larger_save_size = 0
         total_save_size = 0
         total_rom_size = 0
@@ -19,6 +19,12 @@ if [[ $# -lt 1 ]]; then
     echo "            but may be faster for large flash chips."
     echo ""
     echo "Note! This will cut the binary in 832kB chunks and flash them to address and onwards"
+    echo ""
+    echo "Set DIFF=1 to only program the 4kB blocks that changed. This needs the"
+    echo "<binary>.blocks manifest generated by the build (tools/flash_diff.py)."
+    echo ""
+    echo "Otherwise the next chunk is loaded while the previous one is programmed."
+    echo "Set PIPELINE=0 to load and program the chunks one after the other."
     exit
 fi
 
@@ -47,6 +53,60 @@ SIZE=$((FILESIZE))
 SECTOR_SIZE=$(( 4 * 1024 ))
 ERASE_BYTES=0
 
+BLOCK_SIZE=$(( 4 * 1024 ))
+HASH_SIZE=32
+DIFF=${DIFF:-0}
+if [[ $DIFF == 1 ]]; then
+    BLOCKS_FILE="${IMAGE%.bin}.blocks"
+    if [[ ! -e "${BLOCKS_FILE}" ]]; then
+        echo_red "Block manifest ${BLOCKS_FILE} not found, run make first."
+        exit 1
+    fi
+fi
+
+# $1: retry count
+function ask_retry() {
+    if [[ $1 -gt 1 ]]; then
+        echo_red "Flashing failed... power cycle unit and retry? (y/n)"
+        read -n 1 -r
+        if [[ ! $REPLY =~ ^[Yy]$ ]]; then
+            echo "Aborted."
+            exit 1
+        fi
+
+        echo ""
+        echo "Retry count $1/10"
+    fi
+}
+
+function flash_failed() {
+    echo ""
+    echo ""
+    echo_red "Programming of the external flash FAILED after 10 tries."
+    echo_red "Please check your debugger and wires connecting to the target."
+    echo ""
+    echo ""
+    exit 1
+}
+
+PIPELINE=${PIPELINE:-1}
+if [[ $DIFF != 1 && $PIPELINE == 1 ]]; then
+    # Try to flash 10 times, give up after that.
+    for RETRY_COUNT in $(seq 10); do
+        ask_retry $RETRY_COUNT
+        ${DIR}/flashapp.sh --pipeline "${IMAGE}" ${ADDRESS} ${CHIP_ERASE} && break
+    done
+
+    if [[ $RETRY_COUNT -eq 10 ]]; then
+        flash_failed
+    fi
+
+    echo_green "Programming of the external flash succeeded."
+    echo ""
+    echo ""
+    exit 0
+fi
+
 ERASE=1
 i=0
 while [[ $SIZE -gt 0 ]]; do
@@ -79,32 +139,21 @@ while [[ $SIZE -gt 0 ]]; do
         ERASE_BYTES=$(( (( SIZE + SECTOR_SIZE - 1 ) / SECTOR_SIZE) * SECTOR_SIZE ))
     fi
 
-    # Try to flash 10 times, give up after that.
-    COUNT=10
-    for RETRY_COUNT in $(seq $COUNT); do
-        if [[ $RETRY_COUNT -gt 1 ]]; then
-            echo_red "Flashing chunk $i failed... power cycle unit and retry? (y/n)"
-            read -n 1 -r
-            if [[ ! $REPLY =~ ^[Yy]$ ]]; then
-                echo "Aborted."
-                exit 1
-            fi
-
-            echo ""
-            echo "Retry count $RETRY_COUNT/10"
-        fi
+    MANIFEST=""
+    if [[ $DIFF == 1 ]]; then
+        MANIFEST=$(mktemp /tmp/flash_manifest.XXXXXX)
+        CHUNK_BLOCKS=$(( DEFAULT_CHUNK_SIZE / BLOCK_SIZE ))
+        dd if="${BLOCKS_FILE}" of="${MANIFEST}" bs=${HASH_SIZE} count=${CHUNK_BLOCKS} skip=$(( i * CHUNK_BLOCKS )) 2> /dev/null
+    fi
 
-        ${DIR}/flashapp.sh ${TMPFILE} ${ADDRESS_HEX} ${SIZE_HEX} ${ERASE} ${ERASE_BYTES} $((i + 1)) ${CHUNKS} && break
+    # Try to flash 10 times, give up after that.
+    for RETRY_COUNT in $(seq 10); do
+        ask_retry $RETRY_COUNT
+        MANIFEST=${MANIFEST} ${DIR}/flashapp.sh ${TMPFILE} ${ADDRESS_HEX} ${SIZE_HEX} ${ERASE} ${ERASE_BYTES} $((i + 1)) ${CHUNKS} && break
     done
 
     if [[ $RETRY_COUNT -eq 10 ]]; then
-        echo ""
-        echo ""
-        echo_red "Programming of the external flash FAILED after 3 tries."
-        echo_red "Please check your debugger and wires connecting to the target."
-        echo ""
-        echo ""
-        exit 1
+        flash_failed
     else
         echo ""
         echo ""
@@ -118,6 +167,9 @@ while [[ $SIZE -gt 0 ]]; do
     ERASE_BYTES=0
 
     rm -f ${TMPFILE}
+    if [[ ! -z "${MANIFEST}" ]]; then
+        rm -f ${MANIFEST}
+    fi
 
     SIZE=$(( SIZE - CHUNK_SIZE ))
     i=$(( i + 1 ))
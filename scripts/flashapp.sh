@@ -18,10 +18,12 @@ FLASHAPP_IDLE="00000001"
 FLASHAPP_TEST_NEXT="0000000b"
 FLASHAPP_FINAL="0000000d"
 FLASHAPP_ERROR="0000000e"
+FLASHAPP_DIFF_NEXT="0000000f"
 
 STATUS_BAD_HASH_RAM="bad00001"
 STATUS_BAD_HAS_FLASH="bad00002"
 STATUS_NOT_ALIGNED="bad00003"
+STATUS_TOO_LARGE="bad00004"
 STATUS_IDLE="cafe0000"
 STATUS_DONE="cafe0001"
 STATUS_BUSY="cafe0002"
@@ -38,6 +40,27 @@ VAR_program_erase_bytes=$(     printf '0x%08x\n' $(get_symbol "program_erase_byt
 VAR_program_chunk_idx=$(       printf '0x%08x\n' $(get_symbol "program_chunk_idx"))
 VAR_program_chunk_count=$(     printf '0x%08x\n' $(get_symbol "program_chunk_count"))
 VAR_program_expected_sha256=$( printf '0x%08x\n' $(get_symbol "program_expected_sha256"))
+VAR_program_sparse=$(          printf '0x%08x\n' $(get_symbol "program_sparse"))
+VAR_program_block_dirty=$(     printf '0x%08x\n' $(get_symbol "program_block_dirty"))
+VAR_program_slot_ready=$(      printf '0x%08x\n' $(get_symbol "program_slot_ready"))
+VAR_program_slot_loaded=$(     printf '0x%08x\n' $(get_symbol "program_slot_loaded"))
+VAR_program_slot_size=$(       printf '0x%08x\n' $(get_symbol "program_slot_size"))
+VAR_program_slot_address=$(    printf '0x%08x\n' $(get_symbol "program_slot_address"))
+VAR_program_slot_erase=$(      printf '0x%08x\n' $(get_symbol "program_slot_erase"))
+VAR_program_slot_erase_bytes=$(printf '0x%08x\n' $(get_symbol "program_slot_erase_bytes"))
+VAR_program_slot_sha256=$(     printf '0x%08x\n' $(get_symbol "program_slot_sha256"))
+
+# Size of program_block_dirty in flashapp.c
+BLOCK_DIRTY_BYTES=512
+
+# FLASHAPP_SLOT_COUNT and FLASHAPP_SLOT_SIZE in flashapp_slots.h
+SLOT_COUNT=2
+SLOT_SIZE=$(( 416 * 1024 ))
+
+# Granularity of the progress reported to the flashapp while a slot is loaded
+LOAD_STEP=$(( 32 * 1024 ))
+
+PYTHON3=${PYTHON3:-python3}
 
 INTFLASH_BANK=${INTFLASH_BANK:-1}
 if [ $INTFLASH_BANK -eq 2 ]; then
@@ -82,6 +105,8 @@ function state_to_string() {
     elif [[ "$1" == "0000000c" ]]; then echo "FLASHAPP_TEST"
     elif [[ "$1" == "0000000d" ]]; then echo "FLASHAPP_FINAL"
     elif [[ "$1" == "0000000e" ]]; then echo "FLASHAPP_ERROR"
+    elif [[ "$1" == "0000000f" ]]; then echo "FLASHAPP_DIFF_NEXT"
+    elif [[ "$1" == "00000010" ]]; then echo "FLASHAPP_DIFF"
     else echo "UNKNOWN"
     fi
 }
@@ -100,15 +125,202 @@ function wait_for_idle() {
     done
 }
 
+# $1: slot
+# Wait for the flashapp to be done with the chunk in the slot
+function wait_for_slot() {
+    while true; do
+        STATE_REG=$(read_word ${VAR_flashapp_state})
+        READY_REG=$(read_word $(printf '0x%08x' $(( VAR_program_slot_ready + $1 * 4 ))))
+        if [[ "$STATE_REG" == "$FLASHAPP_ERROR" ]]; then
+            break;
+        elif [[ "$READY_REG" == "00000000" ]]; then
+            break;
+        else
+            echo "State: $(state_to_string $STATE_REG)"
+        fi
+        sleep 1
+    done
+}
+
+function start_flashapp() {
+    ${OPENOCD} -f ${DIR}/interface_${ADAPTER}.cfg \
+        -c "init; reset halt;" \
+        -c "set MSP 0x[string range [mdw $INTFLASH_ADDRESS] 12 19]" \
+        -c "set PC 0x[string range [mdw [format 0x%x [expr {$INTFLASH_ADDRESS + 0x4}]]] 12 19]" \
+        -c 'reg msp $MSP' \
+        -c 'reg pc $PC' \
+        -c "mww ${VAR_boot_magic} ${BOOT_MAGIC_FLASHAPP}" \
+        -c "mww ${VAR_program_chunk_idx} $1" \
+        -c "mww ${VAR_program_chunk_count} $2" \
+        -c "echo \"Starting flash app\";" \
+        -c "resume;" \
+        -c "exit;"
+}
+
+# Wait for the final or error state
+# $1: 1 when all the chunks were queued, the idle state between two chunks
+#     isn't the end then
+function wait_for_done() {
+    local all_chunks=$1
+
+    while true; do
+        STATE_REG=$(read_word ${VAR_flashapp_state})
+        if [[ "$STATE_REG" == "$FLASHAPP_FINAL" ]]; then
+            echo_green "Done!"
+            exit 0
+        elif [[ "$STATE_REG" == "$FLASHAPP_IDLE" && "$all_chunks" != 1 ]]; then
+            echo_green "Done, more chunks left!"
+            exit 0
+        elif [[ "$STATE_REG" == "$FLASHAPP_ERROR" ]]; then
+            STATUS_REG=$(read_word ${VAR_program_status})
+            if [[ "$STATUS_REG" == "$STATUS_BAD_HASH_RAM" ]]; then
+                echo_red "Hash mismatch in RAM. Flashing failed."
+                exit 3
+            elif [[ "$STATUS_REG" == "$STATUS_BAD_HAS_FLASH" ]]; then
+                echo_red "Hash mismatch in FLASH. Flashing failed."
+                exit 3
+            elif [[ "$STATUS_REG" == "$STATUS_NOT_ALIGNED" ]]; then
+                echo_red "Address not 4k aligned. Flashing failed."
+                exit 4
+            elif [[ "$STATUS_REG" == "$STATUS_TOO_LARGE" ]]; then
+                echo_red "Chunk too large. Flashing failed."
+                exit 4
+            else
+                echo_red "Unknown error. Flashing failed. Status: $STATUS_REG"
+                exit 5
+            fi
+        else
+            echo "State: $(state_to_string $STATE_REG)"
+        fi
+        sleep 1
+    done
+}
+
+# $1: image
+# $2: address in flash
+# $3: chip erase
+# Streams the image in SLOT_SIZE chunks. The next chunk is loaded while the
+# flashapp programs the previous one, the target is not halted meanwhile.
+function flash_pipelined() {
+    local image=$1
+    local address=$2
+    local chip_erase=$3
+
+    # stat on macOS has different flags
+    if [[ "$(uname -s)" == "Darwin" ]]; then
+        local filesize=$(stat -f%z "${image}")
+    else
+        local filesize=$(stat -c%s "${image}")
+    fi
+
+    local chunks=$(( (filesize + SLOT_SIZE - 1) / SLOT_SIZE ))
+    local erase=1
+    local erase_bytes=0
+    if [[ $chip_erase != 1 ]]; then
+        erase_bytes=$(( ((filesize + 4095) / 4096) * 4096 ))
+    fi
+
+    start_flashapp 1 ${chunks}
+    wait_for_idle
+
+    # The init state clears the chunk count
+    ${OPENOCD} -f ${DIR}/interface_${ADAPTER}.cfg \
+        -c "init;" \
+        -c "mww ${VAR_program_chunk_count} ${chunks}" \
+        -c "exit;"
+
+    local chunk_file=$(mktemp /tmp/flash_chunk.XXXXXX)
+    local hash_file=$(mktemp /tmp/sha256_hash_hex.XXXXXX)
+    if [[ ! -e "${chunk_file}" || ! -e "${hash_file}" ]]; then
+        echo "Can't create tempfile!"
+        exit 1
+    fi
+
+    for (( i = 0; i < chunks; i++ )); do
+        local slot=$(( i % SLOT_COUNT ))
+        local size=$(( filesize - i * SLOT_SIZE ))
+        if [[ $size -gt $SLOT_SIZE ]]; then
+            size=${SLOT_SIZE}
+        fi
+
+        dd if="${image}" of="${chunk_file}" bs=1024 count=$(( (size + 1023) / 1024 )) skip=$(( i * SLOT_SIZE / 1024 )) 2> /dev/null
+        if [[ $size -le 8 ]]; then
+            echo "Chunk size <= 8 bytes, padding with zeros"
+            dd if=/dev/zero of="${chunk_file}" bs=1 count=$(( 9 - size )) seek=${size} 2> /dev/null
+        fi
+        calc_sha256sum "${chunk_file}" "${hash_file}"
+
+        echo "Waiting for buffer $slot"
+        wait_for_slot ${slot}
+        if [[ "$(read_word ${VAR_flashapp_state})" == "$FLASHAPP_ERROR" ]]; then
+            break
+        fi
+
+        echo_green "Loading chunk $((i + 1)) / ${chunks}"
+        local buffer=$(( VAR_framebuffer2 + slot * SLOT_SIZE ))
+        local cmds=()
+        for (( offset = 0; offset < size; offset += LOAD_STEP )); do
+            local len=$(( size - offset ))
+            if [[ $len -gt $LOAD_STEP ]]; then
+                len=${LOAD_STEP}
+            fi
+            cmds+=(-c "load_image ${chunk_file} ${buffer} bin $(( buffer + offset )) ${len};")
+            cmds+=(-c "mww $(( VAR_program_slot_loaded + slot * 4 )) $(( offset + len ))")
+        done
+
+        ${OPENOCD} -f ${DIR}/interface_${ADAPTER}.cfg \
+            -c "init;" \
+            "${cmds[@]}" \
+            -c "mww $(( VAR_program_slot_size + slot * 4 )) ${size}" \
+            -c "mww $(( VAR_program_slot_address + slot * 4 )) $(( address + i * SLOT_SIZE ))" \
+            -c "mww $(( VAR_program_slot_erase + slot * 4 )) ${erase}" \
+            -c "mww $(( VAR_program_slot_erase_bytes + slot * 4 )) ${erase_bytes}" \
+            -c "load_image ${hash_file} $(( VAR_program_slot_sha256 + slot * 65 ));" \
+            -c "mww $(( VAR_program_slot_ready + slot * 4 )) 1" \
+            -c "exit;"
+
+        # The first chunk erases the whole image
+        erase=0
+        erase_bytes=0
+    done
+
+    rm -f "${chunk_file}" "${hash_file}"
+
+    echo "Please see the LCD for interactive status."
+    wait_for_done 1
+}
+
+# Wait for the block compare to be done
+function wait_for_diff() {
+    while true; do
+        STATE_REG=$(read_word ${VAR_flashapp_state})
+        START_REG=$(read_word ${VAR_program_start})
+        if [[ "$STATE_REG" == "$FLASHAPP_IDLE" && "$START_REG" == "00000000" ]]; then
+            break;
+        elif [[ "$STATE_REG" == "$FLASHAPP_ERROR" ]]; then
+            echo_red "Block compare failed (status: $(read_word ${VAR_program_status})). Flash without DIFF=1."
+            exit 6
+        else
+            echo "State: $(state_to_string $STATE_REG)"
+        fi
+        sleep 1
+    done
+}
+
 if [[ $# -lt 1 ]]; then
     echo "Usage: flashapp.sh <binary to flash> [address in flash] [size] [erase=1] [erase_bytes=0] [chunk_idx] [chunk_count]"
     echo "       flashapp.sh --test"
+    echo "       flashapp.sh --pipeline <binary to flash> [address in flash] [chip_erase=0]"
+    echo "Set MANIFEST=<file> to the block hashes of the binary (tools/flash_diff.py) to only"
+    echo "program the blocks that differ from the flash."
     echo "Note! Destination address must be aligned to 256 bytes."
     echo "'address in flash': Where to program to. 0x000000 is the start of the flash. "
     echo "'size': Size of the binary to flash. Should be aligned to 256 bytes."
     echo "'erase': If '0', chip erase will be skipped. Default '1'."
     echo "'erase_bytes': Number of bytes to erase, all if '0'. Default '0'."
     echo "--test: Performs a erase/write/read test"
+    echo "--pipeline: Programs the whole binary, loading the next chunk while the"
+    echo "            previous one is being programmed."
     exit
 fi
 
@@ -135,6 +347,10 @@ if [[ ${IMAGE} == "--test" ]]; then
     exit 0
 fi
 
+if [[ ${IMAGE} == "--pipeline" ]]; then
+    flash_pipelined "$2" "${3:-0}" "${4:-0}"
+fi
+
 if [[ $# -gt 1 ]]; then
     ADDRESS=$2
 fi
@@ -162,38 +378,67 @@ if [[ $# -gt 6 ]]; then
     CHUNK_COUNT=$7
 fi
 
-HASH_HEX_FILE=$(mktemp /tmp/sha256_hash_hex.XXXXXX)
-if [[ ! -e "${HASH_HEX_FILE}" ]]; then
-    echo "Can't create tempfile!"
-    exit 1
+if [[ ${CHUNK_IDX} -eq "1" ]]; then
+    start_flashapp ${CHUNK_IDX} ${CHUNK_COUNT}
+fi
+
+wait_for_idle
+
+SPARSE=0
+if [[ ! -z "${MANIFEST}" ]]; then
+    echo "Comparing blocks"
+    ${OPENOCD} -f ${DIR}/interface_${ADAPTER}.cfg \
+        -c "init; halt;" \
+        -c "load_image ${MANIFEST} ${VAR_framebuffer2};" \
+        -c "mww ${VAR_program_size} ${SIZE}" \
+        -c "mww ${VAR_program_address} ${ADDRESS}" \
+        -c "mww ${VAR_program_start} 3" \
+        -c "resume; exit;"
+
+    wait_for_diff
+
+    BITMAP_FILE=$(mktemp /tmp/block_dirty.XXXXXX)
+    PACKED_FILE=$(mktemp /tmp/flash_packed.XXXXXX)
+    ${OPENOCD} -f ${DIR}/interface_${ADAPTER}.cfg \
+        -c "init; halt;" \
+        -c "dump_image ${BITMAP_FILE} ${VAR_program_block_dirty} ${BLOCK_DIRTY_BYTES};" \
+        -c "resume; exit;"
+
+    DIRTY_BLOCKS=$(${PYTHON3} ${DIR}/../tools/flash_diff.py pack "${IMAGE}" "${BITMAP_FILE}" "${PACKED_FILE}")
+    rm -f "${BITMAP_FILE}"
+
+    if [[ ${DIRTY_BLOCKS} -eq 0 ]]; then
+        rm -f "${PACKED_FILE}"
+        echo_green "Done, flash already up to date!"
+        exit 0
+    fi
+
+    echo "${DIRTY_BLOCKS} blocks changed"
+    IMAGE=${PACKED_FILE}
+    SPARSE=1
+    ERASE=0
 fi
 
-HASH_FILE=$(mktemp /tmp/sha256_hash.XXXXXX)
-if [[ ! -e "${HASH_FILE}" ]]; then
+HASH_HEX_FILE=$(mktemp /tmp/sha256_hash_hex.XXXXXX)
+if [[ ! -e "${HASH_HEX_FILE}" ]]; then
     echo "Can't create tempfile!"
     exit 1
 fi
-dd if="${IMAGE}" of="${HASH_FILE}" bs=1 count=$(( SIZE )) 2> /dev/null
-calc_sha256sum "${HASH_FILE}" "${HASH_HEX_FILE}"
-rm -f "${HASH_FILE}"
 
-if [[ ${CHUNK_IDX} -eq "1" ]]; then
-    ${OPENOCD} -f ${DIR}/interface_${ADAPTER}.cfg \
-        -c "init; reset halt;" \
-        -c "set MSP 0x[string range [mdw $INTFLASH_ADDRESS] 12 19]" \
-        -c "set PC 0x[string range [mdw [format 0x%x [expr {$INTFLASH_ADDRESS + 0x4}]]] 12 19]" \
-        -c 'reg msp $MSP' \
-        -c 'reg pc $PC' \
-        -c "mww ${VAR_boot_magic} ${BOOT_MAGIC_FLASHAPP}" \
-        -c "mww ${VAR_program_chunk_idx} ${CHUNK_IDX}" \
-        -c "mww ${VAR_program_chunk_count} ${CHUNK_COUNT}" \
-        -c "echo \"Starting flash app\";" \
-        -c "resume;" \
-        -c "exit;"
+if [[ ${SPARSE} -eq 1 ]]; then
+    # The packed file only holds the changed blocks
+    calc_sha256sum "${IMAGE}" "${HASH_HEX_FILE}"
+else
+    HASH_FILE=$(mktemp /tmp/sha256_hash.XXXXXX)
+    if [[ ! -e "${HASH_FILE}" ]]; then
+        echo "Can't create tempfile!"
+        exit 1
+    fi
+    dd if="${IMAGE}" of="${HASH_FILE}" bs=1 count=$(( SIZE )) 2> /dev/null
+    calc_sha256sum "${HASH_FILE}" "${HASH_HEX_FILE}"
+    rm -f "${HASH_FILE}"
 fi
 
-wait_for_idle
-
 echo "Loading data"
     ${OPENOCD} -f ${DIR}/interface_${ADAPTER}.cfg \
     -c "init; halt;" \
@@ -205,6 +450,7 @@ echo "Loading data"
     -c "mww ${VAR_program_erase_bytes} ${ERASE_BYTES}" \
     -c "mww ${VAR_program_chunk_idx} ${CHUNK_IDX}" \
     -c "mww ${VAR_program_chunk_count} ${CHUNK_COUNT}" \
+    -c "mww ${VAR_program_sparse} ${SPARSE}" \
     -c "load_image ${HASH_HEX_FILE} ${VAR_program_expected_sha256};" \
     -c "echo \"Starting flash process\";" \
     -c "mww ${VAR_program_start} 1" \
@@ -212,35 +458,10 @@ echo "Loading data"
 
 # Remove the temporary hash files
 rm -f "${HASH_HEX_FILE}"
+if [[ ${SPARSE} -eq 1 ]]; then
+    rm -f "${IMAGE}"
+fi
 
 echo "Please see the LCD for interactive status."
 
-# Wait for the final or error state
-while true; do
-    STATE_REG=$(read_word ${VAR_flashapp_state})
-    if [[ "$STATE_REG" == "$FLASHAPP_FINAL" ]]; then
-        echo_green "Done!"
-        exit 0
-    elif [[ "$STATE_REG" == "$FLASHAPP_IDLE" ]]; then
-        echo_green "Done, more chunks left!"
-        exit 0
-    elif [[ "$STATE_REG" == "$FLASHAPP_ERROR" ]]; then
-        STATUS_REG=$(read_word ${VAR_program_status})
-        if [[ "$STATUS_REG" == "$STATUS_BAD_HASH_RAM" ]]; then
-            echo_red "Hash mismatch in RAM. Flashing failed."
-            exit 3
-        elif [[ "$STATUS_REG" == "$STATUS_BAD_HAS_FLASH" ]]; then
-            echo_red "Hash mismatch in FLASH. Flashing failed."
-            exit 3
-        elif [[ "$STATUS_REG" == "$STATUS_NOT_ALIGNED" ]]; then
-            echo_red "Address not 4k aligned. Flashing failed."
-            exit 4
-        else
-            echo_red "Unknown error. Flashing failed. Status: $STATUS_REG"
-            exit 5
-        fi
-    else
-        echo "State: $(state_to_string $STATE_REG)"
-    fi
-    sleep 1
-done
+wait_for_done
@@ -0,0 +1,28 @@
+#!/bin/bash
+# Usage: ./profile_pc.sh pc.txt [samples]
+#
+# Samples the program counter of the running target through the DWT PC
+# sample register, without halting it. Start the emulator to profile first,
+# then turn the samples into a profile with:
+#   tools/placement.py samples build/gw_retro_go.elf pc.txt -o profiles/<emu>.prof
+
+. ./scripts/common.sh
+
+OUTPUT=$1
+SAMPLES=${2:-20000}
+
+if [[ -z "$OUTPUT" ]]; then
+    echo "Usage: $0 <output> [samples]"
+    exit 1
+fi
+
+echo_green "Sampling the PC ${SAMPLES} times..."
+
+# DEMCR.TRCENA enables the DWT, DWT_PCSR returns the PC of a recent instruction
+${OPENOCD} -f scripts/interface_${ADAPTER}.cfg \
+    -c "init" \
+    -c "mww 0xE000EDFC [expr {[mrw 0xE000EDFC] | 0x01000000}]" \
+    -c "for {set i 0} {\$i < ${SAMPLES}} {incr i} { echo [format 0x%08x [mrw 0xE000101C]] }" \
+    -c "exit" 2>&1 | grep "^0x" | grep -v "^0xffffffff" > "$OUTPUT"
+
+echo_green "$(wc -l < "$OUTPUT") samples written to ${OUTPUT}"
@@ -0,0 +1,31 @@
+#!/bin/bash
+
+. ./scripts/common.sh
+
+if [[ $# -lt 1 ]]; then
+    echo "Usage: $(basename $0) <currently_running_binary.elf> [dump file]"
+    echo "This will dump the settings journal from the device and decode it"
+    exit 1
+fi
+
+ELF="$1"
+DUMP=settings.bin
+
+if [[ $# -gt 1 ]]; then
+    DUMP="$2"
+fi
+
+configflash_start=$(get_symbol __CONFIGFLASH_START__)
+configflash_size=$(get_symbol __CONFIGFLASH_LENGTH__)
+configflash2_start=$(get_symbol __CONFIGFLASH2_START__)
+configflash2_size=$(get_symbol __CONFIGFLASH2_LENGTH__)
+
+# The two banks of the journal, one after the other in the dump
+${OPENOCD} -f scripts/interface_${ADAPTER}.cfg -c "init; halt; dump_image \"${DUMP}\" ${configflash_start} ${configflash_size}; dump_image \"${DUMP}.2\" ${configflash2_start} ${configflash2_size}; resume; exit;"
+cat "${DUMP}.2" >> "${DUMP}"
+rm -f "${DUMP}.2"
+
+# Reset the device and disable clocks from running when device is suspended
+reset_and_disable_debug
+
+/usr/bin/env python3 tools/settings_dump.py "${DUMP}"
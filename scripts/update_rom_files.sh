@@ -13,7 +13,7 @@ if [[ ! -e $TMPFILE ]]; then
 	exit 1
 fi
 
-find ${@:2} -type f \( -iname \*.gb -o -iname \*.gbc -o -iname \*.nes -o -iname \*.ggcodes -o -iname \*.gw -o -iname \*.sms -o -iname \*.gg -o -iname \*.sg -o -iname \*.md -o -iname \*.gen -o -iname \*.bin -o -iname \*.col -o -iname \*.pce -o -iname \*.pceplus -o -iname \*.rom -o -iname \*.dsk -o -iname \*.mx1 -o -iname \*.mx2 -o -iname \*.mcf -o -iname \*.bin -o -iname \*.a78 -o -iname \*.png -o -iname \*.jpg -o -iname \*.bmp \) | sort > "${TMPFILE}" 2> /dev/null
+find ${@:2} -type f \( -iname \*.gb -o -iname \*.gbc -o -iname \*.nes -o -iname \*.ggcodes -o -iname \*.gw -o -iname \*.sms -o -iname \*.gg -o -iname \*.sg -o -iname \*.md -o -iname \*.gen -o -iname \*.bin -o -iname \*.col -o -iname \*.pce -o -iname \*.pceplus -o -iname \*.ips -o -iname \*.ups -o -iname \*.bps -o -iname \*.rom -o -iname \*.dsk -o -iname \*.mx1 -o -iname \*.mx2 -o -iname \*.mcf -o -iname \*.bin -o -iname \*.a78 -o -iname \*.png -o -iname \*.jpg -o -iname \*.bmp \) | sort > "${TMPFILE}" 2> /dev/null
 #find ${@:2} -type f | sort > "${TMPFILE}" 2> /dev/null
 
 if ! diff -q ${TMPFILE} ${filelist} > /dev/null 2> /dev/null; then
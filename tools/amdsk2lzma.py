@@ -2,6 +2,8 @@
 import os
 import sys
 
+from amstrad_catalog import metadata_block
+
 def compress_lzma(data):
     import lzma
 
@@ -95,6 +97,10 @@ def analyzeDsk(dskFile,fileName):
         print("unkown disk format")
         compressedDisk = []
 
+    # Catalog and auto-run command, so the emulator doesn't have to read the directory
+    if len(compressedDisk) > 0 and compressedDisk is not dskBytes:
+        compressedDisk += metadata_block(dskBytes)
+
     return compressedDisk
 
 n = len(sys.argv)
@@ -0,0 +1,345 @@
+#!/usr/bin/env python3
+"""
+Build time version of the Amstrad disk catalog and auto-run selection of
+Core/Src/porting/amstrad/amstrad_format.c, amstrad_catalog.c and
+amstrad_loader.c, so the emulator doesn't have to decompress the directory
+tracks at launch.
+
+The result is appended to the .cdk image by tools/amdsk2lzma.py as a
+metadata block, read back by catalog_load_prebuilt(). The block ends with
+its own size and the "CPCM" magic, so images without it still work.
+
+    amstrad_catalog.py game.dsk
+
+prints the catalog and the command that will be typed.
+"""
+
+import struct
+import sys
+from pathlib import Path
+
+META_MAGIC = b"CPCM"
+META_VERSION = 1
+META_COMMAND_SIZE = 32
+META_NAME_SIZE = 14
+META_FLAG_PROBE_CPM = 0x01
+META_FLAG_CAT_ART = 0x02
+
+# amstrad_catalog.h
+CAT_MAX_ENTRY = 64
+
+# amstrad_format.h
+FORMAT_ID_DATA = 0xC0
+FORMAT_ID_SYSTEM = 0x40
+FORMAT_ID_IBM = 0x00
+
+FORMAT_TYPE_UNKNOWN = 0
+FORMAT_TYPE_AMSDOS_DATA = 1
+FORMAT_TYPE_AMSDOS_SYSTEM = 2
+FORMAT_TYPE_AMSDOS_IBM = 3
+FORMAT_TYPE_ROMDOS_D10 = 4
+FORMAT_TYPE_ROMDOS_D01 = 5
+
+# sectors, tracks, sides, sector size, sector id, catalogue sector, type, label
+FORMATS = [
+    (10, 42, 1, 2, FORMAT_ID_DATA, 0, FORMAT_TYPE_AMSDOS_DATA, "DATA_B"),
+    (10, 42, 1, 2, FORMAT_ID_SYSTEM, 2, FORMAT_TYPE_AMSDOS_SYSTEM, "SYSTEM_B"),
+    (9, 42, 1, 2, FORMAT_ID_DATA, 0, FORMAT_TYPE_AMSDOS_DATA, "DATA"),
+    (9, 42, 1, 2, FORMAT_ID_SYSTEM, 2, FORMAT_TYPE_AMSDOS_SYSTEM, "SYSTEM"),
+    (10, 42, 1, 2, FORMAT_ID_IBM, 1, FORMAT_TYPE_AMSDOS_IBM, "IBM"),
+    (10, 80, 2, 2, 0x10, 0, FORMAT_TYPE_ROMDOS_D10, "D10"),
+    (9, 80, 2, 2, 0x00, 0, FORMAT_TYPE_ROMDOS_D01, "D01"),
+]
+
+ENTRY_SIZE = 32
+
+
+class Sector:
+    def __init__(self, info, size, data):
+        self.track, self.side, self.sector_info, self.sector_size = info[0:4]
+        self.size = size
+        self.data = data
+
+
+class Disk:
+    """Uncompressed .dsk image, the way cap32_fdc_load_track() sees it"""
+
+    def __init__(self, data):
+        if data[0:8] == b"EXTENDED":
+            extended = True
+            sides = data[0x31] & 0x03
+            compressed = data[0x32] == 0x01
+        elif data[0:8] == b"MV - CPC":
+            extended = False
+            sides = data[0x31]
+            compressed = data[0x34] == 0x01
+        else:
+            raise ValueError("unknown disk format")
+        if compressed:
+            raise ValueError("disk image is already compressed")
+
+        self.tracks = data[0x30]
+        self.sides = sides
+        self.track_sectors = {}
+
+        offset = 0x100
+        for unit in range(self.tracks * sides):
+            if extended:
+                size = data[0x34 + unit] << 8
+            else:
+                size = data[0x32] | (data[0x33] << 8)
+            if size == 0:
+                continue
+
+            info = data[offset:offset + 0x100]
+            data_offset = offset + 0x100
+            sectors = []
+            for i in range(info[0x15]):
+                sector_info = info[0x18 + i * 8:0x18 + i * 8 + 8]
+                if extended:
+                    sector_size = sector_info[6] | (sector_info[7] << 8)
+                else:
+                    sector_size = 0x80 << info[0x14]
+                sectors.append(Sector(sector_info, sector_size, data[data_offset:data_offset + sector_size]))
+                data_offset += sector_size
+            self.track_sectors[unit] = sectors
+            offset += size
+
+    def load_track(self, track, side=0):
+        return self.track_sectors.get(track * self.sides + side, [])
+
+
+def format_get(disk):
+    """Same quirks as format_get(): the last matching entry wins, "D10" is the fallback"""
+    first_track = disk.load_track(0)
+    found = FORMATS[5]
+
+    if not first_track:
+        return found
+    first_sector = first_track[0]
+
+    for entry in FORMATS:
+        sectors, tracks, sides, sector_size, sector_id = entry[0:5]
+        if (len(first_track) <= sectors and disk.tracks <= tracks and disk.sides <= sides
+                and first_sector.sector_size == sector_size
+                and (first_sector.sector_info & 0xF0) == sector_id):
+            found = entry
+    return found
+
+
+def get_char(c):
+    return c & 0x7F
+
+
+class Catalogue:
+    def __init__(self):
+        self.has_cat_art = False
+        self.probe_cpm = False
+        self.dirent = []  # (filename, is_hidden)
+        self.entries_listed_found = 0
+        self.entries_hidden_found = 0
+        self.first_listed_dirent = 0
+        self.first_hidden_dirent = 0
+        self.track_hidden_id = 0
+        self.track_listed_id = 0
+
+    def add(self, name, track_id, is_hidden):
+        if any(n == name for n, _ in self.dirent) or len(self.dirent) >= CAT_MAX_ENTRY:
+            return
+
+        if is_hidden:
+            if not self.first_hidden_dirent:
+                self.track_hidden_id = track_id
+                self.first_hidden_dirent = len(self.dirent)
+            self.entries_hidden_found += 1
+        else:
+            if not self.entries_listed_found:
+                self.track_listed_id = track_id
+                self.first_listed_dirent = len(self.dirent)
+            self.entries_listed_found += 1
+
+        self.dirent.append((name, is_hidden))
+
+
+def build_name(raw_name, raw_ext):
+    name = ""
+    for c in raw_name[0:8]:
+        if get_char(c) == 0x20:
+            break
+        name += chr(get_char(c))
+    name += "."
+    for c in raw_ext[0:3]:
+        if get_char(c) == 0x20:
+            break
+        name += chr(get_char(c))
+    return name if len(name) > 1 else None
+
+
+def is_catalogue_art(catalogue, entry):
+    idx = 1
+    while idx < ENTRY_SIZE and 0x20 <= get_char(entry[idx]) <= 0x5A:
+        idx += 1
+    if idx >= 1 + 11:
+        return False
+    catalogue.has_cat_art = True
+    return True
+
+
+def is_valid_entry(entry):
+    if not entry[15]:
+        return False
+    return all(get_char(c) != 0x22 for c in entry[1:12])
+
+
+def is_valid_ext(ext, is_cpm):
+    ext = bytes(get_char(c) for c in ext)
+    if is_cpm:
+        return ext == b"COM"
+    return ext in (b"BAS", b"BIN", b"   ")
+
+
+def find_sector(sectors, sector_id):
+    for sector in sectors:
+        if (sector.sector_info & 0x0F) == sector_id and sector.sector_size == 2:
+            return sector
+    return None
+
+
+def catalog_probe(disk, user=0, is_cpm=False):
+    catalogue = Catalogue()
+
+    first_track = disk.load_track(0)
+    if not first_track:
+        return catalogue
+
+    format_id = first_track[0].sector_info & 0xF0
+    if format_id == FORMAT_ID_SYSTEM:
+        catalogue.probe_cpm = True
+    elif format_id not in (FORMAT_ID_DATA, FORMAT_ID_IBM):
+        return catalogue
+
+    # The directory is searched on tracks 0 to 2 whatever the format
+    for track_id in range(3):
+        sectors = disk.load_track(track_id)
+        if not sectors:
+            continue
+
+        for sector_id in range(1, 5):
+            sector = find_sector(sectors, sector_id)
+            if sector is None or not sector.size:
+                continue
+
+            for pos in range(sector.size // ENTRY_SIZE):
+                entry = sector.data[pos * ENTRY_SIZE:(pos + 1) * ENTRY_SIZE]
+                if len(entry) < ENTRY_SIZE or entry[0] != user:
+                    continue
+                if is_catalogue_art(catalogue, entry):
+                    continue
+                if not is_valid_entry(entry):
+                    continue
+                if not is_valid_ext(entry[9:12], is_cpm):
+                    continue
+
+                name = build_name(entry[1:9], entry[9:12])
+                if name is None:
+                    continue
+                catalogue.add(name, track_id, bool(entry[0xA] & 0x80) or catalogue.has_cat_art)
+
+    return catalogue
+
+
+def autorun_command(catalogue, fmt, is_cpm=False):
+    """Same order of checks as _loader_run()"""
+    catalogue_sector = fmt[5]
+
+    def launch(name):
+        return name if is_cpm else 'RUN"' + name
+
+    if catalogue.probe_cpm and not catalogue.entries_listed_found and not catalogue.entries_hidden_found:
+        return "|CPM"
+
+    for prefix in ("DISC", "DISK", "JEU.BAS"):
+        for name, _ in catalogue.dirent:
+            if name.startswith(prefix):
+                return launch(name)
+
+    if catalogue.entries_listed_found == 1 or (
+            is_cpm and catalogue.entries_hidden_found == 1):
+        return launch(catalogue.dirent[catalogue.first_listed_dirent][0])
+
+    if (not catalogue.entries_listed_found and catalogue.entries_hidden_found == 1
+            and catalogue.track_hidden_id == catalogue_sector):
+        return launch(catalogue.dirent[catalogue.first_hidden_dirent][0])
+
+    if catalogue_sector in (catalogue.track_listed_id, catalogue.track_hidden_id):
+        first = {}
+        for idx, (name, _) in enumerate(catalogue.dirent):
+            ext = name.split(".", 1)[1].upper()
+            if ext in ("BAS", "", "BIN"):
+                first.setdefault(ext, idx)
+        for ext in ("BAS", "", "BIN"):
+            if ext in first:
+                return launch(catalogue.dirent[first[ext]][0])
+
+    if is_cpm:
+        return "DIR"
+    if fmt[6] == FORMAT_TYPE_AMSDOS_SYSTEM:
+        return "|CPM"
+    return "CAT"
+
+
+def metadata_block(data):
+    """Metadata block appended to the compressed image, see amstrad_catalog.h"""
+    disk = Disk(data)
+    fmt = format_get(disk)
+    catalogue = catalog_probe(disk)
+    command = autorun_command(catalogue, fmt)
+
+    flags = 0
+    if catalogue.probe_cpm:
+        flags |= META_FLAG_PROBE_CPM
+    if catalogue.has_cat_art:
+        flags |= META_FLAG_CAT_ART
+
+    block = struct.pack(
+        "<BBBBBBBBBBBBBBBB",
+        META_VERSION,
+        fmt[6],
+        fmt[0], fmt[1], fmt[2], fmt[3],
+        fmt[5],
+        flags,
+        len(catalogue.dirent),
+        catalogue.entries_listed_found,
+        catalogue.entries_hidden_found,
+        catalogue.first_listed_dirent,
+        catalogue.first_hidden_dirent,
+        catalogue.track_listed_id,
+        catalogue.track_hidden_id,
+        0,
+    )
+    block += command.encode("ascii").ljust(META_COMMAND_SIZE, b"\0")[:META_COMMAND_SIZE - 1] + b"\0"
+    for name, is_hidden in catalogue.dirent:
+        block += name.encode("ascii").ljust(META_NAME_SIZE - 1, b"\0")[:META_NAME_SIZE - 1] + b"\0"
+        block += struct.pack("<BB", int(is_hidden), 0)
+
+    return block + struct.pack("<I", len(block) + 8) + META_MAGIC
+
+
+def main():
+    if len(sys.argv) != 2:
+        print("Usage: amstrad_catalog.py file.dsk")
+        return 1
+
+    disk = Disk(Path(sys.argv[1]).read_bytes())
+    fmt = format_get(disk)
+    catalogue = catalog_probe(disk)
+
+    print("Format: %s, catalogue on track %d" % (fmt[7], fmt[5]))
+    for name, is_hidden in catalogue.dirent:
+        print("  %-13s%s" % (name, " (hidden)" if is_hidden else ""))
+    print("Auto-run: %s" % autorun_command(catalogue, fmt))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""
+Compiles the cheats of a ROM into the patch table read by
+Core/Src/porting/cheats.c.
+
+parse_roms.py calls it for the PCE .pceplus files, the table is stored in
+the external flash with the ROM. A .pceplus line is a list of commands and
+a description:
+
+    01822fbd,018330bd,r0085 09,  Hacked version, 9 lives
+
+- a ROM patch: the first nibble is the byte count - 1, then 5 digits of
+  address in the ROM (without its header) and the bytes;
+- a RAM write, held after every frame: `r`, 4 digits of address in the
+  8KB work RAM and the bytes.
+
+    cheat_table.py game.pceplus
+    cheat_table.py game.pceplus --c-array CHEAT_TABLE > cheats.c
+"""
+
+import argparse
+import struct
+import sys
+from pathlib import Path
+
+TABLE_VERSION = 1
+CHEAT_ROM = 0
+CHEAT_RAM = 1
+PCE_RAM_SIZE = 0x2000
+
+TABLE_HEADER = struct.Struct("<HBB")
+CHEAT_HEADER = struct.Struct("<HH")
+WRITE_HEADER = struct.Struct("<IHBB")
+
+
+class Cheat:
+    def __init__(self, code, desc, writes):
+        self.code = code      # As written in the cheat file
+        self.desc = desc
+        self.writes = writes  # [(type, address, bytes)]
+
+
+def parse_pceplus_command(command):
+    command = "".join(command.split()).lower()
+
+    if command.startswith("r"):
+        address = int(command[1:5], 16)
+        data = bytes.fromhex(command[5:])
+        if not data or address + len(data) > PCE_RAM_SIZE:
+            raise ValueError("RAM write out of the work RAM")
+        return CHEAT_RAM, address, data
+
+    count = (int(command[0], 16)) + 1
+    address = int(command[1:6], 16)
+    data = bytes.fromhex(command[6 : 6 + count * 2])
+    if len(data) != count:
+        raise ValueError("%d bytes announced, %d given" % (count, len(data)))
+    return CHEAT_ROM, address, data
+
+
+def parse_pceplus(text):
+    cheats = []
+
+    for line in text.splitlines():
+        line = line.strip()
+        if not line or line.startswith("#"):
+            continue
+        parts = line.split(",")
+        commands = [p.strip() for p in parts[:-1] if p.strip()]
+        try:
+            writes = [parse_pceplus_command(c) for c in commands]
+        except ValueError as e:
+            print("WARNING: skipping cheat '%s': %s" % (line, e))
+            continue
+        if writes:
+            cheats.append(Cheat(",".join(commands), parts[-1].strip() or None, writes))
+
+    return cheats
+
+
+def compile_table(cheats):
+    """The table of `cheats`, in the same order as their codes."""
+    records = []
+    for cheat in cheats:
+        record = CHEAT_HEADER.pack(len(cheat.writes), 0)
+        for kind, address, data in cheat.writes:
+            record += WRITE_HEADER.pack(address, len(data), kind, 0)
+            record += data + bytes(-len(data) % 4)
+        records.append(record)
+
+    offset = TABLE_HEADER.size + 4 * len(records)
+    offset += -offset % 4
+    table = TABLE_HEADER.pack(len(records), TABLE_VERSION, 0)
+    for record in records:
+        table += struct.pack("<I", offset)
+        offset += len(record)
+    table += bytes(-len(table) % 4)
+
+    return table + b"".join(records)
+
+
+def c_array(name, table, attributes=""):
+    body = ",".join("0x%02x" % b for b in table)
+    return "const uint8_t %s[%d]%s __attribute__((aligned(4))) = {%s};\n" % (name, len(table), attributes, body)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile a .pceplus file into a cheat table")
+    parser.add_argument("file", type=Path)
+    parser.add_argument("--c-array", metavar="NAME", help="print the table as a C array")
+    args = parser.parse_args()
+
+    cheats = parse_pceplus(args.file.read_text())
+    table = compile_table(cheats)
+
+    if args.c_array:
+        sys.stdout.write("#include <stdint.h>\n")
+        sys.stdout.write(c_array(args.c_array, table))
+        return 0
+
+    for i, cheat in enumerate(cheats):
+        ram = sum(1 for kind, _, _ in cheat.writes if kind == CHEAT_RAM)
+        print("%3d: %d ROM, %d RAM writes  %s" % (i, len(cheat.writes) - ram, ram, cheat.desc or cheat.code))
+    print("%d cheats, %d bytes" % (len(cheats), len(table)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
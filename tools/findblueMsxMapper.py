@@ -269,7 +269,7 @@ def getRomMapper(collection,sha1):
             for rom in dump.getElementsByTagName('rom'):
                 hash = rom.getElementsByTagName('hash')[0].childNodes[0].data
                 mapper = ROM_PLAIN
-                if (hash == sha1string):
+                if (hash == sha1):
                     if (rom.getElementsByTagName('type')):
                         mapper = getMapperValue(rom.getElementsByTagName('type')[0].childNodes[0].data)
                         if (mapper == ROM_STANDARD):
@@ -284,38 +284,43 @@ def getRomMapper(collection,sha1):
                     return mapper
             for megarom in dump.getElementsByTagName('megarom'):
                 hash = megarom.getElementsByTagName('hash')[0].childNodes[0].data
-                if sha1string == hash:
+                if sha1 == hash:
                     type = megarom.getElementsByTagName('type')[0].childNodes[0].data
                     return getMapperValue(type)
     return ROM_UNKNOWN
 
 BUF_SIZE = 65536  # lets read stuff in 64kb chunks!
 
-n = len(sys.argv)
+def main():
+    n = len(sys.argv)
 
-if n < 2:
-    print("Usage :\nrfindBlueMsxMapper.py database.xml file.rom \n")
-    sys.exit(0)
+    if n < 2:
+        print("Usage :\nrfindBlueMsxMapper.py database.xml file.rom \n")
+        return 0
 
-# Open file
-#print("Opening "+sys.argv[2])
-sha1 = hashlib.sha1()
+    # Open file
+    #print("Opening "+sys.argv[2])
+    sha1 = hashlib.sha1()
 
-with open(sys.argv[2], 'rb') as f:
-    while True:
-        data = f.read(BUF_SIZE)
-        if not data:
-            break
-        sha1.update(data)
+    with open(sys.argv[2], 'rb') as f:
+        while True:
+            data = f.read(BUF_SIZE)
+            if not data:
+                break
+            sha1.update(data)
 
-sha1string = sha1.hexdigest()
-#print("Rom SHA1: %s" % sha1string)
+    sha1string = sha1.hexdigest()
+    #print("Rom SHA1: %s" % sha1string)
 
-DOMTree = xml.dom.minidom.parse(sys.argv[1])
-collection = DOMTree.documentElement
+    DOMTree = xml.dom.minidom.parse(sys.argv[1])
+    collection = DOMTree.documentElement
 
-print(getRomMapper(collection,sha1string))
-sys.exit(0)
+    print(getRomMapper(collection,sha1string))
+    return 0
+
+# Also imported by romdb.py for the mapper numbers
+if __name__ == "__main__":
+    sys.exit(main())
 
 #tree = ElementTree.parse(sys.argv[1])
 #root = tree.getroot()
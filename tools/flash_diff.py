@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""
+Block level diff of external flash images, used by scripts/flash_multi.sh
+when DIFF=1.
+
+The image is split in BLOCK_SIZE blocks (the smallest erase size of the
+supported flash chips) and a manifest with the binary sha256 of every block
+is generated at build time. The flashapp hashes the same blocks on the
+device and reports the ones that differ in a bitmap (one bit per block,
+little endian uint32 words). Only those blocks are then packed back to back
+and programmed.
+
+    flash_diff.py manifest build/gw_retro_go_extflash.bin build/gw_retro_go_extflash.blocks
+    flash_diff.py plan old.bin new.bin --bitmap dirty.bin
+    flash_diff.py pack new.bin dirty.bin packed.bin
+
+'plan' runs the same comparison as the device between two image files, so
+the planning can be checked on the host.
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+from pathlib import Path
+
+BLOCK_SIZE = 4 * 1024
+HASH_SIZE = 32
+
+
+def block_hashes(data, block_size=BLOCK_SIZE):
+    return [
+        hashlib.sha256(data[i : i + block_size]).digest()
+        for i in range(0, len(data), block_size)
+    ]
+
+
+def dirty_blocks(old_hashes, new_hashes):
+    """Indices of the blocks of the new image that have to be programmed."""
+    dirty = []
+    for i, new in enumerate(new_hashes):
+        if i >= len(old_hashes) or old_hashes[i] != new:
+            dirty.append(i)
+    return dirty
+
+
+def bitmap_from_blocks(blocks, block_count):
+    words = [0] * ((block_count + 31) // 32)
+    for i in blocks:
+        words[i // 32] |= 1 << (i % 32)
+    return struct.pack("<%dI" % len(words), *words)
+
+
+def blocks_from_bitmap(bitmap, block_count):
+    words = struct.unpack("<%dI" % (len(bitmap) // 4), bitmap)
+    return [i for i in range(block_count) if words[i // 32] & (1 << (i % 32))]
+
+
+def pack_blocks(data, blocks, block_size=BLOCK_SIZE):
+    return b"".join(data[i * block_size : (i + 1) * block_size] for i in blocks)
+
+
+def ranges(blocks):
+    """Merges consecutive block indices into (first, count) tuples."""
+    out = []
+    for i in blocks:
+        if out and out[-1][0] + out[-1][1] == i:
+            out[-1] = (out[-1][0], out[-1][1] + 1)
+        else:
+            out.append((i, 1))
+    return out
+
+
+def cmd_manifest(args):
+    data = Path(args.image).read_bytes()
+    Path(args.output).write_bytes(b"".join(block_hashes(data, args.block_size)))
+
+
+def cmd_plan(args):
+    old = Path(args.old).read_bytes()
+    new = Path(args.new).read_bytes()
+    new_hashes = block_hashes(new, args.block_size)
+    dirty = dirty_blocks(block_hashes(old, args.block_size), new_hashes)
+
+    for first, count in ranges(dirty):
+        print("0x%08x-0x%08x (%d blocks)" % (first * args.block_size, (first + count) * args.block_size, count))
+
+    packed = len(pack_blocks(new, dirty, args.block_size))
+    print("%d / %d blocks changed, %d / %d bytes to program" % (len(dirty), len(new_hashes), packed, len(new)))
+
+    if args.bitmap:
+        Path(args.bitmap).write_bytes(bitmap_from_blocks(dirty, len(new_hashes)))
+
+
+def cmd_pack(args):
+    data = Path(args.image).read_bytes()
+    block_count = (len(data) + args.block_size - 1) // args.block_size
+    blocks = blocks_from_bitmap(Path(args.bitmap).read_bytes(), block_count)
+
+    Path(args.output).write_bytes(pack_blocks(data, blocks, args.block_size))
+
+    # Consumed by flashapp.sh
+    print(len(blocks))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Block level diff of external flash images")
+    parser.add_argument("--block-size", type=int, default=BLOCK_SIZE)
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("manifest", help="write the sha256 of every block of an image")
+    p.add_argument("image")
+    p.add_argument("output")
+    p.set_defaults(func=cmd_manifest)
+
+    p = sub.add_parser("plan", help="list the blocks that differ between two images")
+    p.add_argument("old")
+    p.add_argument("new")
+    p.add_argument("--bitmap", help="also write the dirty block bitmap, as the flashapp does")
+    p.set_defaults(func=cmd_plan)
+
+    p = sub.add_parser("pack", help="pack the blocks set in a dirty bitmap back to back")
+    p.add_argument("image")
+    p.add_argument("bitmap")
+    p.add_argument("output")
+    p.set_defaults(func=cmd_pack)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,334 @@
+#!/usr/bin/env python3
+"""
+Memory budget report from the ELF and the linker map, used by "make size_report".
+
+Prints:
+  - the usage and free headroom of every memory region of the linker script,
+  - the code/data/bss split of every emulator overlay and its headroom in RAM_EMU,
+  - the same for the ITCM overlays of the emulators, with the ITCM left for
+    the ITC heap,
+  - the largest objects in every region.
+
+The overlays all start at __RAM_EMU_START__ (and __itcram_emu_start__ for
+ITCM), so their region is reported with the largest of them.
+
+    memory_budget.py build/gw_retro_go.elf build/gw_retro_go.map
+    memory_budget.py build/gw_retro_go.elf build/gw_retro_go.map --save baseline.json
+    memory_budget.py build/gw_retro_go.elf build/gw_retro_go.map --baseline baseline.json
+
+With --baseline only the entries that changed are listed, with their delta.
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+from collections import defaultdict
+from pathlib import Path
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+PT_LOAD = 1
+
+# Regions that only hold a copy of code/data that runs from RAM, they are
+# accounted with the load address of the sections.
+LOAD_REGIONS = ("FLASH", "FLASH2", "EXTFLASH")
+
+
+def parse_elf(path):
+    """Returns the allocated sections as (name, vma, lma, size, nobits)."""
+    data = Path(path).read_bytes()
+
+    if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+        raise ValueError("%s: not a little endian ELF32 file" % path)
+
+    (e_phoff, e_shoff) = struct.unpack_from("<II", data, 0x1C)
+    (e_phentsize, e_phnum, e_shentsize, e_shnum, e_shstrndx) = struct.unpack_from("<HHHHH", data, 0x2A)
+
+    segments = []
+    for i in range(e_phnum):
+        p_type, _, p_vaddr, p_paddr, p_filesz, p_memsz = struct.unpack_from("<IIIIII", data, e_phoff + i * e_phentsize)
+        if p_type == PT_LOAD:
+            segments.append((p_vaddr, p_paddr, p_memsz))
+
+    headers = [struct.unpack_from("<IIIIIIIIII", data, e_shoff + i * e_shentsize) for i in range(e_shnum)]
+    strtab_offset = headers[e_shstrndx][4]
+
+    def name(offset):
+        end = data.index(b"\0", strtab_offset + offset)
+        return data[strtab_offset + offset : end].decode()
+
+    sections = []
+    for sh_name, sh_type, sh_flags, sh_addr, _, sh_size, *_ in headers:
+        if not (sh_flags & SHF_ALLOC) or sh_size == 0:
+            continue
+
+        lma = sh_addr
+        for vaddr, paddr, memsz in segments:
+            if vaddr <= sh_addr < vaddr + memsz:
+                lma = paddr + sh_addr - vaddr
+                break
+
+        sections.append((name(sh_name), sh_addr, lma, sh_size, sh_type == SHT_NOBITS))
+
+    return sections
+
+
+def short_object(path):
+    # libc_nano.a(lib_a-memcpy.o) -> libc_nano.a(memcpy.o)
+    m = re.match(r".*/([^/]+\.a)\((?:lib_a-)?(.+)\)$", path)
+    if m:
+        return "%s(%s)" % m.groups()
+    return path
+
+
+def parse_map(path):
+    """Returns (regions, contributions).
+
+    regions: {name: (origin, length)} from the memory configuration.
+    contributions: [(output section, input section, size, object)].
+    """
+    regions = {}
+    contributions = []
+
+    lines = Path(path).read_text(errors="replace").splitlines()
+
+    region_re = re.compile(r"^(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)")
+    output_re = re.compile(r"^(\.?[\w.]+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+))?")
+    input_re = re.compile(r"^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+    # Long input section names are alone on their line, script patterns
+    # such as "build/nes/*.o(.text*)" are not input sections
+    input_name_re = re.compile(r"^ ([^\s(]+)$")
+    input_cont_re = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+
+    i = 0
+    while i < len(lines) and not lines[i].startswith("Memory Configuration"):
+        i += 1
+    i += 1
+    while i < len(lines) and not lines[i].startswith("Linker script and memory map"):
+        m = region_re.match(lines[i])
+        if m and m.group(1) != "*default*" and m.group(1) != "Name":
+            regions[m.group(1)] = (int(m.group(2), 16), int(m.group(3), 16))
+        i += 1
+
+    output = None
+    pending = None
+    for line in lines[i:]:
+        if pending is not None:
+            m = input_cont_re.match(line)
+            name = pending
+            pending = None
+            if m:
+                contributions.append((output, name, int(m.group(2), 16), short_object(m.group(3))))
+                continue
+
+        if line and not line[0].isspace():
+            m = output_re.match(line)
+            output = m.group(1) if m else None
+            continue
+
+        if output is None:
+            continue
+
+        m = input_re.match(line)
+        if m:
+            size = int(m.group(3), 16)
+            if size and not m.group(1).startswith("*"):
+                contributions.append((output, m.group(1), size, short_object(m.group(4))))
+            continue
+
+        m = input_name_re.match(line)
+        if m and not m.group(1).startswith("*"):
+            pending = m.group(1)
+
+    return regions, contributions
+
+
+def region_of(regions, address):
+    # The smallest region wins, RAM_EMU and the overlays sit inside RAM ranges
+    best = None
+    for name, (origin, length) in regions.items():
+        if origin <= address < origin + length:
+            if best is None or length < regions[best][1]:
+                best = name
+    return best
+
+
+# Overlay output sections: .overlay_<emu>[_bss] in RAM_EMU, .itcram_<emu>[_bss] in ITCM
+OVERLAY_KINDS = {"overlay": "overlays", "itcram": "itcm_overlays"}
+
+
+def overlay_of(section):
+    """Returns (report key, emulator) or None."""
+    m = re.match(r"^\.(overlay|itcram)_(\w+?)(_bss)?$", section)
+    return (OVERLAY_KINDS[m.group(1)], m.group(2)) if m else None
+
+
+def is_space_check(section):
+    # Only reserves the space of an overlay for a link time check
+    return section.startswith("._ram_space_check")
+
+
+def input_kind(input_section, nobits):
+    if nobits or input_section.startswith((".bss", "COMMON")):
+        return "bss"
+    if input_section.startswith(".text") or "_text" in input_section:
+        return "code"
+    return "data"
+
+
+def build_report(elf_path, map_path, top):
+    sections = parse_elf(elf_path)
+    regions, contributions = parse_map(map_path)
+
+    section_info = {name: (vma, lma, size, nobits) for name, vma, lma, size, nobits in sections}
+
+    usage = defaultdict(int)
+    overlays = {kind: defaultdict(lambda: {"code": 0, "data": 0, "bss": 0}) for kind in OVERLAY_KINDS.values()}
+    overlay_regions = {}
+
+    for name, vma, lma, size, nobits in sections:
+        if is_space_check(name):
+            continue
+        region = region_of(regions, vma)
+        overlay = overlay_of(name)
+        if overlay:
+            overlay_regions[overlay[0]] = region
+        else:
+            usage[region] += size
+
+        # Initialized sections running from RAM also take their size in flash
+        if not nobits and lma != vma:
+            load_region = region_of(regions, lma)
+            if load_region in LOAD_REGIONS:
+                usage[load_region] += size
+
+    objects = defaultdict(lambda: defaultdict(int))
+    for output, input_section, size, obj in contributions:
+        if output not in section_info:
+            continue
+        vma, _, _, nobits = section_info[output]
+        overlay = overlay_of(output)
+        if overlay:
+            kind, emu = overlay
+            overlays[kind][emu][input_kind(input_section, nobits)] += size
+            objects["%s %s" % ("overlay" if kind == "overlays" else "itcm", emu)][obj] += size
+        elif not is_space_check(output):
+            objects[region_of(regions, vma)][obj] += size
+
+    # Sections without a map entry (linker generated) still count in the overlays
+    for name, (vma, _, size, nobits) in section_info.items():
+        overlay = overlay_of(name)
+        if overlay:
+            accounted = sum(s for o, _, s, _ in contributions if o == name)
+            if size > accounted:
+                overlays[overlay[0]][overlay[1]]["bss" if nobits else "data"] += size - accounted
+
+    # What the region has left once its other sections are placed
+    overlay_space = {
+        kind: regions[region][1] - usage[region] for kind, region in overlay_regions.items() if region is not None
+    }
+    for kind, region in overlay_regions.items():
+        if region is not None and overlays[kind]:
+            usage[region] += max(sum(o.values()) for o in overlays[kind].values())
+
+    report = {
+        "regions": {
+            name: {"used": usage.get(name, 0), "size": length}
+            for name, (origin, length) in sorted(regions.items(), key=lambda r: r[1][0])
+        },
+        "overlays": {},
+        "itcm_overlays": {},
+        "objects": {},
+    }
+
+    for kind, space in overlay_space.items():
+        for name, split in sorted(overlays[kind].items()):
+            report[kind][name] = dict(split, size=space)
+
+    for region, objs in objects.items():
+        largest = sorted(objs.items(), key=lambda o: -o[1])[:top]
+        report["objects"][region or "?"] = dict(largest)
+
+    return report
+
+
+def fmt_kb(n):
+    return "%8.1fk" % (n / 1024)
+
+
+def fmt_delta(n):
+    # Bytes, the changes are usually small
+    return "%+9d" % n if n else ""
+
+
+def print_report(report, baseline):
+    def delta(path, value):
+        node = baseline
+        for key in path:
+            node = node.get(key, {}) if isinstance(node, dict) else {}
+        return value - node if isinstance(node, int) else value
+
+    print("%-14s %9s %9s %9s %6s" % ("Region", "Used", "Size", "Free", "Use"))
+    for name, r in report["regions"].items():
+        if r["size"] == 0:
+            continue
+        d = delta(("regions", name, "used"), r["used"]) if baseline else 0
+        if baseline and not d:
+            continue
+        print("%-14s %s %s %s %5.1f%% %s" % (
+            name, fmt_kb(r["used"]), fmt_kb(r["size"]), fmt_kb(r["size"] - r["used"]),
+            100 * r["used"] / r["size"], fmt_delta(d)))
+
+    for kind, title in (("overlays", "Overlay"), ("itcm_overlays", "ITCM overlay")):
+        if not report.get(kind):
+            continue
+        print()
+        print("%-14s %9s %9s %9s %9s" % (title, "Code", "Data", "BSS", "Free"))
+        for name, o in report[kind].items():
+            total = o["code"] + o["data"] + o["bss"]
+            d = delta((kind, name, "code"), o["code"]) + delta((kind, name, "data"), o["data"]) + \
+                delta((kind, name, "bss"), o["bss"]) if baseline else 0
+            if baseline and not d:
+                continue
+            print("%-14s %s %s %s %s %s" % (
+                name, fmt_kb(o["code"]), fmt_kb(o["data"]), fmt_kb(o["bss"]), fmt_kb(o["size"] - total), fmt_delta(d)))
+
+    for region, objs in sorted(report["objects"].items()):
+        lines = []
+        for obj, size in objs.items():
+            d = delta(("objects", region, obj), size) if baseline else 0
+            if baseline and not d:
+                continue
+            lines.append("  %s %s  %s" % (fmt_kb(size), fmt_delta(d), obj))
+        if lines:
+            print()
+            print(region)
+            print("\n".join(lines))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Memory budget report from the ELF and the linker map")
+    parser.add_argument("elf")
+    parser.add_argument("map")
+    parser.add_argument("--top", type=int, default=10, help="number of objects listed per region")
+    parser.add_argument("--baseline", help="only list what changed since this report")
+    parser.add_argument("--save", help="store the report as a baseline")
+    args = parser.parse_args()
+
+    report = build_report(args.elf, args.map, args.top)
+
+    baseline = None
+    if args.baseline and Path(args.baseline).exists():
+        baseline = json.loads(Path(args.baseline).read_text())
+        print("Changes since %s\n" % args.baseline)
+
+    print_report(report, baseline)
+
+    if args.save:
+        Path(args.save).write_text(json.dumps(report, indent=2) + "\n")
+
+
+if __name__ == "__main__":
+    sys.exit(main())
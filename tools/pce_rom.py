@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""
+Lays out the PC Engine ROMs the way the emulator maps them.
+
+parse_roms.py calls it after the patches are applied, the emulator then
+maps the ROM without touching it, see Core/Inc/porting/pce/pce_rom.h:
+
+- the copier header is removed, the ROM starts at its first 8KB bank;
+- the US HuCards are decoded, the bits of each byte are reversed again;
+- a compressed ROM is a PCE+ image, compressed bank by bank. Only the
+  banks that save flash are compressed, up to the RAM the emulator can
+  decode them to, the others are executed from the flash.
+
+    pce_rom.py roms/pce/Game.pce -o Game.bin
+    pce_rom.py roms/pce/Game.pce -o Game.bin --compress lzma --c-defines
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+from pathlib import Path
+
+try:
+    from tools import romdb
+except ImportError:
+    import romdb
+
+MAGIC = b"PCE+"
+BANK_SIZE = 0x2000
+MAX_BANKS = 0x80     # Larger ROMs use the SF2 mapper, from a contiguous ROM
+MIN_SAVING = 1024    # Bytes of flash a bank must save to be worth decoding
+
+BIT_REVERSE = bytes(int("{:08b}".format(i)[::-1], 2) for i in range(256))
+
+
+def normalize(data, flags):
+    """`data` and `flags` of the ROM as the emulator maps it."""
+    data = data[len(data) % BANK_SIZE :]
+    if "PCE_US_ENCODED" in flags:
+        data = data.translate(BIT_REVERSE)
+        flags = flags - {"PCE_US_ENCODED"}
+    return data, flags
+
+
+def needs_normalize(size, flags):
+    """Whether a ROM of `size` bytes changes when it is normalized."""
+    return size % BANK_SIZE != 0 or "PCE_US_ENCODED" in flags
+
+
+def legacy_crc32(data, stored_size):
+    """Key of the save states of the ROM `data` made before its crc32 was.
+
+    The emulator hashed the first `stored_size` bytes of the ROM it decoded,
+    copier header and US encoding included, `stored_size` being the size of
+    the ROM in the flash, compressed or not. From 192 banks, the first 4KB.
+    """
+    if len(data) // BANK_SIZE >= 192:
+        stored_size = 4096
+    return zlib.crc32(data[:stored_size]) & 0xFFFFFFFF
+
+
+def pack(data, compress, ram_size):
+    """PCE+ image of the normalized ROM `data`, None when no bank is worth it.
+
+    `compress` compresses a bank, at most `ram_size` bytes of banks are
+    compressed, the ones that save the most flash.
+    """
+    banks = [data[i : i + BANK_SIZE] for i in range(0, len(data), BANK_SIZE)]
+    if not banks or len(banks) > MAX_BANKS:
+        return None
+
+    compressed = [compress(bank) for bank in banks]
+    best = sorted(range(len(banks)), key=lambda i: len(compressed[i]))
+    packed = {i for i in best[: ram_size // BANK_SIZE] if BANK_SIZE - len(compressed[i]) >= MIN_SAVING}
+    if not packed:
+        return None
+
+    sizes = [len(compressed[i]) if i in packed else 0 for i in range(len(banks))]
+    output = [MAGIC, struct.pack("<HH", len(banks), 0), struct.pack("<%dI" % len(sizes), *sizes)]
+    for i, bank in enumerate(banks):
+        if i in packed:
+            output.append(compressed[i] + bytes(-len(compressed[i]) % 4))
+        else:
+            output.append(bank)
+    return b"".join(output)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Lay out a PC Engine ROM like parse_roms.py does")
+    parser.add_argument("rom", type=Path)
+    parser.add_argument("-o", "--output", type=Path, required=True)
+    parser.add_argument("--compress", help="lz4, zopfli or lzma, a PCE+ image")
+    parser.add_argument("--ram", type=lambda x: int(x, 0), default=0x49000, help="bytes of RAM for the compressed banks")
+    parser.add_argument("--c-defines", action="store_true", help="print ROM_CRC32 and ROM_FLAGS for the linux/ builds")
+    args = parser.parse_args()
+
+    info = romdb.RomDb().identify("pce", args.rom.read_bytes())
+    data, info.flags = normalize(args.rom.read_bytes(), info.flags)
+
+    if args.compress:
+        sys.path.insert(0, str(romdb.ROOT))
+        from parse_roms import COMPRESSIONS
+
+        image = pack(data, COMPRESSIONS[args.compress], args.ram)
+        if image is None:
+            print("%s: no bank is worth compressing, stored as is" % args.rom.name, file=sys.stderr)
+        data = image or data
+
+    args.output.write_bytes(data)
+
+    if args.c_defines:
+        print('#include "rom_flags.h"')
+        print("const uint32_t ROM_CRC32 = 0x%08x;" % info.crc32)
+        print("const uint16_t ROM_FLAGS = %s;" % info.c_flags)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,319 @@
+#!/usr/bin/env python3
+"""
+Profile guided code placement.
+
+Profiles are plain text files in profiles/, one per emulator, one function
+per line:
+
+    # samples  size  file                   function
+    18231      412   build/nes/nes6502.o    nes6502_execute
+    ...
+
+'size' is the function size in bytes in the firmware the profile was taken
+with and 'file' the object of the function, from the map file of the
+firmware, or its source file when the map doesn't tell. The placement is
+generated from the checked-in profiles alone, without the firmware.
+
+Profiles are made from:
+  - PC samples of the target (scripts/profile_pc.sh reads DWT_PCSR through
+    the debugger), resolved with the firmware ELF:
+        placement.py samples build/gw_retro_go.elf pc.txt -o profiles/nes.prof
+  - perf runs of the linux/ builds (perf report --stdio --no-children --sort sym),
+    with the sizes taken from the firmware ELF:
+        placement.py perf build/gw_retro_go.elf perf.txt -o profiles/nes.prof
+
+'generate' picks the functions with the most samples per byte until the
+budget of each region is used and writes linker script fragments:
+        placement.py generate profiles/*.prof --itcm 4096 --itcm-emu 8192 --outdir build
+
+- the functions of an emulator object (build/nes/...) go to the ITCM overlay
+  of that emulator, placement_itcm_nes.ld in .itcram_nes, up to --itcm-emu
+  bytes each. The rest of its objects already runs from RAM_EMU;
+- the others go to ._itcram_hot (placement_itcm.ld), resident in ITCM for
+  every emulator, then to ._ram_exec (placement_ram_exec.ld). Every profile
+  has the same weight there, whatever its number of samples, as each
+  emulator only runs on its own.
+"""
+
+import argparse
+import bisect
+import re
+import struct
+import sys
+from collections import defaultdict
+from pathlib import Path
+
+STB_LOCAL = 0
+STT_FUNC = 2
+STT_FILE = 4
+SHT_SYMTAB = 2
+
+# Padding assumed between functions, they are 4 byte aligned at most
+FUNCTION_ALIGN = 4
+
+# ITCM overlay of each emulator and the build directory of its objects, see
+# .itcram_<emu> in STM32H7B0VBTx_FLASH.ld
+OVERLAYS = {
+    "nes": "nes",
+    "gb": "gnuboy",
+    "sms": "smsplusgx",
+    "pce": "pce",
+    "msx": "msx",
+    "wsv": "wsv",
+    "gw": "gw",
+    "md": "md",
+    "a7800": "a7800",
+    "amstrad": "amstrad",
+}
+
+
+def elf_functions(path):
+    """Returns [(address, size, file, name)] sorted by address."""
+    data = Path(path).read_bytes()
+
+    if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+        raise ValueError("%s: not a little endian ELF32 file" % path)
+
+    e_shoff = struct.unpack_from("<I", data, 0x20)[0]
+    e_shentsize, e_shnum = struct.unpack_from("<HH", data, 0x2E)
+    headers = [struct.unpack_from("<IIIIIIIIII", data, e_shoff + i * e_shentsize) for i in range(e_shnum)]
+
+    functions = []
+    for sh_type, sh_offset, sh_size, sh_link, sh_entsize in (
+        (h[1], h[4], h[5], h[6], h[9]) for h in headers
+    ):
+        if sh_type != SHT_SYMTAB:
+            continue
+
+        strtab = headers[sh_link][4]
+
+        def name(offset):
+            end = data.index(b"\0", strtab + offset)
+            return data[strtab + offset : end].decode(errors="replace")
+
+        current_file = ""
+        for i in range(sh_size // sh_entsize):
+            st_name, st_value, st_size, st_info, _, _ = struct.unpack_from("<IIIBBH", data, sh_offset + i * sh_entsize)
+            st_type = st_info & 0xF
+            if st_type == STT_FILE:
+                current_file = name(st_name)
+            elif st_type == STT_FUNC and st_size:
+                # Global symbols come after all the locals, only the local
+                # ones can be tied to their file and need to be.
+                file = current_file if (st_info >> 4) == STB_LOCAL else ""
+                # Clear the thumb bit
+                functions.append((st_value & ~1, st_size, file, name(st_name)))
+
+    return sorted(set(functions))
+
+
+def map_objects(path):
+    """Returns {function: [object]} of the .text.<function> input sections."""
+    objects = defaultdict(list)
+    if path is None or not Path(path).exists():
+        return objects
+    text = Path(path).read_text(errors="replace")
+    # " .text.name  0xaddress  0xsize  build/nes/file.o", the name is on a
+    # line of its own when it is long
+    for m in re.finditer(r"^ \.text\.(\S+)\s+0x[0-9a-fA-F]+\s+0x[0-9a-fA-F]+\s+(\S+\.o)$", text, re.M):
+        if m.group(2) not in objects[m.group(1)]:
+            objects[m.group(1)].append(m.group(2))
+    return objects
+
+
+def object_of(objects, file, func):
+    """The object of `func` from `file`, `file` itself when unknown."""
+    candidates = objects.get(func, [])
+    if file:
+        stem = Path(file).stem
+        candidates = [obj for obj in candidates if Path(obj).stem == stem]
+    return candidates[0] if len(candidates) == 1 else file
+
+
+def default_map(elf):
+    return str(Path(elf).with_suffix(".map"))
+
+
+def write_profile(path, counts, sizes, comment):
+    with open(path, "w") as f:
+        f.write("# %s\n" % comment)
+        f.write("# samples  size  file  function\n")
+        for key, count in sorted(counts.items(), key=lambda c: -c[1]):
+            file, func = key
+            f.write("%d %d %s %s\n" % (count, sizes[key], file or "-", func))
+
+
+def read_profile(path):
+    """Returns {(file, function): (samples, size)}."""
+    profile = {}
+    for line in Path(path).read_text().splitlines():
+        line = line.strip()
+        if not line or line.startswith("#"):
+            continue
+        samples, size, file, func = line.split()
+        profile[(file if file != "-" else "", func)] = (int(samples), int(size))
+    return profile
+
+
+def cmd_samples(args):
+    functions = elf_functions(args.elf)
+    objects = map_objects(args.map or default_map(args.elf))
+    starts = [f[0] for f in functions]
+
+    counts = defaultdict(int)
+    sizes = {}
+    total = 0
+    for line in Path(args.samples).read_text().split():
+        pc = int(line, 16) & ~1
+        i = bisect.bisect_right(starts, pc) - 1
+        total += 1
+        if i < 0:
+            continue
+        address, size, file, func = functions[i]
+        if pc < address + size:
+            key = (object_of(objects, file, func), func)
+            counts[key] += 1
+            sizes[key] = size
+
+    write_profile(args.output, counts, sizes, "%d PC samples, %d in known functions" % (total, sum(counts.values())))
+
+
+def cmd_perf(args):
+    objects = map_objects(args.map or default_map(args.elf))
+    by_name = defaultdict(list)
+    for _, size, file, func in elf_functions(args.elf):
+        by_name[func].append((object_of(objects, file, func), size))
+
+    # "    12.34%  nes  nes  [.] nes6502_execute"
+    perf_re = re.compile(r"^\s*([0-9.]+)%.*\[\.\]\s+(\S+)")
+
+    counts = defaultdict(int)
+    sizes = {}
+    for line in Path(args.report).read_text().splitlines():
+        m = perf_re.match(line)
+        if not m or m.group(2) not in by_name:
+            continue
+        # Percentages are turned into samples per 10000
+        samples = int(float(m.group(1)) * 100)
+        file, size = by_name[m.group(2)][0]
+        counts[(file, m.group(2))] += samples
+        sizes[(file, m.group(2))] = size
+
+    write_profile(args.output, counts, sizes, "perf report %s" % args.report)
+
+
+def section_pattern(file, func):
+    # Input sections come from -ffunction-sections, the file keeps static
+    # functions of the same name apart. An object is matched through a
+    # wildcard, ld would try to open a plain name that isn't an input.
+    if file.endswith(".o"):
+        return "*%s(.text.%s)" % (file, func)
+    if file:
+        obj = re.sub(r"\.[cS]$", ".o", Path(file).name)
+        return "*%s(.text.%s)" % (obj, func)
+    return "*(.text.%s)" % func
+
+
+def pick(candidates, budget):
+    chosen = []
+    used = 0
+    for key, weight, size in candidates:
+        aligned = (size + FUNCTION_ALIGN - 1) & ~(FUNCTION_ALIGN - 1)
+        if used + aligned <= budget:
+            chosen.append(key)
+            used += aligned
+    return chosen, used
+
+
+def overlay_of(file):
+    """The emulator whose ITCM overlay takes the functions of `file`, if any."""
+    for emu, directory in OVERLAYS.items():
+        if file.startswith("build/%s/" % directory):
+            return emu
+    return None
+
+
+def write_fragment(path, region, keys, used, budget):
+    with open(path, "w") as f:
+        f.write("/* Generated by tools/placement.py, do not edit */\n")
+        f.write("/* %s: %d functions, %d / %d bytes */\n" % (region, len(keys), used, budget))
+        for file, func in keys:
+            f.write("%s\n" % section_pattern(file, func))
+
+
+def cmd_generate(args):
+    weights = defaultdict(float)
+    sizes = {}
+
+    for path in args.profiles:
+        profile = read_profile(path)
+        total = sum(samples for samples, _ in profile.values())
+        if total == 0:
+            continue
+        for key, (samples, size) in profile.items():
+            weights[key] += samples / total
+            sizes[key] = max(size, sizes.get(key, 0))
+
+    # Most samples per byte first, name as tie break to keep the output stable
+    candidates = sorted(
+        ((key, weight, sizes[key]) for key, weight in weights.items() if sizes[key] > 0),
+        key=lambda c: (-c[1] / c[2], c[0]),
+    )
+
+    outdir = Path(args.outdir)
+    outdir.mkdir(parents=True, exist_ok=True)
+    regions = []
+
+    # Each overlay is only loaded with its emulator, its budget is its own
+    for emu in OVERLAYS:
+        keys, used = pick([c for c in candidates if overlay_of(c[0][0]) == emu], args.itcm_emu)
+        write_fragment(outdir / ("placement_itcm_%s.ld" % emu), "ITCM %s" % emu, keys, used, args.itcm_emu)
+        regions.append(("ITCM " + emu, keys))
+
+    shared = [c for c in candidates if overlay_of(c[0][0]) is None]
+    itcm, itcm_used = pick(shared, args.itcm)
+    placed = set(itcm)
+    ram_exec, ram_exec_used = pick([c for c in shared if c[0] not in placed], args.ram_exec)
+    write_fragment(outdir / "placement_itcm.ld", "ITCM", itcm, itcm_used, args.itcm)
+    write_fragment(outdir / "placement_ram_exec.ld", "RAM_EXEC", ram_exec, ram_exec_used, args.ram_exec)
+    regions += [("ITCM", itcm), ("RAM_EXEC", ram_exec)]
+
+    if args.verbose:
+        for region, keys in regions:
+            for key in keys:
+                print("%-12s %6.2f%% %6d  %s %s" % (region, 100 * weights[key] / len(args.profiles), sizes[key], *key))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Profile guided code placement")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("samples", help="make a profile from PC samples of the target")
+    p.add_argument("elf")
+    p.add_argument("samples", help="one hex PC per line")
+    p.add_argument("--map", help="map file of the ELF, the .map next to it by default")
+    p.add_argument("-o", "--output", required=True)
+    p.set_defaults(func=cmd_samples)
+
+    p = sub.add_parser("perf", help="make a profile from a perf report of a linux/ build")
+    p.add_argument("elf", help="firmware the sizes are taken from")
+    p.add_argument("report", help="output of perf report --stdio --no-children --sort sym")
+    p.add_argument("--map", help="map file of the ELF, the .map next to it by default")
+    p.add_argument("-o", "--output", required=True)
+    p.set_defaults(func=cmd_perf)
+
+    p = sub.add_parser("generate", help="write the linker placement lists")
+    p.add_argument("profiles", nargs="*")
+    p.add_argument("--itcm", type=int, default=0, help="bytes of resident ITCM for hot code")
+    p.add_argument("--itcm-emu", type=int, default=0, help="bytes of each emulator ITCM overlay for hot code")
+    p.add_argument("--ram-exec", type=int, default=0, help="bytes of RAM_EXEC for hot code")
+    p.add_argument("--outdir", required=True)
+    p.add_argument("-v", "--verbose", action="store_true")
+    p.set_defaults(func=cmd_generate)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,236 @@
+#!/usr/bin/env python3
+"""
+Applies IPS, UPS and BPS patches to a ROM.
+
+parse_roms.py calls it for the patches found next to a ROM, the patched
+ROM is what gets compressed and stored in the external flash:
+
+    roms/pce/Game.pce
+    roms/pce/Game.bps             .ips, .ups then .bps applied first
+    roms/pce/Game.patches/*.ips   then in the order of their names
+
+UPS and BPS patches hold the CRC32 of the source, of the target and of
+the patch itself, a patch made for another dump of the ROM is rejected
+instead of producing a broken game. IPS has no checksum, it is applied
+as is.
+
+    rom_patch.py Game.pce Game.bps -o Game_patched.pce
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+from pathlib import Path
+
+EXTENSIONS = (".ips", ".ups", ".bps")
+
+
+class PatchError(Exception):
+    pass
+
+
+def _crc32(data):
+    return zlib.crc32(data) & 0xFFFFFFFF
+
+
+def _check_footer(patch, source, target, name):
+    # source CRC, target CRC, patch CRC (of everything before it)
+    if len(patch) < 12:
+        raise PatchError("%s: truncated" % name)
+    source_crc, target_crc, patch_crc = struct.unpack("<III", patch[-12:])
+    if _crc32(patch[:-4]) != patch_crc:
+        raise PatchError("%s: corrupted patch file" % name)
+    if source is not None and _crc32(source) != source_crc:
+        raise PatchError("%s: made for another ROM (source CRC %08x, expected %08x)" % (name, _crc32(source), source_crc))
+    if target is not None and _crc32(target) != target_crc:
+        raise PatchError("%s: bad result (target CRC %08x, expected %08x)" % (name, _crc32(target), target_crc))
+
+
+class _Reader:
+    def __init__(self, data, end, name):
+        self.data = data
+        self.end = end
+        self.pos = 0
+        self.name = name
+
+    def bytes(self, count):
+        if self.pos + count > self.end:
+            raise PatchError("%s: truncated" % self.name)
+        value = self.data[self.pos : self.pos + count]
+        self.pos += count
+        return value
+
+    def byte(self):
+        return self.bytes(1)[0]
+
+    def number(self):
+        # UPS/BPS variable length encoding
+        value, shift = 0, 1
+        while True:
+            x = self.byte()
+            value += (x & 0x7F) * shift
+            if x & 0x80:
+                return value
+            shift <<= 7
+            value += shift
+
+
+def apply_ips(source, patch, name="ips"):
+    if patch[:5] != b"PATCH":
+        raise PatchError("%s: not an IPS patch" % name)
+
+    target = bytearray(source)
+    reader = _Reader(patch, len(patch), name)
+    reader.pos = 5
+
+    while True:
+        record = reader.bytes(3)
+        if record == b"EOF":
+            break
+        offset = int.from_bytes(record, "big")
+        size = int.from_bytes(reader.bytes(2), "big")
+        if size:
+            data = reader.bytes(size)
+        else:
+            # RLE record
+            size = int.from_bytes(reader.bytes(2), "big")
+            data = reader.bytes(1) * size
+        if offset + size > len(target):
+            target.extend(bytes(offset + size - len(target)))
+        target[offset : offset + size] = data
+
+    # Optional truncation, a lunar IPS extension
+    if reader.end - reader.pos == 3:
+        del target[int.from_bytes(reader.bytes(3), "big") :]
+
+    return bytes(target)
+
+
+def apply_ups(source, patch, name="ups"):
+    if patch[:4] != b"UPS1":
+        raise PatchError("%s: not an UPS patch" % name)
+    _check_footer(patch, source, None, name)
+
+    reader = _Reader(patch, len(patch) - 12, name)
+    reader.pos = 4
+    source_size = reader.number()
+    target_size = reader.number()
+    if len(source) != source_size:
+        raise PatchError("%s: made for a ROM of %d bytes, not %d" % (name, source_size, len(source)))
+
+    target = bytearray(source[:target_size].ljust(target_size, b"\0"))
+    offset = 0
+    while reader.pos < reader.end:
+        offset += reader.number()
+        # XOR until a zero byte
+        while True:
+            x = reader.byte()
+            if x == 0:
+                offset += 1
+                break
+            if offset < target_size:
+                target[offset] ^= x
+            offset += 1
+
+    target = bytes(target)
+    _check_footer(patch, None, target, name)
+    return target
+
+
+def apply_bps(source, patch, name="bps"):
+    if patch[:4] != b"BPS1":
+        raise PatchError("%s: not a BPS patch" % name)
+    _check_footer(patch, source, None, name)
+
+    reader = _Reader(patch, len(patch) - 12, name)
+    reader.pos = 4
+    source_size = reader.number()
+    target_size = reader.number()
+    reader.bytes(reader.number())  # Metadata
+    if len(source) != source_size:
+        raise PatchError("%s: made for a ROM of %d bytes, not %d" % (name, source_size, len(source)))
+
+    target = bytearray()
+    source_pos = 0
+    target_pos = 0
+    while reader.pos < reader.end:
+        command = reader.number()
+        action, length = command & 3, (command >> 2) + 1
+        if action == 0:    # SourceRead
+            target += source[len(target) : len(target) + length]
+        elif action == 1:  # TargetRead
+            target += reader.bytes(length)
+        else:
+            delta = reader.number()
+            delta = -(delta >> 1) if delta & 1 else delta >> 1
+            if action == 2:  # SourceCopy
+                source_pos += delta
+                if source_pos < 0 or source_pos + length > len(source):
+                    raise PatchError("%s: copy out of the source" % name)
+                target += source[source_pos : source_pos + length]
+                source_pos += length
+            else:            # TargetCopy, may overlap what it writes
+                target_pos += delta
+                if target_pos < 0 or target_pos >= len(target):
+                    raise PatchError("%s: copy out of the target" % name)
+                for _ in range(length):
+                    target.append(target[target_pos])
+                    target_pos += 1
+        if len(target) > target_size:
+            raise PatchError("%s: writes past the end of the ROM" % name)
+
+    if len(target) != target_size:
+        raise PatchError("%s: %d bytes written, %d expected" % (name, len(target), target_size))
+
+    target = bytes(target)
+    _check_footer(patch, None, target, name)
+    return target
+
+
+APPLY = {".ips": apply_ips, ".ups": apply_ups, ".bps": apply_bps}
+
+
+def apply(data, patch_path):
+    """`data` patched with the file at `patch_path`, raises PatchError."""
+    patch_path = Path(patch_path)
+    if patch_path.suffix.lower() not in APPLY:
+        raise PatchError("%s: unknown patch format" % patch_path.name)
+    return APPLY[patch_path.suffix.lower()](data, patch_path.read_bytes(), patch_path.name)
+
+
+def find_patches(folder, name):
+    """The patches of the ROM `name` in `folder`, in the order to apply them."""
+    folder = Path(folder)
+    patches = [folder / (name + e) for e in EXTENSIONS]
+    patches = [p for p in patches if p.is_file()]
+
+    patch_dir = folder / (name + ".patches")
+    if patch_dir.is_dir():
+        patches += sorted(p for p in patch_dir.iterdir() if p.is_file() and p.suffix.lower() in EXTENSIONS)
+
+    return patches
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Apply IPS, UPS and BPS patches to a ROM")
+    parser.add_argument("rom", type=Path)
+    parser.add_argument("patches", type=Path, nargs="+", help="applied in this order")
+    parser.add_argument("-o", "--output", type=Path, required=True)
+    args = parser.parse_args()
+
+    data = args.rom.read_bytes()
+    try:
+        for patch in args.patches:
+            data = apply(data, patch)
+            print("%s: applied" % patch.name)
+    except PatchError as e:
+        print("ERROR: %s" % e)
+        return 1
+
+    args.output.write_bytes(data)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,263 @@
+#!/usr/bin/env python3
+"""
+Identifies the ROMs at build time.
+
+parse_roms.py hashes every ROM once and looks it up in roms/romdb.dat, a
+DAT file in the XML format of the ROM managers (Logiqx) where a game can
+carry retro-go properties:
+
+    <game name="Populous (Japan)">
+        <rom name="Populous (Japan).pce" size="524288" crc="083c956a"/>
+        <feature name="flag" value="pce_onboard_ram"/>
+    </game>
+
+- flag: a ROM_FLAG_* of Core/Inc/porting/rom_flags.h, without the prefix;
+- region: ntsc or pal, instead of guessing it from the file name;
+- mapper: the mapper number of the emulator;
+- controls: the MSX controls profile;
+- save_size: bytes of flash reserved for the save state.
+
+MSX ROMs and disks are also looked up in the blueMSX database,
+roms/msx_bios/msxromdb.xml. The properties no database knows are detected
+from the ROM data, the way the emulators did when a game was started, so
+the emulators only read the result from the ROM entry.
+
+    romdb.py roms/pce/Game.pce
+    romdb.py roms/pce/Game.pce --c-defines
+"""
+
+import argparse
+import hashlib
+import sys
+import xml.etree.ElementTree as ET
+import zlib
+from pathlib import Path
+
+try:
+    from tools import findblueMsxMapper as msx
+except ImportError:
+    import findblueMsxMapper as msx
+
+ROOT = Path(__file__).resolve().parent.parent
+DAT = ROOT / "roms/romdb.dat"
+MSX_DB = ROOT / "roms/msx_bios/msxromdb.xml"
+
+# Core/Inc/porting/rom_flags.h
+FLAGS = {
+    "PCE_US_ENCODED": 1 << 0,
+    "PCE_TWO_PART_ROM": 1 << 1,
+    "PCE_ONBOARD_RAM": 1 << 2,
+}
+
+DEFAULT_CONTROLS = 0xFF
+
+
+class RomInfo:
+    def __init__(self, data=None):
+        self.crc32 = zlib.crc32(data) & 0xFFFFFFFF if data is not None else 0
+        self.sha1 = hashlib.sha1(data).hexdigest() if data is not None else ""
+        self.name = None                   # From a database
+        self.region = None                 # "ntsc" or "pal", None when unknown
+        self.mapper = 0
+        self.flags = set()                 # FLAGS keys
+        self.save_size = None              # None for the size of the system
+        self.controls = DEFAULT_CONTROLS   # MSX
+        self.ctrl_boot = 0                 # MSX, CTRL is pressed at boot
+        self.legacy_crc32 = 0              # PCE, see pce_rom.legacy_crc32()
+
+    @property
+    def game_config(self):
+        # b7-b0: controls profile, b8: CTRL pressed at boot
+        return self.controls + (self.ctrl_boot << 8)
+
+    @property
+    def c_flags(self):
+        if not self.flags:
+            return "0"
+        return " | ".join("ROM_FLAG_" + f for f in sorted(self.flags, key=FLAGS.get))
+
+
+def _number(value):
+    return int(value, 0)
+
+
+class RomDb:
+    def __init__(self, dat=DAT, msx_db=MSX_DB):
+        self.games = {}  # crc32 or sha1 -> <game>
+        self.msx_db = Path(msx_db)
+        self.msx = None  # sha1 -> (mapper, controls, ctrl), parsed when needed
+
+        if Path(dat).exists():
+            for game in ET.parse(dat).getroot().iter("game"):
+                for rom in game.iter("rom"):
+                    if rom.get("crc"):
+                        self.games.setdefault(int(rom.get("crc"), 16), game)
+                    if rom.get("sha1"):
+                        self.games.setdefault(rom.get("sha1").lower(), game)
+
+    def _msx_index(self):
+        # Same first match as findblueMsxMapper.py and findblueMsxControls.py
+        index = {}
+        if not self.msx_db.exists():
+            return index
+
+        for software in ET.parse(self.msx_db).getroot().iter("software"):
+            software_controls = software.find(".//controls")
+            software_ctrl = software.find(".//ctrl")
+            for dump in software.findall("dump"):
+                for kind in ("rom", "megarom", "disk"):
+                    for media in dump.findall(kind):
+                        sha1 = media.findtext("hash")
+                        if sha1 is None or sha1 in index:
+                            continue
+
+                        mapper = msx.ROM_UNKNOWN
+                        if kind == "rom":
+                            mapper = msx.ROM_PLAIN
+                            if media.findtext("type"):
+                                mapper = msx.getMapperValue(media.findtext("type"))
+                                start = media.findtext("start")
+                                if mapper == msx.ROM_STANDARD and start:
+                                    mapper = {"0x4000": msx.ROM_0x4000, "0x8000": msx.ROM_BASIC,
+                                              "0xC000": msx.ROM_0xC000}.get(start, mapper)
+                        elif kind == "megarom":
+                            mapper = msx.getMapperValue(media.findtext("type"))
+
+                        controls = media.find("controls")
+                        if controls is None:
+                            controls = software_controls
+                        ctrl = None
+                        if kind == "disk":
+                            ctrl = media.find("ctrl")
+                            if ctrl is None:
+                                ctrl = software_ctrl
+                        index[sha1] = (
+                            mapper,
+                            int(controls.text) if controls is not None else DEFAULT_CONTROLS,
+                            int(ctrl.text) if ctrl is not None else 0,
+                        )
+        return index
+
+    def _apply_game(self, info, game):
+        info.name = game.get("name")
+        for feature in game.iter("feature"):
+            name, value = feature.get("name"), feature.get("value", "")
+            if name == "flag":
+                if value.upper() not in FLAGS:
+                    raise ValueError("%s: unknown flag %s" % (info.name, value))
+                info.flags.add(value.upper())
+            elif name == "region":
+                if value not in ("ntsc", "pal"):
+                    raise ValueError("%s: unknown region %s" % (info.name, value))
+                info.region = value
+            elif name == "mapper":
+                info.mapper = _number(value)
+            elif name == "controls":
+                info.controls = _number(value)
+            elif name == "save_size":
+                info.save_size = _number(value)
+
+    def identify(self, folder, data, disk=False):
+        """RomInfo of the ROM `data` of the roms/`folder` directory."""
+        info = RomInfo(data)
+
+        # The DAT files list the ROMs without their copier header
+        game = self.games.get(info.crc32) or self.games.get(info.sha1)
+        if game is None and len(data) % 1024 == 512:
+            headerless = data[512:]
+            game = self.games.get(zlib.crc32(headerless) & 0xFFFFFFFF)
+            game = game or self.games.get(hashlib.sha1(headerless).hexdigest())
+
+        if folder == "msx":
+            if self.msx is None:
+                self.msx = self._msx_index()
+            info.mapper, info.controls, info.ctrl_boot = self.msx.get(
+                info.sha1, (msx.ROM_UNKNOWN, DEFAULT_CONTROLS, 0)
+            )
+        if game is not None:
+            self._apply_game(info, game)
+
+        if folder == "msx":
+            if info.mapper == msx.ROM_UNKNOWN and not disk:
+                info.mapper = guess_msx_mapper(data)
+        elif folder == "pce":
+            # The reset vector of a US HuCard reads backwards
+            offset = len(data) & 0x1FFF
+            if len(data) > offset + 0x1FFF and data[offset + 0x1FFF] < 0xE0:
+                info.flags.add("PCE_US_ENCODED")
+
+        return info
+
+
+def guess_msx_mapper(data):
+    """The MegaROM mapper of an MSX ROM, GuessROM() of blueMSX."""
+    size = len(data)
+
+    if size <= 0x10000:
+        if size == 0x10000:
+            return msx.ROM_PLAIN if data[0x4000:0x4002] == b"AB" else msx.ROM_ASCII16
+        if size <= 0x4000 and data[0:2] == b"AB":
+            text = data[8] + 256 * data[9]
+            if (text & 0xC000) == 0x8000:
+                return msx.ROM_BASIC
+        return msx.ROM_PLAIN
+
+    # Count the writes (ld (nn),a) to the bank switching addresses
+    counters = [0] * 6
+    hits = {
+        0x4000: (3,), 0x8000: (3,), 0xA000: (3,),
+        0x5000: (2,), 0x9000: (2,), 0xB000: (2,),
+        0x6000: (3, 4, 5),
+        0x6800: (4,), 0x7800: (4,),
+        0x7000: (2, 4, 5),
+        0x77FF: (5,),
+    }
+    pos = data.find(0x32, 0, size - 3)
+    while pos >= 0:
+        for i in hits.get(data[pos + 1] + (data[pos + 2] << 8), ()):
+            counters[i] += 1
+        pos = data.find(0x32, pos + 1, size - 3)
+
+    mapper = 0
+    counters[4] -= 1 if counters[4] else 0
+    for i in range(6):
+        if counters[i] > 0 and counters[i] >= counters[mapper]:
+            mapper = i
+    if mapper == 5 and counters[0] == counters[5]:
+        mapper = 0
+
+    return [msx.ROM_STANDARD, msx.ROM_MSXDOS2, msx.ROM_KONAMI5,
+            msx.ROM_KONAMI4, msx.ROM_ASCII8, msx.ROM_ASCII16][mapper]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Identify a ROM like parse_roms.py does")
+    parser.add_argument("rom", type=Path)
+    parser.add_argument("--folder", help="roms/ directory of the ROM, default from the extension")
+    parser.add_argument("--c-defines", action="store_true", help="print ROM_CRC32 and ROM_FLAGS for the linux/ builds")
+    args = parser.parse_args()
+
+    folder = args.folder or args.rom.suffix[1:].lower()
+    disk = args.rom.suffix.lower() == ".dsk"
+    info = RomDb().identify(folder, args.rom.read_bytes(), disk=disk)
+
+    if args.c_defines:
+        print('#include "rom_flags.h"')
+        print("const uint32_t ROM_CRC32 = 0x%08x;" % info.crc32)
+        print("const uint16_t ROM_FLAGS = %s;" % info.c_flags)
+        return 0
+
+    print("name:     %s" % (info.name or "unknown"))
+    print("crc32:    %08x" % info.crc32)
+    print("sha1:     %s" % info.sha1)
+    print("region:   %s" % (info.region or "from the file name"))
+    print("mapper:   %d" % info.mapper)
+    print("flags:    %s" % info.c_flags)
+    print("config:   0x%x" % info.game_config)
+    if info.save_size is not None:
+        print("save:     %d" % info.save_size)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
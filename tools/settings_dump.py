@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+"""
+Decodes a dump of the two settings journal banks (see
+Core/Inc/porting/settings_journal.h) into the settings they hold.
+
+The keys, names and scopes come from the tables of
+Core/Inc/porting/odroid_settings_schema.h, the journal is replayed the same
+way as settings_journal_load() does on the device.
+
+    settings_dump.py config.bin
+    settings_dump.py extflash.bin --offset 0x... --offset 0x...
+
+make dump_settings reads the area from the device with openocd.
+"""
+
+import argparse
+import re
+import struct
+import sys
+import zlib
+from pathlib import Path
+
+SCHEMA = Path(__file__).resolve().parent.parent / "Core/Inc/porting/odroid_settings_schema.h"
+
+BANKS = 2
+BANK_SIZE = 4096
+HEADER_SIZE = 16
+JOURNAL_MAGIC = 0x4C4E4A53
+RECORD_END = 0xFFFFFFFF
+
+BANK_HEADER = struct.Struct("<IIHBBI")
+RECORD_HEADER = struct.Struct("<II")
+RANGE_HEADER = struct.Struct("<HH")
+ENTRY = struct.Struct("<HBBIi")
+
+APPS = ["launcher", "gb", "nes", "sms", "pce", "gw", "msx", "wsv", "md", "a7800", "amstrad"]
+
+
+def align4(x):
+    return (x + 3) & ~3
+
+
+def parse_schema(path):
+    """Returns the image version and entry count, and {key: (name, scope, type)}."""
+    text = path.read_text()
+    defines = dict(re.findall(r"#define (ODROID_SETTINGS_IMAGE_\w+)\s+(\d+)", text))
+    settings = {}
+
+    for scope in ("GLOBAL", "APP", "ROM"):
+        table = re.search(r"#define ODROID_SETTINGS_%s\(X\)((?:.*\\\n)*.*)" % scope, text)
+        for key, name, ctype in re.findall(r"X\(\s*(\d+),\s*(\w+),\s*([^,]+),", table.group(1)):
+            settings[int(key)] = (name, scope, ctype.strip())
+
+    return int(defines["ODROID_SETTINGS_IMAGE_VERSION"]), int(defines["ODROID_SETTINGS_IMAGE_ENTRIES"]), settings
+
+
+def bank_header(bank, size, version):
+    magic, sequence, bank_size, bank_version, _, crc = BANK_HEADER.unpack_from(bank)
+    if magic != JOURNAL_MAGIC:
+        return None, "empty"
+    if bank_version != version or bank_size != size:
+        return None, "version %d, %d bytes" % (bank_version, bank_size)
+    if crc != zlib.crc32(bank[HEADER_SIZE : HEADER_SIZE + size]):
+        return None, "bad snapshot crc"
+    return sequence, "sequence %d" % sequence
+
+
+def replay(bank, size):
+    """Snapshot of the bank with its records applied."""
+    image = bytearray(bank[HEADER_SIZE : HEADER_SIZE + size])
+    pos = HEADER_SIZE + align4(size)
+    records = 0
+
+    while pos + RECORD_HEADER.size <= BANK_SIZE:
+        length, crc = RECORD_HEADER.unpack_from(bank, pos)
+        if length == RECORD_END:
+            break
+        data = bank[pos + RECORD_HEADER.size : pos + RECORD_HEADER.size + length]
+        if length > BANK_SIZE - pos - RECORD_HEADER.size or crc != zlib.crc32(data):
+            print("  torn record at 0x%03x, dropped with what follows" % pos)
+            break
+
+        ranges = []
+        i = 0
+        while i + RANGE_HEADER.size <= length:
+            offset, count = RANGE_HEADER.unpack_from(data, i)
+            i += RANGE_HEADER.size
+            ranges.append((offset, data[i : i + count]))
+            i += align4(count)
+        if i != length or any(offset + len(chunk) > size for offset, chunk in ranges):
+            print("  bad record at 0x%03x, dropped with what follows" % pos)
+            break
+
+        for offset, chunk in ranges:
+            image[offset : offset + len(chunk)] = chunk
+        records += 1
+        pos += RECORD_HEADER.size + length
+
+    print("  %d records, %d bytes free" % (records, BANK_SIZE - pos))
+    return bytes(image)
+
+
+def print_settings(image, entries, settings):
+    rows = {"GLOBAL": [], "APP": [], "ROM": []}
+
+    for i in range(entries):
+        key, app, _, rom, value = ENTRY.unpack_from(image, i * ENTRY.size)
+        if key == 0:
+            continue
+        if key not in settings:
+            print("unknown key %d: %d" % (key, value))
+            continue
+        name, scope, ctype = settings[key]
+        if ctype in ("void *", "uint32_t"):
+            value = "0x%08x" % (value & 0xFFFFFFFF)
+        if scope == "APP":
+            name = "%s.%s" % (APPS[app] if app < len(APPS) else app, name)
+        elif scope == "ROM":
+            name = "%08x.%s" % (rom, name)
+            if app:
+                name += "[%d]" % app  # Of a setting with several values
+        rows[scope].append((name, value))
+
+    for scope, values in rows.items():
+        print("%s:" % scope.lower())
+        for name, value in sorted(values):
+            print("  %-28s %s" % (name, value))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a dump of the settings journal")
+    parser.add_argument("dump", help="dump of the banks")
+    parser.add_argument("--offset", type=lambda x: int(x, 0), action="append",
+                        help="of each bank in the dump, one after the other by default")
+    parser.add_argument("--schema", type=Path, default=SCHEMA)
+    args = parser.parse_args()
+
+    version, entries, settings = parse_schema(args.schema)
+    size = entries * ENTRY.size
+    offsets = args.offset or [i * BANK_SIZE for i in range(BANKS)]
+    if len(offsets) != BANKS:
+        print("One offset per bank is needed")
+        return 1
+    dump = Path(args.dump).read_bytes()
+    banks = [dump[offset : offset + BANK_SIZE] for offset in offsets]
+    if any(len(bank) < BANK_SIZE for bank in banks):
+        print("The dump is shorter than the %d banks" % BANKS)
+        return 1
+
+    best = None
+    for i in range(BANKS):
+        sequence, state = bank_header(banks[i], size, version)
+        print("bank %d: %s" % (i, state))
+        if sequence is not None and (best is None or 0 < ((sequence - best[1]) & 0xFFFFFFFF) < 0x80000000):
+            best = (i, sequence)
+
+    if best is None:
+        print("No bank holds version %d settings" % version)
+        return 1
+
+    print("bank %d is active" % best[0])
+    print_settings(replay(banks[best[0]], size), entries, settings)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
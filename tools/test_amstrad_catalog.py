@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""
+Tests of amstrad_catalog.py on synthetic .dsk images: AMSDOS data and
+system disks, hidden files, the choice of the file to run and the CP/M
+fallback when a disk has no file to run.
+
+    python3 -m unittest discover -s tools -p "test_*.py"
+"""
+
+import struct
+import sys
+import unittest
+from pathlib import Path
+
+sys.path.insert(0, str(Path(__file__).resolve().parent))
+
+import amstrad_catalog  # noqa: E402
+
+SECTOR_SIZE = 512
+SECTORS = 9
+TRACKS = 3
+
+
+def dir_entry(name, ext, user=0, hidden=False, extent=0, records=0x80):
+    """32 bytes directory entry, the hidden (system) flag is bit 7 of the second byte of the extension"""
+    raw_ext = bytearray(ext.ljust(3).encode("ascii"))
+    if hidden:
+        raw_ext[1] |= 0x80
+    return (bytes([user]) + name.ljust(8).encode("ascii") + bytes(raw_ext)
+            + bytes([extent, 0, 0, records]) + bytes(range(2, 18)))
+
+
+def make_dsk(first_id, entries=(), extended=False):
+    """TRACKS tracks of SECTORS sectors with ids first_id + 1..., the directory in the first sectors of track 0"""
+    directory = b"".join(entries).ljust(4 * SECTOR_SIZE, b"\xE5")
+    track_size = 0x100 + SECTORS * SECTOR_SIZE
+
+    if extended:
+        header = bytearray(b"EXTENDED CPC DSK File\r\nDisk-Info\r\n".ljust(0x100, b"\0"))
+        header[0x34:0x34 + TRACKS] = bytes([track_size >> 8] * TRACKS)
+    else:
+        header = bytearray(b"MV - CPCEMU Disk-File\r\nDisk-Info\r\n".ljust(0x100, b"\0"))
+        header[0x32:0x34] = struct.pack("<H", track_size)
+    header[0x30] = TRACKS
+    header[0x31] = 1
+
+    data = bytes(header)
+    for track in range(TRACKS):
+        info = bytearray(b"Track-Info\r\n".ljust(0x100, b"\0"))
+        info[0x10] = track
+        info[0x14] = 2  # 512 bytes
+        info[0x15] = SECTORS
+        for i in range(SECTORS):
+            info[0x18 + i * 8:0x20 + i * 8] = struct.pack("<BBBBBBH", track, 0, first_id + 1 + i, 2, 0, 0, SECTOR_SIZE)
+        sectors = directory if track == 0 else b""
+        data += bytes(info) + sectors.ljust(SECTORS * SECTOR_SIZE, b"\xE5")
+    return data
+
+
+def catalog(data):
+    disk = amstrad_catalog.Disk(data)
+    fmt = amstrad_catalog.format_get(disk)
+    catalogue = amstrad_catalog.catalog_probe(disk)
+    return fmt, catalogue, amstrad_catalog.autorun_command(catalogue, fmt)
+
+
+class AmsdosTest(unittest.TestCase):
+    def test_single_file(self):
+        for extended in (False, True):
+            fmt, catalogue, command = catalog(make_dsk(0xC0, [dir_entry("GAME", "BAS")], extended))
+            self.assertEqual(fmt[6], amstrad_catalog.FORMAT_TYPE_AMSDOS_DATA)
+            self.assertEqual(catalogue.dirent, [("GAME.BAS", False)])
+            self.assertEqual(command, 'RUN"GAME.BAS')
+
+    def test_extents_listed_once(self):
+        entries = [dir_entry("INTRO", "BAS"), dir_entry("MAIN", "BIN"), dir_entry("MAIN", "BIN", extent=1)]
+        _, catalogue, command = catalog(make_dsk(0xC0, entries))
+        self.assertEqual(catalogue.dirent, [("INTRO.BAS", False), ("MAIN.BIN", False)])
+        # Several files on the catalogue track, the first BASIC one
+        self.assertEqual(command, 'RUN"INTRO.BAS')
+
+    def test_other_users_and_extensions_ignored(self):
+        entries = [dir_entry("OTHER", "BAS", user=1), dir_entry("NOTES", "TXT"), dir_entry("GAME", "BIN")]
+        _, catalogue, command = catalog(make_dsk(0xC0, entries))
+        self.assertEqual(catalogue.dirent, [("GAME.BIN", False)])
+        self.assertEqual(command, 'RUN"GAME.BIN')
+
+    def test_no_file(self):
+        _, catalogue, command = catalog(make_dsk(0xC0, [dir_entry("NOTES", "TXT")]))
+        self.assertEqual(catalogue.dirent, [])
+        self.assertEqual(command, "CAT")
+
+    def test_metadata_block(self):
+        block = amstrad_catalog.metadata_block(make_dsk(0xC0, [dir_entry("GAME", "BAS")]))
+        self.assertEqual(block[-4:], amstrad_catalog.META_MAGIC)
+        self.assertEqual(struct.unpack("<I", block[-8:-4])[0], len(block))
+        self.assertEqual(block[0], amstrad_catalog.META_VERSION)
+        self.assertEqual(block[8], 1)  # Entries
+        command = block[16:16 + amstrad_catalog.META_COMMAND_SIZE]
+        self.assertEqual(command.rstrip(b"\0"), b'RUN"GAME.BAS')
+
+
+class HiddenTest(unittest.TestCase):
+    def test_single_hidden_file(self):
+        _, catalogue, command = catalog(make_dsk(0xC0, [dir_entry("LOADER", "BIN", hidden=True)]))
+        self.assertEqual(catalogue.dirent, [("LOADER.BIN", True)])
+        self.assertEqual((catalogue.entries_listed_found, catalogue.entries_hidden_found), (0, 1))
+        self.assertEqual(command, 'RUN"LOADER.BIN')
+
+    def test_listed_file_before_hidden_one(self):
+        entries = [dir_entry("LOADER", "BIN", hidden=True), dir_entry("GAME", "BAS")]
+        _, catalogue, command = catalog(make_dsk(0xC0, entries))
+        self.assertEqual(catalogue.first_listed_dirent, 1)
+        self.assertEqual(command, 'RUN"GAME.BAS')
+
+    def test_disc_name_first(self):
+        entries = [dir_entry("INTRO", "BAS"), dir_entry("MAIN", "BIN"), dir_entry("DISC", "BIN", hidden=True)]
+        _, catalogue, command = catalog(make_dsk(0xC0, entries))
+        self.assertEqual(catalogue.dirent[2], ("DISC.BIN", True))
+        self.assertEqual(command, 'RUN"DISC.BIN')
+
+
+class CpmTest(unittest.TestCase):
+    def test_empty_system_disk(self):
+        fmt, catalogue, command = catalog(make_dsk(0x40))
+        self.assertEqual(fmt[6], amstrad_catalog.FORMAT_TYPE_AMSDOS_SYSTEM)
+        self.assertTrue(catalogue.probe_cpm)
+        self.assertEqual(command, "|CPM")
+
+        block = amstrad_catalog.metadata_block(make_dsk(0x40))
+        self.assertTrue(block[7] & amstrad_catalog.META_FLAG_PROBE_CPM)
+
+    def test_system_disk_with_files(self):
+        entries = [dir_entry("INTRO", "BIN", hidden=True), dir_entry("DATA", "BIN", hidden=True)]
+        fmt, catalogue, command = catalog(make_dsk(0x40, entries))
+        self.assertEqual(len(catalogue.dirent), 2)
+        # Not on the catalogue track of the format, CP/M is started
+        self.assertNotEqual(catalogue.track_hidden_id, fmt[5])
+        self.assertEqual(command, "|CPM")
+
+    def test_system_disk_with_one_file(self):
+        _, _, command = catalog(make_dsk(0x40, [dir_entry("GAME", "BAS")]))
+        self.assertEqual(command, 'RUN"GAME.BAS')
+
+
+if __name__ == "__main__":
+    unittest.main()